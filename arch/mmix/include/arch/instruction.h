@@ -51,7 +51,7 @@ enum insn_flag_type {
 struct insn {
 	uint8_t			type;		/* see enum insn_type */
 	uint8_t			flags;		/* see enum insn_flag_type */
-	uint16_t		bc_offset;
+	uint32_t		bc_offset;
 	unsigned long		lir_pos;	/* offset in LIR */
 	unsigned long		mach_offset;	/* offset in machine code */
 	struct list_head	insn_list_node;
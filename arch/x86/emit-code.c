@@ -39,11 +39,13 @@
 
 #include "jit/compilation-unit.h"
 #include "jit/basic-block.h"
+#include "jit/cha.h"
 #include "jit/stack-slot.h"
 #include "jit/statement.h"
 #include "jit/compiler.h"
 #include "jit/exception.h"
 #include "jit/emit-code.h"
+#include "jit/inline-cache.h"
 #include "jit/text.h"
 
 #include "lib/buffer.h"
@@ -52,6 +54,9 @@
 #include "vm/backtrace.h"
 #include "vm/method.h"
 #include "vm/object.h"
+#include "vm/class.h"
+#include "vm/heap.h"
+#include "vm/gc.h"
 
 #include <stdbool.h>
 #include <assert.h>
@@ -394,6 +399,15 @@ void backpatch_branch_target(struct buffer *buf,
 	write_imm32(buf, backpatch_offset, relative_addr);
 }
 
+static void fixup_branch_target(uint8_t *target_p, void *target)
+{
+	long cur = (long) (target - (void *) target_p) - 4;
+	target_p[3] = cur >> 24;
+	target_p[2] = cur >> 16;
+	target_p[1] = cur >> 8;
+	target_p[0] = cur;
+}
+
 static void __emit_jmp(struct buffer *buf, unsigned long addr)
 {
 	unsigned long current = (unsigned long)buffer_current(buf);
@@ -408,6 +422,35 @@ void emit_unwind(struct buffer *buf)
 	__emit_jmp(buf, (unsigned long)&unwind);
 }
 
+/*
+ * Emits an indirect jump through @target which initially points right past
+ * the jump. See jit_recompile_method().
+ */
+void emit_tier_entry(struct buffer *buf, void **target)
+{
+	emit(buf, 0xff);
+	emit(buf, 0x24);
+	emit(buf, 0x25);
+	emit_imm32(buf, (unsigned long) target);
+
+	*target = buffer_current(buf);
+}
+
+static void emit_add_imm_memdisp(struct insn *insn, struct buffer *buf, struct basic_block *bb)
+{
+	long imm = insn->src.imm;
+
+	if (is_imm_8(imm))
+		emit(buf, 0x83);
+	else
+		emit(buf, 0x81);
+
+	emit(buf, 0x04);
+	emit(buf, 0x25);
+	emit_imm32(buf, insn->dest.disp);
+	emit_imm(buf, imm);
+}
+
 void emit_trace_invoke(struct buffer *buf, struct compilation_unit *cu)
 {
 	__emit_push_imm(buf, (unsigned long) cu);
@@ -576,7 +619,6 @@ static void emit_mov_imm_membase(struct insn *insn, struct buffer *buf, struct b
 
 static void __emit_mov_imm_membase(struct buffer *buf, long imm,
 				   enum machine_reg base, long disp);
-
 static void
 __emit_reg_reg(struct buffer *buf, unsigned char opc,
 	       enum machine_reg direct_reg, enum machine_reg rm_reg)
@@ -989,6 +1031,13 @@ static void emit_sbb_reg_reg(struct insn *insn, struct buffer *buf, struct basic
 	emit_reg_reg(buf, 0x19, &insn->src, &insn->dest);
 }
 
+static void __emit_test_imm_reg(struct buffer *buf, long imm, enum machine_reg reg)
+{
+	emit(buf, 0xf7);
+	emit(buf, encode_modrm(0x03, 0x00, encode_mach_reg(reg)));
+	emit_imm32(buf, imm);
+}
+
 static void __emit_test_imm_memdisp(struct buffer *buf,
 	long imm, long disp)
 {
@@ -1631,17 +1680,723 @@ static void emit_jmp_membase(struct insn *insn, struct buffer *buf, struct basic
 	__emit_membase(buf, 0xff, mach_reg(&insn->operand.base_reg), insn->operand.disp, 0x04);
 }
 
+static uint8_t *__emit_jcc_placeholder(struct buffer *buf, unsigned char opc)
+{
+	uint8_t *addr;
+
+	/* open-coded "jcc" */
+	emit(buf, 0x0f);
+	emit(buf, opc);
+
+	addr = buffer_current(buf);
+	emit_imm32(buf, 0);
+
+	return addr;
+}
+
+static uint8_t *__emit_ja_placeholder(struct buffer *buf)
+{
+	return __emit_jcc_placeholder(buf, 0x87);
+}
+
+/*
+ * Bumps the TLAB top pointer by the chunk size in %ecx and initializes the
+ * chunk header and the class of the new object. Jumps to @slow_path if the
+ * TLAB is exhausted. On success the object is returned in %eax.
+ */
+static void emit_tlab_bump(struct buffer *buf, struct vm_class *vmc,
+			   uint8_t **slow_path)
+{
+	unsigned long top_offset, end_offset;
+
+	top_offset = get_thread_local_offset(&current_tlab.top);
+	end_offset = get_thread_local_offset(&current_tlab.end);
+
+	/* mov gs:(top), %eax */
+	emit(buf, 0x65);
+	__emit_memdisp_reg(buf, 0x8b, top_offset, MACH_REG_EAX);
+
+	/* lea (%eax, %ecx), %edx */
+	emit(buf, 0x8d);
+	emit(buf, encode_modrm(0x00, encode_mach_reg(MACH_REG_EDX), 0x04));
+	emit(buf, encode_sib(0x00, encode_mach_reg(MACH_REG_ECX), encode_mach_reg(MACH_REG_EAX)));
+
+	/* cmp gs:(end), %edx */
+	emit(buf, 0x65);
+	__emit_memdisp_reg(buf, 0x3b, end_offset, MACH_REG_EDX);
+	*slow_path = __emit_ja_placeholder(buf);
+
+	/* mov %edx, gs:(top) */
+	emit(buf, 0x65);
+	__emit_reg_memdisp(buf, 0x89, MACH_REG_EDX, top_offset);
+
+	/* or heap_alloc_bits, %ecx */
+	if (gc_concurrent_mark)
+		__emit_memdisp_reg(buf, 0x0b, (unsigned long) &heap_alloc_bits, MACH_REG_ECX);
+
+	__emit_mov_reg_membase(buf, MACH_REG_ECX, MACH_REG_EAX, 0);
+	__emit_add_imm_reg(buf, sizeof(struct heap_header), MACH_REG_EAX);
+	__emit_mov_imm_membase(buf, (unsigned long) vmc, MACH_REG_EAX,
+			       offsetof(struct vm_object, class));
+}
+
+/*
+ * Allocates an instance of an initialized class from the thread-local
+ * allocation buffer. The memory is already zeroed so only the header and
+ * the class pointer need to be set. When the buffer is exhausted we fall
+ * back to vm_object_alloc() whose argument has been pushed by the
+ * instruction selector. The instruction clobbers the caller saved registers
+ * like a call.
+ */
+static void emit_tlab_alloc(struct insn *insn, struct buffer *buf, struct basic_block *bb)
+{
+	struct vm_class *vmc = (void *) insn->operand.imm;
+	uint8_t *slow_path, *done;
+	unsigned long size;
+
+	size = heap_alloc_size(sizeof(struct vm_object) + vmc->object_size);
+
+	__emit_mov_imm_reg(buf, size, MACH_REG_ECX);
+	emit_tlab_bump(buf, vmc, &slow_path);
+
+	/* open-coded "jmp" */
+	emit(buf, 0xe9);
+	done = buffer_current(buf);
+	emit_imm32(buf, 0);
+
+	fixup_branch_target(slow_path, buffer_current(buf));
+	__emit_call(buf, vm_object_alloc);
+
+	fixup_branch_target(done, buffer_current(buf));
+}
+
+/*
+ * Same as above for primitive arrays. The array type and the element count
+ * are on top of the stack as arguments for
+ * vm_object_alloc_primitive_array(). Arrays which do not fit in a TLAB
+ * always take the slow path which also rules out overflows in the size
+ * computation.
+ */
+static void emit_tlab_alloc_array(struct insn *insn, struct buffer *buf, struct basic_block *bb)
+{
+	struct vm_class *vmc = (void *) insn->operand.imm;
+	uint8_t *slow_path, *too_big, *done;
+	unsigned int elem_size;
+
+	elem_size = get_vmtype_size(vm_class_get_storage_vmtype(vm_class_get_array_element_class(vmc)));
+
+	/* mov 4(%esp), %ecx */
+	__emit_membase_reg(buf, 0x8b, MACH_REG_ESP, sizeof(unsigned long), MACH_REG_ECX);
+
+	__emit_cmp_imm_reg(buf, HEAP_TLAB_SIZE / elem_size, MACH_REG_ECX);
+	too_big = __emit_ja_placeholder(buf);
+
+	/* shl $log2(elem_size), %ecx */
+	if (elem_size > 1) {
+		emit(buf, 0xc1);
+		emit(buf, encode_modrm(0x03, 0x04, encode_mach_reg(MACH_REG_ECX)));
+		emit(buf, __builtin_ctz(elem_size));
+	}
+
+	/* round up to the chunk size like heap_alloc_size() */
+	__emit_add_imm_reg(buf, sizeof(struct vm_object) + sizeof(struct heap_header) + HEAP_ALIGN - 1, MACH_REG_ECX);
+	emit_alu_imm_reg(buf, 0x04, ~(HEAP_ALIGN - 1), MACH_REG_ECX);
+
+	emit_tlab_bump(buf, vmc, &slow_path);
+
+	/* mov 4(%esp), %ecx; mov %ecx, array_length(%eax) */
+	__emit_membase_reg(buf, 0x8b, MACH_REG_ESP, sizeof(unsigned long), MACH_REG_ECX);
+	__emit_mov_reg_membase(buf, MACH_REG_ECX, MACH_REG_EAX,
+			       offsetof(struct vm_object, array_length));
+
+	/* open-coded "jmp" */
+	emit(buf, 0xe9);
+	done = buffer_current(buf);
+	emit_imm32(buf, 0);
+
+	fixup_branch_target(too_big, buffer_current(buf));
+	fixup_branch_target(slow_path, buffer_current(buf));
+	__emit_call(buf, vm_object_alloc_primitive_array);
+
+	fixup_branch_target(done, buffer_current(buf));
+}
+
+/*
+ * Layout of an inline cached call site. The site starts at 2 mod 4 so that
+ * the patched 32-bit fields at 2 mod 4 offsets are naturally aligned and
+ * other CPUs never see a torn update:
+ *
+ *	 0: cmp $class, %reg		81 /7 id
+ *	 6: jne slow			75 08
+ *	 8: nop
+ *	 9: call target			e8 rel32
+ *	14: jmp done			eb 0a
+ *	16: mov $ic, %eax		b8 id
+ *	21: call slow_path_target	e8 rel32
+ *	26: done:
+ *
+ * The class field starts out as zero which never matches, so the direct call
+ * target can be patched before the class is.
+ */
+#define IC_SITE_CLASS_OFFSET	2
+#define IC_SITE_TARGET_OFFSET	10
+#define IC_SITE_SLOW_OFFSET	22
+
+/*
+ * Layout of a PIC stub. The stub is jumped to with the return address on
+ * top of the stack and the receiver right above it. Unused entries have a
+ * zero class. The stub starts at an aligned address and the padding keeps
+ * the class and target fields of every entry naturally aligned.
+ *
+ *	 0: mov 4(%esp), %eax		8b 44 24 04
+ *	 4: mov class(%eax), %eax	8b 40 disp8
+ *	 7: cmp $class, %eax		3d id		(entry 0)
+ *	12: nop; nop
+ *	14: je target			0f 84 rel32
+ *	20: nop; nop; nop
+ *	23: ...				(entries 1..n)
+ *	    mov $ic, %eax
+ *	    jmp inline_cache_miss_trampoline
+ *	    megamorphic_entry: vtable or itable dispatch
+ */
+#define IC_STUB_ENTRY_OFFSET	7
+#define IC_STUB_ENTRY_SIZE	16
+#define IC_STUB_CLASS_OFFSET	1
+#define IC_STUB_TARGET_OFFSET	9
+
+static void patch_rel32(void *field, void *target)
+{
+	cpu_write_u32(field, (unsigned long) target - ((unsigned long) field + 4));
+}
+
+static void emit_ic_call(struct insn *insn, struct buffer *buf, struct basic_block *bb)
+{
+	struct inline_cache *ic = (void *) insn->src.imm;
+	enum machine_reg reg = mach_reg(&insn->dest.reg);
+
+	/* Align the class field of the cmp below. */
+	while (((unsigned long) buffer_current(buf) + IC_SITE_CLASS_OFFSET) % 4)
+		emit(buf, 0x90);
+
+	ic->site = buffer_current(buf);
+
+	emit(buf, 0x81);
+	emit(buf, encode_modrm(0x03, 0x07, encode_mach_reg(reg)));
+	emit_imm32(buf, 0);
+
+	emit(buf, 0x75);
+	emit(buf, 0x08);
+	emit(buf, 0x90);
+
+	assert(buffer_current(buf) + 1 == ic->site + IC_SITE_TARGET_OFFSET);
+	__emit_call(buf, inline_cache_miss_trampoline);
+
+	emit(buf, 0xeb);
+	emit(buf, 0x0a);
+
+	__emit_mov_imm_reg(buf, (unsigned long) ic, MACH_REG_EAX);
+	__emit_call(buf, inline_cache_miss_trampoline);
+
+	assert(buffer_current(buf) == ic->site + IC_SITE_SLOW_OFFSET + 4);
+}
+
+void inline_cache_patch_monomorphic(struct inline_cache *ic,
+				    struct vm_class *vmc, void *target)
+{
+	patch_rel32(ic->site + IC_SITE_TARGET_OFFSET, target);
+	cpu_write_u32(ic->site + IC_SITE_CLASS_OFFSET, (unsigned long) vmc);
+}
+
+void inline_cache_patch_slow_path(struct inline_cache *ic, void *target)
+{
+	patch_rel32(ic->site + IC_SITE_SLOW_OFFSET, target);
+}
+
+/*
+ * Emits a jump to the implementation of @i_method in the class in %eax. The
+ * sorted itable is scanned like vm_itable_lookup() does. A receiver which
+ * does not implement the interface ends up in itable_resolver_stub_error().
+ */
+static void emit_itable_jump(struct buffer *buf, struct vm_method *i_method)
+{
+	unsigned long interface_id = i_method->class->interface_id;
+	unsigned char *no_itable, *found, *not_found;
+	unsigned char *scan;
+
+	/* mov itable.table(%eax), %ecx */
+	__emit_membase_reg(buf, 0x8b, MACH_REG_EAX, offsetof(struct vm_class, itable.table), MACH_REG_ECX);
+
+	/* test %ecx, %ecx; je error */
+	emit(buf, 0x85);
+	emit(buf, encode_modrm(0x03, encode_mach_reg(MACH_REG_ECX), encode_mach_reg(MACH_REG_ECX)));
+	no_itable = __emit_jcc_placeholder(buf, 0x84);
+
+	/* cmpl $id, interface_id(%ecx); jae found */
+	scan = buffer_current(buf);
+	__emit_membase(buf, 0x81, MACH_REG_ECX, offsetof(struct vm_itable_entry, interface_id), 0x07);
+	emit_imm32(buf, interface_id);
+	found = __emit_jcc_placeholder(buf, 0x83);
+
+	/* add $size, %ecx; jmp scan */
+	__emit_add_imm_reg(buf, sizeof(struct vm_itable_entry), MACH_REG_ECX);
+	__emit_jmp(buf, (unsigned long) scan);
+
+	/* The table is terminated by ITABLE_END so the scan always stops. */
+	fixup_branch_target(found, buffer_current(buf));
+	not_found = __emit_jcc_placeholder(buf, 0x85);
+
+	__emit_membase_reg(buf, 0x8b, MACH_REG_ECX, offsetof(struct vm_itable_entry, entries), MACH_REG_ECX);
+
+	/* hidden parameter of itable_resolver_stub_error() */
+	__emit_mov_imm_reg(buf, (unsigned long) i_method, MACH_REG_EAX);
+
+	/* jmp *index(%ecx) */
+	__emit_membase(buf, 0xff, MACH_REG_ECX, i_method->itable_index * sizeof(void *), 0x04);
+
+	/* The receiver does not implement the interface. */
+	fixup_branch_target(no_itable, buffer_current(buf));
+	fixup_branch_target(not_found, buffer_current(buf));
+	__emit_mov_imm_reg(buf, (unsigned long) i_method, MACH_REG_EAX);
+	__emit_jmp(buf, (unsigned long) &itable_resolver_stub_error);
+}
+
+int inline_cache_emit_stub(struct inline_cache *ic)
+{
+	static struct buffer_operations exec_buf_ops = {
+		.expand = NULL,
+		.free   = NULL,
+	};
+	struct buffer *buf;
+	unsigned int i;
+
+	buf = __alloc_buffer(&exec_buf_ops);
+	if (!buf)
+		return -ENOMEM;
+
+	jit_text_lock();
+
+	buf->buf = jit_text_ptr();
+
+	/* mov 4(%esp), %eax */
+	__emit_membase_reg(buf, 0x8b, MACH_REG_ESP, sizeof(unsigned long), MACH_REG_EAX);
+
+	/* mov class(%eax), %eax in its disp8 form to keep the entries aligned */
+	emit(buf, 0x8b);
+	emit(buf, encode_modrm(0x01, encode_mach_reg(MACH_REG_EAX), encode_mach_reg(MACH_REG_EAX)));
+	emit(buf, offsetof(struct vm_object, class));
+
+	for (i = 0; i < INLINE_CACHE_STUB_ENTRIES; i++) {
+		assert(buffer_offset(buf) == IC_STUB_ENTRY_OFFSET + i * IC_STUB_ENTRY_SIZE);
+
+		/* cmp $0, %eax */
+		emit(buf, 0x3d);
+		emit_imm32(buf, 0);
+
+		emit(buf, 0x90);
+		emit(buf, 0x90);
+
+		/* je inline_cache_miss_trampoline, patched along with the class */
+		emit(buf, 0x0f);
+		emit(buf, 0x84);
+		emit_imm32(buf, (unsigned long) inline_cache_miss_trampoline - ((unsigned long) buffer_current(buf) + 4));
+
+		emit(buf, 0x90);
+		emit(buf, 0x90);
+		emit(buf, 0x90);
+	}
+
+	__emit_mov_imm_reg(buf, (unsigned long) ic, MACH_REG_EAX);
+	emit(buf, 0xe9);
+	emit_imm32(buf, (unsigned long) inline_cache_miss_trampoline - ((unsigned long) buffer_current(buf) + 4));
+
+	ic->megamorphic_entry = buffer_current(buf);
+
+	__emit_membase_reg(buf, 0x8b, MACH_REG_ESP, sizeof(unsigned long), MACH_REG_EAX);
+	__emit_membase_reg(buf, 0x8b, MACH_REG_EAX, offsetof(struct vm_object, class), MACH_REG_EAX);
+
+	if (inline_cache_is_interface(ic)) {
+		emit_itable_jump(buf, ic->method);
+	} else {
+		__emit_membase_reg(buf, 0x8b, MACH_REG_EAX, offsetof(struct vm_class, vtable), MACH_REG_EAX);
+
+		/* jmp *index(%eax) */
+		__emit_membase(buf, 0xff, MACH_REG_EAX, ic->method->virtual_index * sizeof(void *), 0x04);
+	}
+
+	ic->stub = buffer_ptr(buf);
+
+	jit_text_reserve(buffer_offset(buf));
+	jit_text_unlock();
+
+	return 0;
+}
+
+void inline_cache_patch_stub_entry(struct inline_cache *ic, unsigned int idx,
+				   struct vm_class *vmc, void *target)
+{
+	void *entry = ic->stub + IC_STUB_ENTRY_OFFSET + idx * IC_STUB_ENTRY_SIZE;
+
+	patch_rel32(entry + IC_STUB_TARGET_OFFSET, target);
+	cpu_write_u32(entry + IC_STUB_CLASS_OFFSET, (unsigned long) vmc);
+}
+
+/*
+ * Emits the invokeinterface dispatch stub of @i_method for call sites which
+ * have no inline cache. The stub is called with the receiver as the first
+ * stack argument.
+ */
+void *emit_itable_stub(struct vm_method *i_method)
+{
+	static struct buffer_operations exec_buf_ops = {
+		.expand = NULL,
+		.free   = NULL,
+	};
+	struct buffer *buf;
+	void *stub;
+
+	buf = __alloc_buffer(&exec_buf_ops);
+	if (!buf)
+		return NULL;
+
+	jit_text_lock();
+
+	buf->buf = jit_text_ptr();
+
+	/* mov 4(%esp), %eax; mov class(%eax), %eax */
+	__emit_membase_reg(buf, 0x8b, MACH_REG_ESP, sizeof(unsigned long), MACH_REG_EAX);
+	__emit_membase_reg(buf, 0x8b, MACH_REG_EAX, offsetof(struct vm_object, class), MACH_REG_EAX);
+
+	emit_itable_jump(buf, i_method);
+
+	stub = buffer_ptr(buf);
+
+	jit_text_reserve(buffer_offset(buf));
+	jit_text_unlock();
+
+	free_buffer(buf);
+
+	return stub;
+}
+
+/*
+ * Emits a stub which returns the 64-bit thread-local variable @tls_value
+ * in %edx:%eax.
+ */
+void *emit_tls_return_stub(void *tls_value)
+{
+	static struct buffer_operations exec_buf_ops = {
+		.expand = NULL,
+		.free   = NULL,
+	};
+	unsigned long offset = get_thread_local_offset(tls_value);
+	struct buffer *buf;
+	void *stub;
+
+	buf = __alloc_buffer(&exec_buf_ops);
+	if (!buf)
+		return NULL;
+
+	jit_text_lock();
+
+	buf->buf = jit_text_ptr();
+
+	/* mov %gs:offset, %eax; mov %gs:offset + 4, %edx; ret */
+	emit(buf, 0x65);
+	__emit_memdisp_reg(buf, 0x8b, offset, MACH_REG_EAX);
+	emit(buf, 0x65);
+	__emit_memdisp_reg(buf, 0x8b, offset + sizeof(uint32_t), MACH_REG_EDX);
+	encode_ret(buf);
+
+	stub = buffer_ptr(buf);
+
+	jit_text_reserve(buffer_offset(buf));
+	jit_text_unlock();
+
+	free_buffer(buf);
+
+	return stub;
+}
+
+void cha_patch_call_site(struct cha_site *site, void *target)
+{
+	unsigned char *call = buffer_ptr(site->cu->objcode) + site->mach_offset;
+
+	patch_rel32(call + 1, target);
+}
+
+/*
+ * Dirties the card of the object in the source register. The destination
+ * is a scratch register.
+ */
+static void emit_card_mark_reg_reg(struct insn *insn, struct buffer *buf, struct basic_block *bb)
+{
+	enum machine_reg src, tmp;
+
+	src = mach_reg(&insn->src.reg);
+	tmp = mach_reg(&insn->dest.reg);
+
+	if (src != tmp)
+		__emit_mov_reg_reg(buf, src, tmp);
+
+	/* shr $HEAP_CARD_SHIFT, %tmp */
+	emit(buf, 0xc1);
+	emit(buf, encode_modrm(0x03, 0x05, encode_mach_reg(tmp)));
+	emit(buf, HEAP_CARD_SHIFT);
+
+	/* movb $1, heap_card_base(%tmp) */
+	__emit_membase(buf, 0xc6, tmp, (unsigned long) heap_card_base, 0);
+	emit(buf, 1);
+}
+
+/*
+ * Returns the branch which skips the SATB barrier when no concurrent mark
+ * is in progress.
+ */
+static uint8_t *emit_satb_check(struct buffer *buf)
+{
+	/* cmpb $0, gc_marking */
+	__emit_memdisp(buf, 0x80, (unsigned long) &gc_marking, 0x07);
+	emit(buf, 0);
+
+	return __emit_jcc_placeholder(buf, 0x84);
+}
+
+/*
+ * Logs the reference in @old, which is about to be overwritten, unless it
+ * is NULL or already marked. Like gc_satb_log_object() but without the heap
+ * lookup because JIT compiled code only stores real references.
+ */
+static void emit_satb_log(struct buffer *buf, enum machine_reg old,
+			  uint8_t *not_marking)
+{
+	uint8_t *is_null, *was_marked;
+	enum machine_reg tmp;
+
+	tmp = old == MACH_REG_EAX ? MACH_REG_ECX : MACH_REG_EAX;
+
+	/* test %old, %old */
+	__emit_reg_reg(buf, 0x85, old, old);
+	is_null = __emit_jcc_placeholder(buf, 0x84);
+
+	/* lock bts $HEAP_CHUNK_MARK, header(%old) */
+	emit(buf, 0xf0);
+	emit(buf, 0x0f);
+	__emit_membase(buf, 0xba, old, -(long) sizeof(struct heap_header), 0x05);
+	emit(buf, __builtin_ctzl(HEAP_CHUNK_MARK));
+	was_marked = __emit_jcc_placeholder(buf, 0x82);
+
+	__emit_push_reg(buf, tmp);
+
+	/* mov $1, %tmp; lock xadd %tmp, gc_satb_log_top */
+	__emit_mov_imm_reg(buf, 1, tmp);
+	emit(buf, 0xf0);
+	emit(buf, 0x0f);
+	__emit_reg_memdisp(buf, 0xc1, tmp, (unsigned long) &gc_satb_log_top);
+
+	/* mov %old, gc_satb_log(, %tmp, 4) */
+	emit(buf, 0x89);
+	emit(buf, encode_modrm(0x00, encode_mach_reg(old), 0x04));
+	emit(buf, encode_sib(0x02, encode_mach_reg(tmp), 0x05));
+	emit_imm32(buf, (unsigned long) gc_satb_log);
+
+	__emit_pop_reg(buf, tmp);
+
+	fixup_branch_target(not_marking, buffer_current(buf));
+	fixup_branch_target(is_null, buffer_current(buf));
+	fixup_branch_target(was_marked, buffer_current(buf));
+}
+
+/*
+ * SATB barriers for a reference store to the slot in the source operand.
+ * The destination is a scratch register which receives the old value.
+ */
+static void emit_satb_membase_reg(struct insn *insn, struct buffer *buf, struct basic_block *bb)
+{
+	uint8_t *not_marking = emit_satb_check(buf);
+
+	emit_mov_membase_reg(insn, buf, bb);
+	emit_satb_log(buf, mach_reg(&insn->dest.reg), not_marking);
+}
+
+static void emit_satb_memindex_reg(struct insn *insn, struct buffer *buf, struct basic_block *bb)
+{
+	uint8_t *not_marking = emit_satb_check(buf);
+
+	emit_mov_memindex_reg(insn, buf, bb);
+	emit_satb_log(buf, mach_reg(&insn->dest.reg), not_marking);
+}
+
+/*
+ * Locks the object on top of the stack if it is biased towards the current
+ * thread, which needs no atomic instruction, or if it is unlocked and the
+ * bias has been revoked. Threads without a vm_thread, objects which are not
+ * biased yet, locked objects and inflated lock words take the
+ * vm_object_lock() slow path. Clobbers the caller saved registers like a
+ * call.
+ */
+static void __emit_monitor_enter(struct buffer *buf)
+{
+	uint8_t *no_thread, *not_biased, *overflow, *slow_path, *done, *thin_done;
+
+	/* mov (%esp), %ecx */
+	__emit_membase_reg(buf, 0x8b, MACH_REG_ESP, 0, MACH_REG_ECX);
+
+	/* mov gs:(current_exec_env.thread), %edx */
+	emit(buf, 0x65);
+	__emit_memdisp_reg(buf, 0x8b, get_thread_local_offset(&current_exec_env.thread), MACH_REG_EDX);
+
+	/* test %edx, %edx */
+	__emit_reg_reg(buf, 0x85, MACH_REG_EDX, MACH_REG_EDX);
+	no_thread = __emit_jcc_placeholder(buf, 0x84);
+
+	/* mov lock_word(%ecx), %eax; xor %edx, %eax */
+	__emit_membase_reg(buf, 0x8b, MACH_REG_ECX, offsetof(struct vm_object, lock_word), MACH_REG_EAX);
+	__emit_reg_reg(buf, 0x31, MACH_REG_EDX, MACH_REG_EAX);
+
+	/* Biased towards us if only the depth differs. */
+	__emit_test_imm_reg(buf, ~VM_LOCK_COUNT_MASK, MACH_REG_EAX);
+	not_biased = __emit_jcc_placeholder(buf, 0x85);
+
+	__emit_cmp_imm_reg(buf, VM_LOCK_COUNT_MASK, MACH_REG_EAX);
+	overflow = __emit_jcc_placeholder(buf, 0x84);
+
+	/* addl $VM_LOCK_COUNT_ONE, lock_word(%ecx) */
+	__emit_membase(buf, 0x83, MACH_REG_ECX, offsetof(struct vm_object, lock_word), 0x00);
+	emit(buf, VM_LOCK_COUNT_ONE);
+
+	/* open-coded "jmp" */
+	emit(buf, 0xe9);
+	done = buffer_current(buf);
+	emit_imm32(buf, 0);
+
+	fixup_branch_target(not_biased, buffer_current(buf));
+
+	/* mov $VM_LOCK_UNBIASED, %eax; or $VM_LOCK_UNBIASED, %edx */
+	__emit_mov_imm_reg(buf, VM_LOCK_UNBIASED, MACH_REG_EAX);
+	emit_alu_imm_reg(buf, 0x01, VM_LOCK_UNBIASED, MACH_REG_EDX);
+
+	/* lock cmpxchg %edx, lock_word(%ecx) */
+	emit(buf, 0xf0);
+	emit(buf, 0x0f);
+	__emit_membase_reg(buf, 0xb1, MACH_REG_ECX, offsetof(struct vm_object, lock_word), MACH_REG_EDX);
+	slow_path = __emit_jcc_placeholder(buf, 0x85);
+
+	/* open-coded "jmp" */
+	emit(buf, 0xe9);
+	thin_done = buffer_current(buf);
+	emit_imm32(buf, 0);
+
+	fixup_branch_target(no_thread, buffer_current(buf));
+	fixup_branch_target(overflow, buffer_current(buf));
+	fixup_branch_target(slow_path, buffer_current(buf));
+	__emit_call(buf, vm_object_lock);
+
+	fixup_branch_target(done, buffer_current(buf));
+	fixup_branch_target(thin_done, buffer_current(buf));
+}
+
+/*
+ * Unlocks the object on top of the stack if it is biased towards the
+ * current thread or thin locked once by it. Only the bias owner changes a
+ * biased word so a plain store is enough there. Contending threads set
+ * VM_LOCK_CONTENDED in thin locked words so those are released with
+ * compare and swap. Everything else, including contended thin locks which
+ * have to be inflated, goes to vm_object_unlock().
+ */
+static void __emit_monitor_exit(struct buffer *buf)
+{
+	uint8_t *no_thread, *not_biased, *not_locked, *slow_path, *contended;
+	uint8_t *done, *thin_done;
+
+	/* mov (%esp), %ecx */
+	__emit_membase_reg(buf, 0x8b, MACH_REG_ESP, 0, MACH_REG_ECX);
+
+	/* mov gs:(current_exec_env.thread), %eax */
+	emit(buf, 0x65);
+	__emit_memdisp_reg(buf, 0x8b, get_thread_local_offset(&current_exec_env.thread), MACH_REG_EAX);
+
+	/* test %eax, %eax */
+	__emit_reg_reg(buf, 0x85, MACH_REG_EAX, MACH_REG_EAX);
+	no_thread = __emit_jcc_placeholder(buf, 0x84);
+
+	/* mov lock_word(%ecx), %edx; xor %eax, %edx */
+	__emit_membase_reg(buf, 0x8b, MACH_REG_ECX, offsetof(struct vm_object, lock_word), MACH_REG_EDX);
+	__emit_reg_reg(buf, 0x31, MACH_REG_EAX, MACH_REG_EDX);
+
+	__emit_test_imm_reg(buf, ~VM_LOCK_COUNT_MASK, MACH_REG_EDX);
+	not_biased = __emit_jcc_placeholder(buf, 0x85);
+
+	/* test %edx, %edx */
+	__emit_reg_reg(buf, 0x85, MACH_REG_EDX, MACH_REG_EDX);
+	not_locked = __emit_jcc_placeholder(buf, 0x84);
+
+	/* subl $VM_LOCK_COUNT_ONE, lock_word(%ecx) */
+	__emit_membase(buf, 0x83, MACH_REG_ECX, offsetof(struct vm_object, lock_word), 0x05);
+	emit(buf, VM_LOCK_COUNT_ONE);
+
+	/* open-coded "jmp" */
+	emit(buf, 0xe9);
+	done = buffer_current(buf);
+	emit_imm32(buf, 0);
+
+	fixup_branch_target(not_biased, buffer_current(buf));
+
+	/* Thin locked by us without re-entries or contenders. */
+	__emit_cmp_imm_reg(buf, VM_LOCK_UNBIASED, MACH_REG_EDX);
+	slow_path = __emit_jcc_placeholder(buf, 0x85);
+
+	/* or $VM_LOCK_UNBIASED, %eax; mov $VM_LOCK_UNBIASED, %edx */
+	emit_alu_imm_reg(buf, 0x01, VM_LOCK_UNBIASED, MACH_REG_EAX);
+	__emit_mov_imm_reg(buf, VM_LOCK_UNBIASED, MACH_REG_EDX);
+
+	/* lock cmpxchg %edx, lock_word(%ecx) */
+	emit(buf, 0xf0);
+	emit(buf, 0x0f);
+	__emit_membase_reg(buf, 0xb1, MACH_REG_ECX, offsetof(struct vm_object, lock_word), MACH_REG_EDX);
+	contended = __emit_jcc_placeholder(buf, 0x85);
+
+	/* open-coded "jmp" */
+	emit(buf, 0xe9);
+	thin_done = buffer_current(buf);
+	emit_imm32(buf, 0);
+
+	fixup_branch_target(no_thread, buffer_current(buf));
+	fixup_branch_target(not_locked, buffer_current(buf));
+	fixup_branch_target(slow_path, buffer_current(buf));
+	fixup_branch_target(contended, buffer_current(buf));
+	__emit_call(buf, vm_object_unlock);
+
+	fixup_branch_target(done, buffer_current(buf));
+	fixup_branch_target(thin_done, buffer_current(buf));
+}
+
+/*
+ * monitorenter and monitorexit. The object has been pushed by the
+ * instruction selector as the argument of the slow path call.
+ */
+static void emit_monitor_enter(struct insn *insn, struct buffer *buf, struct basic_block *bb)
+{
+	__emit_monitor_enter(buf);
+}
+
+static void emit_monitor_exit(struct insn *insn, struct buffer *buf, struct basic_block *bb)
+{
+	__emit_monitor_exit(buf);
+}
+
 struct emitter emitters[] = {
 	GENERIC_X86_EMITTERS,
 	DECL_EMITTER(INSN_ADC_IMM_REG, emit_adc_imm_reg),
 	DECL_EMITTER(INSN_ADC_REG_REG, emit_adc_reg_reg),
 	DECL_EMITTER(INSN_ADC_MEMBASE_REG, emit_adc_membase_reg),
+	DECL_EMITTER(INSN_ADD_IMM_MEMDISP, emit_add_imm_memdisp),
 	DECL_EMITTER(INSN_ADD_IMM_REG, emit_add_imm_reg),
 	DECL_EMITTER(INSN_ADD_MEMBASE_REG, emit_add_membase_reg),
 	DECL_EMITTER(INSN_ADD_REG_REG, emit_add_reg_reg),
 	DECL_EMITTER(INSN_AND_MEMBASE_REG, emit_and_membase_reg),
 	DECL_EMITTER(INSN_AND_REG_REG, emit_and_reg_reg),
 	DECL_EMITTER(INSN_CALL_REG, emit_indirect_call),
+	DECL_EMITTER(INSN_CARD_MARK_REG_REG, emit_card_mark_reg_reg),
 	DECL_EMITTER(INSN_CLTD_REG_REG, emit_cltd_reg_reg),
 	DECL_EMITTER(INSN_CMP_IMM_REG, emit_cmp_imm_reg),
 	DECL_EMITTER(INSN_CMP_MEMBASE_REG, emit_cmp_membase_reg),
@@ -1676,8 +2431,11 @@ struct emitter emitters[] = {
 	DECL_EMITTER(INSN_CONV_FPU64_TO_GPR, emit_conv_fpu64_to_gpr),
 	DECL_EMITTER(INSN_CONV_XMM_TO_XMM64, emit_conv_xmm_to_xmm64),
 	DECL_EMITTER(INSN_CONV_XMM64_TO_XMM, emit_conv_xmm64_to_xmm),
+	DECL_EMITTER(INSN_IC_CALL_IMM_REG, emit_ic_call),
 	DECL_EMITTER(INSN_JMP_MEMBASE, emit_jmp_membase),
 	DECL_EMITTER(INSN_JMP_MEMINDEX, emit_jmp_memindex),
+	DECL_EMITTER(INSN_MONITOR_ENTER, emit_monitor_enter),
+	DECL_EMITTER(INSN_MONITOR_EXIT, emit_monitor_exit),
 	DECL_EMITTER(INSN_MOV_MEMBASE_XMM, emit_mov_membase_xmm),
 	DECL_EMITTER(INSN_MOV_64_MEMBASE_XMM, emit_mov_64_membase_xmm),
 	DECL_EMITTER(INSN_MOV_XMM_MEMBASE, emit_mov_xmm_membase),
@@ -1731,6 +2489,8 @@ struct emitter emitters[] = {
 	DECL_EMITTER(INSN_POP_REG, emit_pop_reg),
 	DECL_EMITTER(INSN_SAR_IMM_REG, emit_sar_imm_reg),
 	DECL_EMITTER(INSN_SAR_REG_REG, emit_sar_reg_reg),
+	DECL_EMITTER(INSN_SATB_MEMBASE_REG, emit_satb_membase_reg),
+	DECL_EMITTER(INSN_SATB_MEMINDEX_REG, emit_satb_memindex_reg),
 	DECL_EMITTER(INSN_SBB_IMM_REG, emit_sbb_imm_reg),
 	DECL_EMITTER(INSN_SBB_MEMBASE_REG, emit_sbb_membase_reg),
 	DECL_EMITTER(INSN_SBB_REG_REG, emit_sbb_reg_reg),
@@ -1741,6 +2501,8 @@ struct emitter emitters[] = {
 	DECL_EMITTER(INSN_SUB_REG_REG, emit_sub_reg_reg),
 	DECL_EMITTER(INSN_TEST_IMM_MEMDISP, emit_test_imm_memdisp),
 	DECL_EMITTER(INSN_TEST_MEMBASE_REG, emit_test_membase_reg),
+	DECL_EMITTER(INSN_TLAB_ALLOC_IMM, emit_tlab_alloc),
+	DECL_EMITTER(INSN_TLAB_ALLOC_ARRAY_IMM, emit_tlab_alloc_array),
 	DECL_EMITTER(INSN_XOR_MEMBASE_REG, emit_xor_membase_reg),
 	DECL_EMITTER(INSN_XOR_REG_REG, emit_xor_reg_reg),
 	DECL_EMITTER(INSN_XOR_XMM_REG_REG, emit_xor_xmm_reg_reg),
@@ -1790,7 +2552,7 @@ void emit_trampoline(struct compilation_unit *cu,
 void emit_lock(struct buffer *buf, struct vm_object *obj)
 {
 	__emit_push_imm(buf, (unsigned long)obj);
-	__emit_call(buf, vm_object_lock);
+	__emit_monitor_enter(buf);
 	__emit_add_imm_reg(buf, PTR_SIZE, MACH_REG_xSP);
 
 	__emit_push_reg(buf, MACH_REG_EAX);
@@ -1805,7 +2567,7 @@ void emit_unlock(struct buffer *buf, struct vm_object *obj)
 	__emit_push_reg(buf, MACH_REG_EDX);
 
 	__emit_push_imm(buf, (unsigned long)obj);
-	__emit_call(buf, vm_object_unlock);
+	__emit_monitor_exit(buf);
 	__emit_add_imm_reg(buf, PTR_SIZE, MACH_REG_ESP);
 
 	emit_exception_test(buf, MACH_REG_EAX);
@@ -1821,7 +2583,7 @@ void emit_lock_this(struct buffer *buf)
 	this_arg_offset = offsetof(struct jit_stack_frame, args);
 
 	__emit_push_membase(buf, MACH_REG_EBP, this_arg_offset);
-	__emit_call(buf, vm_object_lock);
+	__emit_monitor_enter(buf);
 	__emit_add_imm_reg(buf, PTR_SIZE, MACH_REG_ESP);
 
 	__emit_push_reg(buf, MACH_REG_EAX);
@@ -1840,7 +2602,7 @@ void emit_unlock_this(struct buffer *buf)
 	__emit_push_reg(buf, MACH_REG_EDX);
 
 	__emit_push_membase(buf, MACH_REG_EBP, this_arg_offset);
-	__emit_call(buf, vm_object_unlock);
+	__emit_monitor_exit(buf);
 	__emit_add_imm_reg(buf, PTR_SIZE, MACH_REG_ESP);
 
 	emit_exception_test(buf, MACH_REG_EAX);
@@ -1849,15 +2611,6 @@ void emit_unlock_this(struct buffer *buf)
 	__emit_pop_reg(buf, MACH_REG_EAX);
 }
 
-static void fixup_branch_target(uint8_t *target_p, void *target)
-{
-	long cur = (long) (target - (void *) target_p) - 4;
-	target_p[3] = cur >> 24;
-	target_p[2] = cur >> 16;
-	target_p[1] = cur >> 8;
-	target_p[0] = cur;
-}
-
 void emit_jni_trampoline(struct buffer *buf, struct vm_method *vmm,
 			 void *target)
 {
@@ -1915,10 +2668,11 @@ void emit_jni_trampoline(struct buffer *buf, struct vm_method *vmm,
 	jit_text_unlock();
 }
 
-/* The regparm(1) makes GCC get the first argument from %ecx and the rest
- * from the stack. This is convenient, because we use %ecx for passing the
- * hidden "method" parameter. Interfaces are invoked on objects, so we also
- * always get the object in the first stack parameter. */
+/* Itable entries of unimplemented methods point here. The regparm(1) makes
+ * GCC get the first argument from %eax and the rest from the stack. This is
+ * convenient, because we use %eax for passing the hidden "method" parameter.
+ * Interfaces are invoked on objects, so we also always get the object in the
+ * first stack parameter. */
 void __attribute__((regparm(1)))
 itable_resolver_stub_error(struct vm_method *method, struct vm_object *obj)
 {
@@ -1933,115 +2687,6 @@ itable_resolver_stub_error(struct vm_method *method, struct vm_object *obj)
 	abort();
 }
 
-/* Note: a < b, always */
-static void emit_itable_bsearch(struct buffer *buf,
-	struct itable_entry **table, unsigned int a, unsigned int b)
-{
-	uint8_t *jb_addr = NULL;
-	uint8_t *ja_addr = NULL;
-	unsigned int m;
-
-	/* Find middle (safe from overflows) */
-	m = a + (b - a) / 2;
-
-	/* No point in emitting the "cmp" if we're not going to test
-	 * anything */
-	if (b - a >= 1) {
-		__emit_cmp_imm_reg(buf, (long) table[m]->i_method, MACH_REG_EAX);
-
-		if (m - a > 0) {
-			/* open-coded "jb" */
-			emit(buf, 0x0f);
-			emit(buf, 0x82);
-
-			/* placeholder address */
-			jb_addr = buffer_current(buf);
-			emit_imm32(buf, 0);
-		}
-
-		if (b - m > 0) {
-			/* open-coded "ja" */
-			emit(buf, 0x0f);
-			emit(buf, 0x87);
-
-			/* placeholder address */
-			ja_addr = buffer_current(buf);
-			emit_imm32(buf, 0);
-		}
-	}
-
-#ifndef NDEBUG
-	/* Make sure what we wanted is what we got;
-	 *
-	 *     cmp i_method, %eax
-	 *     je .okay
-	 *     jmp itable_resolver_stub_error
-	 * .okay:
-	 *
-	 */
-	__emit_cmp_imm_reg(buf, (long) table[m]->i_method, MACH_REG_EAX);
-
-	/* open-coded "je" */
-	emit(buf, 0x0f);
-	emit(buf, 0x84);
-
-	uint8_t *je_addr = buffer_current(buf);
-	emit_imm32(buf, 0);
-
-	__emit_jmp(buf, (unsigned long) &itable_resolver_stub_error);
-
-	fixup_branch_target(je_addr, buffer_current(buf));
-#endif
-
-	__emit_add_imm_reg(buf, 4 * table[m]->c_method->virtual_index, MACH_REG_ECX);
-	emit_really_indirect_jump_reg(buf, MACH_REG_ECX);
-
-	/* This emits the code for checking the interval [a, m> */
-	if (jb_addr) {
-		fixup_branch_target(jb_addr, buffer_current(buf));
-		emit_itable_bsearch(buf, table, a, m - 1);
-	}
-
-	/* This emits the code for checking the interval <m, b] */
-	if (ja_addr) {
-		fixup_branch_target(ja_addr, buffer_current(buf));
-		emit_itable_bsearch(buf, table, m + 1, b);
-	}
-}
-
-/* Note: table is always sorted on entry->method address */
-/* Note: nr_entries is always >= 2 */
-void *emit_itable_resolver_stub(struct vm_class *vmc,
-	struct itable_entry **table, unsigned int nr_entries)
-{
-	static struct buffer_operations exec_buf_ops = {
-		.expand = NULL,
-		.free   = NULL,
-	};
-
-	struct buffer *buf = __alloc_buffer(&exec_buf_ops);
-
-	jit_text_lock();
-
-	buf->buf = jit_text_ptr();
-
-	/* Note: When the stub is called, %eax contains the signature hash that
-	 * we look up in the stub. 0(%esp) contains the object reference. %ecx
-	 * and %edx are available here because they are already saved by the
-	 * caller (guaranteed by ABI). */
-
-	/* Load the start of the vtable into %ecx. Later we just add the
-	 * right offset to %ecx and jump to *(%ecx). */
-	__emit_mov_imm_reg(buf, (long) vmc->vtable.native_ptr, MACH_REG_ECX);
-
-	emit_itable_bsearch(buf, table, 0, nr_entries - 1);
-
-	jit_text_reserve(buffer_offset(buf));
-	jit_text_unlock();
-
-	return buffer_ptr(buf);
-}
-
 #else /* CONFIG_X86_32 */
 
 /*
@@ -3011,11 +3656,43 @@ static void emit_conv_fpu_to_fpu(struct insn *insn, struct buffer *buf, struct b
 	__emit_lopc_reg_reg(buf, 0, opc, 3, src, dest);
 }
 
+/*
+ * Dirties the card of the object in the source register. The destination
+ * is a scratch register.
+ */
+static void emit_card_mark_reg_reg(struct insn *insn, struct buffer *buf, struct basic_block *bb)
+{
+	enum machine_reg src, tmp;
+	unsigned char reg_num;
+
+	src = mach_reg(&insn->src.reg);
+	tmp = mach_reg(&insn->dest.reg);
+
+	if (src != tmp)
+		__emit64_mov_reg_reg(buf, src, tmp);
+
+	/* shr $HEAP_CARD_SHIFT, %tmp */
+	reg_num = encode_mach_reg(tmp);
+	emit(buf, reg_high(reg_num) ? (REX_W | REX_B) : REX_W);
+	emit(buf, 0xc1);
+	emit(buf, encode_modrm(0x03, 0x05, reg_num));
+	emit(buf, HEAP_CARD_SHIFT);
+
+	/* add heap_card_base(%rip), %tmp */
+	__emit_memdisp_reg(buf, 1, 0x03, (unsigned long) &heap_card_base, tmp);
+
+	/* movb $1, (%tmp) */
+	__emit_membase(buf, 0, 0xc6, tmp, 0, 0);
+	emit(buf, 1);
+}
+
 struct emitter emitters[] = {
 	GENERIC_X86_EMITTERS,
+	DECL_EMITTER(INSN_ADD_IMM_MEMDISP, emit_add_imm_memdisp),
 	DECL_EMITTER(INSN_ADD_IMM_REG, emit_add_imm_reg),
 	DECL_EMITTER(INSN_ADD_REG_REG, emit_add_reg_reg),
 	DECL_EMITTER(INSN_CALL_REG, emit_indirect_call),
+	DECL_EMITTER(INSN_CARD_MARK_REG_REG, emit_card_mark_reg_reg),
 	DECL_EMITTER(INSN_CMP_IMM_REG, emit_cmp_imm_reg),
 	DECL_EMITTER(INSN_CMP_MEMBASE_REG, emit_cmp_membase_reg),
 	DECL_EMITTER(INSN_CMP_REG_REG, emit_cmp_reg_reg),
@@ -3274,13 +3951,6 @@ void emit_unlock_this(struct buffer *buf)
 	__emit_pop_reg(buf, MACH_REG_RAX);
 }
 
-void *emit_itable_resolver_stub(struct vm_class *vmc,
-				struct itable_entry **table,
-				unsigned int nr_entries)
-{
-	return NULL;
-}
-
 void itable_resolver_stub_error(struct vm_method *method, struct vm_object *obj)
 {
 	fprintf(stderr, "itable resolver stub error!\n");
@@ -3294,6 +3964,83 @@ void itable_resolver_stub_error(struct vm_method *method, struct vm_object *obj)
 	abort();
 }
 
+/*
+ * Emits the invokeinterface dispatch stub of @i_method. The stub is called
+ * with the receiver in %rdi and @i_method in %rax. It only clobbers %r11
+ * because the argument registers are live.
+ */
+void *emit_itable_stub(struct vm_method *i_method)
+{
+	static struct buffer_operations exec_buf_ops = {
+		.expand = NULL,
+		.free   = NULL,
+	};
+	unsigned long interface_id = i_method->class->interface_id;
+	unsigned char *no_itable, *found, *not_found;
+	unsigned char *scan;
+	struct buffer *buf;
+	void *stub;
+
+	buf = __alloc_buffer(&exec_buf_ops);
+	if (!buf)
+		return NULL;
+
+	jit_text_lock();
+
+	buf->buf = jit_text_ptr();
+
+	__emit64_mov_membase_reg(buf, MACH_REG_RDI, offsetof(struct vm_object, class), MACH_REG_R11);
+	__emit64_mov_membase_reg(buf, MACH_REG_R11, offsetof(struct vm_class, itable.table), MACH_REG_R11);
+
+	/* test %r11, %r11; je error */
+	__emit_reg_reg(buf, 1, 0x85, MACH_REG_R11, MACH_REG_R11);
+	emit(buf, 0x0f);
+	emit(buf, 0x84);
+	no_itable = buffer_current(buf);
+	emit_imm32(buf, 0);
+
+	/* cmpq $id, interface_id(%r11); jae found */
+	scan = buffer_current(buf);
+	__emit_membase(buf, 1, 0x81, MACH_REG_R11, offsetof(struct vm_itable_entry, interface_id), 0x07);
+	emit_imm32(buf, interface_id);
+	emit(buf, 0x0f);
+	emit(buf, 0x83);
+	found = buffer_current(buf);
+	emit_imm32(buf, 0);
+
+	/* add $size, %r11; jmp scan */
+	__emit64_add_imm_reg(buf, sizeof(struct vm_itable_entry), MACH_REG_R11);
+	__emit_jmp(buf, (unsigned long) scan);
+
+	/* The table is terminated by ITABLE_END so the scan always stops. */
+	fixup_branch_target(found, buffer_current(buf));
+	emit(buf, 0x0f);
+	emit(buf, 0x85);
+	not_found = buffer_current(buf);
+	emit_imm32(buf, 0);
+
+	__emit64_mov_membase_reg(buf, MACH_REG_R11, offsetof(struct vm_itable_entry, entries), MACH_REG_R11);
+
+	/* jmp *index(%r11) */
+	__emit_membase(buf, 0, 0xff, MACH_REG_R11, i_method->itable_index * sizeof(void *), 0x04);
+
+	/* The receiver does not implement the interface. */
+	fixup_branch_target(no_itable, buffer_current(buf));
+	fixup_branch_target(not_found, buffer_current(buf));
+	__emit64_mov_reg_reg(buf, MACH_REG_RDI, MACH_REG_RSI);
+	__emit64_mov_reg_reg(buf, MACH_REG_RAX, MACH_REG_RDI);
+	__emit_jmp(buf, (unsigned long) &itable_resolver_stub_error);
+
+	stub = buffer_ptr(buf);
+
+	jit_text_reserve(buffer_offset(buf));
+	jit_text_unlock();
+
+	free_buffer(buf);
+
+	return stub;
+}
+
 void emit_jni_trampoline(struct buffer *buf,
 			 struct vm_method *vmm,
 			 void *target)
@@ -3301,6 +4048,35 @@ void emit_jni_trampoline(struct buffer *buf,
 	abort();
 }
 
+/* Inline caches are not used on x86-64, see invokevirtual(). */
+void inline_cache_patch_monomorphic(struct inline_cache *ic,
+				    struct vm_class *vmc, void *target)
+{
+	abort();
+}
+
+int inline_cache_emit_stub(struct inline_cache *ic)
+{
+	abort();
+}
+
+void inline_cache_patch_stub_entry(struct inline_cache *ic, unsigned int idx,
+				   struct vm_class *vmc, void *target)
+{
+	abort();
+}
+
+void inline_cache_patch_slow_path(struct inline_cache *ic, void *target)
+{
+	abort();
+}
+
+/* Class hierarchy analysis is not used on x86-64 either. */
+void cha_patch_call_site(struct cha_site *site, void *target)
+{
+	abort();
+}
+
 #endif /* CONFIG_X86_32 */
 
 static void do_emit_insn(struct emitter *emitter, struct buffer *buf, struct insn *insn, struct basic_block *bb)
@@ -63,6 +63,7 @@ enum insn_type {
 	INSN_ADC_IMM_REG,
 	INSN_ADC_MEMBASE_REG,
 	INSN_ADC_REG_REG,
+	INSN_ADD_IMM_MEMDISP,
 	INSN_ADD_IMM_REG,
 	INSN_ADD_MEMBASE_REG,
 	INSN_ADD_REG_REG,
@@ -70,6 +71,7 @@ enum insn_type {
 	INSN_AND_REG_REG,
 	INSN_CALL_REG,
 	INSN_CALL_REL,
+	INSN_CARD_MARK_REG_REG,		/* write barrier, see emit_card_mark_reg_reg() */
 	INSN_CLTD_REG_REG,	/* CDQ in Intel manuals*/
 	INSN_CMP_IMM_REG,
 	INSN_CMP_MEMBASE_REG,
@@ -104,6 +106,7 @@ enum insn_type {
 	INSN_CONV_GPR_TO_FPU64,
 	INSN_CONV_XMM_TO_XMM64,
 	INSN_CONV_XMM64_TO_XMM,
+	INSN_IC_CALL_IMM_REG,		/* inline cached call, see emit_ic_call() */
 	INSN_JE_BRANCH,
 	INSN_JGE_BRANCH,
 	INSN_JG_BRANCH,
@@ -113,6 +116,8 @@ enum insn_type {
 	INSN_JMP_MEMBASE,
 	INSN_JMP_BRANCH,
 	INSN_JNE_BRANCH,
+	INSN_MONITOR_ENTER,		/* inline monitorenter, see emit_monitor_enter() */
+	INSN_MONITOR_EXIT,
 	INSN_MOV_IMM_MEMBASE,
 	INSN_MOV_IMM_MEMLOCAL,
 	INSN_MOV_IMM_REG,
@@ -167,6 +172,8 @@ enum insn_type {
 	INSN_RET,
 	INSN_SAR_IMM_REG,
 	INSN_SAR_REG_REG,
+	INSN_SATB_MEMBASE_REG,		/* SATB barrier, see emit_satb_log() */
+	INSN_SATB_MEMINDEX_REG,
 	INSN_SBB_IMM_REG,
 	INSN_SBB_MEMBASE_REG,
 	INSN_SBB_REG_REG,
@@ -177,6 +184,8 @@ enum insn_type {
 	INSN_SUB_REG_REG,
 	INSN_TEST_IMM_MEMDISP,
 	INSN_TEST_MEMBASE_REG,
+	INSN_TLAB_ALLOC_IMM,		/* inline new, see emit_tlab_alloc() */
+	INSN_TLAB_ALLOC_ARRAY_IMM,	/* inline newarray */
 	INSN_XOR_MEMBASE_REG,
 	INSN_XOR_REG_REG,
 	INSN_XOR_XMM_REG_REG,
@@ -195,7 +204,7 @@ enum insn_flag_type {
 struct insn {
 	uint8_t			type;		 /* see enum insn_type */
 	uint8_t			flags;		 /* see enum insn_flag_type */
-	uint16_t		bc_offset;	 /* offset in bytecode */
+	uint32_t		bc_offset;	 /* offset in bytecode */
 	uint32_t		mach_offset;	 /* offset in machine code */
 	uint32_t		lir_pos;	 /* offset in LIR */
 	struct list_head	insn_list_node;
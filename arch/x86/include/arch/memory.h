@@ -7,15 +7,21 @@
  * Memory barriers.
  */
 #ifdef CONFIG_X86_32
-#define mb() asm volatile("lock; addl $0,0(%esp)")
-#define rmb() asm volatile("lock; addl $0,0(%esp)")
-#define wmb() asm volatile("lock; addl $0,0(%esp)")
+#define mb() asm volatile("lock; addl $0,0(%%esp)":::"memory")
+#define rmb() asm volatile("lock; addl $0,0(%%esp)":::"memory")
+#define wmb() asm volatile("lock; addl $0,0(%%esp)":::"memory")
 #else
 #define mb() 	asm volatile("mfence":::"memory")
 #define rmb()	asm volatile("lfence":::"memory")
 #define wmb()	asm volatile("sfence" ::: "memory")
 #endif
 
+/* Prevents the compiler from reordering memory accesses across it. */
+#define barrier() asm volatile("":::"memory")
+
+/* Hint for busy-wait loops. */
+#define cpu_relax() asm volatile("rep; nop":::"memory")
+
 static inline void cpu_write_u32(unsigned char *p, uint32_t val)
 {
 	*((uint32_t*)p) = val;
@@ -586,6 +586,7 @@ static unsigned long insn_flags[] = {
 	[INSN_ADC_IMM_REG]			= USE_DST | DEF_DST,
 	[INSN_ADC_MEMBASE_REG]			= USE_SRC | USE_DST | DEF_DST,
 	[INSN_ADC_REG_REG]			= USE_SRC | USE_DST | DEF_DST,
+	[INSN_ADD_IMM_MEMDISP]			= USE_NONE | DEF_NONE,
 	[INSN_ADD_IMM_REG]			= USE_DST | DEF_DST,
 	[INSN_ADD_MEMBASE_REG]			= USE_SRC | USE_DST | DEF_DST,
 	[INSN_ADD_REG_REG]			= USE_SRC | USE_DST | DEF_DST,
@@ -593,6 +594,7 @@ static unsigned long insn_flags[] = {
 	[INSN_AND_REG_REG]			= USE_SRC | USE_DST | DEF_DST,
 	[INSN_CALL_REG]				= USE_SRC | DEF_NONE | TYPE_CALL,
 	[INSN_CALL_REL]				= USE_NONE | DEF_NONE | TYPE_CALL,
+	[INSN_CARD_MARK_REG_REG]		= USE_SRC | DEF_DST,
 	[INSN_CLTD_REG_REG]			= USE_SRC | DEF_SRC | DEF_DST,
 	[INSN_CMP_IMM_REG]			= USE_DST,
 	[INSN_CMP_MEMBASE_REG]			= USE_SRC | USE_DST,
@@ -627,6 +629,7 @@ static unsigned long insn_flags[] = {
 	[INSN_FSTP_MEMLOCAL]			= USE_FP | DEF_NONE,
 	[INSN_FSUB_64_REG_REG]			= USE_SRC | USE_DST | DEF_DST,
 	[INSN_FSUB_REG_REG]			= USE_SRC | USE_DST | DEF_DST,
+	[INSN_IC_CALL_IMM_REG]			= USE_DST | DEF_NONE | TYPE_CALL,
 	[INSN_JE_BRANCH]			= USE_NONE | DEF_NONE | TYPE_BRANCH,
 	[INSN_JGE_BRANCH]			= USE_NONE | DEF_NONE | TYPE_BRANCH,
 	[INSN_JG_BRANCH]			= USE_NONE | DEF_NONE | TYPE_BRANCH,
@@ -650,6 +653,8 @@ static unsigned long insn_flags[] = {
 	[INSN_MOV_64_XMM_MEMINDEX]		= USE_SRC | USE_DST | USE_IDX_DST | DEF_NONE,
 	[INSN_MOV_64_XMM_MEMLOCAL]		= USE_SRC,
 	[INSN_MOV_64_XMM_XMM]			= USE_SRC | DEF_DST,
+	[INSN_MONITOR_ENTER]			= USE_NONE | DEF_NONE | TYPE_CALL,
+	[INSN_MONITOR_EXIT]			= USE_NONE | DEF_NONE | TYPE_CALL,
 	[INSN_MOV_IMM_MEMBASE]			= USE_DST,
 	[INSN_MOV_IMM_MEMLOCAL]			= USE_FP | DEF_NONE,
 	[INSN_MOV_IMM_REG]			= DEF_DST,
@@ -690,6 +695,8 @@ static unsigned long insn_flags[] = {
 	[INSN_RET]				= USE_NONE | DEF_NONE | TYPE_BRANCH,
 	[INSN_SAR_IMM_REG]			= USE_DST | DEF_DST,
 	[INSN_SAR_REG_REG]			= USE_SRC | USE_DST | DEF_DST,
+	[INSN_SATB_MEMBASE_REG]			= USE_SRC | DEF_DST,
+	[INSN_SATB_MEMINDEX_REG]		= USE_SRC | USE_IDX_SRC | DEF_DST,
 	[INSN_SBB_IMM_REG]			= USE_DST | DEF_DST,
 	[INSN_SBB_MEMBASE_REG]			= USE_SRC | USE_DST | DEF_DST,
 	[INSN_SBB_REG_REG]			= USE_SRC | USE_DST | DEF_DST,
@@ -700,6 +707,8 @@ static unsigned long insn_flags[] = {
 	[INSN_SUB_REG_REG]			= USE_SRC | USE_DST | DEF_DST,
 	[INSN_TEST_IMM_MEMDISP]			= USE_NONE | DEF_NONE,
 	[INSN_TEST_MEMBASE_REG]			= USE_SRC | USE_DST | DEF_NONE,
+	[INSN_TLAB_ALLOC_IMM]			= USE_NONE | DEF_NONE | TYPE_CALL,
+	[INSN_TLAB_ALLOC_ARRAY_IMM]		= USE_NONE | DEF_NONE | TYPE_CALL,
 	[INSN_XOR_64_XMM_REG_REG]		= USE_SRC | USE_DST | DEF_DST,
 	[INSN_XOR_MEMBASE_REG]			= USE_SRC | USE_DST | DEF_DST,
 	[INSN_XOR_REG_REG]			= USE_SRC | USE_DST | DEF_DST,
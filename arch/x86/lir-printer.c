@@ -252,6 +252,12 @@ static int print_adc_reg_reg(struct string *str, struct insn *insn)
 	return print_reg_reg(str, insn);
 }
 
+static int print_add_imm_memdisp(struct string *str, struct insn *insn)
+{
+	print_func_name(str);
+	return print_imm_memdisp(str, insn);
+}
+
 static int print_add_imm_reg(struct string *str, struct insn *insn)
 {
 	print_func_name(str);
@@ -428,6 +434,12 @@ static int print_call_rel(struct string *str, struct insn *insn)
 	return print_rel(str, &insn->operand);
 }
 
+static int print_card_mark_reg_reg(struct string *str, struct insn *insn)
+{
+	print_func_name(str);
+	return print_reg_reg(str, insn);
+}
+
 static int print_cltd_reg_reg(struct string *str, struct insn *insn)	/* CDQ in Intel manuals*/
 {
 	print_func_name(str);
@@ -464,6 +476,16 @@ static int print_div_reg_reg(struct string *str, struct insn *insn)
 	return print_reg_reg(str, insn);
 }
 
+static int print_monitor_enter(struct string *str, struct insn *insn)
+{
+	return print_func_name(str);
+}
+
+static int print_monitor_exit(struct string *str, struct insn *insn)
+{
+	return print_func_name(str);
+}
+
 static int print_mov_membase_xmm(struct string *str, struct insn *insn)
 {
 	print_func_name(str);
@@ -524,6 +546,12 @@ static int print_conv_xmm64_to_xmm(struct string *str, struct insn *insn)
 	return print_reg_reg(str, insn);
 }
 
+static int print_ic_call_imm_reg(struct string *str, struct insn *insn)
+{
+	print_func_name(str);
+	return print_imm_reg(str, insn);
+}
+
 static int print_je_branch(struct string *str, struct insn *insn)
 {
 	print_func_name(str);
@@ -868,6 +896,18 @@ static int print_sar_reg_reg(struct string *str, struct insn *insn)
 	return print_reg_reg(str, insn);
 }
 
+static int print_satb_membase_reg(struct string *str, struct insn *insn)
+{
+	print_func_name(str);
+	return print_membase_reg(str, insn);
+}
+
+static int print_satb_memindex_reg(struct string *str, struct insn *insn)
+{
+	print_func_name(str);
+	return print_memindex_reg(str, insn);
+}
+
 static int print_sbb_imm_reg(struct string *str, struct insn *insn)
 {
 	print_func_name(str);
@@ -928,6 +968,18 @@ static int print_test_membase_reg(struct string *str, struct insn *insn)
 	return print_membase_reg(str, insn);
 }
 
+static int print_tlab_alloc_imm(struct string *str, struct insn *insn)
+{
+	print_func_name(str);
+	return print_imm(str, &insn->operand);
+}
+
+static int print_tlab_alloc_array_imm(struct string *str, struct insn *insn)
+{
+	print_func_name(str);
+	return print_imm(str, &insn->operand);
+}
+
 static int print_xor_membase_reg(struct string *str, struct insn *insn)
 {
 	print_func_name(str);
@@ -958,6 +1010,7 @@ static print_insn_fn insn_printers[] = {
 	[INSN_ADC_IMM_REG] = print_adc_imm_reg,
 	[INSN_ADC_MEMBASE_REG] = print_adc_membase_reg,
 	[INSN_ADC_REG_REG] = print_adc_reg_reg,
+	[INSN_ADD_IMM_MEMDISP] = print_add_imm_memdisp,
 	[INSN_ADD_IMM_REG] = print_add_imm_reg,
 	[INSN_ADD_MEMBASE_REG] = print_add_membase_reg,
 	[INSN_ADD_REG_REG] = print_add_reg_reg,
@@ -965,6 +1018,7 @@ static print_insn_fn insn_printers[] = {
 	[INSN_AND_REG_REG] = print_and_reg_reg,
 	[INSN_CALL_REG] = print_call_reg,
 	[INSN_CALL_REL] = print_call_rel,
+	[INSN_CARD_MARK_REG_REG] = print_card_mark_reg_reg,
 	[INSN_CLTD_REG_REG] = print_cltd_reg_reg,	/* CDQ in Intel manuals*/
 	[INSN_CMP_IMM_REG] = print_cmp_imm_reg,
 	[INSN_CMP_MEMBASE_REG] = print_cmp_membase_reg,
@@ -1003,6 +1057,7 @@ static print_insn_fn insn_printers[] = {
 	[INSN_CONV_GPR_TO_FPU64] = print_conv_gpr_to_fpu64,
 	[INSN_CONV_XMM_TO_XMM64] = print_conv_xmm_to_xmm64,
 	[INSN_CONV_XMM64_TO_XMM] = print_conv_xmm64_to_xmm,
+	[INSN_IC_CALL_IMM_REG] = print_ic_call_imm_reg,
 	[INSN_JE_BRANCH] = print_je_branch,
 	[INSN_JGE_BRANCH] = print_jge_branch,
 	[INSN_JG_BRANCH] = print_jg_branch,
@@ -1012,6 +1067,8 @@ static print_insn_fn insn_printers[] = {
 	[INSN_JMP_MEMBASE] = print_jmp_membase,
 	[INSN_JMP_MEMINDEX] = print_jmp_memindex,
 	[INSN_JNE_BRANCH] = print_jne_branch,
+	[INSN_MONITOR_ENTER] = print_monitor_enter,
+	[INSN_MONITOR_EXIT] = print_monitor_exit,
 	[INSN_MOV_IMM_MEMBASE] = print_mov_imm_membase,
 	[INSN_MOV_IMM_MEMLOCAL] = print_mov_imm_memlocal,
 	[INSN_MOV_IMM_REG] = print_mov_imm_reg,
@@ -1060,6 +1117,8 @@ static print_insn_fn insn_printers[] = {
 	[INSN_RET] = print_ret,
 	[INSN_SAR_IMM_REG] = print_sar_imm_reg,
 	[INSN_SAR_REG_REG] = print_sar_reg_reg,
+	[INSN_SATB_MEMBASE_REG] = print_satb_membase_reg,
+	[INSN_SATB_MEMINDEX_REG] = print_satb_memindex_reg,
 	[INSN_SBB_IMM_REG] = print_sbb_imm_reg,
 	[INSN_SBB_MEMBASE_REG] = print_sbb_membase_reg,
 	[INSN_SBB_REG_REG] = print_sbb_reg_reg,
@@ -1070,6 +1129,8 @@ static print_insn_fn insn_printers[] = {
 	[INSN_SUB_REG_REG] = print_sub_reg_reg,
 	[INSN_TEST_IMM_MEMDISP] = print_test_imm_memdisp,
 	[INSN_TEST_MEMBASE_REG] = print_test_membase_reg,
+	[INSN_TLAB_ALLOC_IMM] = print_tlab_alloc_imm,
+	[INSN_TLAB_ALLOC_ARRAY_IMM] = print_tlab_alloc_array_imm,
 	[INSN_XOR_MEMBASE_REG] = print_xor_membase_reg,
 	[INSN_XOR_REG_REG] = print_xor_reg_reg,
 	[INSN_XOR_XMM_REG_REG] = print_xor_xmm_reg_reg,
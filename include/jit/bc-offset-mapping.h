@@ -10,11 +10,55 @@
 
 #include "lib/string.h"
 #include <limits.h>
+#include <stdint.h>
 
 #define BC_OFFSET_UNKNOWN ULONG_MAX
 
+/*
+ * Bytecode offsets of code inlined from another method carry the index of
+ * the inlined call, counting from one, above the offset in the callee's
+ * bytecode. Offsets of the method itself have zero there.
+ */
+#define BC_OFFSET_INLINE_SHIFT	16
+#define BC_OFFSET_PC_MASK	((1UL << BC_OFFSET_INLINE_SHIFT) - 1)
+
+struct inline_call {
+	struct vm_method	*method;
+
+	/* Offset of the invoke instruction, may be inlined itself. */
+	unsigned long		call_bc_offset;
+};
+
+unsigned long cu_add_inline_call(struct compilation_unit *cu,
+				 struct vm_method *method,
+				 unsigned long call_bc_offset);
+struct vm_method *bc_offset_method(struct compilation_unit *cu,
+				   unsigned long bc_offset);
+unsigned long bc_offset_caller(struct compilation_unit *cu,
+			       unsigned long bc_offset);
+unsigned long bc_offset_outermost(struct compilation_unit *cu,
+				  unsigned long bc_offset);
+unsigned int bc_offset_inline_depth(struct compilation_unit *cu,
+				    unsigned long bc_offset);
+
+static inline bool bc_offset_is_inlined(unsigned long bc_offset)
+{
+	return bc_offset != BC_OFFSET_UNKNOWN &&
+		(bc_offset >> BC_OFFSET_INLINE_SHIFT) != 0;
+}
+
+static inline unsigned long bc_offset_pc(unsigned long bc_offset)
+{
+	if (bc_offset == BC_OFFSET_UNKNOWN)
+		return BC_OFFSET_UNKNOWN;
+
+	return bc_offset & BC_OFFSET_PC_MASK;
+}
+
 unsigned long jit_lookup_bc_offset(struct compilation_unit *cu,
 				   unsigned char *native_ptr);
+unsigned long jit_lookup_inline_bc_offset(struct compilation_unit *cu,
+					  unsigned char *native_ptr);
 void print_bytecode_offset(unsigned long bc_offset, struct string *str);
 void tree_patch_bc_offset(struct tree_node *node, unsigned long bc_offset);
 bool all_insn_have_bytecode_offset(struct compilation_unit *cu);
@@ -24,7 +68,7 @@ int build_bc_offset_map(struct compilation_unit *cu);
 static inline void insn_set_bc_offset(struct insn *insn, unsigned long offset)
 {
 	if (offset != BC_OFFSET_UNKNOWN) {
-		if (offset > USHRT_MAX)
+		if (offset > UINT32_MAX)
 			die("bytecode offset is too big");
 		insn->flags	|= INSN_FLAG_KNOWN_BC_OFFSET;
 		insn->bc_offset	= offset;
@@ -168,4 +168,24 @@ DECLARE_CONVERTER(xreturn);
 
 int convert_instruction(struct parse_context *ctx);
 
+/*
+ * State of a method that is being inlined into the compilation unit. The
+ * local variables of the method are kept in temporaries of the caller.
+ */
+struct inline_frame {
+	struct inline_frame	*parent;
+	struct vm_method	*method;
+	unsigned int		depth;
+
+	struct expression	**locals;
+	unsigned long		nr_locals;
+
+	/* Size of the caller's part of the mimic stack. */
+	unsigned long		stack_base;
+};
+
+struct expression *local_var_expr(struct parse_context *ctx,
+				  enum vm_type type, unsigned long idx);
+int convert_inlined_method(struct parse_context *ctx, unsigned long bc_offset);
+
 #endif /* JIT_BYTECODE_TO_IR_H */
@@ -0,0 +1,54 @@
+#ifndef JIT_CHA_H
+#define JIT_CHA_H
+
+#include "lib/list.h"
+
+#include <stdbool.h>
+
+struct compilation_unit;
+struct insn;
+struct vm_class;
+struct vm_method;
+
+/*
+ * A virtual or interface call site that class hierarchy analysis bound to
+ * its only possible target. The site is a plain direct call which is
+ * patched back to dynamic dispatch if a class loaded later on invalidates
+ * the assumption it was compiled under.
+ */
+struct cha_site {
+	struct compilation_unit	*cu;
+
+	/* The method named at the call site and the one it was bound to. */
+	struct vm_method	*method;
+	struct vm_method	*target;
+
+	/*
+	 * The call instruction is only valid until the code is emitted,
+	 * see cha_prepare_sites().
+	 */
+	struct insn		*call_insn;
+	unsigned long		mach_offset;
+
+	bool			ready;
+	bool			invalid;
+
+	/* vm_method::cha_site_list or vm_class::cha_site_list */
+	struct list_head	dependency_node;
+	struct list_head	cu_node;
+};
+
+struct cha_site *cha_bind_invoke(struct compilation_unit *cu, struct vm_method *method);
+void cha_prepare_sites(struct compilation_unit *cu);
+void cha_free_sites(struct compilation_unit *cu);
+
+void cha_method_overridden(struct vm_method *vmm);
+void cha_add_implementor(struct vm_class *vmc);
+
+/*
+ * Architecture specific patching of the direct call of @site. Called with
+ * the CHA lock held.
+ */
+void cha_patch_call_site(struct cha_site *site, void *target);
+
+#endif /* JIT_CHA_H */
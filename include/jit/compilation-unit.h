@@ -12,9 +12,11 @@
 #include "arch/stack-frame.h"
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <pthread.h>
 
 struct buffer;
+struct inline_call;
 struct vm_method;
 struct insn;
 enum machine_reg;
@@ -33,6 +35,28 @@ struct compilation_unit {
 	bool is_compiled;
 	pthread_mutex_t mutex;
 
+	/*
+	 * Number of calls that went through the trampoline or, for baseline
+	 * code, entered the method. Baseline code also counts the loop
+	 * iterations in ->nr_backedges. Neither count is exact.
+	 */
+	uint32_t nr_invocations;
+	uint32_t nr_backedges;
+
+	/* State in the background compile queue, see jit/compile-queue.c. */
+	bool is_queued;
+	bool is_hot;
+	unsigned long compile_priority;
+
+	/*
+	 * Baseline code is compiled without the expensive optimizations and
+	 * jumps through ->tier_entry at its entry so that callers can be sent
+	 * to the optimized code once the method is recompiled.
+	 */
+	bool is_baseline;
+	void *tier_entry;
+	struct list_head baseline_node;
+
 	/* The frame pointer for this method.  */
 	struct var_info *frame_ptr;
 
@@ -63,6 +87,7 @@ struct compilation_unit {
 
 	struct list_head static_fixup_site_list;
 	struct list_head call_fixup_site_list;
+	struct list_head cha_site_list;
 	struct list_head tableswitch_list;
 	struct list_head lookupswitch_list;
 
@@ -81,6 +106,13 @@ struct compilation_unit {
 	 */
 	unsigned long *bc_offset_map;
 
+	/*
+	 * Call sites whose target was inlined into this method. Indexed
+	 * by the call index of inlined bytecode offsets.
+	 */
+	struct inline_call *inline_calls;
+	unsigned long nr_inline_calls;
+
 	/*
 	 * This maps LIR offset to instruction.
 	 */
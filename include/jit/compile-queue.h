@@ -0,0 +1,31 @@
+#ifndef JIT_COMPILE_QUEUE_H
+#define JIT_COMPILE_QUEUE_H
+
+#include <stdbool.h>
+
+struct compilation_unit;
+
+/*
+ * Number of background compiler threads. Zero disables background
+ * compilation, a negative value picks a default based on the number of
+ * CPUs.
+ */
+extern int opt_nr_compiler_threads;
+
+/*
+ * Compile methods with the baseline tier first and recompile them once
+ * they have been entered about opt_compile_threshold times. Requires
+ * background compiler threads and x86-32. Off by default.
+ */
+extern bool opt_tiered_compilation;
+extern unsigned long opt_compile_threshold;
+
+void compile_queue_init(void);
+bool compile_queue_submit(struct compilation_unit *cu, unsigned long priority);
+void compile_queue_add_baseline(struct compilation_unit *cu);
+void compile_queue_drop_baseline(struct compilation_unit *cu);
+bool compile_queue_is_compiler_thread(void);
+bool compile_queue_is_enabled(void);
+bool compile_queue_is_tiered(void);
+
+#endif /* JIT_COMPILE_QUEUE_H */
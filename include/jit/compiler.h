@@ -15,6 +15,7 @@
 struct vm_method;
 struct compilation_unit;
 struct expression;
+struct inline_frame;
 struct statement;
 struct buffer;
 
@@ -44,6 +45,13 @@ struct parse_context {
 	struct compilation_unit *cu;
 	struct basic_block *bb;
 
+	/*
+	 * The method whose bytecode is being converted. This differs from
+	 * cu->method when converting an inlined method.
+	 */
+	struct vm_method *method;
+	struct inline_frame *inline_frame;
+
 	struct bytecode_buffer *buffer;
 	unsigned char *code;
 	unsigned long offset;
@@ -61,12 +69,17 @@ void do_convert_statement(struct basic_block *bb, struct statement *stmt,
 int compile(struct compilation_unit *);
 int analyze_control_flow(struct compilation_unit *);
 int convert_to_ir(struct compilation_unit *);
+int analyze_escapes(struct compilation_unit *);
+void coarsen_locks(struct compilation_unit *);
 int analyze_liveness(struct compilation_unit *);
 int select_instructions(struct compilation_unit *cu);
 int allocate_registers(struct compilation_unit *cu);
 int insert_spill_reload_insns(struct compilation_unit *cu);
 int emit_machine_code(struct compilation_unit *);
+void trampoline_init(void);
 void *jit_magic_trampoline(struct compilation_unit *);
+void *jit_compile_method(struct compilation_unit *);
+void *jit_recompile_method(struct compilation_unit *);
 
 struct jit_trampoline *alloc_jit_trampoline(void);
 struct jit_trampoline *build_jit_trampoline(struct compilation_unit *);
@@ -15,6 +15,7 @@ extern void emit_trace_invoke(struct buffer *, struct compilation_unit *);
 extern void emit_epilog(struct buffer *);
 extern void emit_trampoline(struct compilation_unit *, void *, struct jit_trampoline *);
 extern void emit_unwind(struct buffer *);
+extern void emit_tier_entry(struct buffer *, void **);
 extern void emit_lock(struct buffer *, struct vm_object *);
 extern void emit_lock_this(struct buffer *);
 extern void emit_unlock(struct buffer *, struct vm_object *);
@@ -25,5 +26,7 @@ extern void emit_nop(struct buffer *buf);
 extern void backpatch_branch_target(struct buffer *buf, struct insn *insn,
 				    unsigned long target_offset);
 extern void emit_jni_trampoline(struct buffer *, struct vm_method *, void *);
+extern void *emit_itable_stub(struct vm_method *);
+extern void *emit_tls_return_stub(void *);
 
 #endif /* JATO_EMIT_CODE_H */
@@ -1,10 +1,13 @@
 #ifndef JIT_GDB_H
 #define JIT_GDB_H
 
+struct compilation_unit;
+struct vm_method;
+
 #ifdef CONFIG_GDB
 
 extern void gdb_init(void);
-extern void gdb_register_method(struct vm_method *method);
+extern void gdb_register_method(struct compilation_unit *cu);
 extern void gdb_register_trampoline(struct vm_method *method);
 
 #else /* CONFIG_GDB */
@@ -13,7 +16,7 @@ static inline void gdb_init(void)
 {
 }
 
-static inline void gdb_register_method(struct vm_method *method)
+static inline void gdb_register_method(struct compilation_unit *cu)
 {
 }
 
@@ -0,0 +1,63 @@
+#ifndef JIT_INLINE_CACHE_H
+#define JIT_INLINE_CACHE_H
+
+#include <stdbool.h>
+
+struct vm_class;
+struct vm_method;
+struct vm_object;
+
+/*
+ * Number of receiver classes a call site dispatches to directly before it
+ * is considered megamorphic: one checked inline at the call site and the
+ * rest in a polymorphic inline cache (PIC) stub.
+ */
+#define INLINE_CACHE_MAX_CLASSES	4
+#define INLINE_CACHE_STUB_ENTRIES	(INLINE_CACHE_MAX_CLASSES - 1)
+
+enum inline_cache_state {
+	INLINE_CACHE_UNINITIALIZED,
+	INLINE_CACHE_MONOMORPHIC,
+	INLINE_CACHE_POLYMORPHIC,
+	INLINE_CACHE_MEGAMORPHIC,
+};
+
+/*
+ * Patchable inline cache of an invokevirtual or invokeinterface call site.
+ * The call site compares the receiver class against the cached class and
+ * calls the cached target directly. Otherwise it calls the slow path target
+ * which is inline_cache_miss_trampoline() at first, then the PIC stub and
+ * finally a plain vtable or itable dispatch. Inline caches live as long as
+ * the code that uses them.
+ */
+struct inline_cache {
+	enum inline_cache_state	state;
+	struct vm_method	*method;	/* interface method for invokeinterface */
+
+	unsigned int		nr_classes;
+	struct vm_class		*classes[INLINE_CACHE_MAX_CLASSES];
+
+	/* Machine code of the call site and of the PIC stub. */
+	void			*site;
+	void			*stub;
+	void			*megamorphic_entry;
+};
+
+struct inline_cache *alloc_inline_cache(struct vm_method *method);
+bool inline_cache_is_interface(struct inline_cache *ic);
+void *inline_cache_megamorphic_stub(struct vm_method *method);
+void *inline_cache_miss(struct inline_cache *ic, struct vm_object *receiver);
+void inline_cache_miss_trampoline(void);
+
+/*
+ * Architecture specific patching of the call site and the PIC stub. Called
+ * with the inline cache lock held.
+ */
+void inline_cache_patch_monomorphic(struct inline_cache *ic,
+				    struct vm_class *vmc, void *target);
+int inline_cache_emit_stub(struct inline_cache *ic);
+void inline_cache_patch_stub_entry(struct inline_cache *ic, unsigned int idx,
+				   struct vm_class *vmc, void *target);
+void inline_cache_patch_slow_path(struct inline_cache *ic, void *target);
+
+#endif /* JIT_INLINE_CACHE_H */
@@ -10,6 +10,9 @@ struct vtable {
 void vtable_init(struct vtable *vtable, unsigned int nr_methods);
 void vtable_release(struct vtable *vtable);
 void vtable_setup_method(struct vtable *vtable, unsigned long idx, void *native_ptr);
+void vtable_lock(void);
+void vtable_unlock(void);
 void fixup_vtable(struct compilation_unit *cu, void *target);
+void repoint_vtable(struct compilation_unit *cu, void *old, void *target);
 
 #endif /* __JIT_VTABLE_H */
@@ -0,0 +1,34 @@
+#ifndef LIB_FUTEX_H
+#define LIB_FUTEX_H
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Thin wrappers around the futex(2) system call. Futexes are only shared
+ * between threads of this process so the private variants are used.
+ */
+
+/*
+ * Sleeps as long as *@uaddr equals @val. @deadline is an absolute
+ * CLOCK_MONOTONIC time or NULL to sleep until woken. Returns 0 when woken,
+ * otherwise -1 with errno set to EAGAIN, EINTR or ETIMEDOUT.
+ */
+static inline int futex_wait(volatile uint32_t *uaddr, uint32_t val,
+			     const struct timespec *deadline)
+{
+	return syscall(SYS_futex, uaddr, FUTEX_WAIT_BITSET | FUTEX_PRIVATE_FLAG,
+		       val, deadline, NULL, FUTEX_BITSET_MATCH_ANY);
+}
+
+/* Wakes up at most @nr threads sleeping on @uaddr. */
+static inline int futex_wake(volatile uint32_t *uaddr, int nr)
+{
+	return syscall(SYS_futex, uaddr, FUTEX_WAKE | FUTEX_PRIVATE_FLAG,
+		       nr, NULL, NULL, 0);
+}
+
+#endif
@@ -0,0 +1,27 @@
+#ifndef LIB_WS_DEQUE_H
+#define LIB_WS_DEQUE_H
+
+#include <stdbool.h>
+
+/*
+ * Fixed size work-stealing deque. The owning thread pushes and pops at the
+ * bottom end while other threads steal from the top end.
+ */
+struct ws_deque {
+	volatile long		top;
+	volatile long		bottom;
+	unsigned long		mask;
+	void			**elements;
+};
+
+int init_ws_deque(struct ws_deque *deque, unsigned long size);
+bool ws_deque_push(struct ws_deque *deque, void *element);
+void *ws_deque_pop(struct ws_deque *deque);
+void *ws_deque_steal(struct ws_deque *deque);
+
+static inline bool ws_deque_is_empty(struct ws_deque *deque)
+{
+	return deque->bottom <= deque->top;
+}
+
+#endif
@@ -1,10 +1,16 @@
 #ifndef RUNTIME_RUNTIME_H
 #define RUNTIME_RUNTIME_H
 
+#include "vm/jni.h"
+
 struct vm_object;
 
 void native_vmruntime_exit(int status);
 void native_vmruntime_run_finalization_for_exit(void);
+void native_vmruntime_gc(void);
+jlong native_vmruntime_free_memory(void);
+jlong native_vmruntime_total_memory(void);
+jlong native_vmruntime_max_memory(void);
 struct vm_object *native_vmruntime_maplibraryname(struct vm_object *name);
 int native_vmruntime_native_load(struct vm_object *name,
 				 struct vm_object *classloader);
@@ -4,6 +4,8 @@
 #include <assert.h>
 #include <pthread.h>
 
+#include "arch/memory.h"
+
 #include "vm/field.h"
 #include "vm/itable.h"
 #include "vm/method.h"
@@ -61,6 +63,13 @@ struct vm_class {
 	unsigned int vtable_size;
 	struct vtable vtable;
 
+	/*
+	 * Loaded direct subclasses which have a vtable of their own, linked
+	 * through ->subclass_node. Protected by vtable_lock().
+	 */
+	struct list_head subclasses;
+	struct list_head subclass_node;
+
 	/* The java.lang.Class object representing this class */
 	struct vm_object *object;
 
@@ -85,7 +94,17 @@ struct vm_class {
 	   NULL for default classloader. */
 	struct vm_object *classloader;
 
-	void *itable[VM_ITABLE_SIZE];
+	/* Interfaces only, see vm_itable_setup_interface() */
+	unsigned int interface_id;
+	unsigned int nr_itable_methods;
+
+	/* Interfaces only, see cha_add_implementor() */
+	struct vm_class *cha_implementor;
+	bool has_many_implementors;
+	struct list_head cha_site_list;
+
+	/* Interface method dispatch of regular classes, see vm/itable.c */
+	struct vm_itable itable;
 };
 
 int vm_class_link(struct vm_class *vmc, const struct cafebabe_class *class);
@@ -94,8 +113,32 @@ int vm_class_link_array_class(struct vm_class *vmc, struct vm_class *elem_class,
 int vm_class_init(struct vm_class *vmc);
 int vm_class_ensure_object(struct vm_class *vmc);
 
+/*
+ * Reads the state of @vmc without taking the class monitor. The load has
+ * acquire semantics (x86 does not reorder loads with later loads) so once
+ * VM_CLASS_INITIALIZED is observed, everything the class initializer wrote
+ * is visible as well.
+ */
+static inline enum vm_class_state vm_class_get_state(const struct vm_class *vmc)
+{
+	enum vm_class_state state;
+
+	state = *(volatile enum vm_class_state *) &vmc->state;
+	barrier();
+
+	return state;
+}
+
+static inline bool vm_class_is_initialized(const struct vm_class *vmc)
+{
+	return vm_class_get_state(vmc) == VM_CLASS_INITIALIZED;
+}
+
 static inline int vm_class_ensure_init(struct vm_class *vmc)
 {
+	if (vm_class_is_initialized(vmc))
+		return 0;
+
 	return vm_class_init(vmc);
 }
 
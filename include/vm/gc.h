@@ -3,16 +3,51 @@
 
 #include <stdbool.h>
 #include <signal.h>
+#include <stdint.h>
 
 struct register_state;
+struct heap_tlab;
+struct vm_object;
 
 extern void *gc_safepoint_page;
+extern __thread struct heap_tlab current_tlab;
 extern bool verbose_gc;
 extern bool gc_enabled;
 
+#define GC_DEFAULT_TRIGGER_PERCENT	80
+#define GC_DEFAULT_NURSERY_SIZE		(4UL * 1024 * 1024)
+
+extern unsigned int gc_trigger_percent;
+extern unsigned long gc_nursery_size;
+extern unsigned int gc_nr_workers;
+extern bool gc_concurrent_mark;
+
+extern volatile bool gc_marking;
+extern struct vm_object **gc_satb_log;
+extern uint32_t gc_satb_log_top;
+
 void gc_init(void);
+void gc_attach_thread(void);
+void gc_detach_thread(void);
 
 void *gc_alloc(size_t size);
+void gc_collect(void);
+void gc_safepoint_operation(void (*fn)(void *), void *arg);
+void gc_register_root(struct vm_object **root);
+void gc_print_stats(void);
+void gc_write_barrier(struct vm_object *obj);
+void gc_satb_log_object(struct vm_object *obj);
+
+/*
+ * Snapshot-at-the-beginning barrier for reference stores done by the VM
+ * itself. It must be called with the reference which is about to be
+ * overwritten. JIT compiled code does the same inline.
+ */
+static inline void gc_satb_barrier(struct vm_object *old)
+{
+	if (gc_marking && old)
+		gc_satb_log_object(old);
+}
 
 void gc_safepoint(struct register_state *);
 void suspend_handler(int, siginfo_t *, void *);
@@ -0,0 +1,127 @@
+#ifndef __VM_HEAP_H
+#define __VM_HEAP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+struct vm_object;
+
+/*
+ * Every heap chunk starts with a header word. The chunk size (including the
+ * header) is always a multiple of HEAP_ALIGN so the low bits of the header
+ * are free to hold the chunk flags.
+ */
+struct heap_header {
+	unsigned long		word;
+} __attribute__((aligned(8)));
+
+#define HEAP_ALIGN		8UL
+
+/* A free chunk needs room for the header and the free list link. */
+#define HEAP_MIN_CHUNK		(2 * HEAP_ALIGN)
+
+#define HEAP_CHUNK_FREE		(1UL << 0)
+#define HEAP_CHUNK_MARK		(1UL << 1)
+#define HEAP_CHUNK_OLD		(1UL << 2)	/* survived a collection */
+#define HEAP_CHUNK_FLAGS	(HEAP_ALIGN - 1)
+
+#define HEAP_DEFAULT_MIN_SIZE	(16UL * 1024 * 1024)
+#define HEAP_DEFAULT_MAX_SIZE	(256UL * 1024 * 1024)
+
+#define HEAP_TLAB_SIZE		(64UL * 1024)
+
+/* Every card covers 2^HEAP_CARD_SHIFT bytes of the heap. */
+#define HEAP_CARD_SHIFT		9
+#define HEAP_CARD_SIZE		(1UL << HEAP_CARD_SHIFT)
+
+/*
+ * Thread-local allocation buffer. The owning thread bump allocates chunks
+ * from [top, end) without taking heap_lock(). The memory is cleared when
+ * the buffer is carved from the heap. JIT compiled code accesses this
+ * structure directly.
+ */
+struct heap_tlab {
+	void			*top;
+	void			*end;
+};
+
+static inline unsigned long heap_chunk_size(struct heap_header *hdr)
+{
+	return hdr->word & ~HEAP_CHUNK_FLAGS;
+}
+
+/*
+ * Returns the size of the chunk which holds an object of @size bytes.
+ */
+static inline unsigned long heap_alloc_size(unsigned long size)
+{
+	size = (size + sizeof(struct heap_header) + HEAP_ALIGN - 1) & ~(HEAP_ALIGN - 1);
+	if (size < HEAP_MIN_CHUNK)
+		size = HEAP_MIN_CHUNK;
+
+	return size;
+}
+
+static inline struct heap_header *heap_object_header(struct vm_object *obj)
+{
+	return (struct heap_header *) obj - 1;
+}
+
+extern unsigned long heap_min_size;
+extern unsigned long heap_max_size;
+
+/*
+ * The card table biased by the start of the heap so that the card of
+ * address p is heap_card_base[p >> HEAP_CARD_SHIFT]. JIT compiled code
+ * marks cards through this pointer directly.
+ */
+extern unsigned char *heap_card_base;
+
+/*
+ * Records that a reference has been stored into the object at @p. The
+ * next minor collection scans every old object on a dirty card for
+ * references to young objects.
+ */
+static inline void heap_mark_card(void *p)
+{
+	heap_card_base[(unsigned long) p >> HEAP_CARD_SHIFT] = 1;
+}
+
+/*
+ * Header bits of newly allocated chunks. Objects are allocated marked while
+ * a concurrent mark is in progress. JIT compiled code reads this directly.
+ */
+extern unsigned long heap_alloc_bits;
+
+int heap_init(void);
+void *heap_alloc(size_t size);
+void *heap_tlab_bump(struct heap_tlab *tlab, size_t size);
+void *heap_tlab_alloc(struct heap_tlab *tlab, size_t size);
+unsigned long heap_used(void);
+unsigned long heap_young(void);
+unsigned long heap_capacity(void);
+bool heap_expand(size_t size);
+void heap_resize(unsigned long size);
+
+void heap_lock(void);
+void heap_unlock(void);
+
+/*
+ * The following functions are only to be used by the garbage collector
+ * while the world is stopped and heap_lock() is held.
+ */
+void heap_prepare_collection(void);
+void heap_prepare_minor_collection(void);
+void heap_prepare_concurrent_collection(void);
+void heap_abort_collection(void);
+struct vm_object *heap_lookup_object(void *p);
+struct vm_object *heap_lookup_interior(void *p);
+bool heap_mark_object(struct vm_object *obj);
+bool heap_object_is_live(struct vm_object *obj);
+void heap_retire_tlab(struct heap_tlab *tlab);
+void heap_scan_dirty_cards(void (*fn)(struct vm_object *));
+unsigned long heap_sweep(void);
+unsigned long heap_sweep_young(void);
+unsigned long heap_max_objects(void);
+
+#endif
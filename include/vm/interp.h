@@ -0,0 +1,37 @@
+#ifndef JATO_VM_INTERP_H
+#define JATO_VM_INTERP_H
+
+#include <stdbool.h>
+
+#include "vm/jni.h"
+
+struct vm_method;
+
+/*
+ * An interpreted method invocation. Interpreted methods run in native
+ * frames which the stack walker skips, see get_intermediate_stack_trace().
+ */
+struct interp_frame {
+	struct vm_method	*method;
+
+	/* Bytecode offset of the instruction being executed */
+	unsigned long		pc;
+
+	/* Frame of interp_call_method(), orders it with compiled frames */
+	void			*native_frame;
+
+	struct interp_frame	*prev;
+};
+
+/*
+ * Execute class initializers, and the cold methods they call, with the
+ * bytecode interpreter instead of compiling them.
+ */
+extern bool opt_interpreter;
+
+bool interp_can_execute(struct vm_method *vmm);
+struct interp_frame *interp_current_frame(void);
+void interp_call_method(struct vm_method *vmm, unsigned long *args,
+			union jvalue *result);
+
+#endif /* JATO_VM_INTERP_H */
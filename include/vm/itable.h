@@ -3,27 +3,55 @@
 
 #include <stdbool.h>
 
-#include "lib/list.h"
-
 extern bool opt_trace_itable;
 
-/* Tunable for the interface method table. Set it too low and we will get
- * conflicts between different methods wanting the same slot in the itable.
- * Set it too high, and we waste a lot of memory per class we load. */
-#define VM_ITABLE_SIZE 8
-
 struct vm_class;
 struct vm_method;
 
-struct itable_entry {
-	struct vm_method *i_method;
-	struct vm_method *c_method;
-	struct list_head node;
+/*
+ * Every interface gets a small integer ID when it is linked and each of its
+ * abstract methods an index into the interface (vm_method::itable_index). A
+ * class has one block of entry points per interface it implements, directly
+ * or through its superclasses and superinterfaces. The blocks are kept in an
+ * array sorted by interface ID and terminated by ITABLE_END, which the
+ * dispatch stubs scan for the interface:
+ *
+ *	vmc->itable.table[i].entries[itable_index]
+ *
+ * so a class only pays for the interfaces it implements, however many are
+ * loaded. Interface IDs are handed out in link order, which puts the
+ * interfaces that are loaded early and used everywhere at the front.
+ */
+struct vm_itable_entry {
+	/* The dispatch stubs rely on these two coming first. */
+	unsigned long interface_id;
+	void **entries;
+
+	/*
+	 * Vtable index of every entry. Overriding methods keep the vtable
+	 * index of the method they override so these are shared with the
+	 * superclass where possible.
+	 */
+	unsigned int *vtable_index;
+	struct vm_class *interface;
+};
+
+/* Interface ID of the entry which terminates vm_itable::table. */
+#define ITABLE_END (~0UL)
+
+struct vm_itable {
+	/* NULL for classes which implement no interfaces. */
+	struct vm_itable_entry *table;
+	unsigned int nr_interfaces;
 };
 
+/* Vtable index of itable entries without an implementation. */
+#define ITABLE_NO_METHOD (~0U)
+
+void vm_itable_setup_interface(struct vm_class *vmc);
 int vm_itable_setup(struct vm_class *vmc);
-unsigned int itable_hash(struct vm_method *vmm);
-void *emit_itable_resolver_stub(struct vm_class *vmc,
-	struct itable_entry **sorted_table, unsigned int nr_entries);
+void *vm_itable_lookup(struct vm_class *vmc, struct vm_method *i_method);
+void *vm_itable_stub(struct vm_method *i_method);
+void vm_itable_fixup(struct vm_class *vmc, unsigned long vtable_index, void *target);
 
 #endif
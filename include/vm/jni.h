@@ -75,6 +75,7 @@ void vm_jni_init_interface(void);
 struct vm_jni_env *vm_jni_get_jni_env(void);
 struct java_vm *vm_jni_get_current_java_vm(void);
 int vm_jni_load_object(const char *name, struct vm_object *classloader);
+void vm_jni_for_each_classloader(void (*fn)(struct vm_object *));
 void *vm_jni_lookup_method(const char *class_name, const char *method_name,
 			   const char *method_type);
 bool vm_jni_check_trap(void *ptr);
@@ -27,6 +27,12 @@ struct vm_args_map {
 };
 #endif
 
+enum vm_method_interp {
+	VM_METHOD_INTERP_UNKNOWN,
+	VM_METHOD_INTERP_YES,
+	VM_METHOD_INTERP_NO,
+};
+
 struct vm_method_arg {
 	struct vm_type_info type_info;
 	struct list_head list_node;
@@ -55,7 +61,17 @@ struct vm_method {
 	struct compilation_unit *compilation_unit;
 	struct jit_trampoline *trampoline;
 
+	/* Interface dispatch stub, see vm_itable_stub() */
+	void *itable_stub;
+
+	/* Whether the bytecode interpreter can run it, see vm/interp.c */
+	enum vm_method_interp interp;
+
 	bool is_vm_native;
+
+	/* Class hierarchy analysis state, see jit/cha.c */
+	bool is_overridden;
+	struct list_head cha_site_list;
 };
 
 int vm_method_init(struct vm_method *vmm,
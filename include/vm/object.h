@@ -5,37 +5,81 @@
 #include <stdbool.h>
 #include <stdint.h>
 
+#include "lib/list.h"
+
 #include "vm/jni.h"
 #include "vm/field.h"
 #include "vm/thread.h"
+#include "vm/gc.h"
 #include "vm/vm.h"
 
+struct monitor_profile;
 struct vm_class;
+struct vm_method;
 enum vm_type;
 
 struct vm_monitor {
 	pthread_mutex_t mutex;
-	pthread_cond_t cond;
 
-	/* Holds the owner of this monitor or NULL when not locked. */
-	struct vm_thread *owner;
+	/*
+	 * Threads blocked in wait() on this monitor, and notified threads
+	 * which are woken one by one as the monitor is released. Both are
+	 * FIFO queues linked through vm_thread::wait_node and protected by
+	 * @mutex.
+	 */
+	struct list_head wait_queue;
+	struct list_head entry_queue;
 
 	/*
-	 * owner field might be read by other threads even if lock on
-	 * @mutex is not held by them. For example vm_monitor_unlock()
-	 * checks if the current thread is the owner of monitor. In
-	 * SMP systems we must either ensure atomicity and use memory
-	 * barriers or use a mutex. The latter approach is choosed.
+	 * Holds the owner of this monitor or NULL when not locked. It is
+	 * read without holding @mutex, for example by vm_monitor_unlock()
+	 * to check that the current thread is the owner, so it must only
+	 * be accessed through vm_monitor_{get,set}_owner().
 	 */
-	pthread_mutex_t owner_mutex;
+	struct vm_thread *owner;
 
 	/*
 	 * Holds the number of recursive locks on this monitor. This
 	 * field is protected by @mutex.
 	 */
 	int lock_count;
+
+	/*
+	 * The object this monitor has been inflated for or NULL for monitors
+	 * which are not attached to an object.
+	 */
+	struct vm_object *object;
+	struct list_head inflated_node;
+
+	/*
+	 * Number of trylock attempts before a contending thread parks.
+	 * Adapted to how long the monitor has recently been held.
+	 */
+	unsigned int spin_limit;
+
+	/* Contention statistics for -Xtrace:monitors. */
+	struct vm_method *owner_method;
+	struct monitor_profile *profile;
 };
 
+/*
+ * The lock word of an object is zero until the object is first locked. A
+ * biased or thin locked word holds the owning vm_thread and a count in the
+ * low bits, which is why vm_threads are VM_LOCK_OWNER_ALIGN aligned. A thin
+ * locked word with VM_LOCK_CONTENDED set has threads waiting for it. An
+ * inflated word points to a vm_monitor. See vm/monitor.c for the details.
+ */
+#define VM_LOCK_INFLATED	(1UL << 0)
+#define VM_LOCK_UNBIASED	(1UL << 1)
+#define VM_LOCK_COUNT_ONE	(1UL << 2)
+#define VM_LOCK_COUNT_MASK	(3UL << 2)
+#define VM_LOCK_CONTENDED	(1UL << 4)
+#define VM_LOCK_BITS		(VM_LOCK_INFLATED | VM_LOCK_UNBIASED | VM_LOCK_COUNT_MASK | VM_LOCK_CONTENDED)
+#define VM_LOCK_OWNER_ALIGN	(VM_LOCK_BITS + 1)
+
+extern bool opt_trace_biased_locking;
+extern bool opt_trace_monitors;
+
 struct vm_object {
 	/* For arrays, this points to the array type, e.g. for int arrays,
 	 * this points to the (artificial) class named "[I". We actually rely
@@ -44,7 +88,7 @@ struct vm_object {
 	 * we access ->class first. */
 	struct vm_class *class;
 
-	struct vm_monitor monitor;
+	unsigned long lock_word;
 
 	jsize array_length;
 	uint8_t fields[];
@@ -53,10 +97,11 @@ struct vm_object {
 /* XXX: BUILD_BUG_ON(offsetof(vm_object, class) != 0); */
 
 int init_vm_objects(void);
-int init_vm_monitors(void);
 
 struct vm_object *vm_object_alloc(struct vm_class *class);
+struct vm_object *vm_object_alloc_initialized(struct vm_class *class);
 struct vm_object *vm_object_alloc_primitive_array(int type, int count);
+struct vm_class *vm_primitive_array_class(int type);
 struct vm_object *vm_object_alloc_multi_array(struct vm_class *class,
 	int nr_dimensions, int *count);
 struct vm_object *vm_object_alloc_array(struct vm_class *class, int count);
@@ -72,8 +117,15 @@ void vm_object_check_null(struct vm_object *obj);
 void vm_object_check_array(struct vm_object *obj, jsize index);
 void vm_object_check_cast(struct vm_object *obj, struct vm_class *class);
 
-void vm_object_lock(struct vm_object *obj);
-void vm_object_unlock(struct vm_object *obj);
+int vm_object_lock(struct vm_object *obj);
+int vm_object_unlock(struct vm_object *obj);
+int vm_object_wait(struct vm_object *obj);
+int vm_object_timed_wait(struct vm_object *obj, long long ms, int ns);
+int vm_object_notify(struct vm_object *obj);
+int vm_object_notify_all(struct vm_object *obj);
+void vm_monitor_reclaim(bool (*is_live)(struct vm_object *));
+void vm_monitor_print_stats(void);
+void vm_monitor_print_profile(void);
 
 void array_store_check(struct vm_object *arrayref, struct vm_object *obj);
 void array_store_check_vmtype(struct vm_object *arrayref, enum vm_type vm_type);
@@ -88,6 +140,7 @@ int vm_monitor_wait(struct vm_monitor *mon);
 int vm_monitor_timed_wait(struct vm_monitor *mon, long long ms, int ns);
 int vm_monitor_notify(struct vm_monitor *mon);
 int vm_monitor_notify_all(struct vm_monitor *mon);
+void vm_monitor_wake_waiter(struct vm_thread *thread);
 struct vm_thread *vm_monitor_get_owner(struct vm_monitor *mon);
 void vm_monitor_set_owner(struct vm_monitor *mon, struct vm_thread *owner);
 
@@ -146,7 +199,22 @@ DECLARE_FIELD_SETTER(double);
 DECLARE_FIELD_SETTER(float);
 DECLARE_FIELD_SETTER(int);
 DECLARE_FIELD_SETTER(long);
-DECLARE_FIELD_SETTER(object);
+
+/*
+ * Reference stores must go through the write barriers so that the collector
+ * finds references from old objects to young ones and references which are
+ * overwritten during a concurrent mark.
+ */
+static inline void
+field_set_object(struct vm_object *obj, const struct vm_field *field,
+		 jobject value)
+{
+	jobject *p = (jobject *) &obj->fields[field->offset];
+
+	gc_satb_barrier(*p);
+	*p = value;
+	gc_write_barrier(obj);
+}
 
 DECLARE_FIELD_GETTER(byte);
 DECLARE_FIELD_GETTER(boolean);
@@ -201,7 +269,16 @@ DECLARE_ARRAY_FIELD_SETTER(double, J_DOUBLE);
 DECLARE_ARRAY_FIELD_SETTER(float, J_FLOAT);
 DECLARE_ARRAY_FIELD_SETTER(int, J_INT);
 DECLARE_ARRAY_FIELD_SETTER(long, J_LONG);
-DECLARE_ARRAY_FIELD_SETTER(object, J_REFERENCE);
+
+static inline void
+array_set_field_object(struct vm_object *obj, int index, jobject value)
+{
+	jobject *p = (jobject *) &obj->fields[index * get_vmtype_size(J_REFERENCE)];
+
+	gc_satb_barrier(*p);
+	*p = value;
+	gc_write_barrier(obj);
+}
 
 DECLARE_ARRAY_FIELD_GETTER(byte, J_BYTE);
 DECLARE_ARRAY_FIELD_GETTER(boolean, J_BOOLEAN);
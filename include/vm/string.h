@@ -5,5 +5,6 @@ struct vm_object;
 
 void init_literals_hash_map(void);
 struct vm_object *vm_string_intern(struct vm_object *string);
+void vm_string_for_each_literal(void (*fn)(struct vm_object *));
 
 #endif /* JATO_STRING_H */
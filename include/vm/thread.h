@@ -8,6 +8,7 @@
 #include <stdio.h> /* for NOT_IMPLEMENTED */
 #include <pthread.h>
 
+struct heap_tlab;
 struct vm_object;
 
 enum vm_thread_state {
@@ -19,11 +20,6 @@ enum vm_thread_state {
 	VM_THREAD_STATE_WAITING,
 };
 
-enum thread_state {
-	THREAD_STATE_CONSISTENT,
-	THREAD_STATE_INCONSISTENT,
-};
-
 struct vm_thread {
 	pthread_mutex_t mutex;
 
@@ -35,7 +31,28 @@ struct vm_thread {
 	struct list_head list_node;
 	bool interrupted;
 	struct vm_monitor *wait_mon;
-	enum thread_state thread_state;
+
+	/*
+	 * Link in the wait or entry queue of @wait_mon, the futex word the
+	 * thread sleeps on while waiting and whether it has been notified.
+	 */
+	struct list_head wait_node;
+	uint32_t wait_futex;
+	bool wait_notified;
+
+	/* Highest address of the native stack of this thread. */
+	void *stack_top;
+
+	/*
+	 * Stack pointer and pending exception recorded when the thread
+	 * entered a GC safepoint. Everything in [gc_stack_ptr, stack_top)
+	 * is scanned for references by the collector.
+	 */
+	void *gc_stack_ptr;
+	struct vm_object *gc_exception;
+
+	/* Allocation buffer of this thread or NULL if not set up yet. */
+	struct heap_tlab *tlab;
 };
 
 struct vm_exec_env {
@@ -58,6 +75,7 @@ static inline struct vm_thread *vm_thread_self(void)
 
 int init_threading(void);
 int vm_thread_start(struct vm_object *vmthread);
+int vm_thread_start_system(const char *name, void *(*start_routine)(void *), void *arg);
 void vm_thread_wait_for_non_daemons(void);
 void vm_thread_set_state(struct vm_thread *thread, enum vm_thread_state state);
 struct vm_object *vm_thread_get_java_thread(struct vm_thread *thread);
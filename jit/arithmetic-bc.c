@@ -250,7 +250,7 @@ int convert_iinc(struct parse_context *ctx)
 		const_value = bytecode_read_s8(ctx->buffer);
 	}
 
-	local_expression = local_expr(J_INT, index);
+	local_expression = local_var_expr(ctx, J_INT, index);
 	if (!local_expression)
 		goto failed;
 
@@ -24,9 +24,11 @@
  * Please refer to the file LICENSE for details.
  */
 
+#include <assert.h>
 #include <errno.h>
 #include <malloc.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include "arch/instruction.h"
 
@@ -99,14 +101,111 @@ int build_bc_offset_map(struct compilation_unit *cu)
 }
 
 /**
- * native_ptr_to_bytecode_offset - translates native instruction pointer
- *                                 to bytecode offset from which given
- *                                 instruction originates.
+ * cu_add_inline_call - registers a call site at @call_bc_offset which
+ *                      inlines @method.
+ *
+ * Returns the bytecode offset of the first instruction of the inlined
+ * method or BC_OFFSET_UNKNOWN if we ran out of memory or call indices.
+ */
+unsigned long cu_add_inline_call(struct compilation_unit *cu,
+				 struct vm_method *method,
+				 unsigned long call_bc_offset)
+{
+	struct inline_call *calls;
+	unsigned long idx;
+
+	idx = cu->nr_inline_calls + 1;
+	if (idx > (UINT32_MAX >> BC_OFFSET_INLINE_SHIFT))
+		return BC_OFFSET_UNKNOWN;
+
+	calls = realloc(cu->inline_calls, idx * sizeof(*calls));
+	if (!calls)
+		return BC_OFFSET_UNKNOWN;
+
+	calls[idx - 1].method		= method;
+	calls[idx - 1].call_bc_offset	= call_bc_offset;
+
+	cu->inline_calls	= calls;
+	cu->nr_inline_calls	= idx;
+
+	return idx << BC_OFFSET_INLINE_SHIFT;
+}
+
+static struct inline_call *
+bc_offset_inline_call(struct compilation_unit *cu, unsigned long bc_offset)
+{
+	unsigned long idx = bc_offset >> BC_OFFSET_INLINE_SHIFT;
+
+	assert(idx > 0 && idx <= cu->nr_inline_calls);
+
+	return &cu->inline_calls[idx - 1];
+}
+
+/**
+ * bc_offset_method - returns the method whose bytecode @bc_offset points
+ *                    to.
+ */
+struct vm_method *bc_offset_method(struct compilation_unit *cu,
+				   unsigned long bc_offset)
+{
+	if (!bc_offset_is_inlined(bc_offset))
+		return cu->method;
+
+	return bc_offset_inline_call(cu, bc_offset)->method;
+}
+
+/**
+ * bc_offset_caller - returns the bytecode offset of the call site into
+ *                    which the code at @bc_offset was inlined.
+ */
+unsigned long bc_offset_caller(struct compilation_unit *cu,
+			       unsigned long bc_offset)
+{
+	assert(bc_offset_is_inlined(bc_offset));
+
+	return bc_offset_inline_call(cu, bc_offset)->call_bc_offset;
+}
+
+/**
+ * bc_offset_outermost - translates @bc_offset to an offset in the bytecode
+ *                       of cu->method.
+ */
+unsigned long bc_offset_outermost(struct compilation_unit *cu,
+				  unsigned long bc_offset)
+{
+	while (bc_offset_is_inlined(bc_offset))
+		bc_offset = bc_offset_caller(cu, bc_offset);
+
+	return bc_offset;
+}
+
+/**
+ * bc_offset_inline_depth - returns the number of inlined methods the code
+ *                          at @bc_offset is nested in.
+ */
+unsigned int bc_offset_inline_depth(struct compilation_unit *cu,
+				    unsigned long bc_offset)
+{
+	unsigned int depth = 0;
+
+	while (bc_offset_is_inlined(bc_offset)) {
+		bc_offset = bc_offset_caller(cu, bc_offset);
+		depth++;
+	}
+
+	return depth;
+}
+
+/**
+ * jit_lookup_inline_bc_offset - translates native instruction pointer
+ *                               to bytecode offset from which given
+ *                               instruction originates. The offset
+ *                               can point into an inlined method.
  * @cu: compilation unit of method containing @native_ptr.
  * @native_ptr: native instruction pointer to be translated.
  */
 unsigned long
-jit_lookup_bc_offset(struct compilation_unit *cu, unsigned char *native_ptr)
+jit_lookup_inline_bc_offset(struct compilation_unit *cu, unsigned char *native_ptr)
 {
 	unsigned long native_addr;
 	unsigned long method_addr;
@@ -128,12 +227,32 @@ jit_lookup_bc_offset(struct compilation_unit *cu, unsigned char *native_ptr)
 	return cu->bc_offset_map[offset];
 }
 
+/**
+ * native_ptr_to_bytecode_offset - translates native instruction pointer
+ *                                 to bytecode offset in cu->method. Code
+ *                                 of inlined methods maps to the offset
+ *                                 of the call site.
+ * @cu: compilation unit of method containing @native_ptr.
+ * @native_ptr: native instruction pointer to be translated.
+ */
+unsigned long
+jit_lookup_bc_offset(struct compilation_unit *cu, unsigned char *native_ptr)
+{
+	return bc_offset_outermost(cu, jit_lookup_inline_bc_offset(cu, native_ptr));
+}
+
 void print_bytecode_offset(unsigned long bytecode_offset, struct string *str)
 {
+	static char buf[32];
+
 	if (bytecode_offset == BC_OFFSET_UNKNOWN)
 		str_append(str, "?");
-	else {
-		static char buf[32];
+	else if (bc_offset_is_inlined(bytecode_offset)) {
+		sprintf(buf, "%ld:%ld",
+			bytecode_offset >> BC_OFFSET_INLINE_SHIFT,
+			bc_offset_pc(bytecode_offset));
+		str_append(str, buf);
+	} else {
 		sprintf(buf, "%ld", bytecode_offset);
 		str_append(str, buf);
 	}
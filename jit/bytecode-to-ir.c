@@ -173,6 +173,7 @@ static int do_convert_bb_to_ir(struct basic_block *bb)
 		.buffer = &buffer,
 		.cu = cu,
 		.bb = bb,
+		.method = cu->method,
 		.code = cu->method->code_attribute.code,
 		.is_wide = false,
 	};
@@ -200,6 +201,63 @@ static int do_convert_bb_to_ir(struct basic_block *bb)
 	return err;
 }
 
+/**
+ * convert_inlined_method - Convert the bytecode of an inlined method.
+ * @ctx: parse context of the inlined method.
+ * @bc_offset: bytecode offset of the first instruction of the method.
+ *
+ * Only straight-line methods are inlined, so the whole method converts
+ * into the current basic block of the caller.
+ */
+int convert_inlined_method(struct parse_context *ctx, unsigned long bc_offset)
+{
+	struct vm_method *method = ctx->method;
+	int err = 0;
+
+	while (ctx->buffer->pos < method->code_attribute.code_length) {
+		ctx->offset = bc_offset + ctx->buffer->pos;
+
+		err = convert_instruction(ctx);
+		if (err)
+			break;
+	}
+	return err;
+}
+
+/**
+ * local_var_expr - Returns an expression for local variable @idx of the
+ * method being converted.
+ *
+ * Local variables of inlined methods are temporaries. A new temporary is
+ * picked when the variable is reused for a value of another type.
+ */
+struct expression *local_var_expr(struct parse_context *ctx,
+				  enum vm_type type, unsigned long idx)
+{
+	struct inline_frame *frame = ctx->inline_frame;
+	struct expression *expr;
+
+	if (!frame)
+		return local_expr(type, idx);
+
+	if (idx >= frame->nr_locals)
+		return NULL;
+
+	expr = frame->locals[idx];
+	if (!expr || expr->vm_type != type) {
+		expr = temporary_expr(type, ctx->cu);
+		if (!expr)
+			return NULL;
+
+		if (frame->locals[idx])
+			expr_put(frame->locals[idx]);
+
+		frame->locals[idx] = expr;
+	}
+
+	return expr_get(expr);
+}
+
 static int reload_mimic_stack(struct basic_block *bb, struct stack *reload)
 {
 	unsigned int i;
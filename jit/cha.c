@@ -0,0 +1,281 @@
+/*
+ * Class hierarchy analysis
+ *
+ * This file is released under the GPL version 2. Please refer to the file
+ * LICENSE for details.
+ *
+ * A virtual method which no loaded class overrides has exactly one target,
+ * and so does an interface method with exactly one concrete implementor.
+ * Call sites of such methods are compiled to direct calls and registered as
+ * dependent on the method or the interface. When a class that overrides the
+ * method or implements the interface is linked, the dependent call sites are
+ * patched back to dynamic dispatch.
+ *
+ * No instance of the new class exists before it is linked, so frames that
+ * are already executing a bound target are still correct and nothing needs
+ * to be deoptimized on the stack.
+ */
+
+#include "jit/cha.h"
+#include "jit/compilation-unit.h"
+#include "jit/compiler.h"
+#include "jit/inline-cache.h"
+
+#include "arch/instruction.h"
+
+#include "vm/class.h"
+#include "vm/die.h"
+#include "vm/itable.h"
+#include "vm/method.h"
+#include "vm/stdlib.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+
+/*
+ * Makes binding a call site atomic with respect to invalidating it. Also
+ * protects the CHA state of methods and classes.
+ */
+static pthread_mutex_t cha_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void cha_lock(void)
+{
+	if (pthread_mutex_lock(&cha_mutex))
+		die("pthread_mutex_lock");
+}
+
+static void cha_unlock(void)
+{
+	if (pthread_mutex_unlock(&cha_mutex))
+		die("pthread_mutex_unlock");
+}
+
+static bool method_is_bindable(struct vm_method *vmm)
+{
+	return !vm_method_is_abstract(vmm) && !vm_method_is_native(vmm);
+}
+
+static bool method_is_final(struct vm_method *vmm)
+{
+	if (vmm->method->access_flags & CAFEBABE_METHOD_ACC_FINAL)
+		return true;
+
+	return method_is_private(vmm) || vm_class_is_final(vmm->class);
+}
+
+static struct cha_site *alloc_cha_site(struct compilation_unit *cu,
+				       struct vm_method *method,
+				       struct vm_method *target)
+{
+	struct cha_site *site;
+
+	site = zalloc(sizeof(*site));
+	if (!site)
+		return NULL;
+
+	site->cu = cu;
+	site->method = method;
+	site->target = target;
+
+	INIT_LIST_HEAD(&site->dependency_node);
+	list_add(&site->cu_node, &cu->cha_site_list);
+
+	return site;
+}
+
+static struct cha_site *bind_virtual(struct compilation_unit *cu,
+				     struct vm_method *method)
+{
+	struct cha_site *site;
+
+	if (!method_is_bindable(method) || method->is_overridden)
+		return NULL;
+
+	site = alloc_cha_site(cu, method, method);
+	if (!site)
+		return NULL;
+
+	if (!method_is_final(method))
+		list_add(&site->dependency_node, &method->cha_site_list);
+
+	return site;
+}
+
+static struct cha_site *bind_interface(struct compilation_unit *cu,
+				       struct vm_method *method)
+{
+	struct vm_class *vmi = method->class;
+	struct vm_method *target;
+	struct cha_site *site;
+
+	if (!vmi->cha_implementor || vmi->has_many_implementors)
+		return NULL;
+
+	/*
+	 * The verifier does not check interface types, so this trusts the
+	 * receiver to implement the interface just like the itable dispatch
+	 * does.
+	 */
+	target = vm_class_get_method_recursive(vmi->cha_implementor,
+					       method->name, method->type);
+	if (!target || !method_is_bindable(target))
+		return NULL;
+
+	site = alloc_cha_site(cu, method, target);
+	if (!site)
+		return NULL;
+
+	list_add(&site->dependency_node, &vmi->cha_site_list);
+
+	return site;
+}
+
+/*
+ * Returns a call site bound to the only target of @method or NULL if the
+ * call needs dynamic dispatch. The caller sets ->call_insn to the direct
+ * call of ->target.
+ */
+struct cha_site *cha_bind_invoke(struct compilation_unit *cu, struct vm_method *method)
+{
+	struct cha_site *site;
+
+	cha_lock();
+
+	if (vm_class_is_interface(method->class))
+		site = bind_interface(cu, method);
+	else
+		site = bind_virtual(cu, method);
+
+	cha_unlock();
+
+	return site;
+}
+
+static void patch_back(struct cha_site *site)
+{
+	struct jit_trampoline *t = site->target->trampoline;
+	struct fixup_site *fixup;
+	void *stub;
+
+	stub = inline_cache_megamorphic_stub(site->method);
+	if (!stub)
+		die("out of memory");
+
+	/*
+	 * The direct call is still waiting for the target to be compiled.
+	 * Keep fixup_direct_calls() from patching it after us.
+	 */
+	pthread_mutex_lock(&t->mutex);
+
+	list_for_each_entry(fixup, &t->fixup_site_list, trampoline_node) {
+		if (fixup->cu != site->cu || fixup->mach_offset != site->mach_offset)
+			continue;
+
+		pthread_mutex_lock(&fixup->mutex);
+		fixup->ready = false;
+		pthread_mutex_unlock(&fixup->mutex);
+	}
+
+	cha_patch_call_site(site, stub);
+
+	pthread_mutex_unlock(&t->mutex);
+}
+
+static void invalidate_sites(struct list_head *sites)
+{
+	struct cha_site *this, *next;
+
+	list_for_each_entry_safe(this, next, sites, dependency_node) {
+		list_del(&this->dependency_node);
+		INIT_LIST_HEAD(&this->dependency_node);
+
+		this->invalid = true;
+
+		/* Otherwise patched in cha_prepare_sites() */
+		if (this->ready)
+			patch_back(this);
+	}
+}
+
+/*
+ * Called after the machine code of @cu is emitted and before it is made
+ * available to other threads.
+ */
+void cha_prepare_sites(struct compilation_unit *cu)
+{
+	struct cha_site *site;
+
+	cha_lock();
+
+	list_for_each_entry(site, &cu->cha_site_list, cu_node) {
+		site->mach_offset = site->call_insn->mach_offset;
+		site->call_insn = NULL;
+		site->ready = true;
+
+		if (site->invalid)
+			patch_back(site);
+	}
+
+	cha_unlock();
+}
+
+void cha_free_sites(struct compilation_unit *cu)
+{
+	struct cha_site *this, *next;
+
+	cha_lock();
+
+	list_for_each_entry_safe(this, next, &cu->cha_site_list, cu_node) {
+		list_del(&this->dependency_node);
+		list_del(&this->cu_node);
+		free(this);
+	}
+
+	cha_unlock();
+}
+
+/*
+ * Called when a class which overrides @vmm is linked. The flag is never
+ * cleared, so a method stays dynamically dispatched even if the
+ * overriding class turns out to be unused.
+ */
+void cha_method_overridden(struct vm_method *vmm)
+{
+	cha_lock();
+
+	if (!vmm->is_overridden) {
+		vmm->is_overridden = true;
+		invalidate_sites(&vmm->cha_site_list);
+	}
+
+	cha_unlock();
+}
+
+/*
+ * Registers @vmc as an implementor of the interfaces in its itable. Only
+ * concrete classes count because abstract ones have no instances.
+ */
+void cha_add_implementor(struct vm_class *vmc)
+{
+	if (vm_class_is_abstract(vmc))
+		return;
+
+	cha_lock();
+
+	for (unsigned int i = 0; i < vmc->itable.nr_interfaces; ++i) {
+		struct vm_class *vmi = vmc->itable.table[i].interface;
+
+		if (vmi->has_many_implementors)
+			continue;
+
+		if (!vmi->cha_implementor) {
+			vmi->cha_implementor = vmc;
+			continue;
+		}
+
+		vmi->has_many_implementors = true;
+		invalidate_sites(&vmi->cha_site_list);
+	}
+
+	cha_unlock();
+}
@@ -26,6 +26,7 @@
 #include "arch/registers.h"
 
 #include "jit/basic-block.h"
+#include "jit/cha.h"
 #include "jit/compilation-unit.h"
 #include "jit/instruction.h"
 #include "jit/stack-slot.h"
@@ -96,6 +97,7 @@ struct compilation_unit *compilation_unit_alloc(struct vm_method *method)
 
 		INIT_LIST_HEAD(&cu->static_fixup_site_list);
 		INIT_LIST_HEAD(&cu->call_fixup_site_list);
+		INIT_LIST_HEAD(&cu->cha_site_list);
 		INIT_LIST_HEAD(&cu->tableswitch_list);
 		INIT_LIST_HEAD(&cu->lookupswitch_list);
 
@@ -203,6 +205,7 @@ void free_compilation_unit(struct compilation_unit *cu)
 	struct basic_block *bb, *tmp_bb;
 
 	free_call_fixup_sites(cu);
+	cha_free_sites(cu);
 	shrink_compilation_unit(cu);
 
 	list_for_each_entry_safe(bb, tmp_bb, &cu->bb_list, bb_list_node)
@@ -214,6 +217,7 @@ void free_compilation_unit(struct compilation_unit *cu)
 	free_buffer(cu->objcode);
 	free_stack_frame(cu->stack_frame);
 	free_bc_offset_map(cu->bc_offset_map);
+	free(cu->inline_calls);
 	free_lookupswitch_list(cu);
 	free_tableswitch_list(cu);
 	free_lir_insn_map(cu);
@@ -0,0 +1,297 @@
+/*
+ * Background compilation
+ *
+ * This file is released under the GPL version 2. Please refer to the file
+ * LICENSE for details.
+ *
+ * A method is compiled when it is first called, in jit_magic_trampoline().
+ * When there are compiler threads, the trampoline queues the method instead
+ * and, on x86-32, runs it with the bytecode interpreter so that the caller
+ * does not wait for the compiler. The queue is ordered by the invocation count of the
+ * methods at the time they were queued, so hot methods go first. The code is
+ * installed in vtables and call sites by jit_compile_method() and the
+ * trampoline is not called again.
+ *
+ * Methods which the interpreter can not run are still compiled by the
+ * trampoline, as is everything when there are no compiler threads.
+ *
+ * When tiered compilation is enabled, methods are first compiled without
+ * inlining, escape analysis and lock coarsening. It is off by default: the
+ * baseline tier still allocates registers like the optimizing one, so it
+ * compiles barely faster and only adds the entry jump and the counters.
+ * It is only supported on x86-32, whose code reaches the counters and
+ * ->tier_entry with 32-bit absolute addresses. The baseline code counts
+ * method entries and loop iterations and an idle compiler thread
+ * periodically looks for methods whose counts crossed the threshold and
+ * recompiles them with all optimizations. There is no on-stack
+ * replacement so a running loop stays in the baseline code until the
+ * method is called again.
+ */
+
+#include "jit/compilation-unit.h"
+#include "jit/compile-queue.h"
+#include "jit/compiler.h"
+#include "jit/exception.h"
+
+#include "lib/pqueue.h"
+
+#include "vm/class.h"
+#include "vm/die.h"
+#include "vm/method.h"
+#include "vm/system.h"
+#include "vm/thread.h"
+
+#include <pthread.h>
+#include <errno.h>
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+
+#define COMPILE_QUEUE_MAX_DEFAULT_THREADS	2
+
+/* How often idle compiler threads look for hot baseline methods. */
+#define TIER_SCAN_INTERVAL_MS			10
+
+/* A loop iteration counts this much less than a method entry. */
+#define TIER_BACKEDGE_RATIO			16
+
+int opt_nr_compiler_threads = -1;
+bool opt_tiered_compilation = false;
+unsigned long opt_compile_threshold = 1000;
+
+/*
+ * Protects the queue, the baseline list and ->is_queued, ->is_hot and
+ * ->compile_priority of every cu.
+ */
+static pthread_mutex_t compile_queue_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t compile_queue_cond = PTHREAD_COND_INITIALIZER;
+static struct pqueue *compile_queue;
+
+/* Baseline methods which have not been recompiled yet. */
+static struct list_head baseline_list = LIST_HEAD_INIT(baseline_list);
+
+static __thread bool is_compiler_thread;
+
+bool compile_queue_is_compiler_thread(void)
+{
+	return is_compiler_thread;
+}
+
+static int compare_priority(void *v1, void *v2)
+{
+	struct compilation_unit *cu1 = v1, *cu2 = v2;
+
+	if (cu1->compile_priority < cu2->compile_priority)
+		return -1;
+
+	if (cu1->compile_priority > cu2->compile_priority)
+		return 1;
+
+	return 0;
+}
+
+bool compile_queue_is_enabled(void)
+{
+	return compile_queue != NULL;
+}
+
+bool compile_queue_is_tiered(void)
+{
+	return compile_queue && opt_tiered_compilation;
+}
+
+static void __compile_queue_submit(struct compilation_unit *cu, unsigned long priority)
+{
+	if (cu->is_queued)
+		return;
+
+	cu->compile_priority = priority;
+
+	if (pqueue_insert(compile_queue, cu) == 0) {
+		cu->is_queued = true;
+		pthread_cond_signal(&compile_queue_cond);
+	}
+}
+
+/*
+ * Compiling a static method installs its code in call sites which then
+ * skip the class initialization check of the trampoline.
+ */
+static bool method_can_compile_in_background(struct vm_method *vmm)
+{
+	if (vm_method_is_native(vmm))
+		return false;
+
+	if (vm_method_is_static(vmm) && !vm_class_is_initialized(vmm->class))
+		return false;
+
+	return true;
+}
+
+/*
+ * Queues @cu for the compiler threads. Returns false if there are none or
+ * the method can not be compiled in the background.
+ */
+bool compile_queue_submit(struct compilation_unit *cu, unsigned long priority)
+{
+	bool is_queued;
+
+	if (!compile_queue || !method_can_compile_in_background(cu->method))
+		return false;
+
+	pthread_mutex_lock(&compile_queue_mutex);
+	__compile_queue_submit(cu, priority);
+	is_queued = cu->is_queued;
+	pthread_mutex_unlock(&compile_queue_mutex);
+
+	return is_queued;
+}
+
+/*
+ * Adds baseline @cu to the methods that are recompiled once they are hot.
+ * This is also used to try again when recompiling a hot method failed.
+ */
+void compile_queue_add_baseline(struct compilation_unit *cu)
+{
+	pthread_mutex_lock(&compile_queue_mutex);
+	cu->is_hot = false;
+	list_add_tail(&cu->baseline_node, &baseline_list);
+	pthread_mutex_unlock(&compile_queue_mutex);
+}
+
+/* Keeps hot @cu in the baseline tier for good. */
+void compile_queue_drop_baseline(struct compilation_unit *cu)
+{
+	pthread_mutex_lock(&compile_queue_mutex);
+	cu->is_hot = false;
+	pthread_mutex_unlock(&compile_queue_mutex);
+}
+
+static unsigned long tier_hotness(struct compilation_unit *cu)
+{
+	uint32_t nr_invocations, nr_backedges;
+
+	/* The counters are updated by compiled code without locking. */
+	nr_invocations = *(volatile uint32_t *) &cu->nr_invocations;
+	nr_backedges = *(volatile uint32_t *) &cu->nr_backedges;
+
+	return nr_invocations + nr_backedges / TIER_BACKEDGE_RATIO;
+}
+
+static void queue_hot_methods(void)
+{
+	struct compilation_unit *cu, *next;
+
+	list_for_each_entry_safe(cu, next, &baseline_list, baseline_node) {
+		unsigned long hotness = tier_hotness(cu);
+
+		if (hotness < opt_compile_threshold)
+			continue;
+
+		list_del(&cu->baseline_node);
+		cu->is_hot = true;
+
+		__compile_queue_submit(cu, hotness);
+	}
+}
+
+static int wait_for_work(void)
+{
+	struct timespec deadline;
+
+	if (!opt_tiered_compilation)
+		return pthread_cond_wait(&compile_queue_cond, &compile_queue_mutex);
+
+	clock_gettime(CLOCK_REALTIME, &deadline);
+
+	deadline.tv_nsec += TIER_SCAN_INTERVAL_MS * 1000000L;
+	if (deadline.tv_nsec >= 1000000000L) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+
+	return pthread_cond_timedwait(&compile_queue_cond, &compile_queue_mutex, &deadline);
+}
+
+static struct compilation_unit *compile_queue_pop(void)
+{
+	struct compilation_unit *cu;
+
+	pthread_mutex_lock(&compile_queue_mutex);
+
+	while (pqueue_is_empty(compile_queue)) {
+		if (wait_for_work() == ETIMEDOUT)
+			queue_hot_methods();
+	}
+
+	cu = pqueue_remove_top(compile_queue);
+	cu->is_queued = false;
+
+	pthread_mutex_unlock(&compile_queue_mutex);
+
+	return cu;
+}
+
+static void *compiler_thread(void *arg)
+{
+	is_compiler_thread = true;
+
+	for (;;) {
+		struct compilation_unit *cu;
+		bool is_compiled;
+		void *ret;
+
+		cu = compile_queue_pop();
+
+		pthread_mutex_lock(&cu->mutex);
+		is_compiled = cu->is_compiled;
+		pthread_mutex_unlock(&cu->mutex);
+
+		if (!is_compiled)
+			ret = jit_compile_method(cu);
+		else if (cu->is_hot)
+			ret = jit_recompile_method(cu);
+		else
+			continue;
+
+		/* The trampoline reports the error when the method is called. */
+		if (!ret)
+			clear_exception();
+	}
+
+	return NULL;
+}
+
+void compile_queue_init(void)
+{
+	int nr_threads = opt_nr_compiler_threads;
+
+#ifndef CONFIG_X86_32
+	if (opt_tiered_compilation) {
+		warn("tiered compilation is not supported on this architecture");
+		opt_tiered_compilation = false;
+	}
+#endif
+
+	if (nr_threads < 0) {
+		long nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+		nr_threads = min(max(nr_cpus - 1, 0L), (long) COMPILE_QUEUE_MAX_DEFAULT_THREADS);
+	}
+
+	if (!nr_threads)
+		return;
+
+	compile_queue = pqueue_alloc(compare_priority);
+	if (!compile_queue)
+		die("Couldn't allocate compile queue");
+
+	for (int i = 0; i < nr_threads; i++) {
+		char name[32];
+
+		snprintf(name, sizeof(name), "JIT compiler %d", i);
+
+		if (vm_thread_start_system(name, compiler_thread, NULL))
+			die("Couldn't start compiler thread");
+	}
+}
@@ -7,6 +7,7 @@
  * LICENSE for details.
  */
 
+#include "jit/cha.h"
 #include "jit/compilation-unit.h"
 #include "jit/compiler.h"
 #include "jit/statement.h"
@@ -70,6 +71,14 @@ int compile(struct compilation_unit *cu)
 	if (err)
 		goto out;
 
+	if (!cu->is_baseline) {
+		err = analyze_escapes(cu);
+		if (err)
+			goto out;
+
+		coarsen_locks(cu);
+	}
+
 	if (opt_trace_cfg)
 		trace_cfg(cu);
 
@@ -118,6 +127,8 @@ int compile(struct compilation_unit *cu)
 
 	resolve_fixup_offsets(cu);
 
+	cha_prepare_sites(cu);
+
 	cu->native_ptr = buffer_ptr(cu->objcode);
 	cu->is_compiled = true;
 
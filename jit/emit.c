@@ -182,6 +182,9 @@ int emit_machine_code(struct compilation_unit *cu)
 
 	frame_size = frame_locals_size(cu->stack_frame);
 
+	if (cu->is_baseline)
+		emit_tier_entry(cu->objcode, &cu->tier_entry);
+
 	emit_prolog(cu->objcode, frame_size);
 	if (method_is_synchronized(cu->method))
 		emit_monitorenter(cu);
@@ -220,7 +223,7 @@ int emit_machine_code(struct compilation_unit *cu)
 
 	jit_text_unlock();
 
-	gdb_register_method(cu->method);
+	gdb_register_method(cu);
 
 	return err;
 }
@@ -0,0 +1,635 @@
+/*
+ * Escape analysis and scalar replacement
+ *
+ * This file is released under the GPL version 2. Please refer to the file
+ * LICENSE for details.
+ *
+ * An object allocated with EXPR_NEW whose reference is only ever used to
+ * access the fields of the object does not need to exist: the fields can be
+ * kept in temporaries instead. The reference is followed through the
+ * temporaries and local variables it is copied to. The object escapes if
+ * any of them is used for anything else than a copy or a field access, or
+ * if any of them is assigned some other value.
+ *
+ * The analysis is flow insensitive, so it only replaces objects whose
+ * references are all used in the basic block of the allocation and after
+ * the allocation. Every execution of the basic block then sees exactly one
+ * instance.
+ *
+ * Monitor operations on an object that does not escape are also allowed.
+ * No other thread can ever see such an object, so they are removed even if
+ * the object is used in other basic blocks.
+ */
+
+#include "jit/bc-offset-mapping.h"
+#include "jit/compilation-unit.h"
+#include "jit/compiler.h"
+#include "jit/expression.h"
+#include "jit/statement.h"
+
+#include "vm/class.h"
+#include "vm/die.h"
+#include "vm/field.h"
+#include "vm/stdlib.h"
+
+#include <errno.h>
+#include <stdlib.h>
+
+/*
+ * Objects with more aliases or fields than this are left alone. So are all
+ * allocations past the first ESCAPE_MAX_ALLOCATIONS of a method, which
+ * bounds the time spent on large methods.
+ */
+#define ESCAPE_MAX_ALLOCATIONS	32
+#define ESCAPE_MAX_ALIASES	16
+#define ESCAPE_MAX_FIELDS	16
+
+/* A temporary or a local variable holding the object reference. */
+struct alias {
+	bool			is_local;
+	struct var_info		*var;
+	unsigned long		local_index;
+};
+
+struct scalar_field {
+	struct vm_field		*field;
+	enum vm_type		type;
+	struct var_info		*tmp_low;
+	struct var_info		*tmp_high;
+};
+
+struct allocation {
+	struct basic_block	*bb;
+	struct statement	*stmt;	/* STMT_STORE of the EXPR_NEW */
+
+	struct alias		aliases[ESCAPE_MAX_ALIASES];
+	unsigned int		nr_aliases;
+
+	struct scalar_field	fields[ESCAPE_MAX_FIELDS];
+	unsigned int		nr_fields;
+
+	unsigned int		nr_monitors;
+
+	bool			escapes;
+	bool			block_local;
+	bool			seen_alloc;
+};
+
+static bool expr_is_local(struct expression *expr)
+{
+	return expr_type(expr) == EXPR_LOCAL || expr_type(expr) == EXPR_FLOAT_LOCAL;
+}
+
+static bool expr_is_temporary(struct expression *expr)
+{
+	return expr_type(expr) == EXPR_TEMPORARY || expr_type(expr) == EXPR_FLOAT_TEMPORARY;
+}
+
+static struct expression *strip_null_check(struct expression *expr)
+{
+	if (expr_type(expr) == EXPR_NULL_CHECK)
+		return to_expr(expr->null_check_ref);
+
+	return expr;
+}
+
+static bool alias_matches(struct allocation *alloc, struct alias *alias,
+			  struct expression *expr)
+{
+	if (alias->is_local) {
+		if (!expr_is_local(expr))
+			return false;
+
+		if (expr->local_index == alias->local_index) {
+			if (expr->vm_type == J_REFERENCE)
+				return true;
+
+			alloc->escapes = true;
+		}
+
+		/* The second half of a long or a double */
+		if (vm_type_slot_size(expr->vm_type) == 2 &&
+		    expr->local_index + 1 == alias->local_index)
+			alloc->escapes = true;
+
+		return false;
+	}
+
+	if (!expr_is_temporary(expr))
+		return false;
+
+	if (expr->tmp_low == alias->var) {
+		if (expr->vm_type == J_REFERENCE)
+			return true;
+
+		alloc->escapes = true;
+	}
+
+	if (expr->tmp_high == alias->var)
+		alloc->escapes = true;
+
+	return false;
+}
+
+/*
+ * Returns true if @expr is one of the aliases of @alloc. Marks @alloc as
+ * escaping if @expr overlaps an alias without being a reference to it.
+ */
+static bool is_alias(struct allocation *alloc, struct expression *expr)
+{
+	for (unsigned int i = 0; i < alloc->nr_aliases; i++) {
+		if (alias_matches(alloc, &alloc->aliases[i], expr))
+			return true;
+	}
+
+	return false;
+}
+
+static void add_alias(struct allocation *alloc, struct expression *expr)
+{
+	struct alias *alias;
+
+	if (expr->vm_type != J_REFERENCE || alloc->nr_aliases == ESCAPE_MAX_ALIASES) {
+		alloc->escapes = true;
+		return;
+	}
+
+	alias = &alloc->aliases[alloc->nr_aliases++];
+
+	if (expr_is_local(expr)) {
+		alias->is_local		= true;
+		alias->local_index	= expr->local_index;
+	} else {
+		alias->is_local		= false;
+		alias->var		= expr->tmp_low;
+	}
+}
+
+static bool expr_is_var(struct expression *expr)
+{
+	return expr_is_local(expr) || expr_is_temporary(expr);
+}
+
+static bool stmt_copies_alias(struct allocation *alloc, struct statement *stmt)
+{
+	if (stmt_type(stmt) != STMT_STORE)
+		return false;
+
+	return is_alias(alloc, strip_null_check(to_expr(stmt->store_src)));
+}
+
+/*
+ * Collects the variables the object reference is copied to.
+ */
+static void find_aliases(struct compilation_unit *cu, struct allocation *alloc)
+{
+	struct basic_block *bb;
+	struct statement *stmt;
+	bool changed;
+
+	add_alias(alloc, to_expr(alloc->stmt->store_dest));
+
+	do {
+		changed = false;
+
+		for_each_basic_block(bb, &cu->bb_list) {
+			list_for_each_entry(stmt, &bb->stmt_list, stmt_list_node) {
+				struct expression *dest;
+
+				if (!stmt_copies_alias(alloc, stmt))
+					continue;
+
+				dest = to_expr(stmt->store_dest);
+				if (!expr_is_var(dest) || is_alias(alloc, dest))
+					continue;
+
+				add_alias(alloc, dest);
+				if (alloc->escapes)
+					return;
+
+				changed = true;
+			}
+		}
+	} while (changed);
+}
+
+static struct scalar_field *lookup_field(struct allocation *alloc,
+					 struct vm_field *field)
+{
+	for (unsigned int i = 0; i < alloc->nr_fields; i++) {
+		if (alloc->fields[i].field == field)
+			return &alloc->fields[i];
+	}
+
+	return NULL;
+}
+
+static void add_field(struct allocation *alloc, struct vm_field *field)
+{
+	struct scalar_field *f;
+
+	if (lookup_field(alloc, field))
+		return;
+
+	if (alloc->nr_fields == ESCAPE_MAX_FIELDS) {
+		alloc->block_local = false;
+		return;
+	}
+
+	f = &alloc->fields[alloc->nr_fields++];
+	f->field	= field;
+	f->type		= mimic_stack_type(vm_field_type(field));
+}
+
+static bool is_field_of_alias(struct allocation *alloc, struct expression *expr)
+{
+	struct expression *ref;
+
+	if (expr_type(expr) != EXPR_INSTANCE_FIELD &&
+	    expr_type(expr) != EXPR_FLOAT_INSTANCE_FIELD)
+		return false;
+
+	ref = strip_null_check(to_expr(expr->objectref_expression));
+
+	return is_alias(alloc, ref);
+}
+
+static void check_expr(struct allocation *alloc, struct expression *expr, bool *uses)
+{
+	if (is_field_of_alias(alloc, expr)) {
+		add_field(alloc, expr->instance_field);
+		*uses = true;
+		return;
+	}
+
+	if (is_alias(alloc, expr)) {
+		alloc->escapes = true;
+		return;
+	}
+
+	for (int i = 0; i < expr_nr_kids(expr); i++) {
+		if (expr->node.kids[i])
+			check_expr(alloc, to_expr(expr->node.kids[i]), uses);
+	}
+}
+
+static bool stmt_has_invoke_result(struct statement *stmt)
+{
+	switch (stmt_type(stmt)) {
+	case STMT_INVOKE:
+	case STMT_INVOKEVIRTUAL:
+	case STMT_INVOKEINTERFACE:
+		return stmt->invoke_result != NULL;
+	default:
+		return false;
+	}
+}
+
+static bool is_monitor_of_alias(struct allocation *alloc, struct statement *stmt)
+{
+	if (stmt_type(stmt) != STMT_MONITOR_ENTER && stmt_type(stmt) != STMT_MONITOR_EXIT)
+		return false;
+
+	return is_alias(alloc, strip_null_check(to_expr(stmt->expression)));
+}
+
+static void check_stmt(struct allocation *alloc, struct basic_block *bb,
+		       struct statement *stmt)
+{
+	bool uses = false;
+
+	if (stmt == alloc->stmt) {
+		alloc->seen_alloc = true;
+		return;
+	}
+
+	if (is_monitor_of_alias(alloc, stmt)) {
+		alloc->nr_monitors++;
+		return;
+	} else if (stmt_type(stmt) == STMT_STORE &&
+	    is_alias(alloc, to_expr(stmt->store_dest))) {
+		/* Copies are removed, anything else overwrites the reference. */
+		if (!stmt_copies_alias(alloc, stmt))
+			alloc->escapes = true;
+
+		uses = true;
+	} else if (stmt_copies_alias(alloc, stmt)) {
+		alloc->escapes = true;
+	} else {
+		for (int i = 0; i < stmt_nr_kids(stmt); i++) {
+			if (stmt->node.kids[i])
+				check_expr(alloc, to_expr(stmt->node.kids[i]), &uses);
+		}
+	}
+
+	if (stmt_has_invoke_result(stmt) && is_alias(alloc, stmt->invoke_result))
+		alloc->escapes = true;
+
+	if (uses && (bb != alloc->bb || !alloc->seen_alloc))
+		alloc->block_local = false;
+}
+
+static bool allocation_escapes(struct compilation_unit *cu, struct allocation *alloc)
+{
+	struct basic_block *bb;
+	struct statement *stmt;
+
+	find_aliases(cu, alloc);
+
+	for_each_basic_block(bb, &cu->bb_list) {
+		list_for_each_entry(stmt, &bb->stmt_list, stmt_list_node) {
+			if (alloc->escapes)
+				return true;
+
+			check_stmt(alloc, bb, stmt);
+		}
+	}
+
+	return alloc->escapes;
+}
+
+static struct expression *field_temporary_expr(struct scalar_field *f)
+{
+	struct expression *expr;
+
+	if (vm_type_is_float(f->type))
+		expr = alloc_expression(EXPR_FLOAT_TEMPORARY, f->type);
+	else
+		expr = alloc_expression(EXPR_TEMPORARY, f->type);
+
+	if (!expr)
+		return NULL;
+
+	expr->tmp_low	= f->tmp_low;
+	expr->tmp_high	= f->tmp_high;
+
+	return expr;
+}
+
+static void scalarize_field_expr(struct allocation *alloc, struct expression *expr)
+{
+	struct scalar_field *f;
+
+	f = lookup_field(alloc, expr->instance_field);
+	assert(f != NULL);
+
+	expr_put(to_expr(expr->objectref_expression));
+
+	if (vm_type_is_float(f->type))
+		expr_set_type(expr, EXPR_FLOAT_TEMPORARY);
+	else
+		expr_set_type(expr, EXPR_TEMPORARY);
+
+	expr->vm_type	= f->type;
+	expr->tmp_low	= f->tmp_low;
+	expr->tmp_high	= f->tmp_high;
+}
+
+static void scalarize_expr(struct allocation *alloc, struct expression *expr)
+{
+	if (is_field_of_alias(alloc, expr)) {
+		scalarize_field_expr(alloc, expr);
+		return;
+	}
+
+	for (int i = 0; i < expr_nr_kids(expr); i++) {
+		if (expr->node.kids[i])
+			scalarize_expr(alloc, to_expr(expr->node.kids[i]));
+	}
+}
+
+/*
+ * Stores to byte, char, short and boolean fields truncate the value which a
+ * temporary would not do.
+ */
+static int truncate_field_store(struct statement *stmt, struct vm_field *field)
+{
+	struct expression *src;
+	enum vm_type to_type;
+
+	to_type = vm_field_type(field);
+	if (to_type == J_BOOLEAN)
+		to_type = J_BYTE;
+
+	if (to_type != J_BYTE && to_type != J_CHAR && to_type != J_SHORT)
+		return 0;
+
+	src = truncation_expr(to_type, to_expr(stmt->store_src));
+	if (!src)
+		return -ENOMEM;
+
+	tree_patch_bc_offset(&src->node, stmt->node.bytecode_offset);
+	stmt->store_src = &src->node;
+
+	return 0;
+}
+
+static int scalarize_stmt(struct allocation *alloc, struct statement *stmt)
+{
+	if (stmt_type(stmt) == STMT_STORE) {
+		struct expression *dest = to_expr(stmt->store_dest);
+
+		if (is_field_of_alias(alloc, dest)) {
+			int err;
+
+			err = truncate_field_store(stmt, dest->instance_field);
+			if (err)
+				return err;
+		}
+	}
+
+	for (int i = 0; i < stmt_nr_kids(stmt); i++) {
+		if (stmt->node.kids[i])
+			scalarize_expr(alloc, to_expr(stmt->node.kids[i]));
+	}
+
+	return 0;
+}
+
+/*
+ * Fields of a new object are zero, so the allocation becomes a store of
+ * zero to the temporary of every field that is used.
+ */
+static int insert_field_init_stmt(struct allocation *alloc, struct scalar_field *f)
+{
+	struct expression *dest, *value;
+	struct statement *stmt;
+
+	if (vm_type_is_float(f->type))
+		value = fvalue_expr(f->type, 0.0);
+	else
+		value = value_expr(f->type, 0);
+
+	if (!value)
+		return -ENOMEM;
+
+	dest = field_temporary_expr(f);
+	if (!dest) {
+		expr_put(value);
+		return -ENOMEM;
+	}
+
+	stmt = alloc_statement(STMT_STORE);
+	if (!stmt) {
+		expr_put(dest);
+		expr_put(value);
+		return -ENOMEM;
+	}
+
+	stmt->store_dest	= &dest->node;
+	stmt->store_src		= &value->node;
+
+	tree_patch_bc_offset(&stmt->node, alloc->stmt->node.bytecode_offset);
+	list_add_tail(&stmt->stmt_list_node, &alloc->stmt->stmt_list_node);
+
+	return 0;
+}
+
+static int scalar_replace(struct compilation_unit *cu, struct allocation *alloc)
+{
+	struct statement *stmt, *next;
+	int err;
+
+	for (unsigned int i = 0; i < alloc->nr_fields; i++) {
+		struct scalar_field *f = &alloc->fields[i];
+
+		if (f->type == J_LONG) {
+			f->tmp_low	= get_var(cu, J_INT);
+			f->tmp_high	= get_var(cu, J_INT);
+		} else {
+			f->tmp_low	= get_var(cu, f->type);
+			f->tmp_high	= NULL;
+		}
+
+		err = insert_field_init_stmt(alloc, f);
+		if (err)
+			return err;
+	}
+
+	list_for_each_entry_safe(stmt, next, &alloc->bb->stmt_list, stmt_list_node) {
+		if (stmt == alloc->stmt ||
+		    (stmt_type(stmt) == STMT_STORE &&
+		     is_alias(alloc, to_expr(stmt->store_dest)))) {
+			list_del(&stmt->stmt_list_node);
+			free_statement(stmt);
+			continue;
+		}
+
+		err = scalarize_stmt(alloc, stmt);
+		if (err)
+			return err;
+	}
+
+	return 0;
+}
+
+/*
+ * Removes the monitor operations on an object that does not escape. The
+ * reference is never null so the null checks can go too.
+ */
+static void elide_locks(struct compilation_unit *cu, struct allocation *alloc)
+{
+	struct statement *stmt, *next;
+	struct basic_block *bb;
+
+	for_each_basic_block(bb, &cu->bb_list) {
+		list_for_each_entry_safe(stmt, next, &bb->stmt_list, stmt_list_node) {
+			if (!is_monitor_of_alias(alloc, stmt))
+				continue;
+
+			list_del(&stmt->stmt_list_node);
+			free_statement(stmt);
+		}
+	}
+}
+
+static bool is_allocation_stmt(struct statement *stmt)
+{
+	struct expression *dest, *src;
+
+	if (stmt_type(stmt) != STMT_STORE)
+		return false;
+
+	dest = to_expr(stmt->store_dest);
+	src = to_expr(stmt->store_src);
+
+	return expr_type(src) == EXPR_NEW && expr_is_var(dest);
+}
+
+static bool allocation_is_replaceable(struct allocation *alloc)
+{
+	struct vm_class *vmc;
+
+	if (!alloc->block_local)
+		return false;
+
+	/*
+	 * Allocating an instance of a class that is not initialized yet runs
+	 * the class initializer.
+	 */
+	vmc = to_expr(alloc->stmt->store_src)->class;
+
+	return vm_class_is_initialized(vmc) && !vm_class_is_abstract(vmc) &&
+		!vm_class_is_interface(vmc);
+}
+
+/**
+ *	analyze_escapes - Optimize objects that do not escape
+ *	@cu: compilation unit to optimize.
+ *
+ *	Runs on the tree representation right after convert_to_ir().
+ */
+int analyze_escapes(struct compilation_unit *cu)
+{
+	struct statement *allocs[ESCAPE_MAX_ALLOCATIONS];
+	struct basic_block *blocks[ESCAPE_MAX_ALLOCATIONS];
+	unsigned int nr_allocs = 0;
+	struct basic_block *bb;
+	struct statement *stmt;
+	int err = 0;
+
+	for_each_basic_block(bb, &cu->bb_list) {
+		list_for_each_entry(stmt, &bb->stmt_list, stmt_list_node) {
+			if (nr_allocs == ESCAPE_MAX_ALLOCATIONS)
+				goto analyze;
+
+			if (!is_allocation_stmt(stmt))
+				continue;
+
+			allocs[nr_allocs]	= stmt;
+			blocks[nr_allocs]	= bb;
+			nr_allocs++;
+		}
+	}
+
+analyze:
+	for (unsigned int i = 0; i < nr_allocs; i++) {
+		struct allocation *alloc;
+
+		alloc = zalloc(sizeof(*alloc));
+		if (!alloc)
+			return warn("out of memory"), -ENOMEM;
+
+		alloc->bb		= blocks[i];
+		alloc->stmt		= allocs[i];
+		alloc->block_local	= true;
+
+		if (allocation_escapes(cu, alloc)) {
+			free(alloc);
+			continue;
+		}
+
+		if (alloc->nr_monitors)
+			elide_locks(cu, alloc);
+
+		if (allocation_is_replaceable(alloc))
+			err = scalar_replace(cu, alloc);
+
+		free(alloc);
+
+		if (err)
+			break;
+	}
+
+	return err;
+}
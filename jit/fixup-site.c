@@ -58,6 +58,8 @@ void free_fixup_site(struct fixup_site *site)
 void trampoline_add_fixup_site(struct jit_trampoline *trampoline,
 			       struct fixup_site *site)
 {
+	site->target = trampoline;
+
 	pthread_mutex_lock(&trampoline->mutex);
 	list_add_tail(&site->trampoline_node, &trampoline->fixup_site_list);
 	pthread_mutex_unlock(&trampoline->mutex);
@@ -138,9 +138,9 @@ static void gdb_register_code(char *name, struct buffer *buf)
 	pthread_mutex_unlock(&gdb_mutex);
 }
 
-void gdb_register_method(struct vm_method *method)
+void gdb_register_method(struct compilation_unit *cu)
 {
-	struct compilation_unit *cu = method->compilation_unit;
+	struct vm_method *method = cu->method;
 	char name[256], *class, *vmm;
 
 	class = method->class->name;
@@ -0,0 +1,167 @@
+/*
+ * Inline caches for virtual and interface call sites
+ *
+ * This file is released under the GPL version 2. Please refer to the file
+ * LICENSE for details.
+ *
+ * A call site starts out uninitialized and calls
+ * inline_cache_miss_trampoline() which looks up the target and records the
+ * receiver class. The first class is patched into the call site itself, up
+ * to INLINE_CACHE_STUB_ENTRIES more go to a PIC stub, and after that the
+ * site falls back to the vtable or the itable for good.
+ */
+
+#include "jit/compilation-unit.h"
+#include "jit/cu-mapping.h"
+#include "jit/inline-cache.h"
+
+#include "vm/class.h"
+#include "vm/die.h"
+#include "vm/method.h"
+#include "vm/object.h"
+#include "vm/stdlib.h"
+
+#include "arch/itable.h"
+
+#include <pthread.h>
+
+/* Serializes patching of all inline caches; misses are rare. */
+static pthread_mutex_t inline_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+struct inline_cache *alloc_inline_cache(struct vm_method *method)
+{
+	struct inline_cache *ic;
+
+	ic = zalloc(sizeof(*ic));
+	if (!ic)
+		return NULL;
+
+	ic->state = INLINE_CACHE_UNINITIALIZED;
+	ic->method = method;
+
+	return ic;
+}
+
+bool inline_cache_is_interface(struct inline_cache *ic)
+{
+	return vm_class_is_interface(ic->method->class);
+}
+
+/*
+ * Returns the entry point of a stub which does a plain vtable or itable
+ * dispatch of @method, for call sites that cannot be cached.
+ */
+void *inline_cache_megamorphic_stub(struct vm_method *method)
+{
+	struct inline_cache *ic;
+	int err;
+
+	ic = alloc_inline_cache(method);
+	if (!ic)
+		return NULL;
+
+	pthread_mutex_lock(&inline_cache_mutex);
+
+	err = inline_cache_emit_stub(ic);
+	ic->state = INLINE_CACHE_MEGAMORPHIC;
+
+	pthread_mutex_unlock(&inline_cache_mutex);
+
+	if (err) {
+		free(ic);
+		return NULL;
+	}
+
+	return ic->megamorphic_entry;
+}
+
+/*
+ * Caching a trampoline would make the call site go through
+ * jit_magic_trampoline() on every call, so wait until the vtable slot has
+ * been fixed up to point to compiled code.
+ */
+static bool is_trampoline(void *target)
+{
+	struct compilation_unit *cu;
+
+	cu = jit_lookup_cu((unsigned long) target);
+	if (!cu)
+		return false;
+
+	return target == vm_method_trampoline_ptr(cu->method);
+}
+
+static bool inline_cache_has_class(struct inline_cache *ic, struct vm_class *vmc)
+{
+	for (unsigned int i = 0; i < ic->nr_classes; i++) {
+		if (ic->classes[i] == vmc)
+			return true;
+	}
+
+	return false;
+}
+
+static void inline_cache_add_class(struct inline_cache *ic,
+				   struct vm_class *vmc, void *target)
+{
+	if (ic->nr_classes == INLINE_CACHE_MAX_CLASSES) {
+		inline_cache_patch_slow_path(ic, ic->megamorphic_entry);
+		ic->state = INLINE_CACHE_MEGAMORPHIC;
+		return;
+	}
+
+	if (ic->nr_classes == 0) {
+		inline_cache_patch_monomorphic(ic, vmc, target);
+		ic->state = INLINE_CACHE_MONOMORPHIC;
+	} else {
+		if (!ic->stub && inline_cache_emit_stub(ic))
+			return;
+
+		inline_cache_patch_stub_entry(ic, ic->nr_classes - 1, vmc, target);
+
+		if (ic->state == INLINE_CACHE_MONOMORPHIC) {
+			inline_cache_patch_slow_path(ic, ic->stub);
+			ic->state = INLINE_CACHE_POLYMORPHIC;
+		}
+	}
+
+	ic->classes[ic->nr_classes++] = vmc;
+}
+
+static void *interface_target(struct inline_cache *ic, struct vm_object *receiver)
+{
+	void *target;
+
+	target = vm_itable_lookup(receiver->class, ic->method);
+	if (!target)
+		itable_resolver_stub_error(ic->method, receiver);
+
+	return target;
+}
+
+/*
+ * Called from inline_cache_miss_trampoline() when the receiver class of a
+ * call site is not cached. Returns the target to jump to.
+ */
+void *inline_cache_miss(struct inline_cache *ic, struct vm_object *receiver)
+{
+	struct vm_class *vmc = receiver->class;
+	void *target;
+
+	if (inline_cache_is_interface(ic))
+		target = interface_target(ic, receiver);
+	else
+		target = vmc->vtable.native_ptr[ic->method->virtual_index];
+
+	if (is_trampoline(target))
+		return target;
+
+	pthread_mutex_lock(&inline_cache_mutex);
+
+	if (ic->state != INLINE_CACHE_MEGAMORPHIC && !inline_cache_has_class(ic, vmc))
+		inline_cache_add_class(ic, vmc, target);
+
+	pthread_mutex_unlock(&inline_cache_mutex);
+
+	return target;
+}
@@ -8,6 +8,7 @@
  * and return instructions to immediate representation of the JIT compiler.
  */
 
+#include "jit/bc-offset-mapping.h"
 #include "jit/bytecode-to-ir.h"
 #include "jit/compiler.h"
 #include "jit/statement.h"
@@ -17,22 +18,56 @@
 #include "vm/bytecodes.h"
 #include "vm/class.h"
 #include "vm/method.h"
+#include "vm/preload.h"
 #include "lib/stack.h"
 #include "vm/die.h"
 #include "vm/jni.h"
+#include "vm/stdlib.h"
 
 #include <string.h>
 #include <errno.h>
 #include <stdio.h>
 
+/*
+ * Inlining budgets. Methods up to INLINE_MAX_CODE_SIZE bytes of bytecode
+ * are inlined, which covers getters, setters and most constructors, up to
+ * INLINE_MAX_TOTAL_SIZE bytes per compilation unit.
+ */
+#define INLINE_MAX_CODE_SIZE	35
+#define INLINE_MAX_TOTAL_SIZE	512
+#define INLINE_MAX_DEPTH	3
+
+/*
+ * Discards the callee's part of the mimic stack and leaves the return
+ * value, if any, for the caller.
+ */
+static void inline_return(struct parse_context *ctx, struct expression *value)
+{
+	struct inline_frame *frame = ctx->inline_frame;
+
+	while (stack_size(ctx->bb->mimic_stack) > frame->stack_base)
+		expr_put(stack_pop(ctx->bb->mimic_stack));
+
+	if (value)
+		stack_push(ctx->bb->mimic_stack, value);
+}
+
 int convert_xreturn(struct parse_context *ctx)
 {
+	struct statement *return_stmt;
 	struct expression *expr;
-	struct statement *return_stmt = alloc_statement(STMT_RETURN);
+
+	expr = stack_pop(ctx->bb->mimic_stack);
+
+	if (ctx->inline_frame) {
+		inline_return(ctx, expr);
+		return 0;
+	}
+
+	return_stmt = alloc_statement(STMT_RETURN);
 	if (!return_stmt)
 		return warn("out of memory"), -ENOMEM;
 
-	expr = stack_pop(ctx->bb->mimic_stack);
 	return_stmt->return_value = &expr->node;
 	convert_statement(ctx, return_stmt);
 	clear_mimic_stack(ctx->bb->mimic_stack);
@@ -41,7 +76,14 @@ int convert_xreturn(struct parse_context *ctx)
 
 int convert_return(struct parse_context *ctx)
 {
-	struct statement *return_stmt = alloc_statement(STMT_VOID_RETURN);
+	struct statement *return_stmt;
+
+	if (ctx->inline_frame) {
+		inline_return(ctx, NULL);
+		return 0;
+	}
+
+	return_stmt = alloc_statement(STMT_VOID_RETURN);
 	if (!return_stmt)
 		return warn("out of memory"), -ENOMEM;
 
@@ -138,7 +180,7 @@ static struct vm_method *resolve_invoke_target(struct parse_context *ctx)
 
 	idx = bytecode_read_u16(ctx->buffer);
 
-	return vm_class_resolve_method_recursive(ctx->cu->method->class, idx);
+	return vm_class_resolve_method_recursive(ctx->method->class, idx);
 }
 
 static struct vm_method *resolve_invokeinterface_target(struct parse_context *ctx)
@@ -147,7 +189,7 @@ static struct vm_method *resolve_invokeinterface_target(struct parse_context *ct
 
 	idx = bytecode_read_u16(ctx->buffer);
 
-	return vm_class_resolve_interface_method_recursive(ctx->cu->method->class, idx);
+	return vm_class_resolve_interface_method_recursive(ctx->method->class, idx);
 }
 
 static void null_check_arg(struct expression *arg)
@@ -180,6 +222,343 @@ static void null_check_this_arg(struct expression *arg)
 	null_check_this_arg(to_expr(arg->args_left));
 }
 
+/*
+ * An invokevirtual target which no subclass can override. Targets that are
+ * only known not to be overridden by the classes loaded so far are bound
+ * by class hierarchy analysis at instruction selection instead because
+ * inlined code cannot be patched back.
+ */
+static bool method_is_exact_target(struct vm_method *vmm)
+{
+	if (vmm->method->access_flags & CAFEBABE_METHOD_ACC_FINAL)
+		return true;
+
+	return method_is_private(vmm) || vm_class_is_final(vmm->class);
+}
+
+static unsigned long inlined_code_size(struct compilation_unit *cu)
+{
+	unsigned long size = 0;
+
+	for (unsigned long i = 0; i < cu->nr_inline_calls; i++)
+		size += cu->inline_calls[i].method->code_attribute.code_length;
+
+	return size;
+}
+
+/*
+ * Inlined methods are converted into the basic block of the call site so
+ * they must not branch, throw or have more than one exit.
+ */
+static bool method_is_straight_line(struct vm_method *vmm)
+{
+	unsigned long code_length = vmm->code_attribute.code_length;
+	unsigned char *code = vmm->code_attribute.code;
+	unsigned long pc;
+
+	bytecode_for_each_insn(code, code_length, pc) {
+		unsigned char opc = code[pc];
+
+		if (bc_is_branch(opc) || bc_is_athrow(opc) || bc_is_ret(&code[pc]))
+			return false;
+
+		if (opc == OPC_MONITORENTER || opc == OPC_MONITOREXIT)
+			return false;
+
+		if (bc_is_return(opc))
+			return pc + bc_insn_size(code, pc) == code_length;
+	}
+
+	return false;
+}
+
+static bool bc_is_simple_push(unsigned char opc)
+{
+	return (opc >= OPC_ACONST_NULL && opc <= OPC_SIPUSH) ||
+		(opc >= OPC_LDC2_W && opc <= OPC_ALOAD_3);
+}
+
+static bool bc_stores_local_0(const unsigned char *code, unsigned long pc)
+{
+	unsigned char opc = code[pc];
+
+	if (opc >= OPC_ISTORE && opc <= OPC_ASTORE)
+		return code[pc + 1] == 0;
+
+	return opc == OPC_ISTORE_0 || opc == OPC_LSTORE_0 || opc == OPC_FSTORE_0 ||
+		opc == OPC_DSTORE_0 || opc == OPC_ASTORE_0;
+}
+
+static bool bc_cannot_throw(unsigned char opc)
+{
+	switch (opc) {
+	case OPC_LDC:
+	case OPC_LDC_W:
+	case OPC_IDIV:
+	case OPC_LDIV:
+	case OPC_IREM:
+	case OPC_LREM:
+		return false;
+	}
+
+	if (opc >= OPC_IALOAD && opc <= OPC_SALOAD)
+		return false;
+
+	if (opc >= OPC_IASTORE && opc <= OPC_SASTORE)
+		return false;
+
+	return opc <= OPC_DCMPG || (opc >= OPC_IRETURN && opc <= OPC_RETURN);
+}
+
+/*
+ * The monitor of an inlined synchronized method is released at the end of
+ * the inlined code only so the code must not throw. Fields can be accessed
+ * through "this" which is known to be non-null.
+ */
+static bool method_cannot_throw(struct vm_method *vmm)
+{
+	unsigned long code_length = vmm->code_attribute.code_length;
+	unsigned char *code = vmm->code_attribute.code;
+	unsigned char prev = OPC_NOP, prev2 = OPC_NOP;
+	unsigned long pc;
+
+	bytecode_for_each_insn(code, code_length, pc) {
+		unsigned char opc = code[pc];
+
+		if (bc_stores_local_0(code, pc))
+			return false;
+
+		if (opc == OPC_GETFIELD) {
+			if (prev != OPC_ALOAD_0)
+				return false;
+		} else if (opc == OPC_PUTFIELD) {
+			if (prev2 != OPC_ALOAD_0 || !bc_is_simple_push(prev))
+				return false;
+		} else if (!bc_cannot_throw(opc))
+			return false;
+
+		prev2 = prev;
+		prev = opc;
+	}
+
+	return true;
+}
+
+static bool method_is_inlineable(struct parse_context *ctx, struct vm_method *target)
+{
+	unsigned long code_length = target->code_attribute.code_length;
+	struct inline_frame *frame;
+
+	/* Every invocation is traced at method entry. */
+	if (opt_trace_invoke)
+		return false;
+
+	/* Baseline code is recompiled with inlining once it gets hot. */
+	if (ctx->cu->is_baseline)
+		return false;
+
+	if (vm_method_is_native(target) || vm_method_is_abstract(target))
+		return false;
+
+	if (method_is_synchronized(target) &&
+	    (vm_method_is_static(target) || !method_cannot_throw(target)))
+		return false;
+
+	if (code_length == 0 || code_length > INLINE_MAX_CODE_SIZE)
+		return false;
+
+	if (target->code_attribute.exception_table_length)
+		return false;
+
+	if (ctx->inline_frame && ctx->inline_frame->depth >= INLINE_MAX_DEPTH)
+		return false;
+
+	if (target == ctx->cu->method)
+		return false;
+
+	for (frame = ctx->inline_frame; frame; frame = frame->parent) {
+		if (frame->method == target)
+			return false;
+	}
+
+	if (inlined_code_size(ctx->cu) + code_length > INLINE_MAX_TOTAL_SIZE)
+		return false;
+
+	/*
+	 * Stack traces skip the constructor frames of the exception by
+	 * looking at the classes of machine frames.
+	 */
+	if (vm_class_is_assignable_from(vm_java_lang_Throwable, target->class))
+		return false;
+
+	return method_is_straight_line(target);
+}
+
+static int inline_monitor_stmt(struct parse_context *ctx, enum statement_type type)
+{
+	struct expression *receiver;
+	struct statement *stmt;
+
+	receiver = local_var_expr(ctx, J_REFERENCE, 0);
+	if (!receiver)
+		return warn("out of memory"), -ENOMEM;
+
+	stmt = alloc_statement(type);
+	if (!stmt) {
+		expr_put(receiver);
+		return warn("out of memory"), -ENOMEM;
+	}
+
+	stmt->expression = &receiver->node;
+	convert_statement(ctx, stmt);
+
+	return 0;
+}
+
+static int store_inline_arg(struct parse_context *ctx,
+			    struct parse_context *callee_ctx,
+			    struct expression *arg, enum vm_type type,
+			    unsigned long idx)
+{
+	struct expression *dest;
+	struct statement *stmt;
+
+	dest = local_var_expr(callee_ctx, type, idx);
+	if (!dest)
+		return warn("out of memory"), -ENOMEM;
+
+	stmt = alloc_statement(STMT_STORE);
+	if (!stmt) {
+		expr_put(dest);
+		return warn("out of memory"), -ENOMEM;
+	}
+
+	stmt->store_dest = &dest->node;
+	stmt->store_src = &arg->node;
+	convert_statement(ctx, stmt);
+
+	return 0;
+}
+
+/*
+ * Converts the bytecode of @target in place of the invoke instruction.
+ * The arguments are stored in the callee's local variables and the code
+ * of the callee gets bytecode offsets of its own, see cu_add_inline_call(),
+ * so that exceptions and stack traces see the call site.
+ */
+static int inline_invoke(struct parse_context *ctx, struct vm_method *target)
+{
+	unsigned int argc = method_real_argument_count(target);
+	struct expression *args[argc + 1];
+	unsigned long slots[argc + 1];
+	enum vm_type types[argc + 1];
+	struct parse_context callee_ctx;
+	struct bytecode_buffer buffer;
+	struct inline_frame frame;
+	struct vm_method_arg *arg;
+	unsigned long bc_offset;
+	unsigned long slot;
+	unsigned int first;
+	unsigned int i;
+	int err;
+
+	bc_offset = cu_add_inline_call(ctx->cu, target, ctx->offset);
+	if (bc_offset == BC_OFFSET_UNKNOWN)
+		return warn("out of memory"), -ENOMEM;
+
+	frame = (struct inline_frame) {
+		.parent		= ctx->inline_frame,
+		.method		= target,
+		.depth		= ctx->inline_frame ? ctx->inline_frame->depth + 1 : 1,
+		.nr_locals	= target->code_attribute.max_locals,
+	};
+
+	frame.locals = zalloc(frame.nr_locals * sizeof(*frame.locals));
+	if (frame.nr_locals && !frame.locals)
+		return warn("out of memory"), -ENOMEM;
+
+	i = slot = 0;
+
+	if (!vm_method_is_static(target)) {
+		types[i] = J_REFERENCE;
+		slots[i++] = slot++;
+	}
+
+	list_for_each_entry(arg, &target->args, list_node) {
+		enum vm_type type = arg->type_info.vm_type;
+
+		types[i] = mimic_stack_type(type);
+		slots[i++] = slot;
+		slot += vm_type_slot_size(type);
+	}
+
+	for (i = argc; i > 0; i--)
+		args[i - 1] = stack_pop(ctx->bb->mimic_stack);
+
+	frame.stack_base = stack_size(ctx->bb->mimic_stack);
+
+	buffer = (struct bytecode_buffer) {
+		.buffer		= target->code_attribute.code,
+		.pos		= 0,
+	};
+
+	callee_ctx = (struct parse_context) {
+		.cu		= ctx->cu,
+		.bb		= ctx->bb,
+		.method		= target,
+		.inline_frame	= &frame,
+		.buffer		= &buffer,
+		.code		= target->code_attribute.code,
+		.is_wide	= false,
+	};
+
+	/*
+	 * The receiver is null checked after the other arguments have been
+	 * evaluated just like for a call.
+	 */
+	first = vm_method_is_static(target) ? 0 : 1;
+
+	for (i = first; i < argc; i++) {
+		err = store_inline_arg(ctx, &callee_ctx, args[i], types[i], slots[i]);
+		if (err)
+			goto out;
+	}
+
+	if (first) {
+		err = store_inline_arg(ctx, &callee_ctx, null_check_expr(args[0]),
+				       J_REFERENCE, 0);
+		if (err)
+			goto out;
+	}
+
+	/*
+	 * The receiver is not null and the code can not throw, see
+	 * method_cannot_throw(), so the monitor is always released here.
+	 */
+	if (method_is_synchronized(target)) {
+		callee_ctx.offset = bc_offset;
+
+		err = inline_monitor_stmt(&callee_ctx, STMT_MONITOR_ENTER);
+		if (err)
+			goto out;
+	}
+
+	err = convert_inlined_method(&callee_ctx, bc_offset);
+	if (err)
+		goto out;
+
+	if (method_is_synchronized(target))
+		err = inline_monitor_stmt(&callee_ctx, STMT_MONITOR_EXIT);
+out:
+	for (i = 0; i < frame.nr_locals; i++) {
+		if (frame.locals[i])
+			expr_put(frame.locals[i]);
+	}
+	free(frame.locals);
+
+	return err;
+}
+
 int convert_invokeinterface(struct parse_context *ctx)
 {
 	struct vm_method *invoke_target;
@@ -228,6 +607,10 @@ int convert_invokevirtual(struct parse_context *ctx)
 	if (!invoke_target)
 		return warn("unable to resolve invocation target"), -EINVAL;
 
+	if (method_is_exact_target(invoke_target) &&
+	    method_is_inlineable(ctx, invoke_target))
+		return inline_invoke(ctx, invoke_target);
+
 	stmt = invoke_stmt(ctx, STMT_INVOKEVIRTUAL, invoke_target);
 	if (!stmt)
 		return warn("out of memory"), -ENOMEM;
@@ -253,6 +636,9 @@ int convert_invokespecial(struct parse_context *ctx)
 	if (!invoke_target)
 		return warn("unable to resolve invocation target"), -EINVAL;
 
+	if (method_is_inlineable(ctx, invoke_target))
+		return inline_invoke(ctx, invoke_target);
+
 	stmt = invoke_stmt(ctx, STMT_INVOKE, invoke_target);
 	if (!stmt)
 		return warn("out of memory"), -ENOMEM;
@@ -280,6 +666,11 @@ int convert_invokestatic(struct parse_context *ctx)
 	if (!invoke_target)
 		return warn("unable to resolve invocation target"), -EINVAL;
 
+	/* The class is initialized by the call otherwise. */
+	if (vm_class_is_initialized(invoke_target->class) &&
+	    method_is_inlineable(ctx, invoke_target))
+		return inline_invoke(ctx, invoke_target);
+
 	stmt = invoke_stmt(ctx, STMT_INVOKE, invoke_target);
 	if (!stmt)
 		return warn("out of memory"), -ENOMEM;
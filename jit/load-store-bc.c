@@ -21,6 +21,7 @@
 #include "vm/class.h"
 #include "vm/classloader.h"
 #include "vm/object.h"
+#include "vm/string.h"
 #include "lib/stack.h"
 #include "vm/die.h"
 
@@ -97,7 +98,7 @@ static int __convert_ldc(struct parse_context *ctx, unsigned long cp_idx)
 	struct cafebabe_constant_pool *cp;
 	struct expression *expr = NULL;
 
-	vmc = ctx->cu->method->class;
+	vmc = ctx->method->class;
 
 	if (cafebabe_class_constant_index_invalid(vmc->class, cp_idx))
 		return warn("invalid constant index: %ld", cp_idx), -EINVAL;
@@ -122,6 +123,14 @@ static int __convert_ldc(struct parse_context *ctx, unsigned long cp_idx)
 		if (!string)
 			return warn("out of memory"), -ENOMEM;
 
+		/*
+		 * The string is referenced from compiled code so it must
+		 * be kept alive by the GC. Interning makes it a root.
+		 */
+		string = vm_string_intern(string);
+		if (!string)
+			return warn("out of memory"), -ENOMEM;
+
 		expr = value_expr(J_REFERENCE, (unsigned long) string);
 		break;
 	}
@@ -189,7 +198,7 @@ static int convert_load(struct parse_context *ctx, unsigned int index, enum vm_t
 {
 	struct expression *expr;
 
-	expr = local_expr(type, index);
+	expr = local_var_expr(ctx, type, index);
 	if (!expr)
 		return warn("out of memory"), -ENOMEM;
 
@@ -282,7 +291,10 @@ static int convert_store(struct parse_context *ctx, unsigned int index, enum vm_
 	if (!stmt)
 		goto failed;
 
-	dest_expr = local_expr(type, index);
+	dest_expr = local_var_expr(ctx, type, index);
+	if (!dest_expr)
+		goto failed;
+
 	src_expr = stack_pop(ctx->bb->mimic_stack);
 
 	stmt->store_dest = &dest_expr->node;
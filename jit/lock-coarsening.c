@@ -0,0 +1,283 @@
+/*
+ * Lock coarsening
+ *
+ * This file is released under the GPL version 2. Please refer to the file
+ * LICENSE for details.
+ *
+ * A monitor exit that is followed by a monitor enter on the same object,
+ * with nothing in between that can throw, block or have side effects, is
+ * removed together with the enter so that the two synchronized regions
+ * become one. This happens with back-to-back synchronized blocks and with
+ * consecutive calls to inlined synchronized methods.
+ *
+ * Two references are known to be the same object if they are both copies
+ * of a local variable that is never assigned in the method, such as "this"
+ * or an argument.
+ */
+
+#include "jit/compilation-unit.h"
+#include "jit/compiler.h"
+#include "jit/expression.h"
+#include "jit/statement.h"
+
+#include "vm/types.h"
+
+#include <stddef.h>
+
+/* Maximum length of the copy chain followed by copy_root() */
+#define COARSEN_MAX_COPY_DEPTH	8
+
+static bool expr_is_var(struct expression *expr)
+{
+	switch (expr_type(expr)) {
+	case EXPR_LOCAL:
+	case EXPR_TEMPORARY:
+		return true;
+	default:
+		return false;
+	}
+}
+
+static struct expression *strip_null_check(struct expression *expr)
+{
+	if (expr_type(expr) == EXPR_NULL_CHECK)
+		return to_expr(expr->null_check_ref);
+
+	return expr;
+}
+
+static bool same_var(struct expression *a, struct expression *b)
+{
+	if (expr_type(a) != expr_type(b))
+		return false;
+
+	if (expr_type(a) == EXPR_LOCAL)
+		return a->local_index == b->local_index;
+
+	return a->tmp_low == b->tmp_low;
+}
+
+/* Returns true if @dest overwrites any part of the variable @var. */
+static bool var_overlaps(struct expression *dest, struct expression *var)
+{
+	if (expr_type(var) == EXPR_LOCAL) {
+		if (expr_type(dest) != EXPR_LOCAL && expr_type(dest) != EXPR_FLOAT_LOCAL)
+			return false;
+
+		if (dest->local_index == var->local_index)
+			return true;
+
+		return vm_type_slot_size(dest->vm_type) == 2 &&
+			dest->local_index + 1 == var->local_index;
+	}
+
+	if (expr_type(dest) != EXPR_TEMPORARY && expr_type(dest) != EXPR_FLOAT_TEMPORARY)
+		return false;
+
+	return dest->tmp_low == var->tmp_low || dest->tmp_high == var->tmp_low;
+}
+
+static struct expression *stmt_def(struct statement *stmt)
+{
+	switch (stmt_type(stmt)) {
+	case STMT_STORE:
+		return to_expr(stmt->store_dest);
+	case STMT_INVOKE:
+	case STMT_INVOKEVIRTUAL:
+	case STMT_INVOKEINTERFACE:
+		return stmt->invoke_result;
+	default:
+		return NULL;
+	}
+}
+
+/*
+ * Returns the local variable the reference in @expr always is a copy of,
+ * or NULL if there is no such variable. Temporaries without assignments
+ * are not roots because mimic stack slots are assigned on CFG edges.
+ */
+static struct expression *
+copy_root(struct compilation_unit *cu, struct expression *expr, int depth)
+{
+	struct expression *root = NULL;
+	struct basic_block *bb;
+	struct statement *stmt;
+
+	expr = strip_null_check(expr);
+
+	if (!expr_is_var(expr) || expr->vm_type != J_REFERENCE)
+		return NULL;
+
+	if (depth > COARSEN_MAX_COPY_DEPTH)
+		return NULL;
+
+	for_each_basic_block(bb, &cu->bb_list) {
+		for_each_stmt(stmt, &bb->stmt_list) {
+			struct expression *def, *src_root;
+
+			def = stmt_def(stmt);
+			if (!def || !var_overlaps(def, expr))
+				continue;
+
+			if (stmt_type(stmt) != STMT_STORE || !same_var(def, expr))
+				return NULL;
+
+			src_root = copy_root(cu, to_expr(stmt->store_src), depth + 1);
+			if (!src_root)
+				return NULL;
+
+			if (root && !same_var(root, src_root))
+				return NULL;
+
+			root = src_root;
+		}
+	}
+
+	if (!root && expr_type(expr) == EXPR_LOCAL)
+		return expr;
+
+	return root;
+}
+
+/*
+ * Statements between the two regions are executed with the monitor held
+ * after coarsening so they may only copy values around. A null check of
+ * the locked object can not fail.
+ */
+static bool stmt_is_harmless(struct compilation_unit *cu, struct statement *stmt,
+			     struct expression *root)
+{
+	struct expression *src;
+
+	if (stmt_type(stmt) != STMT_STORE)
+		return false;
+
+	switch (expr_type(to_expr(stmt->store_dest))) {
+	case EXPR_LOCAL:
+	case EXPR_FLOAT_LOCAL:
+	case EXPR_TEMPORARY:
+	case EXPR_FLOAT_TEMPORARY:
+		break;
+	default:
+		return false;
+	}
+
+	src = to_expr(stmt->store_src);
+
+	switch (expr_type(src)) {
+	case EXPR_VALUE:
+	case EXPR_FVALUE:
+	case EXPR_LOCAL:
+	case EXPR_FLOAT_LOCAL:
+	case EXPR_TEMPORARY:
+	case EXPR_FLOAT_TEMPORARY:
+		return true;
+	case EXPR_NULL_CHECK: {
+		struct expression *src_root = copy_root(cu, src, 0);
+
+		return src_root && same_var(src_root, root);
+	}
+	default:
+		return false;
+	}
+}
+
+static struct basic_block *fallthrough_bb(struct basic_block *bb)
+{
+	struct basic_block *next;
+
+	if (bb->nr_successors != 1)
+		return NULL;
+
+	next = bb->successors[0];
+	if (next == bb || next->is_eh || next->nr_predecessors != 1)
+		return NULL;
+
+	return next;
+}
+
+/*
+ * Looks for a monitor enter on @root after @exit, following the control
+ * flow into a basic block that is only entered from this one.
+ */
+static struct statement *
+find_matching_enter(struct compilation_unit *cu, struct basic_block *bb,
+		    struct statement *exit, struct expression *root)
+{
+	struct list_head *node = &exit->stmt_list_node;
+
+	for (;;) {
+		for (node = node->next; node != &bb->stmt_list; node = node->next) {
+			struct statement *stmt;
+			struct expression *enter_root;
+
+			stmt = list_entry(node, struct statement, stmt_list_node);
+
+			if (stmt_type(stmt) == STMT_GOTO && node->next == &bb->stmt_list)
+				break;
+
+			if (stmt_type(stmt) != STMT_MONITOR_ENTER) {
+				if (!stmt_is_harmless(cu, stmt, root))
+					return NULL;
+
+				continue;
+			}
+
+			enter_root = copy_root(cu, to_expr(stmt->expression), 0);
+			if (enter_root && same_var(enter_root, root))
+				return stmt;
+
+			return NULL;
+		}
+
+		bb = fallthrough_bb(bb);
+		if (!bb)
+			return NULL;
+
+		node = &bb->stmt_list;
+	}
+}
+
+static bool coarsen_lock(struct compilation_unit *cu, struct basic_block *bb,
+			 struct statement *exit)
+{
+	struct statement *enter;
+	struct expression *root;
+
+	root = copy_root(cu, to_expr(exit->expression), 0);
+	if (!root)
+		return false;
+
+	enter = find_matching_enter(cu, bb, exit, root);
+	if (!enter)
+		return false;
+
+	list_del(&exit->stmt_list_node);
+	free_statement(exit);
+
+	list_del(&enter->stmt_list_node);
+	free_statement(enter);
+
+	return true;
+}
+
+/**
+ *	coarsen_locks - Merge adjacent synchronized regions on the same object
+ *	@cu: compilation unit to optimize.
+ */
+void coarsen_locks(struct compilation_unit *cu)
+{
+	struct basic_block *bb;
+	struct statement *stmt;
+
+restart:
+	for_each_basic_block(bb, &cu->bb_list) {
+		for_each_stmt(stmt, &bb->stmt_list) {
+			if (stmt_type(stmt) != STMT_MONITOR_EXIT)
+				continue;
+
+			if (coarsen_lock(cu, bb, stmt))
+				goto restart;
+		}
+	}
+}
@@ -59,7 +59,7 @@ static struct vm_field *lookup_field(struct parse_context *ctx)
 
 	index = bytecode_read_u16(ctx->buffer);
 
-	return vm_class_resolve_field_recursive(ctx->cu->method->class, index);
+	return vm_class_resolve_field_recursive(ctx->method->class, index);
 }
 
 int convert_getstatic(struct parse_context *ctx)
@@ -372,7 +372,7 @@ int convert_new(struct parse_context *ctx)
 	struct vm_class *class;
 
 	type_idx = bytecode_read_u16(ctx->buffer);
-	class = vm_class_resolve_class(ctx->cu->method->class, type_idx);
+	class = vm_class_resolve_class(ctx->method->class, type_idx);
 	if (!class)
 		return warn("unable to resolve class"), -EINVAL;
 
@@ -417,7 +417,7 @@ int convert_anewarray(struct parse_context *ctx)
 	size = stack_pop(ctx->bb->mimic_stack);
 	type_idx = bytecode_read_u16(ctx->buffer);
 
-	class = vm_class_resolve_class(ctx->cu->method->class, type_idx);
+	class = vm_class_resolve_class(ctx->method->class, type_idx);
 	if (!class)
 		return warn("unable to resolve class"), -EINVAL;
 
@@ -449,7 +449,7 @@ int convert_multianewarray(struct parse_context *ctx)
 
 	type_idx = bytecode_read_u16(ctx->buffer);
 	dimension = bytecode_read_u8(ctx->buffer);
-	class = vm_class_resolve_class(ctx->cu->method->class, type_idx);
+	class = vm_class_resolve_class(ctx->method->class, type_idx);
 	if (!class)
 		return warn("out of memory"), -ENOMEM;
 
@@ -494,7 +494,7 @@ int convert_instanceof(struct parse_context *ctx)
 	objectref = stack_pop(ctx->bb->mimic_stack);
 
 	type_idx = bytecode_read_u16(ctx->buffer);
-	class = vm_class_resolve_class(ctx->cu->method->class, type_idx);
+	class = vm_class_resolve_class(ctx->method->class, type_idx);
 	if (!class)
 		return warn("unable to resolve class"), -EINVAL;
 
@@ -517,7 +517,7 @@ int convert_checkcast(struct parse_context *ctx)
 	object_ref_tmp = dup_expr(ctx, stack_pop(ctx->bb->mimic_stack));
 
 	type_idx = bytecode_read_u16(ctx->buffer);
-	class = vm_class_resolve_class(ctx->cu->method->class, type_idx);
+	class = vm_class_resolve_class(ctx->method->class, type_idx);
 	if (!class)
 		return warn("out of memory"), -ENOMEM;
 
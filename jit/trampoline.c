@@ -24,11 +24,13 @@
  * Please refer to the file LICENSE for details.
  */
 
+#include "jit/compile-queue.h"
 #include "jit/cu-mapping.h"
 #include "jit/emit-code.h"
 #include "jit/exception.h"
 #include "jit/compiler.h"
 
+#include "vm/interp.h"
 #include "vm/preload.h"
 #include "lib/buffer.h"
 #include "vm/class.h"
@@ -41,6 +43,9 @@
 #include "vm/jni.h"
 #include "vm/stack-trace.h"
 
+#include "arch/atomic.h"
+
+#include <stdint.h>
 #include <stdio.h>
 
 static void *jit_jni_trampoline(struct compilation_unit *cu)
@@ -94,6 +99,8 @@ out:
 
 static void *jit_java_trampoline(struct compilation_unit *cu)
 {
+	cu->is_baseline = compile_queue_is_tiered();
+
 	if (compile(cu)) {
 		assert(exception_occurred() != NULL);
 
@@ -105,22 +112,30 @@ static void *jit_java_trampoline(struct compilation_unit *cu)
 		return NULL;
 	}
 
+	if (cu->is_baseline)
+		compile_queue_add_baseline(cu);
+
 	return buffer_ptr(cu->objcode);
 }
 
-void *jit_magic_trampoline(struct compilation_unit *cu)
+static void count_invocation(struct compilation_unit *cu)
 {
-	struct vm_method *method = cu->method;
-	void *ret;
+	uint32_t old;
 
-	if (vm_method_is_static(method)) {
-		/* This is for "invokestatic"... */
-		if (vm_class_ensure_init(method->class))
-			return NULL;
-	}
+	do {
+		old = *(volatile uint32_t *) &cu->nr_invocations;
+	} while (atomic_cmpxchg_32(&cu->nr_invocations, old, old + 1) != old);
+}
 
-	if (opt_trace_magic_trampoline)
-		trace_magic_trampoline(cu);
+/*
+ * Compiles @cu unless that is already done and points vtables and direct
+ * call sites to the code. This is called by the trampoline and by the
+ * background compiler threads.
+ */
+void *jit_compile_method(struct compilation_unit *cu)
+{
+	struct vm_method *method = cu->method;
+	void *ret;
 
 	pthread_mutex_lock(&cu->mutex);
 
@@ -167,6 +182,184 @@ void *jit_magic_trampoline(struct compilation_unit *cu)
 	return ret;
 }
 
+/*
+ * Compiles the method of baseline @cu again with all optimizations. Code
+ * which still calls the baseline code is sent to the new code by the jump
+ * at its entry while vtables and new call sites use the new code directly.
+ * The baseline code is kept because other threads can be running it.
+ *
+ * When we run out of memory, @cu goes back to the baseline list so that it
+ * is tried again later. A method which does not compile stays baseline.
+ */
+void *jit_recompile_method(struct compilation_unit *cu)
+{
+	struct compilation_unit *opt_cu;
+	void *old, *ret;
+
+	opt_cu = compilation_unit_alloc(cu->method);
+	if (!opt_cu)
+		goto out_retry;
+
+	if (compile(opt_cu)) {
+		assert(exception_occurred() != NULL);
+
+		free_compilation_unit(opt_cu);
+		compile_queue_drop_baseline(cu);
+		return NULL;
+	}
+
+	ret = buffer_ptr(opt_cu->objcode);
+
+	if (add_cu_mapping((unsigned long) ret, opt_cu) != 0) {
+		free_compilation_unit(opt_cu);
+		goto out_retry;
+	}
+
+	shrink_compilation_unit(opt_cu);
+
+	*(void * volatile *) &cu->tier_entry = ret;
+
+	pthread_mutex_lock(&cu->mutex);
+
+	old = cu->native_ptr;
+	cu->native_ptr = ret;
+	cu->is_baseline = false;
+
+	if (method_is_virtual(cu->method))
+		repoint_vtable(cu, old, ret);
+
+	pthread_mutex_unlock(&cu->mutex);
+
+	return ret;
+
+  out_retry:
+	compile_queue_add_baseline(cu);
+	signal_new_exception(vm_java_lang_OutOfMemoryError, NULL);
+	return NULL;
+}
+
+#ifdef CONFIG_X86_32
+/* The return value of an interpreted method, for interp_return_stub */
+static __thread uint64_t interp_return_value;
+
+static void *interp_return_stub;
+
+void trampoline_init(void)
+{
+	if (!compile_queue_is_enabled())
+		return;
+
+	interp_return_stub = emit_tls_return_stub(&interp_return_value);
+	if (!interp_return_stub)
+		die("Couldn't allocate interpreter return stub");
+}
+
+/*
+ * Returns true if @cu is left to a compiler thread and the caller should
+ * run it with the interpreter in the meantime.
+ */
+static bool jit_should_interpret(struct compilation_unit *cu)
+{
+	struct vm_method *vmm = cu->method;
+	bool is_compiled;
+
+	if (!interp_return_stub)
+		return false;
+
+	/* interp_return_stub does not return on the FPU stack. */
+	if (vmm->return_type.vm_type == J_FLOAT || vmm->return_type.vm_type == J_DOUBLE)
+		return false;
+
+	/* Otherwise someone is compiling it right now. */
+	if (pthread_mutex_trylock(&cu->mutex) == 0) {
+		is_compiled = cu->is_compiled;
+		pthread_mutex_unlock(&cu->mutex);
+
+		if (is_compiled)
+			return false;
+	}
+
+	if (!interp_can_execute(vmm))
+		return false;
+
+	return compile_queue_submit(cu, cu->nr_invocations);
+}
+
+/*
+ * Interprets the method of @cu with the arguments in the trampoline @frame
+ * and returns code which returns the result like the compiled method would.
+ * A pending exception is thrown by the trampoline.
+ */
+static void *jit_interpret_method(struct compilation_unit *cu,
+				  struct native_stack_frame *frame)
+{
+	union jvalue result;
+
+	interp_call_method(cu->method, frame->args, &result);
+
+	switch (cu->method->return_type.vm_type) {
+	case J_BOOLEAN:
+		interp_return_value = result.z;
+		break;
+	case J_BYTE:
+		interp_return_value = (uint32_t) (jint) result.b;
+		break;
+	case J_CHAR:
+		interp_return_value = result.c;
+		break;
+	case J_SHORT:
+		interp_return_value = (uint32_t) (jint) result.s;
+		break;
+	case J_INT:
+		interp_return_value = (uint32_t) result.i;
+		break;
+	case J_LONG:
+		interp_return_value = result.j;
+		break;
+	case J_REFERENCE:
+		interp_return_value = (unsigned long) result.l;
+		break;
+	default:
+		interp_return_value = 0;
+		break;
+	}
+
+	return interp_return_stub;
+}
+#else
+void trampoline_init(void)
+{
+}
+#endif
+
+void *jit_magic_trampoline(struct compilation_unit *cu)
+{
+	struct vm_method *method = cu->method;
+
+	if (vm_method_is_static(method)) {
+		/* This is for "invokestatic"... */
+		if (vm_class_ensure_init(method->class))
+			return NULL;
+	}
+
+	if (opt_trace_magic_trampoline)
+		trace_magic_trampoline(cu);
+
+	count_invocation(cu);
+
+#ifdef CONFIG_X86_32
+	/*
+	 * Keep the caller going while a compiler thread compiles the method.
+	 * jit_compile_method() installs the code in vtables and call sites
+	 * when it is ready.
+	 */
+	if (jit_should_interpret(cu))
+		return jit_interpret_method(cu, __builtin_frame_address(1));
+#endif
+
+	return jit_compile_method(cu);
+}
+
 struct jit_trampoline *build_jit_trampoline(struct compilation_unit *cu)
 {
 	struct jit_trampoline *trampoline;
@@ -27,8 +27,29 @@
 #include "jit/vtable.h"
 #include "jit/compilation-unit.h"
 #include "vm/class.h"
+#include "vm/die.h"
+#include <pthread.h>
 #include <stdlib.h>
 
+/*
+ * Serializes vtable fixups against the setup of subclass vtables so that a
+ * subclass either copies the compiled entry point from its superclass or is
+ * already registered to receive it. Also protects vm_class::subclasses.
+ */
+static pthread_mutex_t vtable_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+void vtable_lock(void)
+{
+	if (pthread_mutex_lock(&vtable_mutex))
+		die("pthread_mutex_lock");
+}
+
+void vtable_unlock(void)
+{
+	if (pthread_mutex_unlock(&vtable_mutex))
+		die("pthread_mutex_unlock");
+}
+
 void vtable_init(struct vtable *vtable, unsigned int nr_methods)
 {
 	vtable->native_ptr = calloc(nr_methods, sizeof(void *));
@@ -44,13 +65,44 @@ void vtable_setup_method(struct vtable *vtable, unsigned long idx, void *native_
 	vtable->native_ptr[idx] = native_ptr;
 }
 
+static void fixup_subclass_vtables(struct vm_class *vmc, unsigned long idx,
+				   void *old, void *target)
+{
+	struct vm_class *sub;
+
+	list_for_each_entry(sub, &vmc->subclasses, subclass_node) {
+		/* The method is overridden in this part of the hierarchy. */
+		if (sub->vtable.native_ptr[idx] != old)
+			continue;
+
+		sub->vtable.native_ptr[idx] = target;
+		vm_itable_fixup(sub, idx, target);
+		fixup_subclass_vtables(sub, idx, old, target);
+	}
+}
+
 /**
  * This function replaces pointers in vtable so that they point
- * directly to compiled code instead of trampoline code.
+ * directly to compiled code instead of trampoline code. Subclasses
+ * which inherit the method and itable entries are updated as well.
  */
 void fixup_vtable(struct compilation_unit *cu, void *target)
+{
+	repoint_vtable(cu, vm_method_trampoline_ptr(cu->method), target);
+}
+
+/**
+ * This function replaces pointers to @old in vtables with @target when
+ * a method is recompiled.
+ */
+void repoint_vtable(struct compilation_unit *cu, void *old, void *target)
 {
 	struct vm_class *vmc = cu->method->class;
+	unsigned long idx = cu->method->virtual_index;
 
-	vmc->vtable.native_ptr[cu->method->virtual_index] = target;
+	vtable_lock();
+	vmc->vtable.native_ptr[idx] = target;
+	vm_itable_fixup(vmc, idx, target);
+	fixup_subclass_vtables(vmc, idx, old, target);
+	vtable_unlock();
 }
@@ -0,0 +1,121 @@
+/*
+ * Work-stealing deque
+ *
+ * This file is released under the GPL version 2. Please refer to the file
+ * LICENSE for details.
+ *
+ * The algorithm is described in the following paper:
+ *
+ *   "Dynamic Circular Work-Stealing Deque", Chase and Lev.
+ *
+ * The deque does not grow. ws_deque_push() fails when it is full and the
+ * caller has to deal with the overflow.
+ */
+
+#include "lib/ws-deque.h"
+
+#include "arch/atomic.h"
+#include "arch/memory.h"
+
+#include <stdlib.h>
+#include <errno.h>
+
+/* @size must be a power of two. */
+int init_ws_deque(struct ws_deque *deque, unsigned long size)
+{
+	deque->elements = malloc(size * sizeof(void *));
+	if (!deque->elements)
+		return -ENOMEM;
+
+	deque->top	= 0;
+	deque->bottom	= 0;
+	deque->mask	= size - 1;
+
+	return 0;
+}
+
+static bool ws_deque_cas_top(struct ws_deque *deque, long top)
+{
+	return atomic_cmpxchg_ptr((void *) &deque->top, (void *) top, (void *) (top + 1)) == (void *) top;
+}
+
+/*
+ * Must only be called by the owner of @deque.
+ */
+bool ws_deque_push(struct ws_deque *deque, void *element)
+{
+	long bottom = deque->bottom;
+
+	if (bottom - deque->top > (long) deque->mask)
+		return false;
+
+	deque->elements[bottom & deque->mask] = element;
+
+	/* The element must be visible before a thief can see it. */
+	wmb();
+
+	deque->bottom = bottom + 1;
+
+	return true;
+}
+
+/*
+ * Must only be called by the owner of @deque. Returns NULL if the deque is
+ * empty.
+ */
+void *ws_deque_pop(struct ws_deque *deque)
+{
+	long bottom, top;
+	void *element;
+
+	bottom = deque->bottom - 1;
+	deque->bottom = bottom;
+
+	/* Publish the new bottom before looking at top. */
+	mb();
+
+	top = deque->top;
+
+	if (bottom < top) {
+		deque->bottom = top;
+		return NULL;
+	}
+
+	element = deque->elements[bottom & deque->mask];
+	if (bottom > top)
+		return element;
+
+	/* Last element, race against thieves. */
+	if (!ws_deque_cas_top(deque, top))
+		element = NULL;
+
+	deque->bottom = top + 1;
+
+	return element;
+}
+
+/*
+ * Can be called by any thread. Returns NULL if the deque is empty or if
+ * another thread took the element first.
+ */
+void *ws_deque_steal(struct ws_deque *deque)
+{
+	long bottom, top;
+	void *element;
+
+	top = deque->top;
+
+	mb();
+
+	bottom = deque->bottom;
+
+	if (top >= bottom)
+		return NULL;
+
+	element = deque->elements[top & deque->mask];
+
+	if (!ws_deque_cas_top(deque, top))
+		return NULL;
+
+	return element;
+}
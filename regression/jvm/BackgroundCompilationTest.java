@@ -0,0 +1,96 @@
+package jvm;
+
+/**
+ * This tests that methods compiled by the background compiler threads work
+ * when several threads race to call them and the heap is collected at the
+ * same time, and that they return the same results and throw the same
+ * exceptions while they are interpreted before that. Run with -Xgc
+ * -XX:CICompilerCount=2.
+ */
+public class BackgroundCompilationTest extends TestCase {
+    private static final int NR_THREADS = 4;
+
+    private static int a(int x) { return b(x) + 1; }
+    private static int b(int x) { return c(x) + 1; }
+    private static int c(int x) { return d(x) + 1; }
+    private static int d(int x) { return e(x) + 1; }
+    private static int e(int x) { return f(x) + 1; }
+    private static int f(int x) { return g(x) + 1; }
+    private static int g(int x) { return h(x) + 1; }
+    private static int h(int x) { return x; }
+
+    private static byte negate(int x) { return (byte) -x; }
+    private static char complement(int x) { return (char) ~x; }
+    private static short shortOf(int x) { return (short) x; }
+    private static boolean isOdd(int x) { return (x & 1) != 0; }
+    private static long shift(int x) { return (long) x << 33; }
+    private static int divide(int x) { return 100 / x; }
+
+    private int value;
+
+    private void add(int x) {
+        value += x;
+        allocate();
+    }
+
+    private static Object allocate() {
+        Object[] garbage = new Object[64];
+
+        for (int i = 0; i < garbage.length; i++)
+            garbage[i] = new int[16];
+
+        return garbage;
+    }
+
+    private static class Caller extends Thread {
+        private final BackgroundCompilationTest test = new BackgroundCompilationTest();
+
+        public void run() {
+            for (int i = 0; i < 100; i++)
+                test.add(a(i));
+        }
+    }
+
+    public static void testConcurrentCalls() throws InterruptedException {
+        Caller[] callers = new Caller[NR_THREADS];
+
+        for (int i = 0; i < NR_THREADS; i++) {
+            callers[i] = new Caller();
+            callers[i].start();
+        }
+
+        for (int i = 0; i < NR_THREADS; i++) {
+            callers[i].join();
+
+            /* sum of i + 7 for i in [0, 100) */
+            assertEquals(5650, callers[i].test.value);
+        }
+    }
+
+    public static void testNarrowResults() {
+        for (int i = 1; i < 100; i++) {
+            assertEquals(-i, negate(i));
+            assertEquals(0xffff - i, complement(i));
+            assertEquals(-i, shortOf(0x10000 - i));
+            assertTrue(isOdd(i) == ((i & 1) == 1));
+            assertEquals((long) i << 33, shift(i));
+        }
+    }
+
+    public static void testException() {
+        for (int i = 0; i < 100; i++) {
+            try {
+                divide(0);
+                fail();
+            } catch (ArithmeticException e) {
+                assertEquals("divide", e.getStackTrace()[0].getMethodName());
+            }
+        }
+    }
+
+    public static void main(String[] args) throws InterruptedException {
+        testConcurrentCalls();
+        testNarrowResults();
+        testException();
+    }
+}
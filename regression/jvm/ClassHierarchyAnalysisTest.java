@@ -0,0 +1,100 @@
+package jvm;
+
+/**
+ * This tests that call sites which were bound to the only loaded target of
+ * a method are dispatched dynamically again once a class that overrides the
+ * method or implements the interface is loaded.
+ */
+public class ClassHierarchyAnalysisTest extends TestCase {
+    private static class Base {
+        public int value() {
+            return 1;
+        }
+
+        public int otherValue() {
+            return 10;
+        }
+    }
+
+    private static class Derived extends Base {
+        public int value() {
+            return 2;
+        }
+
+        public int otherValue() {
+            return 20;
+        }
+    }
+
+    private interface Unique {
+        int id();
+    }
+
+    private static class First implements Unique {
+        public int id() {
+            return 1;
+        }
+    }
+
+    private static class Second implements Unique {
+        public int id() {
+            return 2;
+        }
+    }
+
+    private static int callValue(Base b) {
+        return b.value();
+    }
+
+    private static int callOtherValue(Base b, boolean call) {
+        if (call)
+            return b.otherValue();
+
+        return 0;
+    }
+
+    private static int callId(Unique u) {
+        return u.id();
+    }
+
+    private static Base newDerived() {
+        return new Derived();
+    }
+
+    private static Unique newSecond() {
+        return new Second();
+    }
+
+    public static void testOverridingClassLoadedLater() {
+        Base base = new Base();
+
+        assertEquals(1, callValue(base));
+
+        /* Base.otherValue() is not compiled when the call site is patched. */
+        assertEquals(0, callOtherValue(base, false));
+
+        Base derived = newDerived();
+
+        assertEquals(2, callValue(derived));
+        assertEquals(1, callValue(base));
+
+        assertEquals(20, callOtherValue(derived, true));
+        assertEquals(10, callOtherValue(base, true));
+    }
+
+    public static void testImplementorLoadedLater() {
+        Unique first = new First();
+
+        assertEquals(1, callId(first));
+
+        Unique second = newSecond();
+
+        assertEquals(2, callId(second));
+        assertEquals(1, callId(first));
+    }
+
+    public static void main(String[] args) {
+        testOverridingClassLoadedLater();
+        testImplementorLoadedLater();
+    }
+}
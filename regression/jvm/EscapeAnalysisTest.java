@@ -0,0 +1,115 @@
+package jvm;
+
+/**
+ * This tests that objects which do not escape the method that allocates
+ * them behave the same when their fields are kept in registers.
+ */
+public class EscapeAnalysisTest extends TestCase {
+    private static final class Point {
+        private int x;
+        private int y;
+
+        public Point(int x, int y) {
+            this.x = x;
+            this.y = y;
+        }
+
+        public int getX() {
+            return x;
+        }
+
+        public int getY() {
+            return y;
+        }
+    }
+
+    private static final class Narrow {
+        byte b;
+        char c;
+        short s;
+        boolean z;
+    }
+
+    private static final class Wide {
+        long l;
+        double d;
+        float f;
+        Object o;
+    }
+
+    private static Object escaped;
+
+    public static void testLocalObjectInLoop() {
+        int sum = 0;
+
+        for (int i = 0; i < 10; i++) {
+            Point p = new Point(i, i * 2);
+
+            sum += p.getX() + p.getY();
+        }
+
+        assertEquals(135, sum);
+    }
+
+    public static void testBoxing() {
+        assertEquals(42, new Integer(42).intValue());
+    }
+
+    public static void testDefaultValues() {
+        Wide w = new Wide();
+
+        assertEquals(0L, w.l);
+        assertEquals(0.0, w.d);
+        assertEquals(0.0f, w.f);
+        assertNull(w.o);
+    }
+
+    public static void testNarrowFields() {
+        int value = 0x1f2f3;
+        Narrow n = new Narrow();
+
+        n.b = (byte) value;
+        n.c = (char) value;
+        n.s = (short) value;
+        n.z = true;
+
+        assertEquals(-13, n.b);
+        assertEquals(0xf2f3, n.c);
+        assertEquals(-3341, n.s);
+        assertTrue(n.z);
+    }
+
+    public static void testWideFields() {
+        Wide w = new Wide();
+
+        w.l = 0x123456789abcdefL;
+        w.d = 1.5;
+        w.f = 2.5f;
+        w.o = "foo";
+
+        w.l += 1;
+
+        assertEquals(0x123456789abcdf0L, w.l);
+        assertEquals(1.5, w.d);
+        assertEquals(2.5f, w.f);
+        assertEquals("foo", w.o);
+    }
+
+    public static void testEscapingObject() {
+        Point p = new Point(1, 2);
+
+        escaped = p;
+
+        assertEquals(1, p.getX());
+        assertEquals(p, escaped);
+    }
+
+    public static void main(String[] args) {
+        testLocalObjectInLoop();
+        testBoxing();
+        testDefaultValues();
+        testNarrowFields();
+        testWideFields();
+        testEscapingObject();
+    }
+}
@@ -0,0 +1,89 @@
+package jvm;
+
+/*
+ * Mutates live object graphs while other threads allocate garbage so that
+ * references are overwritten while a concurrent mark is in progress. Run it
+ * with -Xgc -XX:+ConcurrentMark.
+ */
+public class GcConcurrentMarkTest extends TestCase {
+    static class Node {
+        Node left, right;
+        int value;
+
+        Node(int value) {
+            this.value = value;
+        }
+    }
+
+    static Node build(int depth, int value) {
+        Node node = new Node(value);
+
+        if (depth > 0) {
+            node.left = build(depth - 1, value * 2);
+            node.right = build(depth - 1, value * 2 + 1);
+        }
+        return node;
+    }
+
+    static long sum(Node node) {
+        if (node == null)
+            return 0;
+
+        return node.value + sum(node.left) + sum(node.right);
+    }
+
+    /* Swapping the children of every node keeps the sum of the tree. */
+    static void mirror(Node node) {
+        if (node == null)
+            return;
+
+        Node tmp = node.left;
+        node.left = node.right;
+        node.right = tmp;
+
+        mirror(node.left);
+        mirror(node.right);
+    }
+
+    public static void main(String[] args) throws Exception {
+        final Node[] trees = new Node[4];
+
+        for (int i = 0; i < trees.length; i++)
+            trees[i] = build(12, 1);
+
+        final long expected = sum(trees[0]);
+
+        Thread[] threads = new Thread[trees.length * 2];
+
+        for (int i = 0; i < trees.length; i++) {
+            final Node tree = trees[i];
+
+            threads[i] = new Thread(new Runnable() {
+                public void run() {
+                    for (int i = 0; i < 200; i++)
+                        mirror(tree);
+                }
+            });
+        }
+
+        for (int i = trees.length; i < threads.length; i++) {
+            threads[i] = new Thread(new Runnable() {
+                public void run() {
+                    Node[] slots = new Node[16];
+
+                    for (int i = 0; i < 400; i++)
+                        slots[i % slots.length] = build(8, i);
+                }
+            });
+        }
+
+        for (int i = 0; i < threads.length; i++)
+            threads[i].start();
+
+        for (int i = 0; i < threads.length; i++)
+            threads[i].join();
+
+        for (int i = 0; i < trees.length; i++)
+            assertEquals(expected, sum(trees[i]));
+    }
+}
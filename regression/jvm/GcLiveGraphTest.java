@@ -0,0 +1,67 @@
+package jvm;
+
+/*
+ * Keeps a large object graph alive while several threads allocate garbage
+ * so that every collection has a lot of marking to do. Run it with
+ * -Xgc -verbose:gc and different -XX:ParallelGCThreads= values to compare
+ * pause times.
+ */
+public class GcLiveGraphTest extends TestCase {
+    static class Node {
+        Node left, right;
+        int value;
+
+        Node(int value) {
+            this.value = value;
+        }
+    }
+
+    static Node build(int depth, int value) {
+        Node node = new Node(value);
+
+        if (depth > 0) {
+            node.left = build(depth - 1, value * 2);
+            node.right = build(depth - 1, value * 2 + 1);
+        }
+        return node;
+    }
+
+    static long sum(Node node) {
+        if (node == null)
+            return 0;
+
+        return node.value + sum(node.left) + sum(node.right);
+    }
+
+    public static void main(String[] args) throws Exception {
+        Node[] trees = new Node[8];
+
+        for (int i = 0; i < trees.length; i++)
+            trees[i] = build(14, 1);
+
+        long expected = sum(trees[0]);
+
+        Thread[] threads = new Thread[8];
+
+        for (int i = 0; i < threads.length; i++) {
+            threads[i] = new Thread(new Runnable() {
+                public void run() {
+                    for (int i = 0; i < 100; i++)
+                        build(8, i);
+                }
+            });
+        }
+
+        for (int i = 0; i < threads.length; i++)
+            threads[i].start();
+
+        for (int i = 0; i < 4; i++)
+            System.gc();
+
+        for (int i = 0; i < threads.length; i++)
+            threads[i].join();
+
+        for (int i = 0; i < trees.length; i++)
+            assertEquals(expected, sum(trees[i]));
+    }
+}
@@ -0,0 +1,27 @@
+package jvm;
+
+/**
+ * This tests that a program can allocate more than the maximum heap size
+ * in total without -Xgc. Run with -Xmx16m.
+ */
+public class HeapLimitTest extends TestCase {
+    private static final int CHUNK_SIZE = 1024 * 1024;
+
+    public static void testAllocateMoreThanMaxHeap() {
+        long total = 0;
+        byte[] chunk = null;
+
+        for (int i = 0; i < 64; i++) {
+            chunk = new byte[CHUNK_SIZE];
+            chunk[i] = (byte) i;
+            total += chunk.length;
+        }
+
+        assertEquals(64L * CHUNK_SIZE, total);
+        assertEquals(63, chunk[63]);
+    }
+
+    public static void main(String[] args) {
+        testAllocateMoreThanMaxHeap();
+    }
+}
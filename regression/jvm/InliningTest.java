@@ -0,0 +1,153 @@
+package jvm;
+
+/**
+ * This tests that small methods inlined into their callers behave like
+ * calls, including exceptions and stack traces.
+ */
+public class InliningTest extends TestCase {
+    private static final class Point {
+        private int x;
+        private long y;
+
+        public Point(int x, long y) {
+            this.x = x;
+            this.y = y;
+        }
+
+        public int getX() {
+            return x;
+        }
+
+        public final long getY() {
+            return y;
+        }
+
+        public void setX(int x) {
+            this.x = x;
+        }
+
+        private int sum() {
+            return getX() + (int) getY();
+        }
+    }
+
+    private static int square(int x) {
+        return x * x;
+    }
+
+    private static double scale(double value, long factor, int extra) {
+        return value * factor + extra;
+    }
+
+    private static int reuseLocal(int x) {
+        int y = x + 1;
+        x = y * 2;
+        x++;
+        return x;
+    }
+
+    private static int sumOfSquares(int a, int b) {
+        return square(a) + square(b);
+    }
+
+    private static StackTraceElement[] stackTrace() {
+        return new Exception().getStackTrace();
+    }
+
+    private static int getX(Point p) {
+        return p.getX();
+    }
+
+    public static void testGettersAndSetters() {
+        Point p = new Point(1, 2L);
+
+        assertEquals(1, p.getX());
+        assertEquals(2L, p.getY());
+
+        p.setX(3);
+        assertEquals(3, p.getX());
+        assertEquals(5, p.sum());
+    }
+
+    public static void testStaticHelpers() {
+        assertEquals(49, square(7));
+        assertEquals(25, sumOfSquares(3, 4));
+        assertEquals(7.0, scale(1.5, 4L, 1));
+        assertEquals(11, reuseLocal(2));
+    }
+
+    public static void testOperandStackBelowCall() {
+        int a = 2;
+
+        assertEquals(2 + 9, a + square(3));
+    }
+
+    public static void testNullReceiver() {
+        boolean caught = false;
+
+        try {
+            getX(null);
+        } catch (NullPointerException e) {
+            caught = true;
+        }
+
+        assertTrue(caught);
+    }
+
+    public static void testStackTrace() {
+        StackTraceElement []st = stackTrace();
+
+        assertNotNull(st);
+        assertEquals(3, st.length);
+
+        assertStackTraceElement(st[0], 54, "InliningTest.java",
+                "jvm.InliningTest",
+                "stackTrace",
+                false);
+
+        assertStackTraceElement(st[1], 98, "InliningTest.java",
+                "jvm.InliningTest",
+                "testStackTrace",
+                false);
+    }
+
+    private static class Polygon {
+        int sides() {
+            return 0;
+        }
+    }
+
+    private static class Triangle extends Polygon {
+        int sides() {
+            return 3;
+        }
+    }
+
+    private static int sides(Polygon p) {
+        return p.sides();
+    }
+
+    /*
+     * Polygon.sides() has no overrides when sides() is compiled, so class
+     * hierarchy analysis binds the call. Triangle is only loaded when the
+     * second test method is compiled.
+     */
+    public static void testCHABoundCallBeforeOverride() {
+        assertEquals(0, sides(new Polygon()));
+    }
+
+    public static void testCHABoundCallAfterOverride() {
+        assertEquals(3, sides(new Triangle()));
+        assertEquals(0, sides(new Polygon()));
+    }
+
+    public static void main(String[] args) {
+        testGettersAndSetters();
+        testStaticHelpers();
+        testOperandStackBelowCall();
+        testNullReceiver();
+        testStackTrace();
+        testCHABoundCallBeforeOverride();
+        testCHABoundCallAfterOverride();
+    }
+}
@@ -0,0 +1,226 @@
+package jvm;
+
+/**
+ * This tests that class initializers, which are executed by the bytecode
+ * interpreter, compute the same results as compiled code.
+ */
+public class InterpreterTest extends TestCase {
+    private static interface Shape {
+        int area();
+    }
+
+    private static class Rectangle implements Shape {
+        private final int width, height;
+
+        Rectangle(int width, int height) {
+            this.width = width;
+            this.height = height;
+        }
+
+        public int area() {
+            return width * height;
+        }
+    }
+
+    private static class Square extends Rectangle {
+        Square(int side) {
+            super(side, side);
+        }
+    }
+
+    private static class Initializer {
+        static int intResult;
+        static long longResult;
+        static float floatResult;
+        static double doubleResult;
+        static int[] squares;
+        static byte[] bytes;
+        static char[] chars;
+        static long[][] matrix;
+        static String string;
+        static String literal;
+        static Object[] objects;
+        static int lookupswitchResult;
+        static int tableswitchResult;
+        static int callResult;
+        static int shapeResult;
+        static int conversionResult;
+
+        private static int sum(int n) {
+            int result = 0;
+
+            for (int i = 0; i < n; i++)
+                result += i;
+
+            return result;
+        }
+
+        private static String describe(int n) {
+            switch (n) {
+            case 0:
+                return "zero";
+            case 1:
+                return "one";
+            case 1000:
+                return "thousand";
+            default:
+                return "many";
+            }
+        }
+
+        private static int digit(int n) {
+            switch (n) {
+            case 1:
+                return 10;
+            case 2:
+                return 20;
+            case 3:
+                return 30;
+            default:
+                return -1;
+            }
+        }
+
+        static {
+            int x = Integer.MAX_VALUE;
+
+            intResult = (x + 1) / 3 % 1000 - (-7 >> 1) + (-7 >>> 28) + (5 ^ 3) + (6 & 3) + (4 | 1);
+
+            long y = Long.MAX_VALUE;
+
+            longResult = (y + 1) / 7 % 100000L + (1L << 40) - (-1L >>> 60);
+
+            float a = 1.5f;
+            double b = 10.0;
+
+            floatResult = a * 4.0f - 0.5f;
+            doubleResult = b / 4.0 + (b - 2.5) % 2.0;
+
+            squares = new int[10];
+            for (int i = 0; i < squares.length; i++)
+                squares[i] = i * i;
+
+            bytes = new byte[] { (byte) 200, 1, -1 };
+            chars = new char[] { 'j', 'a', 't', 'o' };
+
+            matrix = new long[3][4];
+            matrix[2][3] = 42L;
+
+            StringBuilder builder = new StringBuilder();
+            for (int i = 0; i < 3; i++)
+                builder.append(i);
+            string = "abc" + builder.toString();
+            literal = "jato";
+
+            objects = new Object[] { string, null, squares };
+
+            lookupswitchResult = describe(0).length() + describe(1000).length() + describe(5).length();
+
+            tableswitchResult = 0;
+            for (int i = 0; i < 5; i++)
+                tableswitchResult += digit(i);
+
+            callResult = 0;
+            for (int i = 0; i < 100; i++)
+                callResult += sum(i);
+
+            Shape[] shapes = { new Rectangle(2, 3), new Square(4) };
+            shapeResult = 0;
+            for (int i = 0; i < shapes.length; i++) {
+                shapeResult += shapes[i].area();
+                if (shapes[i] instanceof Square)
+                    shapeResult += 1000;
+            }
+
+            double d = 3.99, nan = Double.NaN, huge = 1e20;
+            float f = -2.5f;
+            int i = 70000, m = -1;
+
+            conversionResult = (int) d + (int) f + (int) nan + (int) (long) huge
+                + (int) huge + (short) i + (char) m;
+        }
+    }
+
+    private static class FailingInitializer {
+        static int[] array = new int[2];
+        static int value = array[2];
+    }
+
+    private static class ThrowingInitializer {
+        static int value = explode();
+
+        private static int explode() {
+            throw new IllegalStateException();
+        }
+    }
+
+    public static void testArithmetic() {
+        assertEquals(-882 + 4 + 15 + 6 + 2 + 5, Initializer.intResult);
+        assertEquals(-39401L + (1L << 40) - 15L, Initializer.longResult);
+        assertEquals(5.5f, Initializer.floatResult);
+        assertEquals(4.0, Initializer.doubleResult);
+    }
+
+    public static void testArrays() {
+        assertEquals(81, Initializer.squares[9]);
+        assertEquals(-56, Initializer.bytes[0]);
+        assertEquals(-1, Initializer.bytes[2]);
+        assertEquals('o', Initializer.chars[3]);
+        assertEquals(3, Initializer.matrix.length);
+        assertEquals(42L, Initializer.matrix[2][3]);
+        assertEquals(0L, Initializer.matrix[0][0]);
+        assertNull(Initializer.objects[1]);
+    }
+
+    public static void testStrings() {
+        assertEquals("abc012", Initializer.string);
+        assertTrue(Initializer.objects[0] == Initializer.string);
+        assertTrue(Initializer.literal == "jato");
+    }
+
+    public static void testCalls() {
+        assertEquals(4 + 8 + 4, Initializer.lookupswitchResult);
+        assertEquals(-1 + 10 + 20 + 30 - 1, Initializer.tableswitchResult);
+        assertEquals(161700, Initializer.callResult);
+        assertEquals(6 + 16 + 1000, Initializer.shapeResult);
+    }
+
+    public static void testConversions() {
+        assertEquals(3 - 2 + 0 - 1 + Integer.MAX_VALUE + 4464 + 65535,
+                     Initializer.conversionResult);
+    }
+
+    public static void testExceptionInInitializer() {
+        try {
+            takeInt(FailingInitializer.value);
+            fail();
+        } catch (ExceptionInInitializerError e) {
+            assertTrue(e.getCause() instanceof ArrayIndexOutOfBoundsException);
+        }
+    }
+
+    public static void testStackTraceOfExceptionInInitializer() {
+        try {
+            takeInt(ThrowingInitializer.value);
+            fail();
+        } catch (ExceptionInInitializerError e) {
+            StackTraceElement[] trace = e.getCause().getStackTrace();
+
+            assertEquals("explode", trace[0].getMethodName());
+            assertEquals(153, trace[0].getLineNumber());
+            assertEquals("<clinit>", trace[1].getMethodName());
+            assertEquals(150, trace[1].getLineNumber());
+            assertEquals("testStackTraceOfExceptionInInitializer", trace[2].getMethodName());
+        }
+    }
+
+    public static void main(String[] args) {
+        testArithmetic();
+        testArrays();
+        testStrings();
+        testCalls();
+        testConversions();
+        testExceptionInInitializer();
+        testStackTraceOfExceptionInInitializer();
+    }
+}
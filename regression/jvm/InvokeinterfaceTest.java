@@ -2,10 +2,9 @@ package jvm;
 
 /**
  * The purpose of this test is to see whether our itable approach is working
- * like it should. With this many methods, we are certain to exhaust the
- * itable capacity and generate conflict resolution stubs. We check that the
- * right methods have been called by setting a flag in only four methods out
- * of all, and we check that these four flags have been set.
+ * like it should. We check that the right methods have been called by
+ * setting a flag in only four methods out of all, and we check that these
+ * four flags have been set.
  */
 public class InvokeinterfaceTest extends TestCase {
     private interface A {
@@ -195,8 +194,84 @@ public class InvokeinterfaceTest extends TestCase {
         public void seq();
     }
 
+    private static void testPolymorphicInvokeinterfaceCallSite() {
+        Shape[] shapes = {
+            new Triangle(), new Square(), new Pentagon(), new Hexagon(),
+            new Rectangle(), new Octagon(),
+        };
+        int[] sides = { 3, 4, 5, 6, 4, 8 };
+
+        /* One call site that goes monomorphic, polymorphic and megamorphic. */
+        for (int round = 0; round < 3; round++) {
+            for (int i = 0; i < shapes.length; i++)
+                assertEquals(sides[i], shapes[i].sides());
+        }
+    }
+
+    private static interface Shape {
+        public int sides();
+    }
+
+    private static class Triangle implements Shape {
+        public int sides() { return 3; }
+    }
+
+    private static class Square implements Shape {
+        public int sides() { return 4; }
+    }
+
+    /* Inherits the implementation from its superclass. */
+    private static class Rectangle extends Square {
+    }
+
+    private static class Pentagon implements Shape {
+        public int sides() { return 5; }
+    }
+
+    private static class Hexagon implements Shape {
+        public int sides() { return 6; }
+    }
+
+    private static class Octagon implements Shape {
+        public int sides() { return 8; }
+    }
+
+    private static void testInterfaceImplementedBySubclassOfAbstractClass() {
+        Counter counter = new ConcreteCounter();
+
+        assertEquals(1, counter.next());
+        assertEquals(2, counter.next());
+        assertEquals(42, counter.base());
+    }
+
+    private static interface Counter {
+        public int next();
+        public int base();
+    }
+
+    /* Leaves next() to subclasses. */
+    private static abstract class AbstractCounter implements Counter {
+        public int base() { return 42; }
+    }
+
+    private static class ConcreteCounter extends AbstractCounter {
+        private int value;
+
+        public int next() { return ++value; }
+    }
+
+    private static void testInterfaceInheritedFromSuperclass() {
+        Shape shape = new Rectangle();
+
+        assertEquals(4, shape.sides());
+        assertTrue(shape instanceof Square);
+    }
+
     public static void main(String[] args) {
         testInvokeinterface();
         testInvokeinterfaceItableHashCollision();
+        testPolymorphicInvokeinterfaceCallSite();
+        testInterfaceImplementedBySubclassOfAbstractClass();
+        testInterfaceInheritedFromSuperclass();
     }
 }
@@ -0,0 +1,99 @@
+package jvm;
+
+/**
+ * This tests that removing and merging monitor operations keeps the
+ * semantics of synchronized blocks and inlined synchronized methods.
+ */
+public class LockElisionTest extends TestCase {
+    private static final class Counter {
+        private int value;
+
+        public synchronized int get() {
+            return value;
+        }
+
+        public synchronized void set(int value) {
+            this.value = value;
+        }
+    }
+
+    private static boolean isLocked(Object o) {
+        try {
+            o.notify();
+        } catch (IllegalMonitorStateException e) {
+            return false;
+        }
+        return true;
+    }
+
+    public static void testThreadLocalObject() {
+        int sum = 0;
+
+        for (int i = 0; i < 10; i++) {
+            Object lock = new Object();
+
+            synchronized (lock) {
+                sum += i;
+            }
+        }
+
+        assertEquals(45, sum);
+    }
+
+    public static void testThreadLocalCounter() {
+        Counter c = new Counter();
+
+        c.set(1);
+        c.set(c.get() + 1);
+
+        assertEquals(2, c.get());
+    }
+
+    public static void testAdjacentBlocks(Object o) {
+        int x = 0;
+
+        synchronized (o) {
+            x++;
+        }
+        synchronized (o) {
+            x++;
+        }
+
+        assertEquals(2, x);
+        assertFalse(isLocked(o));
+    }
+
+    public static void testAdjacentBlocksWithException(Object o) {
+        boolean caught = false;
+
+        try {
+            synchronized (o) {
+                takeInt(1);
+            }
+            synchronized (o) {
+                throw new RuntimeException();
+            }
+        } catch (RuntimeException e) {
+            caught = true;
+        }
+
+        assertTrue(caught);
+        assertFalse(isLocked(o));
+    }
+
+    public static void testInlinedSynchronizedMethods(Counter c) {
+        c.set(3);
+        c.set(c.get() * 2);
+
+        assertEquals(6, c.get());
+        assertFalse(isLocked(c));
+    }
+
+    public static void main(String[] args) {
+        testThreadLocalObject();
+        testThreadLocalCounter();
+        testAdjacentBlocks(new Object());
+        testAdjacentBlocksWithException(new Object());
+        testInlinedSynchronizedMethods(new Counter());
+    }
+}
@@ -86,6 +86,58 @@ public class MethodInvocationAndReturnTest extends TestCase {
         public int value() { return 0; }
     }
 
+    public static void testInheritedMethodCompiledThroughSubClassVtable() {
+        Base leaf = new NonOverridingLeaf();
+        Base overridingLeaf = new LeafOfOverridingMiddle();
+
+        /* Compiles Base.value() through the vtable of a subclass. */
+        assertEquals(0, leaf.value());
+        assertEquals(0, leaf.value());
+
+        assertEquals(0, new Middle().value());
+        assertEquals(2, overridingLeaf.value());
+        assertEquals(2, new OverridingMiddle().value());
+    }
+
+    public static class Base {
+        public int value() { return 0; }
+    }
+
+    public static class Middle extends Base {
+    }
+
+    public static class NonOverridingLeaf extends Middle {
+    }
+
+    public static class OverridingMiddle extends Middle {
+        public int value() { return 2; }
+    }
+
+    public static class LeafOfOverridingMiddle extends OverridingMiddle {
+    }
+
+    public static void testPolymorphicCallSite() {
+        Base[] receivers = {
+            new Base(), new OverridingMiddle(), new Sibling(),
+            new SiblingLeaf(), new LeafOfOverridingMiddle(), new Middle(),
+        };
+        int[] expected = { 0, 2, 5, 7, 2, 0 };
+
+        /* One call site that goes monomorphic, polymorphic and megamorphic. */
+        for (int round = 0; round < 3; round++) {
+            for (int i = 0; i < receivers.length; i++)
+                assertEquals(expected[i], receivers[i].value());
+        }
+    }
+
+    public static class Sibling extends Base {
+        public int value() { return 5; }
+    }
+
+    public static class SiblingLeaf extends Sibling {
+        public int value() { return 7; }
+    }
+
     public static void testRecursiveInvocation() {
         assertEquals(3, recursive(2));
     }
@@ -128,6 +180,8 @@ public class MethodInvocationAndReturnTest extends TestCase {
     public static void main(String[] args) {
         testReturnFromInvokeVirtualReinstatesTheFrameOfTheInvoker();
         testInvokeVirtualInvokesSuperClassMethodIfMethodIsNotOverridden();
+        testInheritedMethodCompiledThroughSubClassVtable();
+        testPolymorphicCallSite();
         testRecursiveInvocation();
         testInvokestaticLongReturnValue();
         testInvokevirtualLongReturnValue();
@@ -0,0 +1,28 @@
+package jvm;
+
+/*
+ * Stops the world while another thread spins in a loop which makes no
+ * calls. The loop polls for safepoints on its back-edge so the collection
+ * does not have to wait for it to finish.
+ */
+public class SafepointLoopTest extends TestCase {
+    static volatile boolean stop;
+    static int counter;
+
+    public static void main(String[] args) throws Exception {
+        Thread spinner = new Thread(new Runnable() {
+            public void run() {
+                while (!stop)
+                    counter++;
+            }
+        });
+
+        spinner.start();
+
+        for (int i = 0; i < 10; i++)
+            System.gc();
+
+        stop = true;
+        spinner.join();
+    }
+}
@@ -87,12 +87,149 @@ public class SynchronizationTest extends TestCase {
         assertEquals(3, staticSynchronizedMethod(3));
     }
 
+    private static int recursiveLock(Object obj, int depth) {
+        synchronized (obj) {
+            if (depth == 0)
+                return 0;
+
+            return recursiveLock(obj, depth - 1) + 1;
+        }
+    }
+
+    public static void testDeepRecursiveLocking() {
+        Object obj = new Object();
+
+        assertEquals(16, recursiveLock(obj, 16));
+
+        synchronized (obj) {
+            obj.notify();
+        }
+    }
+
+    public static void testTimedWaitOnUncontendedLock() throws InterruptedException {
+        Object obj = new Object();
+
+        synchronized (obj) {
+            synchronized (obj) {
+                obj.wait(1);
+            }
+            obj.notifyAll();
+        }
+    }
+
+    private static int counter;
+
+    public static void testContendedLocking() throws InterruptedException {
+        final Object lock = new Object();
+        Thread[] threads = new Thread[4];
+
+        counter = 0;
+
+        for (int i = 0; i < threads.length; i++) {
+            threads[i] = new Thread() {
+                public void run() {
+                    for (int j = 0; j < 10000; j++) {
+                        synchronized (lock) {
+                            counter++;
+                        }
+                    }
+                }
+            };
+            threads[i].start();
+        }
+
+        for (int i = 0; i < threads.length; i++)
+            threads[i].join();
+
+        assertEquals(threads.length * 10000, counter);
+    }
+
+    private static int items;
+    private static int consumed;
+
+    public static void testProducerConsumer() throws InterruptedException {
+        final Object queue = new Object();
+        Thread[] consumers = new Thread[4];
+
+        items = 0;
+        consumed = 0;
+
+        for (int i = 0; i < consumers.length; i++) {
+            consumers[i] = new Thread() {
+                public void run() {
+                    for (int j = 0; j < 1000; j++) {
+                        synchronized (queue) {
+                            while (items == 0) {
+                                try {
+                                    queue.wait();
+                                } catch (InterruptedException e) {
+                                    return;
+                                }
+                            }
+                            items--;
+                            consumed++;
+                        }
+                    }
+                }
+            };
+            consumers[i].start();
+        }
+
+        for (int i = 0; i < consumers.length * 1000; i++) {
+            synchronized (queue) {
+                items++;
+                if (i % 2 == 0)
+                    queue.notify();
+                else
+                    queue.notifyAll();
+            }
+        }
+
+        for (int i = 0; i < consumers.length; i++)
+            consumers[i].join();
+
+        assertEquals(consumers.length * 1000, consumed);
+        assertEquals(0, items);
+    }
+
+    private static boolean interrupted;
+
+    public static void testInterruptWakesWaiter() throws InterruptedException {
+        final Object lock = new Object();
+
+        interrupted = false;
+
+        Thread waiter = new Thread() {
+            public void run() {
+                synchronized (lock) {
+                    try {
+                        lock.wait();
+                    } catch (InterruptedException e) {
+                        interrupted = true;
+                    }
+                }
+            }
+        };
+        waiter.start();
+
+        /* Interrupting before wait() is entered must throw as well. */
+        Thread.sleep(10);
+        waiter.interrupt();
+        waiter.join();
+
+        assertTrue(interrupted);
+    }
 
-    public static void main(String[] args) {
+    public static void main(String[] args) throws InterruptedException {
         testMonitorEnterAndExit();
         testStaticSynchronizedMethod();
         testSynchronizedMethod();
         testStaticSynchronizedExceptingMethod();
         testSynchronizedExceptingMethod();
+        testDeepRecursiveLocking();
+        testTimedWaitOnUncontendedLock();
+        testContendedLocking();
+        testProducerConsumer();
+        testInterruptWakesWaiter();
     }
 }
@@ -0,0 +1,95 @@
+package jvm;
+
+/**
+ * This tests that methods keep working when they are recompiled while
+ * other code is calling them. Run with -XX:CICompilerCount=1
+ * -XX:+TieredCompilation -XX:CompileThreshold=10.
+ */
+public class TieredCompilationTest extends TestCase {
+    private static final int ROUNDS = 20;
+
+    private static interface Shape {
+        int area();
+    }
+
+    private static class Square implements Shape {
+        protected final int side;
+
+        Square(int side) {
+            this.side = side;
+        }
+
+        public int area() {
+            return side * side;
+        }
+    }
+
+    private static class Cube extends Square {
+        Cube(int side) {
+            super(side);
+        }
+
+        public int area() {
+            return 6 * super.area();
+        }
+    }
+
+    private static int fib(int n) {
+        return n < 2 ? n : fib(n - 1) + fib(n - 2);
+    }
+
+    private static int sum(int n) {
+        int result = 0;
+
+        for (int i = 0; i < n; i++)
+            result += i;
+
+        return result;
+    }
+
+    private static void pause() {
+        try {
+            Thread.sleep(20);
+        } catch (InterruptedException e) {
+        }
+    }
+
+    public static void testStaticCalls() {
+        for (int round = 0; round < ROUNDS; round++) {
+            for (int i = 0; i < 10; i++)
+                assertEquals(55, fib(10));
+
+            pause();
+        }
+    }
+
+    public static void testLoops() {
+        for (int round = 0; round < ROUNDS; round++) {
+            assertEquals(499500, sum(1000));
+
+            pause();
+        }
+    }
+
+    public static void testVirtualCalls() {
+        Square square = new Square(2);
+        Square cube = new Cube(2);
+        Shape shape = new Cube(3);
+
+        for (int round = 0; round < ROUNDS; round++) {
+            for (int i = 0; i < 10; i++) {
+                assertEquals(4, square.area());
+                assertEquals(24, cube.area());
+                assertEquals(54, shape.area());
+            }
+
+            pause();
+        }
+    }
+
+    public static void main(String[] args) {
+        testStaticCalls();
+        testLoops();
+        testVirtualCalls();
+    }
+}
@@ -47,6 +47,7 @@ done
 if [ -z "$CLASS_LIST" ]; then
     # First test for VM features that are needed to bootstrap more complex tests.
     run_java jvm.EntryTest 0
+    run_java jvm.EscapeAnalysisTest 0
     run_java jvm.ExitStatusIsOneTest 1
     run_java jvm.ExitStatusIsZeroTest 0
     run_java jvm.ArgsTest 0
@@ -58,9 +59,11 @@ if [ -z "$CLASS_LIST" ]; then
     run_java jvm.ArrayExceptionsTest 0
     run_java jvm.ArrayMemberTest 0
     run_java jvm.ArrayTest 0
+    JAVA_OPTS="$JAVA_OPTS -Xgc -XX:CICompilerCount=2" run_java jvm.BackgroundCompilationTest 0
     run_java jvm.BranchTest 0
     run_java jvm.CFGCrashTest 0
     run_java jvm.ClassExceptionsTest 0
+    run_java jvm.ClassHierarchyAnalysisTest 0
     run_java jvm.ClassLoaderTest 0
     run_java jvm.CloneTest 0
     run_java jvm.ControlTransferTest 0
@@ -73,17 +76,23 @@ if [ -z "$CLASS_LIST" ]; then
     run_java jvm.FinallyTest 0
     run_java jvm.FloatArithmeticTest 0
     run_java jvm.FloatConversionTest 0
+    JAVA_OPTS="$JAVA_OPTS -Xgc -XX:+ConcurrentMark" run_java jvm.GcConcurrentMarkTest 0
+    run_java jvm.GcLiveGraphTest 0
     run_java jvm.GcTortureTest 0
     run_java jvm.GetstaticPatchingTest 0
+    JAVA_OPTS="$JAVA_OPTS -Xmx16m" run_java jvm.HeapLimitTest 0
+    run_java jvm.InliningTest 0
     run_java jvm.IntegerArithmeticExceptionsTest 0
     run_java jvm.IntegerArithmeticTest 0
     run_java jvm.InterfaceFieldInheritanceTest 0
     run_java jvm.InterfaceInheritanceTest 0
+    run_java jvm.InterpreterTest 0
     run_java jvm.InvokeResultTest 0
     run_java jvm.InvokeTest 0
     run_java jvm.InvokeinterfaceTest 0
     run_java jvm.InvokestaticPatchingTest 0
     run_java jvm.LoadConstantsTest 0
+    run_java jvm.LockElisionTest 0
     run_java jvm.LongArithmeticExceptionsTest 0
     run_java jvm.LongArithmeticTest 0
     run_java jvm.MethodInvocationAndReturnTest 0
@@ -100,12 +109,14 @@ if [ -z "$CLASS_LIST" ]; then
     run_java jvm.PutstaticPatchingTest 0
     run_java jvm.PutstaticTest 0
     run_java jvm.RegisterAllocatorTortureTest 0
+    JAVA_OPTS="$JAVA_OPTS -Xgc" run_java jvm.SafepointLoopTest 0
     run_java jvm.StackTraceTest 0
     run_java jvm.StringTest 0
     run_java jvm.SubroutineTest 0
     run_java jvm.SwitchTest 0
     run_java jvm.SynchronizationExceptionsTest 0
     run_java jvm.SynchronizationTest 0
+    JAVA_OPTS="$JAVA_OPTS -XX:CICompilerCount=1 -XX:+TieredCompilation -XX:CompileThreshold=10" run_java jvm.TieredCompilationTest 0
     run_java jvm.TrampolineBackpatchingTest 0
     run_java jvm.VirtualAbstractInterfaceMethodTest 0
     run_java jvm.WideTest 0
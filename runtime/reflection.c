@@ -36,6 +36,7 @@
 #include "vm/types.h"
 #include "vm/call.h"
 #include "vm/die.h"
+#include "vm/gc.h"
 
 static int marshall_call_arguments(struct vm_method *vmm, unsigned long *args,
 				   struct vm_object *args_array);
@@ -706,7 +707,13 @@ void native_field_set(struct vm_object *this, struct vm_object *o,
 			return;
 		}
 
+		if (type == J_REFERENCE)
+			gc_satb_barrier(*(struct vm_object **) &o->fields[vmf->offset]);
+
 		unwrap(&o->fields[vmf->offset], type, value_obj);
+
+		if (type == J_REFERENCE)
+			gc_write_barrier(o);
 	}
 }
 
@@ -28,12 +28,23 @@
 #include "jit/exception.h"
 #include "vm/preload.h"
 #include "vm/object.h"
+#include "vm/heap.h"
+#include "vm/gc.h"
 
 #include <stdlib.h>
 #include <stdio.h>
 
 void native_vmruntime_exit(int status)
 {
+	if (verbose_gc)
+		gc_print_stats();
+
+	if (opt_trace_biased_locking)
+		vm_monitor_print_stats();
+
+	if (opt_trace_monitors)
+		vm_monitor_print_profile();
+
 	/* XXX: exit gracefully */
 	exit(status);
 }
@@ -42,6 +53,26 @@ void native_vmruntime_run_finalization_for_exit(void)
 {
 }
 
+void native_vmruntime_gc(void)
+{
+	gc_collect();
+}
+
+jlong native_vmruntime_free_memory(void)
+{
+	return heap_capacity() - heap_used();
+}
+
+jlong native_vmruntime_total_memory(void)
+{
+	return heap_capacity();
+}
+
+jlong native_vmruntime_max_memory(void)
+{
+	return heap_max_size;
+}
+
 struct vm_object *native_vmruntime_maplibraryname(struct vm_object *name)
 {
 	struct vm_object *result;
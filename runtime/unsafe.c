@@ -31,6 +31,7 @@
 #include "vm/reflection.h"
 #include "vm/preload.h"
 #include "vm/object.h"
+#include "vm/gc.h"
 #include "vm/jni.h"
 
 jint native_unsafe_compare_and_swap_int(struct vm_object *this,
@@ -59,7 +60,15 @@ jint native_unsafe_compare_and_swap_object(struct vm_object *this,
 {
 	void *p = &obj->fields[offset];
 
-	return atomic_cmpxchg_ptr(p, expect, update) == expect;
+	/* Logging the expected value is harmless if the swap fails. */
+	gc_satb_barrier(expect);
+
+	if (atomic_cmpxchg_ptr(p, expect, update) != expect)
+		return false;
+
+	gc_write_barrier(obj);
+
+	return true;
 }
 
 jlong native_unsafe_object_field_offset(struct vm_object *this,
@@ -1,6 +1,7 @@
 #include <stdint.h>
 #include <errno.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "vm/class.h"
 #include "vm/field.h"
@@ -69,3 +70,18 @@ struct vm_method *vm_class_get_method(const struct vm_class *vmc,
 {
 	return NULL;
 }
+
+struct vm_method *vm_class_get_method_recursive(const struct vm_class *vmc,
+	const char *name, const char *type)
+{
+	for (; vmc; vmc = vmc->super) {
+		for (unsigned int i = 0; i < vmc->nr_methods; ++i) {
+			struct vm_method *vmm = &vmc->methods[i];
+
+			if (!strcmp(vmm->name, name) && !strcmp(vmm->type, type))
+				return vmm;
+		}
+	}
+
+	return NULL;
+}
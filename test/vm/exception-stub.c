@@ -0,0 +1,5 @@
+#include "jit/exception.h"
+
+void signal_new_exception(struct vm_class *vmc, const char *msg)
+{
+}
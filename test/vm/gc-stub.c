@@ -1,13 +1,32 @@
 #include "vm/stdlib.h"
+#include "vm/heap.h"
 #include "vm/gc.h"
 
 void *gc_safepoint_page;
 
+__thread struct heap_tlab current_tlab;
+
+unsigned char *heap_card_base;
+unsigned long heap_alloc_bits;
+
+bool gc_concurrent_mark;
+volatile bool gc_marking;
+struct vm_object **gc_satb_log;
+uint32_t gc_satb_log_top;
+
 void *gc_alloc(size_t size)
 {
 	return zalloc(size);
 }
 
+void heap_lock(void)
+{
+}
+
+void heap_unlock(void)
+{
+}
+
 void gc_attach_thread(void)
 {
 }
@@ -15,3 +34,20 @@ void gc_attach_thread(void)
 void gc_detach_thread(void)
 {
 }
+
+void gc_safepoint_operation(void (*fn)(void *), void *arg)
+{
+	fn(arg);
+}
+
+void gc_register_root(struct vm_object **root)
+{
+}
+
+void gc_write_barrier(struct vm_object *obj)
+{
+}
+
+void gc_satb_log_object(struct vm_object *obj)
+{
+}
@@ -0,0 +1,255 @@
+#include <libharness.h>
+
+#include "vm/heap.h"
+
+#include <string.h>
+
+#define TEST_HEAP_SIZE	(1024 * 1024)
+
+static void init_test_heap(unsigned long min_size)
+{
+	heap_min_size = min_size;
+	heap_max_size = TEST_HEAP_SIZE;
+
+	assert_int_equals(0, heap_init());
+}
+
+void test_heap_alloc_returns_zeroed_memory(void)
+{
+	unsigned char zero[64];
+	void *p;
+
+	init_test_heap(TEST_HEAP_SIZE);
+
+	memset(zero, 0, sizeof(zero));
+
+	p = heap_alloc(sizeof(zero));
+	assert_not_null(p);
+	assert_mem_equals(zero, p, sizeof(zero));
+}
+
+void test_heap_alloc_is_limited_by_capacity(void)
+{
+	init_test_heap(4096);
+
+	while (heap_alloc(100))
+		;
+
+	assert_true(heap_used() <= heap_capacity());
+	assert_true(heap_expand(100));
+	assert_not_null(heap_alloc(100));
+}
+
+void test_heap_lookup_finds_allocated_objects(void)
+{
+	void *a, *b;
+
+	init_test_heap(TEST_HEAP_SIZE);
+
+	a = heap_alloc(32);
+	b = heap_alloc(32);
+
+	heap_prepare_collection();
+
+	assert_ptr_equals(a, heap_lookup_object(a));
+	assert_ptr_equals(b, heap_lookup_object(b));
+	assert_ptr_equals(NULL, heap_lookup_object(a + 8));
+
+	assert_ptr_equals(a, heap_lookup_interior(a + 8));
+	assert_ptr_equals(b, heap_lookup_interior(b + 31));
+}
+
+void test_heap_sweep_reclaims_unmarked_objects(void)
+{
+	unsigned long used;
+	void *a, *b, *c;
+
+	init_test_heap(TEST_HEAP_SIZE);
+
+	a = heap_alloc(32);
+	b = heap_alloc(32);
+	c = heap_alloc(32);
+	used = heap_used();
+
+	heap_prepare_collection();
+	assert_true(heap_mark_object(a));
+	assert_false(heap_mark_object(a));
+	assert_true(heap_mark_object(c));
+
+	assert_int_equals(used / 3, heap_sweep());
+	assert_int_equals(used / 3 * 2, heap_used());
+
+	assert_ptr_equals(b, heap_alloc(32));
+}
+
+void test_heap_sweep_returns_free_tail_to_wilderness(void)
+{
+	void *a, *b;
+
+	init_test_heap(TEST_HEAP_SIZE);
+
+	a = heap_alloc(32);
+	b = heap_alloc(32);
+	heap_alloc(32);
+
+	heap_prepare_collection();
+	heap_mark_object(a);
+	heap_sweep();
+
+	assert_ptr_equals(b, heap_alloc(64));
+}
+
+void test_heap_tlab_alloc_bumps_allocation_buffer(void)
+{
+	struct heap_tlab tlab = { NULL, NULL };
+	void *a, *b;
+
+	init_test_heap(TEST_HEAP_SIZE);
+
+	a = heap_tlab_alloc(&tlab, 32);
+	b = heap_tlab_alloc(&tlab, 32);
+
+	assert_not_null(a);
+	assert_ptr_equals(a + heap_alloc_size(32), b);
+	assert_ptr_equals(b + heap_alloc_size(32) - sizeof(struct heap_header), tlab.top);
+	assert_int_equals(HEAP_TLAB_SIZE, heap_used());
+}
+
+void test_heap_tlab_bump_only_allocates_from_buffer(void)
+{
+	struct heap_tlab tlab = { NULL, NULL };
+	void *a, *b;
+
+	init_test_heap(TEST_HEAP_SIZE);
+
+	assert_ptr_equals(NULL, heap_tlab_bump(&tlab, 32));
+	assert_int_equals(0, heap_used());
+
+	a = heap_tlab_alloc(&tlab, 32);
+	b = heap_tlab_bump(&tlab, 32);
+
+	assert_ptr_equals(a + heap_alloc_size(32), b);
+	assert_ptr_equals(NULL, heap_tlab_bump(&tlab, HEAP_TLAB_SIZE));
+	assert_int_equals(HEAP_TLAB_SIZE, heap_used());
+}
+
+void test_heap_retire_tlab_frees_unused_space(void)
+{
+	struct heap_tlab tlab = { NULL, NULL };
+	void *a, *b;
+
+	init_test_heap(TEST_HEAP_SIZE);
+
+	a = heap_tlab_alloc(&tlab, 32);
+	b = heap_tlab_alloc(&tlab, 32);
+
+	heap_lock();
+	heap_retire_tlab(&tlab);
+	heap_unlock();
+
+	assert_ptr_equals(NULL, tlab.top);
+	assert_int_equals(2 * heap_alloc_size(32), heap_used());
+
+	heap_prepare_collection();
+	heap_mark_object(b);
+
+	assert_int_equals(heap_alloc_size(32), heap_sweep());
+	assert_ptr_equals(a, heap_alloc(32));
+}
+
+void test_heap_sweep_young_promotes_survivors(void)
+{
+	void *a, *b;
+
+	init_test_heap(TEST_HEAP_SIZE);
+
+	a = heap_alloc(32);
+	b = heap_alloc(32);
+	assert_int_equals(2 * heap_alloc_size(32), heap_young());
+
+	heap_prepare_minor_collection();
+	assert_true(heap_mark_object(a));
+
+	assert_int_equals(heap_alloc_size(32), heap_sweep_young());
+	assert_int_equals(0, heap_young());
+
+	heap_prepare_minor_collection();
+	assert_false(heap_mark_object(a));
+	assert_ptr_equals(b, heap_alloc(32));
+}
+
+void test_heap_object_is_live_follows_collection_kind(void)
+{
+	void *a, *b;
+
+	init_test_heap(TEST_HEAP_SIZE);
+
+	a = heap_alloc(32);
+	b = heap_alloc(32);
+
+	heap_prepare_collection();
+	heap_mark_object(a);
+	assert_true(heap_object_is_live(a));
+	assert_false(heap_object_is_live(b));
+	heap_sweep();
+
+	heap_prepare_minor_collection();
+	assert_true(heap_object_is_live(a));
+}
+
+void test_heap_concurrent_collection_keeps_new_objects(void)
+{
+	void *a, *b, *c;
+
+	init_test_heap(TEST_HEAP_SIZE);
+
+	a = heap_alloc(32);
+	b = heap_alloc(32);
+
+	heap_prepare_concurrent_collection();
+	assert_true(heap_mark_object(a));
+
+	c = heap_alloc(32);
+	assert_false(heap_mark_object(c));
+
+	assert_int_equals(heap_alloc_size(32), heap_sweep());
+	assert_ptr_equals(b, heap_alloc(32));
+
+	heap_prepare_collection();
+	assert_true(heap_mark_object(heap_alloc(32)));
+}
+
+static struct vm_object *scanned[2];
+static unsigned int nr_scanned;
+
+static void record_scanned(struct vm_object *obj)
+{
+	scanned[nr_scanned++] = obj;
+}
+
+void test_heap_scan_dirty_cards_visits_old_objects(void)
+{
+	void *a, *b;
+
+	init_test_heap(TEST_HEAP_SIZE);
+
+	a = heap_alloc(32);
+	heap_prepare_collection();
+	heap_mark_object(a);
+	heap_sweep();
+
+	b = heap_alloc(32);
+	heap_mark_card(a);
+	heap_mark_card(b);
+
+	nr_scanned = 0;
+	heap_prepare_minor_collection();
+	heap_scan_dirty_cards(record_scanned);
+
+	assert_int_equals(1, nr_scanned);
+	assert_ptr_equals(a, scanned[0]);
+
+	nr_scanned = 0;
+	heap_scan_dirty_cards(record_scanned);
+	assert_int_equals(0, nr_scanned);
+}
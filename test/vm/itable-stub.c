@@ -0,0 +1,24 @@
+#include <stdlib.h>
+
+#include "arch/itable.h"
+
+#include "jit/emit-code.h"
+#include "jit/vtable.h"
+
+void vtable_lock(void)
+{
+}
+
+void vtable_unlock(void)
+{
+}
+
+void *emit_itable_stub(struct vm_method *i_method)
+{
+	return NULL;
+}
+
+void itable_resolver_stub_error(struct vm_method *method, struct vm_object *obj)
+{
+	abort();
+}
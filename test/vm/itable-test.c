@@ -0,0 +1,131 @@
+#include <libharness.h>
+
+#include <string.h>
+
+#include "cafebabe/class.h"
+#include "cafebabe/method_info.h"
+
+#include "vm/class.h"
+#include "vm/itable.h"
+#include "vm/method.h"
+
+#define NR_INTERFACES		4096
+
+static const struct cafebabe_method_info abstract_method_info = {
+	.access_flags	= CAFEBABE_METHOD_ACC_ABSTRACT,
+};
+
+static const struct cafebabe_method_info concrete_method_info;
+
+static struct vm_class interfaces[NR_INTERFACES];
+static struct vm_method interface_methods[NR_INTERFACES];
+
+static void *native_ptrs[] = { (void *) 0xcafebabe };
+
+static void init_method(struct vm_method *vmm, struct vm_class *vmc,
+			const struct cafebabe_method_info *info)
+{
+	memset(vmm, 0, sizeof *vmm);
+	vmm->class = vmc;
+	vmm->method = info;
+	vmm->name = "run";
+	vmm->type = "()V";
+}
+
+/*
+ * Links NR_INTERFACES interfaces with one method each, as a large
+ * application would, so that the interface IDs of the last ones are high.
+ */
+static void load_interfaces(void)
+{
+	static bool loaded;
+
+	if (loaded)
+		return;
+
+	for (unsigned int i = 0; i < NR_INTERFACES; i++) {
+		struct vm_class *vmi = &interfaces[i];
+
+		memset(vmi, 0, sizeof *vmi);
+		vmi->access_flags = CAFEBABE_CLASS_ACC_INTERFACE;
+		vmi->nr_methods = 1;
+		vmi->methods = &interface_methods[i];
+
+		init_method(&interface_methods[i], vmi, &abstract_method_info);
+		vm_itable_setup_interface(vmi);
+	}
+
+	loaded = true;
+}
+
+static void init_class(struct vm_class *vmc, struct vm_class *super,
+		       struct vm_class **implements, unsigned int nr_implements,
+		       struct vm_method *method)
+{
+	memset(vmc, 0, sizeof *vmc);
+	vmc->super = super;
+	vmc->nr_interfaces = nr_implements;
+	vmc->interfaces = implements;
+	vmc->vtable.native_ptr = native_ptrs;
+
+	if (method) {
+		init_method(method, vmc, &concrete_method_info);
+		vmc->nr_methods = 1;
+		vmc->methods = method;
+	}
+}
+
+void test_itable_only_holds_implemented_interfaces(void)
+{
+	struct vm_class *implements[] = { &interfaces[NR_INTERFACES - 1] };
+	struct vm_class vmc, subclass;
+	struct vm_method run;
+
+	load_interfaces();
+
+	init_class(&vmc, NULL, implements, ARRAY_SIZE(implements), &run);
+	init_class(&subclass, &vmc, NULL, 0, NULL);
+
+	assert_int_equals(0, vm_itable_setup(&vmc));
+	assert_int_equals(0, vm_itable_setup(&subclass));
+
+	/* One entry and the terminator, however high the interface ID is. */
+	assert_int_equals(1, vmc.itable.nr_interfaces);
+	assert_int_equals(1, subclass.itable.nr_interfaces);
+	assert_true(vmc.itable.table[1].interface_id == ITABLE_END);
+	assert_true(subclass.itable.table[1].interface_id == ITABLE_END);
+
+	assert_ptr_equals(native_ptrs[0],
+		vm_itable_lookup(&subclass, &interface_methods[NR_INTERFACES - 1]));
+	assert_ptr_equals(NULL,
+		vm_itable_lookup(&subclass, &interface_methods[0]));
+}
+
+void test_itable_is_sorted_by_interface_id(void)
+{
+	struct vm_class *implements[] = {
+		&interfaces[NR_INTERFACES - 1],
+		&interfaces[0],
+		&interfaces[NR_INTERFACES / 2],
+	};
+	struct vm_class vmc;
+	struct vm_method run;
+
+	load_interfaces();
+
+	init_class(&vmc, NULL, implements, ARRAY_SIZE(implements), &run);
+
+	assert_int_equals(0, vm_itable_setup(&vmc));
+	assert_int_equals(ARRAY_SIZE(implements), vmc.itable.nr_interfaces);
+
+	for (unsigned int i = 1; i <= vmc.itable.nr_interfaces; i++)
+		assert_true(vmc.itable.table[i - 1].interface_id < vmc.itable.table[i].interface_id);
+
+	for (unsigned int i = 0; i < ARRAY_SIZE(implements); i++) {
+		struct vm_method *i_method = implements[i]->methods;
+
+		assert_ptr_equals(native_ptrs[0], vm_itable_lookup(&vmc, i_method));
+	}
+
+	assert_ptr_equals(NULL, vm_itable_lookup(&vmc, &interface_methods[1]));
+}
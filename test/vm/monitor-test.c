@@ -0,0 +1,404 @@
+#include <libharness.h>
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "vm/object.h"
+#include "vm/system.h"
+#include "vm/thread.h"
+
+#define NR_CONTENDED_ITERATIONS		100000
+#define NR_BENCHMARK_ITERATIONS		1000000
+
+static struct vm_thread self;
+
+void test_vm_monitor_lock_is_recursive(void)
+{
+	struct vm_monitor mon;
+
+	current_exec_env.thread = &self;
+
+	assert_int_equals(0, vm_monitor_init(&mon));
+
+	assert_int_equals(0, vm_monitor_lock(&mon));
+	assert_int_equals(0, vm_monitor_lock(&mon));
+	assert_ptr_equals(&self, vm_monitor_get_owner(&mon));
+	assert_int_equals(2, mon.lock_count);
+
+	assert_int_equals(0, vm_monitor_unlock(&mon));
+	assert_ptr_equals(&self, vm_monitor_get_owner(&mon));
+
+	assert_int_equals(0, vm_monitor_unlock(&mon));
+	assert_ptr_equals(NULL, vm_monitor_get_owner(&mon));
+	assert_int_equals(0, mon.lock_count);
+}
+
+void test_vm_monitor_unlock_fails_if_not_owner(void)
+{
+	struct vm_monitor mon;
+
+	current_exec_env.thread = &self;
+
+	assert_int_equals(0, vm_monitor_init(&mon));
+
+	assert_int_equals(-1, vm_monitor_unlock(&mon));
+	assert_int_equals(-1, vm_monitor_notify(&mon));
+}
+
+struct contended_counter {
+	struct vm_monitor	mon;
+	unsigned long		value;
+};
+
+static void *contended_counter_thread(void *arg)
+{
+	struct contended_counter *counter = arg;
+	struct vm_thread thread;
+	int i;
+
+	current_exec_env.thread = &thread;
+
+	for (i = 0; i < NR_CONTENDED_ITERATIONS; i++) {
+		if (vm_monitor_lock(&counter->mon))
+			return NULL;
+
+		if (vm_monitor_get_owner(&counter->mon) == &thread)
+			counter->value++;
+
+		if (vm_monitor_unlock(&counter->mon))
+			return NULL;
+	}
+
+	return NULL;
+}
+
+void test_vm_monitor_excludes_other_threads(void)
+{
+	struct contended_counter counter;
+	pthread_t threads[4];
+	unsigned int i;
+
+	assert_int_equals(0, vm_monitor_init(&counter.mon));
+	counter.value = 0;
+
+	for (i = 0; i < ARRAY_SIZE(threads); i++)
+		pthread_create(&threads[i], NULL, contended_counter_thread, &counter);
+
+	for (i = 0; i < ARRAY_SIZE(threads); i++)
+		pthread_join(threads[i], NULL);
+
+	assert_int_equals(ARRAY_SIZE(threads) * NR_CONTENDED_ITERATIONS,
+			  counter.value);
+	assert_ptr_equals(NULL, vm_monitor_get_owner(&counter.mon));
+}
+
+static void init_test_thread(struct vm_thread *thread)
+{
+	pthread_mutex_init(&thread->mutex, NULL);
+	thread->interrupted = false;
+	thread->wait_mon = NULL;
+	INIT_LIST_HEAD(&thread->wait_node);
+}
+
+static unsigned int nr_queued(struct list_head *queue)
+{
+	struct list_head *node;
+	unsigned int nr = 0;
+
+	list_for_each(node, queue)
+		nr++;
+
+	return nr;
+}
+
+struct waiter {
+	pthread_t		posix_id;
+	struct vm_thread	thread;
+	struct vm_monitor	*mon;
+	int			err;
+};
+
+static void *waiter_thread(void *arg)
+{
+	struct waiter *waiter = arg;
+
+	current_exec_env.thread = &waiter->thread;
+
+	vm_monitor_lock(waiter->mon);
+	waiter->err = vm_monitor_wait(waiter->mon);
+	vm_monitor_unlock(waiter->mon);
+
+	return NULL;
+}
+
+static void start_waiters(struct vm_monitor *mon, struct waiter *waiters,
+			  unsigned int nr)
+{
+	unsigned int i;
+
+	for (i = 0; i < nr; i++) {
+		init_test_thread(&waiters[i].thread);
+		waiters[i].mon = mon;
+		waiters[i].err = -1;
+		pthread_create(&waiters[i].posix_id, NULL, waiter_thread, &waiters[i]);
+	}
+
+	for (;;) {
+		vm_monitor_lock(mon);
+		if (nr_queued(&mon->wait_queue) == nr)
+			break;
+		vm_monitor_unlock(mon);
+		sched_yield();
+	}
+}
+
+void test_vm_monitor_notify_hands_off_to_one_waiter(void)
+{
+	struct waiter waiters[2];
+	struct vm_monitor mon;
+	unsigned int i;
+
+	current_exec_env.thread = &self;
+	assert_int_equals(0, vm_monitor_init(&mon));
+
+	start_waiters(&mon, waiters, ARRAY_SIZE(waiters));
+
+	assert_int_equals(0, vm_monitor_notify(&mon));
+	assert_int_equals(1, nr_queued(&mon.wait_queue));
+	assert_int_equals(1, nr_queued(&mon.entry_queue));
+
+	/* The first waiter is notified first. */
+	assert_ptr_equals(&waiters[0].thread,
+		list_first_entry(&mon.entry_queue, struct vm_thread, wait_node));
+
+	assert_int_equals(0, vm_monitor_notify(&mon));
+	assert_int_equals(0, vm_monitor_unlock(&mon));
+
+	for (i = 0; i < ARRAY_SIZE(waiters); i++) {
+		pthread_join(waiters[i].posix_id, NULL);
+		assert_int_equals(0, waiters[i].err);
+	}
+}
+
+void test_vm_monitor_notify_all_requeues_waiters(void)
+{
+	struct waiter waiters[4];
+	struct vm_monitor mon;
+	unsigned int i;
+
+	current_exec_env.thread = &self;
+	assert_int_equals(0, vm_monitor_init(&mon));
+
+	start_waiters(&mon, waiters, ARRAY_SIZE(waiters));
+
+	assert_int_equals(0, vm_monitor_notify_all(&mon));
+	assert_int_equals(0, nr_queued(&mon.wait_queue));
+	assert_int_equals(ARRAY_SIZE(waiters), nr_queued(&mon.entry_queue));
+
+	assert_int_equals(0, vm_monitor_unlock(&mon));
+
+	for (i = 0; i < ARRAY_SIZE(waiters); i++) {
+		pthread_join(waiters[i].posix_id, NULL);
+		assert_int_equals(0, waiters[i].err);
+	}
+
+	assert_true(list_is_empty(&mon.entry_queue));
+}
+
+void test_vm_monitor_timed_wait_times_out(void)
+{
+	struct vm_monitor mon;
+
+	init_test_thread(&self);
+	current_exec_env.thread = &self;
+	assert_int_equals(0, vm_monitor_init(&mon));
+
+	assert_int_equals(0, vm_monitor_lock(&mon));
+	assert_int_equals(0, vm_monitor_timed_wait(&mon, 10, 0));
+	assert_ptr_equals(&self, vm_monitor_get_owner(&mon));
+	assert_true(list_is_empty(&mon.wait_queue));
+	assert_int_equals(0, vm_monitor_unlock(&mon));
+}
+
+#define THIN_LOCK_HOLD_NS	100000000ULL
+
+struct thin_lock_contender {
+	struct vm_thread	thread __attribute__((aligned(VM_LOCK_OWNER_ALIGN)));
+	struct vm_object	*obj;
+	unsigned long long	cpu_ns;
+	int			err;
+};
+
+static unsigned long long thread_cpu_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void *thin_lock_contender_thread(void *arg)
+{
+	struct thin_lock_contender *contender = arg;
+	unsigned long long start;
+
+	current_exec_env.thread = &contender->thread;
+
+	start = thread_cpu_ns();
+	contender->err = vm_object_lock(contender->obj);
+	contender->cpu_ns = thread_cpu_ns() - start;
+
+	if (!contender->err)
+		contender->err = vm_object_unlock(contender->obj);
+
+	return NULL;
+}
+
+void test_vm_object_lock_parks_thin_lock_contender(void)
+{
+	static struct vm_thread owner __attribute__((aligned(VM_LOCK_OWNER_ALIGN)));
+	struct thin_lock_contender contender;
+	struct timespec hold = { 0, THIN_LOCK_HOLD_NS };
+	static struct vm_object obj;
+	pthread_t posix_id;
+
+	current_exec_env.thread = &owner;
+
+	obj.class = NULL;
+	obj.lock_word = VM_LOCK_UNBIASED;
+
+	assert_int_equals(0, vm_object_lock(&obj));
+	assert_int_equals((unsigned long) &owner | VM_LOCK_UNBIASED, obj.lock_word);
+
+	contender.obj = &obj;
+	contender.err = -1;
+	pthread_create(&posix_id, NULL, thin_lock_contender_thread, &contender);
+
+	while (!(*(volatile unsigned long *) &obj.lock_word & VM_LOCK_CONTENDED))
+		sched_yield();
+
+	nanosleep(&hold, NULL);
+
+	assert_int_equals(0, vm_object_unlock(&obj));
+	pthread_join(posix_id, NULL);
+
+	assert_int_equals(0, contender.err);
+	assert_true(obj.lock_word & VM_LOCK_INFLATED);
+
+	/* A spinning contender would have burnt the whole hold time. */
+	assert_true(contender.cpu_ns < THIN_LOCK_HOLD_NS / 4);
+}
+
+/*
+ * Owner tracking as it was done before it became lock-free: every access to
+ * the owner field took a separate mutex. Kept here as the baseline of the
+ * benchmark below.
+ */
+struct mutex_owner_monitor {
+	pthread_mutex_t		mutex;
+	pthread_mutex_t		owner_mutex;
+	struct vm_thread	*owner;
+	int			lock_count;
+};
+
+static struct vm_thread *mutex_owner_get(struct mutex_owner_monitor *mon)
+{
+	struct vm_thread *owner;
+
+	pthread_mutex_lock(&mon->owner_mutex);
+	owner = mon->owner;
+	pthread_mutex_unlock(&mon->owner_mutex);
+
+	return owner;
+}
+
+static void mutex_owner_set(struct mutex_owner_monitor *mon,
+			    struct vm_thread *owner)
+{
+	pthread_mutex_lock(&mon->owner_mutex);
+	mon->owner = owner;
+	pthread_mutex_unlock(&mon->owner_mutex);
+}
+
+static int mutex_owner_lock(struct mutex_owner_monitor *mon)
+{
+	if (mon->lock_count && mutex_owner_get(mon) == &self) {
+		mon->lock_count++;
+		return 0;
+	}
+
+	if (pthread_mutex_lock(&mon->mutex))
+		return -1;
+
+	mutex_owner_set(mon, &self);
+	mon->lock_count = 1;
+	return 0;
+}
+
+static int mutex_owner_unlock(struct mutex_owner_monitor *mon)
+{
+	if (mutex_owner_get(mon) != &self)
+		return -1;
+
+	if (--mon->lock_count > 0)
+		return 0;
+
+	mutex_owner_set(mon, NULL);
+	return pthread_mutex_unlock(&mon->mutex);
+}
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void test_vm_monitor_uncontended_lock_unlock_benchmark(void)
+{
+	struct mutex_owner_monitor baseline;
+	unsigned long long start, lockfree_ns, mutex_ns;
+	struct vm_monitor mon;
+	int i;
+
+	current_exec_env.thread = &self;
+
+	assert_int_equals(0, vm_monitor_init(&mon));
+	pthread_mutex_init(&baseline.mutex, NULL);
+	pthread_mutex_init(&baseline.owner_mutex, NULL);
+	baseline.owner = NULL;
+	baseline.lock_count = 0;
+
+	start = now_ns();
+	for (i = 0; i < NR_BENCHMARK_ITERATIONS; i++) {
+		if (mutex_owner_lock(&baseline) || mutex_owner_unlock(&baseline))
+			break;
+	}
+	mutex_ns = now_ns() - start;
+	assert_int_equals(NR_BENCHMARK_ITERATIONS, i);
+
+	start = now_ns();
+	for (i = 0; i < NR_BENCHMARK_ITERATIONS; i++) {
+		if (vm_monitor_lock(&mon) || vm_monitor_unlock(&mon))
+			break;
+	}
+	lockfree_ns = now_ns() - start;
+	assert_int_equals(NR_BENCHMARK_ITERATIONS, i);
+
+	/*
+	 * Timings depend on the machine so they are reported rather than
+	 * asserted on.
+	 */
+	fprintf(stderr, "\nmonitor lock/unlock: owner_mutex %.1f ns, "
+		"lock-free owner %.1f ns per pair\n",
+		(double) mutex_ns / NR_BENCHMARK_ITERATIONS,
+		(double) lockfree_ns / NR_BENCHMARK_ITERATIONS);
+
+	pthread_mutex_destroy(&baseline.owner_mutex);
+	pthread_mutex_destroy(&baseline.mutex);
+}
@@ -4,6 +4,7 @@
 
 #include "vm/class.h"
 #include "vm/object.h"
+#include "vm/string.h"
 
 struct vm_object *
 vm_object_alloc_string_from_utf8(const uint8_t bytes[], unsigned int length)
@@ -19,6 +20,11 @@ vm_object_alloc_string_from_c(const char *bytes)
 	return NULL;
 }
 
+struct vm_object *vm_string_intern(struct vm_object *string)
+{
+	return string;
+}
+
 struct vm_object *new_exception(struct vm_class *class, const char *message)
 {
 	return NULL;
@@ -0,0 +1,6 @@
+#include "vm/gc.h"
+
+void gc_safepoint_operation(void (*fn)(void *), void *arg)
+{
+	fn(arg);
+}
@@ -54,6 +54,11 @@ int stack_trace_elem_next_java(struct stack_trace_elem *elem)
 	return -1;
 }
 
+struct compilation_unit *stack_trace_elem_get_cu(struct stack_trace_elem *elem)
+{
+	return NULL;
+}
+
 void print_java_stack_trace_elem(struct stack_trace_elem *elem)
 {
 }
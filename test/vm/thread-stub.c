@@ -6,3 +6,12 @@ char *vm_thread_get_name(struct vm_thread *thread)
 {
 	return NULL;
 }
+
+void vm_thread_set_state(struct vm_thread *thread, enum vm_thread_state state)
+{
+}
+
+bool vm_thread_interrupted(struct vm_thread *thread)
+{
+	return false;
+}
@@ -0,0 +1,47 @@
+#include <libharness.h>
+
+#include "lib/ws-deque.h"
+
+void test_ws_deque_pop_is_lifo(void)
+{
+	struct ws_deque deque;
+
+	assert_int_equals(0, init_ws_deque(&deque, 4));
+
+	assert_true(ws_deque_push(&deque, (void *) 1));
+	assert_true(ws_deque_push(&deque, (void *) 2));
+
+	assert_ptr_equals((void *) 2, ws_deque_pop(&deque));
+	assert_ptr_equals((void *) 1, ws_deque_pop(&deque));
+	assert_ptr_equals(NULL, ws_deque_pop(&deque));
+	assert_true(ws_deque_is_empty(&deque));
+}
+
+void test_ws_deque_steal_is_fifo(void)
+{
+	struct ws_deque deque;
+
+	assert_int_equals(0, init_ws_deque(&deque, 4));
+
+	ws_deque_push(&deque, (void *) 1);
+	ws_deque_push(&deque, (void *) 2);
+
+	assert_ptr_equals((void *) 1, ws_deque_steal(&deque));
+	assert_ptr_equals((void *) 2, ws_deque_pop(&deque));
+	assert_ptr_equals(NULL, ws_deque_steal(&deque));
+}
+
+void test_ws_deque_push_fails_when_full(void)
+{
+	struct ws_deque deque;
+
+	assert_int_equals(0, init_ws_deque(&deque, 2));
+
+	assert_true(ws_deque_push(&deque, (void *) 1));
+	assert_true(ws_deque_push(&deque, (void *) 2));
+	assert_false(ws_deque_push(&deque, (void *) 3));
+
+	assert_ptr_equals((void *) 1, ws_deque_steal(&deque));
+	assert_true(ws_deque_push(&deque, (void *) 3));
+	assert_ptr_equals((void *) 3, ws_deque_pop(&deque));
+}
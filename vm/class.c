@@ -33,6 +33,7 @@
 #include "cafebabe/stream.h"
 #include "cafebabe/class.h"
 
+#include "jit/cha.h"
 #include "jit/exception.h"
 #include "jit/compiler.h"
 #include "jit/vtable.h"
@@ -41,6 +42,7 @@
 #include "vm/classloader.h"
 #include "vm/preload.h"
 #include "vm/errors.h"
+#include "vm/interp.h"
 #include "vm/itable.h"
 #include "vm/method.h"
 #include "vm/object.h"
@@ -86,6 +88,7 @@ setup_vtable(struct vm_class *vmc)
 					vmm->name, vmm->type);
 			if (vmm2) {
 				vmm->virtual_index = vmm2->virtual_index;
+				cha_method_overridden(vmm2);
 				continue;
 			}
 		}
@@ -98,6 +101,13 @@ setup_vtable(struct vm_class *vmc)
 
 	vtable_init(&vmc->vtable, vmc->vtable_size);
 
+	/*
+	 * Superclass slots are fixed up concurrently when methods get
+	 * compiled. Fill in the vtable and register with the superclass
+	 * atomically with respect to that.
+	 */
+	vtable_lock();
+
 	/* Superclass methods */
 	for (uint16_t i = 0; i < super_vtable_size; ++i)
 		vtable_setup_method(&vmc->vtable, i,
@@ -111,6 +121,11 @@ setup_vtable(struct vm_class *vmc)
 				    vmm->virtual_index,
 				    vm_method_call_ptr(vmm));
 	}
+
+	if (super)
+		list_add_tail(&vmc->subclass_node, &super->subclasses);
+
+	vtable_unlock();
 }
 
 static int vm_class_link_common(struct vm_class *vmc)
@@ -127,6 +142,16 @@ static int vm_class_link_common(struct vm_class *vmc)
 
 	vmc->object = NULL;
 	vmc->classloader = NULL;
+	INIT_LIST_HEAD(&vmc->subclasses);
+	INIT_LIST_HEAD(&vmc->subclass_node);
+
+	vmc->interface_id = 0;
+	vmc->nr_itable_methods = 0;
+	memset(&vmc->itable, 0, sizeof(vmc->itable));
+
+	vmc->cha_implementor = NULL;
+	vmc->has_many_implementors = false;
+	INIT_LIST_HEAD(&vmc->cha_site_list);
 
 	return 0;
 }
@@ -440,19 +465,25 @@ int vm_class_link(struct vm_class *vmc, const struct cafebabe_class *class)
 	for (uint16_t i = 0; i < vmc->nr_methods; ++i) {
 		struct vm_method *vmm = &vmc->methods[i];
 
-		vmm->itable_index = itable_hash(vmm);
-
 		if (vm_method_prepare_jit(vmm))
 			goto error_free_methods;
 	}
 
 	array_destroy(&extra_methods);
 
-	if (!vm_class_is_interface(vmc)) {
+	if (vm_class_is_interface(vmc)) {
+		vm_itable_setup_interface(vmc);
+	} else {
 		setup_vtable(vmc);
 
-		if (!vm_class_is_abstract(vmc))
-			vm_itable_setup(vmc);
+		/*
+		 * Abstract classes get an itable too so that subclasses
+		 * can share its vtable indices.
+		 */
+		if (vm_itable_setup(vmc))
+			goto error_free_methods;
+
+		cha_add_implementor(vmc);
 	}
 
 	INIT_LIST_HEAD(&vmc->static_fixup_site_list);
@@ -649,15 +680,29 @@ int vm_class_init(struct vm_class *vmc)
 			if (strcmp(vmc->methods[i].name, "<clinit>"))
 				continue;
 
-			void (*clinit_trampoline)(void)
-				= vm_method_trampoline_ptr(&vmc->methods[i]);
+			struct vm_method *clinit = &vmc->methods[i];
+
+			if (interp_can_execute(clinit)) {
+				union jvalue result;
+
+				interp_call_method(clinit, NULL, &result);
+			} else {
+				void (*clinit_trampoline)(void)
+					= vm_method_trampoline_ptr(clinit);
+
+				clinit_trampoline();
+			}
 
-			clinit_trampoline();
 			if (exception_occurred())
 				goto error;
 		}
 	}
 
+	/*
+	 * vm_class_ensure_init() checks the state without locking. Locking
+	 * the monitor is a full barrier so the stores of the initializer are
+	 * visible before the class is published as initialized.
+	 */
 	vm_monitor_lock(&vmc->monitor);
 	vmc->state = VM_CLASS_INITIALIZED;
 	vm_monitor_notify_all(&vmc->monitor);
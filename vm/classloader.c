@@ -720,6 +720,27 @@ classloader_find_class(struct vm_object *loader, const char *name)
 	return vmc;
 }
 
+/*
+ * Calls @fn for every loaded class. The caller must make sure that the class
+ * cache can not be modified concurrently, e.g. by stopping the world.
+ */
+void classloader_for_each_class(void (*fn)(struct vm_class *))
+{
+	struct hash_map_entry *this;
+
+	hash_map_for_each_entry(this, classes) {
+		struct classloader_class *class = this->value;
+
+		if (class->status == CLASS_LOADED)
+			fn(class->class);
+	}
+
+	for (unsigned int i = 0; i < VM_TYPE_MAX; i++) {
+		if (primitive_class_cache[i])
+			fn(primitive_class_cache[i]);
+	}
+}
+
 int classloader_add_to_cache(struct vm_object *loader, struct vm_class *vmc)
 {
 	struct classloader_class *class;
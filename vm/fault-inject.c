@@ -26,6 +26,7 @@
 
 #include "vm/fault-inject.h"
 #include "vm/object.h"
+#include "vm/gc.h"
 
 struct vm_fault_entry {
 	bool enabled;
@@ -58,6 +59,8 @@ void native_vm_enable_fault(enum vm_fault fault,
 
 	vm_fault_entries[fault].enabled = true;
 	vm_fault_entries[fault].arg = arg;
+
+	gc_register_root(&vm_fault_entries[fault].arg);
 }
 
 void native_vm_disable_fault(enum vm_fault fault)
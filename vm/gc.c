@@ -33,28 +33,44 @@
 #include "arch/registers.h"
 #include "arch/memory.h"
 #include "arch/signal.h"
+#include "arch/atomic.h"
 
 #include "jit/compilation-unit.h"
 #include "jit/cu-mapping.h"
+#include "jit/exception.h"
 
 #include "lib/guard-page.h"
+#include "lib/ws-deque.h"
 
+#include "vm/classloader.h"
 #include "vm/stdlib.h"
+#include "vm/string.h"
 #include "vm/thread.h"
 #include "vm/method.h"
+#include "vm/object.h"
 #include "vm/class.h"
 #include "vm/trace.h"
+#include "vm/heap.h"
+#include "vm/jni.h"
 #include "vm/die.h"
 #include "vm/gc.h"
 
-#include <inttypes.h>
+#include <sys/mman.h>
 #include <pthread.h>
+#include <errno.h>
 #include <stdbool.h>
 #include <assert.h>
+#include <unistd.h>
+#include <sched.h>
+#include <string.h>
 #include <stdio.h>
+#include <time.h>
 
 void *gc_safepoint_page;
 
+/* Allocation buffer of the current thread. */
+__thread struct heap_tlab current_tlab;
+
 static pthread_mutex_t	gc_reclaim_mutex	= PTHREAD_MUTEX_INITIALIZER;
 static pthread_cond_t	gc_reclaim_cond		= PTHREAD_COND_INITIALIZER;
 static bool		gc_reclaim_in_progress;
@@ -67,10 +83,142 @@ static int nr_threads;
 
 static __thread sig_atomic_t in_safepoint;
 
+/*
+ * Set while the thread bump allocates from its TLAB without the heap lock.
+ * A suspend signal which arrives meanwhile is deferred until the allocation
+ * is done, see gc_heap_alloc().
+ */
+static __thread volatile sig_atomic_t in_tlab_bump;
+static __thread volatile sig_atomic_t suspend_deferred;
+
+/* Set while the GC thread is bringing the other threads to a safepoint. */
+static volatile sig_atomic_t gc_stop_requested;
+
+/* Threads which have not reached a safepoint by then are signalled again. */
+#define GC_RESIGNAL_NSEC	(1000 * 1000)
+
+#define GC_NR_TTSP_BUCKETS	16
+
+/*
+ * Time to safepoint histogram. Bucket 0 counts stops which took less than
+ * a microsecond and bucket i stops which took [2^(i-1), 2^i) microseconds.
+ * The last bucket has no upper bound.
+ */
+static unsigned long gc_ttsp_histogram[GC_NR_TTSP_BUCKETS];
+
 static pthread_t gc_thread_id;
 
 bool verbose_gc;
-bool gc_enabled;
+
+/*
+ * Objects come from a heap of at most -Xmx bytes, so without the collector
+ * a program fails once it has allocated that much in total.
+ */
+bool gc_enabled = true;
+
+/* Heap occupancy, in percent of the heap capacity, which starts a cycle. */
+unsigned int gc_trigger_percent = GC_DEFAULT_TRIGGER_PERCENT;
+
+/* Bytes allocated since the last cycle which start a minor collection. */
+unsigned long gc_nursery_size = GC_DEFAULT_NURSERY_SIZE;
+
+/* Mark occupancy triggered major collections concurrently. */
+bool gc_concurrent_mark;
+
+/*
+ * Set while a concurrent mark is in progress, i.e. while the SATB barrier
+ * must log overwritten references. Only changed while the world is stopped.
+ */
+volatile bool gc_marking;
+
+/*
+ * Snapshot-at-the-beginning log. The barrier marks the old value of an
+ * overwritten reference and appends it here so that the workers scan it.
+ * Only the thread which sets the mark bit logs an object so the log can not
+ * hold more entries than there are objects. Entries are reserved before
+ * they are written so readers wait for them to become non-NULL.
+ */
+struct vm_object **gc_satb_log;
+uint32_t gc_satb_log_top;
+static uint32_t gc_satb_log_next;
+
+enum gc_reason {
+	GC_REASON_NURSERY,
+	GC_REASON_OCCUPANCY,
+	GC_REASON_ALLOC_FAILURE,
+	GC_REASON_EXPLICIT,
+	GC_REASON_VM_OPERATION,	/* not a collection, see gc_safepoint_operation() */
+};
+
+/* protected by gc_reclaim_mutex */
+static enum gc_reason gc_reason;
+static size_t gc_reason_size;
+static void (*gc_vm_operation)(void *);
+static void *gc_vm_operation_arg;
+
+/* Heap occupancy in bytes at which the next cycle is started. */
+static unsigned long gc_trigger_limit;
+
+#define GC_MAX_ROOTS	64
+
+/* protected by heap_lock() */
+static struct vm_object **gc_roots[GC_MAX_ROOTS];
+static unsigned int nr_gc_roots;
+
+/* Number of threads, including the GC thread, which mark in parallel. */
+unsigned int gc_nr_workers;
+
+#define GC_DEQUE_SIZE		(1UL << 14)
+#define GC_MAX_DEFAULT_WORKERS	8
+
+/*
+ * Marking is shared by the GC thread and the helper threads. Every worker
+ * pushes the objects it marks on its own deque and steals from the others
+ * once it runs out of work.
+ */
+struct gc_worker {
+	struct ws_deque		deque;
+	unsigned int		id;
+	pthread_t		thread;
+
+	unsigned long		nr_scanned;
+	unsigned long		nr_stolen;
+};
+
+static struct gc_worker *gc_workers;
+static __thread struct gc_worker *gc_self;
+
+static pthread_mutex_t	gc_work_mutex		= PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t	gc_work_cond		= PTHREAD_COND_INITIALIZER;
+static pthread_cond_t	gc_work_done_cond	= PTHREAD_COND_INITIALIZER;
+
+/* protected by gc_work_mutex */
+static unsigned long gc_work_generation;
+static unsigned int nr_gc_workers_done;
+
+/* Next root scanning task to claim, see gc_mark_roots(). */
+static uint32_t gc_next_root_task;
+
+/* Number of workers which found no work. Marking ends when all are idle. */
+static uint32_t nr_gc_workers_idle;
+
+static bool gc_minor;
+
+enum gc_mark_phase {
+	GC_MARK_ALL,		/* scan the roots and mark everything */
+	GC_MARK_ROOTS,		/* only mark the roots */
+	GC_MARK_CONCURRENT,	/* mark from the roots marked before */
+};
+
+static enum gc_mark_phase gc_mark_phase;
+
+/*
+ * Marked objects which did not fit in a worker deque. The stack is big
+ * enough to hold every object in the heap.
+ */
+static struct vm_object **mark_stack;
+static unsigned long mark_stack_top;
+static pthread_spinlock_t mark_stack_lock;
 
 static void hide_safepoint_guard_page(void)
 {
@@ -100,6 +248,30 @@ static void suspend_self(void)
 		die("wrong signal");
 }
 
+/*
+ * Like suspend_self() but gives up after @nsec nanoseconds. Returns false if
+ * no wakeup arrived in time.
+ */
+static bool suspend_self_timeout(long nsec)
+{
+	struct timespec timeout = { 0, nsec };
+	sigset_t mask;
+
+	if (sigemptyset(&mask) != 0)
+		die("sigemptyset");
+
+	if (sigaddset(&mask, SIGUSR2) != 0)
+		die("sigaddset");
+
+	if (sigtimedwait(&mask, NULL, &timeout) == SIGUSR2)
+		return true;
+
+	if (errno != EAGAIN && errno != EINTR)
+		die("sigtimedwait");
+
+	return false;
+}
+
 static void suspend_thread(pthread_t thread_id)
 {
 	if (pthread_kill(thread_id, SIGUSR1) != 0)
@@ -154,236 +326,928 @@ static void enter_safepoint(void)
 		die("pthread_spin_unlock");
 }
 
-static void do_gc_reclaim(void)
+static void mark_stack_push(struct vm_object *obj)
 {
-	if (verbose_gc)
-		fprintf(stderr, "[GC]\n");
+	if (pthread_spin_lock(&mark_stack_lock) != 0)
+		die("pthread_spin_lock");
+
+	assert(mark_stack_top < heap_max_objects());
+
+	mark_stack[mark_stack_top++] = obj;
 
-	/* TODO: Do main GC work here. */
+	if (pthread_spin_unlock(&mark_stack_lock) != 0)
+		die("pthread_spin_unlock");
 }
 
-static void gc_scan_rootset(struct register_state *regs)
+static struct vm_object *mark_stack_pop(void)
 {
-	struct compilation_unit *cu;
+	struct vm_object *obj = NULL;
 
-	cu = jit_lookup_cu(regs->ip);
-	if (!cu) {
-		warn("safepoint at unknown IP %" PRIx64, regs->ip);
+	if (!mark_stack_top)
+		return NULL;
+
+	if (pthread_spin_lock(&mark_stack_lock) != 0)
+		die("pthread_spin_lock");
+
+	if (mark_stack_top)
+		obj = mark_stack[--mark_stack_top];
+
+	if (pthread_spin_unlock(&mark_stack_lock) != 0)
+		die("pthread_spin_unlock");
+
+	return obj;
+}
+
+static void gc_mark_object(struct vm_object *obj)
+{
+	if (!heap_mark_object(obj))
 		return;
-	}
 
-	if (verbose_gc)
-		fprintf(stderr, "[GC at %s.%s]\n", cu->method->class->name, cu->method->name);
+	if (!ws_deque_push(&gc_self->deque, obj))
+		mark_stack_push(obj);
+}
 
-	/* TODO: get live references from this thread. */
+/*
+ * Marks the object pointed to by @obj. Fields declared as references can also
+ * hold VM internal pointers (e.g. java.lang.Class.vmdata) so every pointer
+ * is checked against the heap first.
+ */
+static void gc_mark(struct vm_object *obj)
+{
+	obj = heap_lookup_object(obj);
+	if (obj)
+		gc_mark_object(obj);
 }
 
-void gc_safepoint(struct register_state *regs)
+/*
+ * Conservatively scans the memory range [start, end) for pointers into the
+ * heap. Interior pointers keep the enclosing object alive.
+ */
+static void gc_scan_range(void *start, void *end)
 {
-	gc_scan_rootset(regs);
+	void **p;
 
-	enter_safepoint();
+	start = (void *) ALIGN((unsigned long) start, sizeof(void *));
 
-	suspend_self();
+	for (p = start; (void *) (p + 1) <= end; p++) {
+		struct vm_object *obj = heap_lookup_interior(*p);
 
-	exit_safepoint();
+		if (obj)
+			gc_mark_object(obj);
+	}
 }
 
-void suspend_handler(int sig, siginfo_t *si, void *ctx)
+static void gc_scan_array(struct vm_object *array)
 {
-	struct vm_thread *self = vm_thread_self();
+	struct vm_class *elem_class = array->class->array_element_class;
+
+	if (elem_class->kind == VM_CLASS_KIND_PRIMITIVE)
+		return;
 
-	if (signal_from_native(ctx)) {
-		struct register_state thread_register_state;
-		ucontext_t *uc = ctx;
+	for (jsize i = 0; i < array->array_length; i++)
+		gc_mark(array_get_field_object(array, i));
+}
+
+static void gc_scan_object(struct vm_object *obj)
+{
+	struct vm_class *vmc = obj->class;
+
+	/* The object is being allocated and is not initialized yet. */
+	if (!vmc)
+		return;
 
-		/*
-		 * Fresh threads might return NULL from vm_thread_self().
-		 */
-		if (self)
-			self->thread_state = THREAD_STATE_CONSISTENT;
+	if (vmc->kind == VM_CLASS_KIND_ARRAY) {
+		gc_scan_array(obj);
+		return;
+	}
 
-		save_signal_registers(&thread_register_state, uc->uc_mcontext.gregs);
-		gc_safepoint(&thread_register_state);
-	} else {
-		self->thread_state = THREAD_STATE_INCONSISTENT;
+	for (; vmc; vmc = vmc->super) {
+		if (!vmc->class)
+			continue;
 
-		enter_safepoint();
+		for (uint16_t i = 0; i < vmc->class->fields_count; i++) {
+			struct vm_field *vmf = &vmc->fields[i];
 
-		suspend_self();
+			if (vm_field_is_static(vmf))
+				continue;
 
-		do_exit_safepoint();	/* don't wake up GC */
+			if (vm_field_type(vmf) != J_REFERENCE)
+				continue;
+
+			gc_mark(field_get_object(obj, vmf));
+		}
 	}
 }
 
-void wakeup_handler(int sig, siginfo_t *si, void *ctx)
+static void gc_mark_class(struct vm_class *vmc)
 {
+	gc_mark(vmc->object);
+	gc_mark(vmc->classloader);
+
+	if (vmc->kind != VM_CLASS_KIND_REGULAR || !vmc->static_values)
+		return;
+
+	for (uint16_t i = 0; i < vmc->class->fields_count; i++) {
+		struct vm_field *vmf = &vmc->fields[i];
+
+		if (!vm_field_is_static(vmf))
+			continue;
+
+		if (vm_field_type(vmf) != J_REFERENCE)
+			continue;
+
+		gc_mark(*(struct vm_object **) (vmc->static_values + vmf->offset));
+	}
 }
 
-static void gc_resume_rest(void)
+static void gc_mark_thread(struct vm_thread *thread)
 {
-	struct vm_thread *thread;
+	gc_mark(thread->vmthread);
 
-	if (pthread_spin_lock(&gc_spinlock) != 0)
-		die("pthread_spin_lock");
+	/*
+	 * Thread is not attached to the VM yet or did not enter the
+	 * safepoint through gc_safepoint().
+	 */
+	if (!thread->gc_stack_ptr)
+		return;
 
-	assert(nr_in_safepoint == nr_threads);
+	gc_mark(thread->gc_exception);
 
-	if (pthread_spin_unlock(&gc_spinlock) != 0)
-		die("pthread_spin_unlock");
+	/*
+	 * The register state at the safepoint is saved in the signal
+	 * frame so it is covered by the stack scan.
+	 */
+	gc_scan_range(thread->gc_stack_ptr, thread->stack_top);
+}
 
-	vm_thread_for_each(thread) {
-		assert(thread->posix_id != pthread_self());
+static void gc_mark_global_roots(void)
+{
+	classloader_for_each_class(gc_mark_class);
+	vm_string_for_each_literal(gc_mark);
+	vm_jni_for_each_classloader(gc_mark);
 
-		resume_thread(thread->posix_id);
-	}
+	for (unsigned int i = 0; i < nr_gc_roots; i++)
+		gc_mark(*gc_roots[i]);
+}
 
-	/* Wait for all threads to leave a safepoint. */
-	suspend_self();
+static uint32_t atomic_add_u32(uint32_t *p, int delta)
+{
+	uint32_t old;
 
-	if (pthread_spin_lock(&gc_spinlock) != 0)
-		die("pthread_spin_lock");
+	do {
+		old = *(volatile uint32_t *) p;
+	} while (atomic_cmpxchg_32(p, old, old + delta) != old);
 
-	assert(nr_in_safepoint == 0);
+	return old + delta;
+}
 
-	if (pthread_spin_unlock(&gc_spinlock) != 0)
-		die("pthread_spin_unlock");
+enum {
+	GC_TASK_GLOBAL_ROOTS,
+	GC_TASK_DIRTY_CARDS,
+	GC_TASK_THREADS,	/* one task for every thread */
+};
+
+static uint32_t gc_claim_root_task(void)
+{
+	return atomic_add_u32(&gc_next_root_task, 1) - 1;
 }
 
-static void gc_suspend_rest(void)
+/*
+ * Root scanning is split into tasks which the workers claim in order. The
+ * stack of every thread is a separate task.
+ */
+static void gc_mark_roots(void)
 {
-	unsigned long nr_restarted = 0;
 	struct vm_thread *thread;
+	uint32_t task, idx;
 
-	if (pthread_spin_lock(&gc_spinlock) != 0)
-		die("pthread_spin_lock");
+	task = gc_claim_root_task();
 
-	assert(nr_in_safepoint == 0);
-	assert(nr_threads > 0);
+	if (task == GC_TASK_GLOBAL_ROOTS) {
+		gc_mark_global_roots();
+		task = gc_claim_root_task();
+	}
 
-	if (pthread_spin_unlock(&gc_spinlock) != 0)
-		die("pthread_spin_unlock");
+	if (task == GC_TASK_DIRTY_CARDS) {
+		if (gc_minor)
+			heap_scan_dirty_cards(gc_scan_object);
+		task = gc_claim_root_task();
+	}
+
+	idx = GC_TASK_THREADS;
 
 	vm_thread_for_each(thread) {
-		assert(thread->posix_id != pthread_self());
+		if (idx++ != task)
+			continue;
 
-		suspend_thread(thread->posix_id);
+		gc_mark_thread(thread);
+		task = gc_claim_root_task();
 	}
+}
 
-	/* Wait for all threads to enter a safepoint.  */
-	suspend_self();
-
-	/*
-	 * Restart inconsistent threads and let them run until they enter a
-	 * safepoint through guard page polling.
-	 */
-	hide_safepoint_guard_page();
+static struct vm_object *gc_steal(struct gc_worker *self)
+{
+	for (unsigned int i = 1; i < gc_nr_workers; i++) {
+		struct gc_worker *victim;
+		struct vm_object *obj;
 
-	vm_thread_for_each(thread) {
-		assert(thread->posix_id != pthread_self());
+		victim = &gc_workers[(self->id + i) % gc_nr_workers];
 
-		if (thread->thread_state == THREAD_STATE_INCONSISTENT) {
-			resume_thread(thread->posix_id);
-			nr_restarted++;
+		obj = ws_deque_steal(&victim->deque);
+		if (obj) {
+			self->nr_stolen++;
+			return obj;
 		}
 	}
 
-	/* Wait for restarted threads to enter a safepoint.  */
-	if (nr_restarted)
-		suspend_self();
+	return NULL;
+}
 
-	if (pthread_spin_lock(&gc_spinlock) != 0)
-		die("pthread_spin_lock");
+static void gc_satb_log_push(struct vm_object *obj)
+{
+	uint32_t idx;
 
-	assert(nr_in_safepoint == nr_threads);
+	idx = atomic_add_u32(&gc_satb_log_top, 1) - 1;
+	assert(idx < heap_max_objects());
 
-	if (pthread_spin_unlock(&gc_spinlock) != 0)
-		die("pthread_spin_unlock");
+	gc_satb_log[idx] = obj;
+}
 
-	unhide_safepoint_guard_page();
+static struct vm_object *gc_satb_log_pop(void)
+{
+	struct vm_object *obj;
+	uint32_t idx;
+
+	do {
+		idx = *(volatile uint32_t *) &gc_satb_log_next;
+
+		if (idx == *(volatile uint32_t *) &gc_satb_log_top)
+			return NULL;
+	} while (atomic_cmpxchg_32(&gc_satb_log_next, idx, idx + 1) != idx);
+
+	while (!(obj = ((struct vm_object * volatile *) gc_satb_log)[idx]))
+		sched_yield();
+
+	return obj;
 }
 
-static void do_gc(void)
+static void gc_satb_log_reset(void)
 {
-	vm_lock_thread_count();
+	memset(gc_satb_log, 0, gc_satb_log_top * sizeof(*gc_satb_log));
 
-	if (pthread_spin_lock(&gc_spinlock) != 0)
-		die("pthread_spin_lock");
+	gc_satb_log_top = 0;
+	gc_satb_log_next = 0;
+}
 
-	nr_threads = vm_nr_threads();
+static bool gc_work_available(void)
+{
+	if (mark_stack_top)
+		return true;
 
-	/* Don't deadlock during early boostrap. */
-	if (nr_threads == 0) {
-		if (pthread_spin_unlock(&gc_spinlock) != 0)
-			die("pthread_spin_unlock");
-		goto out;
+	if (*(volatile uint32_t *) &gc_satb_log_next != *(volatile uint32_t *) &gc_satb_log_top)
+		return true;
+
+	for (unsigned int i = 0; i < gc_nr_workers; i++) {
+		if (!ws_deque_is_empty(&gc_workers[i].deque))
+			return true;
 	}
 
-	if (pthread_spin_unlock(&gc_spinlock) != 0)
-		die("pthread_spin_unlock");
+	return false;
+}
 
-	gc_suspend_rest();
-	do_gc_reclaim();
-	gc_resume_rest();
-out:
-	if (pthread_spin_lock(&gc_spinlock) != 0)
-		die("pthread_spin_lock");
+static struct vm_object *gc_next_object(struct gc_worker *self)
+{
+	struct vm_object *obj;
 
-	nr_threads = -1;
+	obj = ws_deque_pop(&self->deque);
+	if (obj)
+		return obj;
 
-	if (pthread_spin_unlock(&gc_spinlock) != 0)
-		die("pthread_spin_unlock");
+	obj = mark_stack_pop();
+	if (obj)
+		return obj;
 
-	vm_unlock_thread_count();
+	obj = gc_satb_log_pop();
+	if (obj)
+		return obj;
 
-	if (pthread_mutex_lock(&gc_reclaim_mutex) != 0)
-		die("pthread_mutex_lock");
+	return gc_steal(self);
+}
 
-	gc_reclaim_in_progress = false;
-	pthread_cond_broadcast(&gc_reclaim_cond);
+/*
+ * Scans marked objects until no worker has anything left to do. Workers
+ * only produce work while they are not idle so once all of them are idle
+ * the marking is complete.
+ */
+static void gc_mark_live_objects(struct gc_worker *self)
+{
+	struct vm_object *obj;
 
-	if (pthread_mutex_unlock(&gc_reclaim_mutex) != 0)
-		die("pthread_mutex_unlock");
+	for (;;) {
+		while ((obj = gc_next_object(self))) {
+			gc_scan_object(obj);
+			self->nr_scanned++;
+		}
+
+		atomic_add_u32(&nr_gc_workers_idle, 1);
+
+		for (;;) {
+			if (*(volatile uint32_t *) &nr_gc_workers_idle == gc_nr_workers)
+				return;
+
+			if (gc_work_available()) {
+				atomic_add_u32(&nr_gc_workers_idle, -1);
+				break;
+			}
+
+			sched_yield();
+		}
+	}
 }
 
-static void *gc_thread(void *arg)
+static void gc_do_mark(struct gc_worker *self)
 {
-	struct sigaction sa;
-	sigset_t sigset;
+	gc_self = self;
 
-	sigemptyset(&sa.sa_mask);
-	sa.sa_flags	= SA_RESTART | SA_SIGINFO;
+	if (gc_mark_phase != GC_MARK_CONCURRENT)
+		gc_mark_roots();
 
-	sa.sa_sigaction	= wakeup_handler;
-	sigaction(SIGUSR2, &sa, NULL);
+	if (gc_mark_phase != GC_MARK_ROOTS)
+		gc_mark_live_objects(self);
+}
 
-	/*
-	 * SIGUSR2 is used to resume threads. Make sure the signal is blocked
-	 * by default to avoid races with sigwait().
-	 */
+static void *gc_worker_thread(void *arg)
+{
+	struct gc_worker *self = arg;
+	unsigned long generation = 0;
+	sigset_t sigset;
+
+	/* Thread suspension signals are only meant for mutators. */
 	sigemptyset(&sigset);
+	sigaddset(&sigset, SIGUSR1);
 	sigaddset(&sigset, SIGUSR2);
 	pthread_sigmask(SIG_BLOCK, &sigset, NULL);
 
 	for (;;) {
-		suspend_self();
-		do_gc();
+		if (pthread_mutex_lock(&gc_work_mutex) != 0)
+			die("pthread_mutex_lock");
+
+		while (gc_work_generation == generation) {
+			if (pthread_cond_wait(&gc_work_cond, &gc_work_mutex) != 0)
+				die("pthread_cond_wait");
+		}
+
+		generation = gc_work_generation;
+
+		if (pthread_mutex_unlock(&gc_work_mutex) != 0)
+			die("pthread_mutex_unlock");
+
+		gc_do_mark(self);
+
+		if (pthread_mutex_lock(&gc_work_mutex) != 0)
+			die("pthread_mutex_lock");
+
+		if (++nr_gc_workers_done == gc_nr_workers - 1)
+			pthread_cond_signal(&gc_work_done_cond);
+
+		if (pthread_mutex_unlock(&gc_work_mutex) != 0)
+			die("pthread_mutex_unlock");
 	}
 	return NULL;
 }
 
 /*
- * This wakes up the GC thread and suspends until garbage collection is done.
+ * Marks all reachable objects using every worker. The GC thread acts as
+ * the first worker. Objects marked in the GC_MARK_ROOTS phase stay on the
+ * worker deques for the next phase.
  */
-static void gc_start(void)
+static void gc_mark_parallel(enum gc_mark_phase phase)
 {
-	if (pthread_mutex_lock(&gc_reclaim_mutex) != 0)
-		die("pthread_mutex_lock");
+	gc_mark_phase = phase;
+	gc_next_root_task = 0;
+	nr_gc_workers_idle = 0;
 
-	if (gc_reclaim_in_progress)
-		goto wait_for_reclaim;
+	for (unsigned int i = 0; i < gc_nr_workers; i++) {
+		gc_workers[i].nr_scanned = 0;
+		gc_workers[i].nr_stolen = 0;
+	}
+
+	if (pthread_mutex_lock(&gc_work_mutex) != 0)
+		die("pthread_mutex_lock");
+
+	nr_gc_workers_done = 0;
+	gc_work_generation++;
+	pthread_cond_broadcast(&gc_work_cond);
+
+	if (pthread_mutex_unlock(&gc_work_mutex) != 0)
+		die("pthread_mutex_unlock");
+
+	gc_do_mark(&gc_workers[0]);
+
+	if (pthread_mutex_lock(&gc_work_mutex) != 0)
+		die("pthread_mutex_lock");
+
+	while (nr_gc_workers_done != gc_nr_workers - 1) {
+		if (pthread_cond_wait(&gc_work_done_cond, &gc_work_mutex) != 0)
+			die("pthread_cond_wait");
+	}
+
+	if (pthread_mutex_unlock(&gc_work_mutex) != 0)
+		die("pthread_mutex_unlock");
+}
+
+static void gc_print_mark_stats(void)
+{
+	unsigned long scanned = 0, stolen = 0;
+
+	for (unsigned int i = 0; i < gc_nr_workers; i++) {
+		scanned += gc_workers[i].nr_scanned;
+		stolen += gc_workers[i].nr_stolen;
+	}
+
+	fprintf(stderr, "[GC: %u mark threads, %lu objects scanned, %lu stolen]\n",
+		gc_nr_workers, scanned, stolen);
+}
+
+/*
+ * Makes the heap parsable by returning the unused part of every thread's
+ * allocation buffer. Threads refill their buffers after they are resumed.
+ */
+static void gc_retire_tlabs(void)
+{
+	struct vm_thread *thread;
+
+	vm_thread_for_each(thread) {
+		if (thread->tlab)
+			heap_retire_tlab(thread->tlab);
+	}
+}
+
+static void gc_print_reason(void)
+{
+	switch (gc_reason) {
+	case GC_REASON_NURSERY:
+		fprintf(stderr, "[GC: minor collection, %luK allocated since last cycle]\n",
+			heap_young() / 1024);
+		break;
+	case GC_REASON_OCCUPANCY:
+		fprintf(stderr, "[GC: heap occupancy %luK of %luK reached %u%% trigger]\n",
+			heap_used() / 1024, heap_capacity() / 1024,
+			gc_trigger_percent);
+		break;
+	case GC_REASON_ALLOC_FAILURE:
+		fprintf(stderr, "[GC: allocation of %zu bytes failed, heap occupancy %luK of %luK]\n",
+			gc_reason_size, heap_used() / 1024,
+			heap_capacity() / 1024);
+		break;
+	case GC_REASON_EXPLICIT:
+		fprintf(stderr, "[GC: System.gc()]\n");
+		break;
+	case GC_REASON_VM_OPERATION:
+		break;
+	}
+}
+
+/*
+ * A minor collection only traces young objects. Old objects are live by
+ * definition and the ones on dirty cards are scanned for references to
+ * young objects. Survivors of any collection are promoted in place.
+ */
+static void do_gc_reclaim(void)
+{
+	bool minor = gc_reason == GC_REASON_NURSERY;
+	unsigned long freed;
+
+	if (verbose_gc)
+		gc_print_reason();
+
+	gc_retire_tlabs();
+
+	if (minor)
+		heap_prepare_minor_collection();
+	else
+		heap_prepare_collection();
+
+	gc_minor = minor;
+	gc_mark_parallel(GC_MARK_ALL);
+	vm_monitor_reclaim(heap_object_is_live);
+
+	if (minor)
+		freed = heap_sweep_young();
+	else
+		freed = heap_sweep();
+
+	if (verbose_gc) {
+		gc_print_mark_stats();
+		fprintf(stderr, "[GC: %s, %luK freed, %luK live]\n",
+			minor ? "minor" : "major",
+			freed / 1024, heap_used() / 1024);
+	}
+}
+
+/*
+ * Sizes the heap so that the application can allocate at least as much as
+ * is live now before the next cycle is triggered.
+ */
+static void gc_update_trigger(void)
+{
+	unsigned long live, capacity;
+
+	live = heap_used();
+	capacity = heap_capacity();
+
+	heap_resize(live / gc_trigger_percent * 200);
+
+	if (verbose_gc && heap_capacity() != capacity)
+		fprintf(stderr, "[GC: heap resized from %luK to %luK]\n",
+			capacity / 1024, heap_capacity() / 1024);
+
+	capacity = heap_capacity();
+
+	gc_trigger_limit = capacity / 100 * gc_trigger_percent;
+
+	/* The heap can not grow any further. */
+	if (gc_trigger_limit <= live)
+		gc_trigger_limit = live + (capacity - live) / 2;
+}
+
+static void gc_scan_rootset(struct register_state *regs)
+{
+	struct vm_thread *self = vm_thread_self();
+	struct compilation_unit *cu;
+
+	/*
+	 * Fresh threads might return NULL from vm_thread_self(). They do
+	 * not hold any references yet.
+	 */
+	if (!self)
+		return;
+
+	/*
+	 * Everything the thread can reference lives above this frame. It
+	 * is scanned by the GC thread once all threads are stopped.
+	 */
+	self->gc_stack_ptr = __builtin_frame_address(0);
+	self->gc_exception = exception_occurred();
+
+	if (!verbose_gc)
+		return;
+
+	cu = jit_lookup_cu(regs->ip);
+	if (cu)
+		fprintf(stderr, "[GC at %s.%s]\n", cu->method->class->name, cu->method->name);
+}
+
+void gc_safepoint(struct register_state *regs)
+{
+	struct vm_thread *self = vm_thread_self();
+
+	gc_scan_rootset(regs);
+
+	enter_safepoint();
+
+	suspend_self();
+
+	if (self)
+		self->gc_stack_ptr = NULL;
+
+	exit_safepoint();
+}
+
+void suspend_handler(int sig, siginfo_t *si, void *ctx)
+{
+	struct register_state thread_register_state;
+	ucontext_t *uc = ctx;
+
+	/* The signal was resent or arrived after the threads were resumed. */
+	if (!gc_stop_requested || in_safepoint)
+		return;
+
+	if (in_tlab_bump) {
+		suspend_deferred = true;
+		return;
+	}
+
+	/*
+	 * JIT compiled code polls the safepoint guard page before calls, on
+	 * loop back-edges and in method epilogues so the thread reaches a
+	 * safepoint shortly on its own.
+	 */
+	if (!signal_from_native(ctx))
+		return;
+
+	save_signal_registers(&thread_register_state, uc->uc_mcontext.gregs);
+	gc_safepoint(&thread_register_state);
+}
+
+void wakeup_handler(int sig, siginfo_t *si, void *ctx)
+{
+}
+
+static void gc_resume_rest(void)
+{
+	struct vm_thread *thread;
+
+	if (pthread_spin_lock(&gc_spinlock) != 0)
+		die("pthread_spin_lock");
+
+	assert(nr_in_safepoint == nr_threads);
+
+	if (pthread_spin_unlock(&gc_spinlock) != 0)
+		die("pthread_spin_unlock");
+
+	vm_thread_for_each(thread) {
+		assert(thread->posix_id != pthread_self());
+
+		resume_thread(thread->posix_id);
+	}
+
+	/* Wait for all threads to leave a safepoint. */
+	suspend_self();
+
+	if (pthread_spin_lock(&gc_spinlock) != 0)
+		die("pthread_spin_lock");
+
+	assert(nr_in_safepoint == 0);
+
+	if (pthread_spin_unlock(&gc_spinlock) != 0)
+		die("pthread_spin_unlock");
+}
+
+static void gc_signal_rest(void)
+{
+	struct vm_thread *thread;
+
+	vm_thread_for_each(thread) {
+		assert(thread->posix_id != pthread_self());
+
+		suspend_thread(thread->posix_id);
+	}
+}
+
+static void gc_record_time_to_safepoint(struct timespec *start)
+{
+	unsigned long usec, bucket = 0;
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	usec = (now.tv_sec - start->tv_sec) * 1000000
+		+ (now.tv_nsec - start->tv_nsec) / 1000;
+
+	if (usec)
+		bucket = min((unsigned long) (BITS_PER_LONG - __builtin_clzl(usec)),
+			     GC_NR_TTSP_BUCKETS - 1UL);
+
+	gc_ttsp_histogram[bucket]++;
+
+	if (verbose_gc)
+		fprintf(stderr, "[GC: time to safepoint %lu us]\n", usec);
+}
+
+/*
+ * Threads running JIT compiled code stop at the next safepoint poll once
+ * the guard page is hidden. Threads running native code do not poll so
+ * they are stopped with a signal which is resent periodically for threads
+ * that left compiled code without passing a poll.
+ */
+static void gc_suspend_rest(void)
+{
+	struct timespec start;
+
+	if (pthread_spin_lock(&gc_spinlock) != 0)
+		die("pthread_spin_lock");
+
+	assert(nr_in_safepoint == 0);
+	assert(nr_threads > 0);
+
+	if (pthread_spin_unlock(&gc_spinlock) != 0)
+		die("pthread_spin_unlock");
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	gc_stop_requested = true;
+	hide_safepoint_guard_page();
+
+	gc_signal_rest();
+
+	/* Wait for all threads to enter a safepoint.  */
+	while (!suspend_self_timeout(GC_RESIGNAL_NSEC))
+		gc_signal_rest();
+
+	if (pthread_spin_lock(&gc_spinlock) != 0)
+		die("pthread_spin_lock");
+
+	assert(nr_in_safepoint == nr_threads);
+
+	if (pthread_spin_unlock(&gc_spinlock) != 0)
+		die("pthread_spin_unlock");
+
+	unhide_safepoint_guard_page();
+	gc_stop_requested = false;
+
+	gc_record_time_to_safepoint(&start);
+}
+
+static void gc_release_threads(void)
+{
+	if (pthread_spin_lock(&gc_spinlock) != 0)
+		die("pthread_spin_lock");
+
+	nr_threads = -1;
+
+	if (pthread_spin_unlock(&gc_spinlock) != 0)
+		die("pthread_spin_unlock");
+
+	vm_unlock_thread_count();
+}
+
+/*
+ * Brings every thread to a safepoint. Returns false without stopping
+ * anything if there are no threads.
+ */
+static bool gc_stop_world(void)
+{
+	vm_lock_thread_count();
+
+	if (pthread_spin_lock(&gc_spinlock) != 0)
+		die("pthread_spin_lock");
+
+	nr_threads = vm_nr_threads();
+
+	if (pthread_spin_unlock(&gc_spinlock) != 0)
+		die("pthread_spin_unlock");
+
+	/* Don't deadlock during early boostrap. */
+	if (nr_threads == 0) {
+		gc_release_threads();
+		return false;
+	}
+
+	/*
+	 * Holding the heap lock guarantees that no thread is stopped in the
+	 * middle of an allocation.
+	 */
+	heap_lock();
+
+	gc_suspend_rest();
+
+	return true;
+}
+
+static void gc_start_world(void)
+{
+	gc_resume_rest();
+
+	heap_unlock();
+
+	gc_release_threads();
+}
+
+/*
+ * A major collection which marks while the mutators run. The world is only
+ * stopped to mark the roots and, at the end, to rescan them, finish the
+ * marking and sweep. In between the SATB barrier keeps everything which was
+ * reachable at the first pause alive.
+ */
+static void do_gc_concurrent(void)
+{
+	unsigned long freed;
+
+	if (!gc_stop_world())
+		return;
+
+	if (verbose_gc)
+		gc_print_reason();
+
+	gc_retire_tlabs();
+	heap_prepare_concurrent_collection();
+
+	gc_minor = false;
+	gc_marking = true;
+	gc_mark_parallel(GC_MARK_ROOTS);
+
+	gc_start_world();
+
+	gc_mark_parallel(GC_MARK_CONCURRENT);
+
+	if (verbose_gc)
+		gc_print_mark_stats();
+
+	if (!gc_stop_world()) {
+		/* Every thread is gone so there is no point in sweeping. */
+		heap_lock();
+		gc_marking = false;
+		heap_abort_collection();
+		gc_satb_log_reset();
+		heap_unlock();
+		return;
+	}
+
+	gc_retire_tlabs();
+	gc_mark_parallel(GC_MARK_ALL);
+
+	gc_marking = false;
+	vm_monitor_reclaim(heap_object_is_live);
+	freed = heap_sweep();
+	gc_satb_log_reset();
+
+	if (verbose_gc) {
+		gc_print_mark_stats();
+		fprintf(stderr, "[GC: concurrent, %luK freed, %luK live]\n",
+			freed / 1024, heap_used() / 1024);
+	}
+
+	gc_start_world();
+}
+
+static bool gc_is_concurrent(enum gc_reason reason)
+{
+	return reason == GC_REASON_OCCUPANCY && gc_concurrent_mark;
+}
+
+static void do_vm_operation(void)
+{
+	bool stopped = gc_stop_world();
+
+	/* Without threads there is nobody to stop. */
+	gc_vm_operation(gc_vm_operation_arg);
+
+	if (stopped)
+		gc_start_world();
+}
+
+static void do_gc(void)
+{
+	if (gc_reason == GC_REASON_VM_OPERATION) {
+		do_vm_operation();
+	} else if (gc_is_concurrent(gc_reason)) {
+		do_gc_concurrent();
+	} else if (gc_stop_world()) {
+		do_gc_reclaim();
+		gc_start_world();
+	}
+
+	/*
+	 * Promoted garbage is only reclaimed by a major collection so the
+	 * heap is sized after those.
+	 */
+	if (gc_reason != GC_REASON_NURSERY && gc_reason != GC_REASON_VM_OPERATION)
+		gc_update_trigger();
+
+	if (pthread_mutex_lock(&gc_reclaim_mutex) != 0)
+		die("pthread_mutex_lock");
+
+	gc_reclaim_in_progress = false;
+	pthread_cond_broadcast(&gc_reclaim_cond);
+
+	if (pthread_mutex_unlock(&gc_reclaim_mutex) != 0)
+		die("pthread_mutex_unlock");
+}
+
+static void *gc_thread(void *arg)
+{
+	struct sigaction sa;
+	sigset_t sigset;
+
+	sigemptyset(&sa.sa_mask);
+	sa.sa_flags	= SA_RESTART | SA_SIGINFO;
+
+	sa.sa_sigaction	= wakeup_handler;
+	sigaction(SIGUSR2, &sa, NULL);
+
+	/*
+	 * SIGUSR2 is used to resume threads. Make sure the signal is blocked
+	 * by default to avoid races with sigwait().
+	 */
+	sigemptyset(&sigset);
+	sigaddset(&sigset, SIGUSR2);
+	pthread_sigmask(SIG_BLOCK, &sigset, NULL);
+
+	for (;;) {
+		suspend_self();
+		do_gc();
+	}
+	return NULL;
+}
+
+/*
+ * This wakes up the GC thread and suspends until garbage collection is done.
+ * Concurrent cycles run in the background.
+ */
+static void gc_start(enum gc_reason reason, size_t size)
+{
+	bool wait = !gc_is_concurrent(reason);
+
+	if (pthread_mutex_lock(&gc_reclaim_mutex) != 0)
+		die("pthread_mutex_lock");
+
+	if (gc_reclaim_in_progress)
+		goto wait_for_reclaim;
 
 	gc_reclaim_in_progress = true;
+	gc_reason = reason;
+	gc_reason_size = size;
 
 	if (pthread_mutex_unlock(&gc_reclaim_mutex) != 0)
 		die("pthread_mutex_unlock");
@@ -394,6 +1258,43 @@ static void gc_start(void)
 		die("pthread_mutex_lock");
 
 wait_for_reclaim:
+	while (wait && gc_reclaim_in_progress) {
+		if (pthread_cond_wait(&gc_reclaim_cond, &gc_reclaim_mutex) != 0)
+			die("pthread_cond_wait");
+	}
+
+	if (pthread_mutex_unlock(&gc_reclaim_mutex) != 0)
+		die("pthread_mutex_unlock");
+}
+
+/*
+ * Runs @fn on the GC thread while every other thread is stopped at a
+ * safepoint. The caller waits for a collection in progress to finish first
+ * and is itself stopped while @fn runs. @fn must not take the heap lock.
+ */
+void gc_safepoint_operation(void (*fn)(void *), void *arg)
+{
+	if (pthread_mutex_lock(&gc_reclaim_mutex) != 0)
+		die("pthread_mutex_lock");
+
+	while (gc_reclaim_in_progress) {
+		if (pthread_cond_wait(&gc_reclaim_cond, &gc_reclaim_mutex) != 0)
+			die("pthread_cond_wait");
+	}
+
+	gc_reclaim_in_progress = true;
+	gc_reason = GC_REASON_VM_OPERATION;
+	gc_vm_operation = fn;
+	gc_vm_operation_arg = arg;
+
+	if (pthread_mutex_unlock(&gc_reclaim_mutex) != 0)
+		die("pthread_mutex_unlock");
+
+	resume_thread(gc_thread_id);
+
+	if (pthread_mutex_lock(&gc_reclaim_mutex) != 0)
+		die("pthread_mutex_lock");
+
 	while (gc_reclaim_in_progress) {
 		if (pthread_cond_wait(&gc_reclaim_cond, &gc_reclaim_mutex) != 0)
 			die("pthread_cond_wait");
@@ -403,6 +1304,35 @@ wait_for_reclaim:
 		die("pthread_mutex_unlock");
 }
 
+static void gc_init_workers(void)
+{
+	if (!gc_nr_workers) {
+		long nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+		gc_nr_workers = min(max(nr_cpus, 1L), (long) GC_MAX_DEFAULT_WORKERS);
+	}
+
+	gc_workers = calloc(gc_nr_workers, sizeof(struct gc_worker));
+	if (!gc_workers)
+		die("Couldn't allocate GC workers");
+
+	for (unsigned int i = 0; i < gc_nr_workers; i++) {
+		struct gc_worker *worker = &gc_workers[i];
+
+		worker->id = i;
+
+		if (init_ws_deque(&worker->deque, GC_DEQUE_SIZE))
+			die("Couldn't allocate GC mark deque");
+
+		/* The GC thread is the first worker. */
+		if (i == 0)
+			continue;
+
+		if (pthread_create(&worker->thread, NULL, &gc_worker_thread, worker))
+			die("Couldn't create GC worker thread");
+	}
+}
+
 void gc_init(void)
 {
 	gc_safepoint_page = alloc_guard_page(false);
@@ -412,14 +1342,215 @@ void gc_init(void)
 	if (pthread_spin_init(&gc_spinlock, PTHREAD_PROCESS_SHARED) != 0)
 		die("pthread_spin_init");
 
+	if (heap_min_size > heap_max_size)
+		die("initial heap size (-Xms) exceeds maximum heap size (-Xmx)");
+
+	if (heap_init())
+		die("Couldn't reserve %lu bytes for the heap", heap_max_size);
+
+	gc_trigger_limit = heap_capacity() / 100 * gc_trigger_percent;
+
+	mark_stack = mmap(NULL, heap_max_objects() * sizeof(*mark_stack),
+			  PROT_READ | PROT_WRITE,
+			  MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (mark_stack == MAP_FAILED)
+		die("Couldn't allocate GC mark stack");
+
+	if (pthread_spin_init(&mark_stack_lock, PTHREAD_PROCESS_PRIVATE) != 0)
+		die("pthread_spin_init");
+
+#ifdef CONFIG_X86_64
+	if (gc_concurrent_mark) {
+		warn("concurrent marking is not supported on this architecture");
+		gc_concurrent_mark = false;
+	}
+#endif
+
+	if (gc_concurrent_mark) {
+		gc_satb_log = mmap(NULL, heap_max_objects() * sizeof(*gc_satb_log),
+				   PROT_READ | PROT_WRITE,
+				   MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+		if (gc_satb_log == MAP_FAILED)
+			die("Couldn't allocate GC SATB log");
+	}
+
+	gc_init_workers();
+
 	if (pthread_create(&gc_thread_id, NULL, &gc_thread, NULL))
 		die("Couldn't create GC thread");
 }
 
+/*
+ * Sets up the allocation buffer of the current thread. Must be called after
+ * the thread is attached to the VM.
+ */
+void gc_attach_thread(void)
+{
+	vm_thread_self()->tlab = &current_tlab;
+}
+
+/*
+ * Returns the allocation buffer of the current thread to the heap before
+ * the thread exits.
+ */
+void gc_detach_thread(void)
+{
+	heap_lock();
+	heap_retire_tlab(&current_tlab);
+	vm_thread_self()->tlab = NULL;
+	heap_unlock();
+}
+
+static void *gc_tlab_bump(struct heap_tlab *tlab, size_t size)
+{
+	void *p;
+
+	in_tlab_bump = true;
+	barrier();
+
+	p = heap_tlab_bump(tlab, size);
+
+	barrier();
+	in_tlab_bump = false;
+
+	if (suspend_deferred) {
+		suspend_deferred = false;
+
+		if (pthread_kill(pthread_self(), SIGUSR1) != 0)
+			die("pthread_kill");
+	}
+
+	return p;
+}
+
+/*
+ * Threads bump allocate from their TLAB without the heap lock. The world
+ * is stopped with the heap lock held, so only the slow path, which takes
+ * it, can not be interrupted by a collection. The bump defers a suspend
+ * signal instead because a thread stopped half way would leave a chunk
+ * header behind that heap_retire_tlab() overwrites.
+ */
+static void *gc_heap_alloc(size_t size)
+{
+	struct vm_thread *self = vm_thread_self();
+	void *p;
+
+	if (!self || !self->tlab)
+		return heap_alloc(size);
+
+	p = gc_tlab_bump(self->tlab, size);
+	if (p)
+		return p;
+
+	return heap_tlab_alloc(self->tlab, size);
+}
+
 void *gc_alloc(size_t size)
+{
+	void *p;
+
+	/* Mutators keep allocating while a concurrent cycle is running. */
+	if (gc_enabled && !gc_reclaim_in_progress) {
+		if (heap_used() >= gc_trigger_limit)
+			gc_start(GC_REASON_OCCUPANCY, size);
+		else if (heap_young() >= gc_nursery_size)
+			gc_start(GC_REASON_NURSERY, size);
+	}
+
+	p = gc_heap_alloc(size);
+	if (p)
+		return p;
+
+	if (gc_enabled) {
+		gc_start(GC_REASON_ALLOC_FAILURE, size);
+
+		p = gc_heap_alloc(size);
+		if (p)
+			return p;
+	}
+
+	while (heap_expand(size)) {
+		p = gc_heap_alloc(size);
+		if (p)
+			return p;
+	}
+
+	return NULL;
+}
+
+void gc_collect(void)
 {
 	if (gc_enabled)
-		gc_start();
+		gc_start(GC_REASON_EXPLICIT, 0);
+}
+
+void gc_print_stats(void)
+{
+	unsigned long nr_stops = 0;
+
+	for (unsigned int i = 0; i < GC_NR_TTSP_BUCKETS; i++)
+		nr_stops += gc_ttsp_histogram[i];
 
-	return zalloc(size);
+	fprintf(stderr, "[GC: time to safepoint histogram, %lu stops]\n", nr_stops);
+
+	for (unsigned int i = 0; i < GC_NR_TTSP_BUCKETS; i++) {
+		unsigned long lo = i ? 1UL << (i - 1) : 0;
+
+		if (!gc_ttsp_histogram[i])
+			continue;
+
+		if (i == GC_NR_TTSP_BUCKETS - 1)
+			fprintf(stderr, "[GC:   %6lu us and more: %lu]\n",
+				lo, gc_ttsp_histogram[i]);
+		else
+			fprintf(stderr, "[GC:   %6lu - %6lu us: %lu]\n",
+				lo, 1UL << i, gc_ttsp_histogram[i]);
+	}
+}
+
+/*
+ * Write barrier for reference stores done by the VM itself. JIT compiled
+ * code marks the card inline.
+ */
+void gc_write_barrier(struct vm_object *obj)
+{
+	heap_mark_card(obj);
+}
+
+/*
+ * Slow path of gc_satb_barrier(). The heap lock keeps the collector from
+ * ending the cycle while the object is being logged.
+ */
+void gc_satb_log_object(struct vm_object *obj)
+{
+	heap_lock();
+
+	if (gc_marking) {
+		obj = heap_lookup_object(obj);
+		if (obj && heap_mark_object(obj))
+			gc_satb_log_push(obj);
+	}
+
+	heap_unlock();
+}
+
+/*
+ * Registers @root as a location which holds a reference that must be kept
+ * alive by the GC.
+ */
+void gc_register_root(struct vm_object **root)
+{
+	heap_lock();
+
+	for (unsigned int i = 0; i < nr_gc_roots; i++) {
+		if (gc_roots[i] == root)
+			goto out;
+	}
+
+	if (nr_gc_roots == GC_MAX_ROOTS)
+		die("too many GC roots");
+
+	gc_roots[nr_gc_roots++] = root;
+out:
+	heap_unlock();
 }
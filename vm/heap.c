@@ -0,0 +1,824 @@
+/*
+ * Garbage collected heap.
+ *
+ * This file is released under the GPL version 2. Please refer to the file
+ * LICENSE for details.
+ *
+ * The heap is a single contiguous region reserved at startup. It is always
+ * parsable: [heap_start, heap_top) is a sequence of chunks, each starting
+ * with a struct heap_header, and everything above heap_top is untouched
+ * wilderness. Free chunks are kept in segregated lists indexed by the
+ * binary logarithm of their size.
+ *
+ * The whole -Xmx sized region is reserved up front but allocations are
+ * limited to the current heap capacity which starts at -Xms and is adjusted
+ * by the collector after every cycle.
+ *
+ * Threads allocate most objects from thread-local allocation buffers
+ * (TLABs) which are carved from the heap as a whole. Allocating from a
+ * TLAB does not take the heap lock, only refilling it does. A TLAB is accounted as
+ * used memory in full until it is retired, at which point its unused tail
+ * becomes a free chunk.
+ *
+ * Objects are never moved because the stacks are scanned conservatively.
+ * The heap is still generational: chunks allocated since the last
+ * collection are young and are remembered as a list of address ranges. A
+ * minor collection only marks and sweeps young objects and every survivor
+ * is promoted by setting HEAP_CHUNK_OLD in its header. Old objects are
+ * treated as live until the next major collection. References from old
+ * objects to young ones are found through a card table which is dirtied by
+ * the write barrier.
+ *
+ * A major collection can also mark concurrently with the mutators. The
+ * object start bitmap is built when the marking starts and stays valid
+ * because nothing is freed until the sweep. Objects allocated in the
+ * meantime are not in the bitmap; they are allocated with the mark bit set
+ * instead and therefore survive the cycle.
+ */
+
+#include "arch/atomic.h"
+
+#include "lib/bitset.h"
+
+#include "vm/system.h"
+#include "vm/heap.h"
+#include "vm/die.h"
+
+#include <sys/mman.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+struct heap_free_chunk {
+	struct heap_header	hdr;
+	struct heap_free_chunk	*next;
+};
+
+struct heap_region {
+	void			*start;
+	void			*end;
+};
+
+#define NR_HEAP_BINS	BITS_PER_LONG
+
+unsigned long heap_min_size = HEAP_DEFAULT_MIN_SIZE;
+unsigned long heap_max_size = HEAP_DEFAULT_MAX_SIZE;
+
+/* Current heap capacity and the number of bytes in allocated chunks. */
+static unsigned long heap_size;
+static unsigned long heap_used_size;
+
+static void *heap_start;
+static void *heap_end;
+static void *heap_top;
+
+/* One bit for every HEAP_ALIGN bytes; set for each allocated chunk. */
+static unsigned long *heap_starts;
+
+static struct heap_free_chunk *heap_bins[NR_HEAP_BINS];
+
+/* Memory allocated since the last collection. */
+static struct heap_region *heap_young_regions;
+static unsigned long nr_heap_young_regions;
+static unsigned long heap_young_size;
+
+/* One byte for every HEAP_CARD_SIZE bytes; non-zero for dirty cards. */
+static unsigned char *heap_cards;
+unsigned char *heap_card_base;
+
+/* Header bits which tell heap_mark_object() that an object is live. */
+static unsigned long heap_live_mask = HEAP_CHUNK_MARK;
+
+unsigned long heap_alloc_bits;
+
+static pthread_mutex_t heap_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void *heap_map(unsigned long size)
+{
+	void *p;
+
+	p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+	if (p == MAP_FAILED)
+		return NULL;
+
+	return p;
+}
+
+int heap_init(void)
+{
+	if (heap_min_size > heap_max_size)
+		return -EINVAL;
+
+	heap_max_size = ALIGN(heap_max_size, (unsigned long) getpagesize());
+	heap_size = heap_min_size;
+
+	heap_start = heap_map(heap_max_size);
+	if (!heap_start)
+		return -1;
+
+	heap_starts = heap_map(heap_max_size / HEAP_ALIGN / 8);
+	if (!heap_starts)
+		return -1;
+
+	heap_cards = heap_map(heap_max_size >> HEAP_CARD_SHIFT);
+	if (!heap_cards)
+		return -1;
+
+	heap_card_base = heap_cards - ((unsigned long) heap_start >> HEAP_CARD_SHIFT);
+
+	heap_young_regions = heap_map(heap_max_objects() * sizeof(struct heap_region));
+	if (!heap_young_regions)
+		return -1;
+
+	heap_end = heap_start + heap_max_size;
+	heap_top = heap_start;
+
+	heap_used_size = 0;
+	memset(heap_bins, 0, sizeof(heap_bins));
+
+	nr_heap_young_regions = 0;
+	heap_young_size = 0;
+	heap_live_mask = HEAP_CHUNK_MARK;
+	heap_alloc_bits = 0;
+
+	return 0;
+}
+
+void heap_lock(void)
+{
+	if (pthread_mutex_lock(&heap_mutex) != 0)
+		die("pthread_mutex_lock");
+}
+
+void heap_unlock(void)
+{
+	if (pthread_mutex_unlock(&heap_mutex) != 0)
+		die("pthread_mutex_unlock");
+}
+
+static unsigned int heap_bin(unsigned long size)
+{
+	return BITS_PER_LONG - 1 - __builtin_clzl(size);
+}
+
+static void heap_free_chunk(struct heap_header *hdr, unsigned long size)
+{
+	struct heap_free_chunk *chunk = (struct heap_free_chunk *) hdr;
+	unsigned int bin;
+
+	chunk->hdr.word	= size | HEAP_CHUNK_FREE;
+
+	/*
+	 * Retired TLABs can leave gaps which are too small to be linked.
+	 * They are only kept parsable until the sweeper coalesces them.
+	 */
+	if (size < HEAP_MIN_CHUNK)
+		return;
+
+	bin = heap_bin(size);
+	chunk->next	= heap_bins[bin];
+	heap_bins[bin]	= chunk;
+}
+
+static struct heap_header *
+heap_split_chunk(struct heap_header *hdr, unsigned long chunk_size,
+		 unsigned long size)
+{
+	unsigned long rest = chunk_size - size;
+
+	if (rest < HEAP_MIN_CHUNK) {
+		hdr->word = chunk_size;
+		return hdr;
+	}
+
+	heap_free_chunk((void *) hdr + size, rest);
+	hdr->word = size;
+
+	return hdr;
+}
+
+static struct heap_header *heap_take_free_chunk(unsigned long size)
+{
+	for (unsigned int bin = heap_bin(size); bin < NR_HEAP_BINS; bin++) {
+		struct heap_free_chunk **p = &heap_bins[bin];
+
+		while (*p) {
+			struct heap_free_chunk *chunk = *p;
+			unsigned long chunk_size = heap_chunk_size(&chunk->hdr);
+
+			if (chunk_size >= size) {
+				*p = chunk->next;
+				return heap_split_chunk(&chunk->hdr, chunk_size, size);
+			}
+
+			p = &chunk->next;
+		}
+	}
+
+	return NULL;
+}
+
+static struct heap_header *heap_extend(unsigned long size)
+{
+	struct heap_header *hdr;
+
+	if (size > (unsigned long) (heap_end - heap_top))
+		return NULL;
+
+	hdr = heap_top;
+	hdr->word = size;
+	heap_top += size;
+
+	return hdr;
+}
+
+static int heap_region_cmp(const void *p1, const void *p2)
+{
+	const struct heap_region *r1 = p1, *r2 = p2;
+
+	if (r1->start < r2->start)
+		return -1;
+
+	return r1->start > r2->start;
+}
+
+/*
+ * Sorts the young regions and merges the ones which overlap. Chunks carved
+ * from the unused tail of a retired TLAB are recorded a second time.
+ */
+static void heap_merge_young_regions(void)
+{
+	unsigned long i, nr = 0;
+
+	if (!nr_heap_young_regions)
+		return;
+
+	qsort(heap_young_regions, nr_heap_young_regions,
+	      sizeof(struct heap_region), heap_region_cmp);
+
+	for (i = 1; i < nr_heap_young_regions; i++) {
+		struct heap_region *this = &heap_young_regions[i];
+		struct heap_region *last = &heap_young_regions[nr];
+
+		if (this->start > last->end) {
+			heap_young_regions[++nr] = *this;
+			continue;
+		}
+
+		if (this->end > last->end)
+			last->end = this->end;
+	}
+
+	nr_heap_young_regions = nr + 1;
+}
+
+static void heap_add_young(struct heap_header *hdr, unsigned long size)
+{
+	struct heap_region *last;
+
+	heap_young_size += size;
+
+	if (nr_heap_young_regions) {
+		last = &heap_young_regions[nr_heap_young_regions - 1];
+
+		if (last->end == (void *) hdr) {
+			last->end += size;
+			return;
+		}
+	}
+
+	if (nr_heap_young_regions == heap_max_objects())
+		heap_merge_young_regions();
+
+	last = &heap_young_regions[nr_heap_young_regions++];
+	last->start = hdr;
+	last->end = (void *) hdr + size;
+}
+
+static struct heap_header *__heap_alloc(unsigned long chunk_size)
+{
+	struct heap_header *hdr;
+
+	if (heap_used_size + chunk_size > heap_size)
+		return NULL;
+
+	hdr = heap_take_free_chunk(chunk_size);
+	if (!hdr)
+		hdr = heap_extend(chunk_size);
+
+	if (hdr) {
+		hdr->word |= heap_alloc_bits;
+		heap_used_size += heap_chunk_size(hdr);
+		heap_add_young(hdr, heap_chunk_size(hdr));
+	}
+
+	return hdr;
+}
+
+/*
+ * Returns zeroed memory for an object of @size bytes or NULL if the heap is
+ * exhausted. The memory is cleared with heap_mutex held so that the
+ * collector never sees a chunk with stale contents.
+ */
+void *heap_alloc(size_t size)
+{
+	struct heap_header *hdr;
+
+	heap_lock();
+
+	hdr = __heap_alloc(heap_alloc_size(size));
+	if (hdr)
+		memset(hdr + 1, 0, heap_chunk_size(hdr) - sizeof(*hdr));
+
+	heap_unlock();
+
+	if (!hdr)
+		return NULL;
+
+	return hdr + 1;
+}
+
+/*
+ * Returns the unused part of @tlab to the heap. Must be called with
+ * heap_lock() held, either by the owner or while the world is stopped.
+ */
+void heap_retire_tlab(struct heap_tlab *tlab)
+{
+	unsigned long rest;
+
+	if (!tlab->top)
+		return;
+
+	rest = tlab->end - tlab->top;
+	if (rest) {
+		heap_free_chunk(tlab->top, rest);
+		heap_used_size -= rest;
+		heap_young_size -= rest;
+	}
+
+	tlab->top = NULL;
+	tlab->end = NULL;
+}
+
+static bool heap_refill_tlab(struct heap_tlab *tlab)
+{
+	struct heap_header *hdr;
+	unsigned long size;
+
+	heap_retire_tlab(tlab);
+
+	hdr = __heap_alloc(HEAP_TLAB_SIZE);
+	if (!hdr)
+		return false;
+
+	size = heap_chunk_size(hdr);
+	memset(hdr, 0, size);
+
+	tlab->top = hdr;
+	tlab->end = (void *) hdr + size;
+
+	return true;
+}
+
+/*
+ * Allocates an object of @size bytes from @tlab without taking heap_lock().
+ * Returns NULL if it does not fit. The caller must not be stopped for a
+ * collection in the middle of this, see gc_heap_alloc().
+ */
+void *heap_tlab_bump(struct heap_tlab *tlab, size_t size)
+{
+	unsigned long chunk_size = heap_alloc_size(size);
+	struct heap_header *hdr;
+
+	if (chunk_size > (unsigned long) (tlab->end - tlab->top))
+		return NULL;
+
+	hdr = tlab->top;
+	hdr->word = chunk_size | heap_alloc_bits;
+	tlab->top += chunk_size;
+
+	return hdr + 1;
+}
+
+/*
+ * Allocates an object of @size bytes from @tlab, refilling it from the heap
+ * when it is exhausted. Objects which are large compared to a TLAB are
+ * allocated from the heap directly. Returns zeroed memory or NULL if the
+ * heap is exhausted. This is the slow path of heap_tlab_bump().
+ */
+void *heap_tlab_alloc(struct heap_tlab *tlab, size_t size)
+{
+	unsigned long chunk_size = heap_alloc_size(size);
+	struct heap_header *hdr;
+
+	heap_lock();
+
+	if (chunk_size > (unsigned long) (tlab->end - tlab->top)) {
+		if (chunk_size > HEAP_TLAB_SIZE / 4 || !heap_refill_tlab(tlab)) {
+			hdr = __heap_alloc(chunk_size);
+			if (hdr)
+				memset(hdr + 1, 0, heap_chunk_size(hdr) - sizeof(*hdr));
+			goto out_unlock;
+		}
+	}
+
+	hdr = tlab->top;
+	hdr->word = chunk_size | heap_alloc_bits;
+	tlab->top += chunk_size;
+
+out_unlock:
+	heap_unlock();
+
+	if (!hdr)
+		return NULL;
+
+	return hdr + 1;
+}
+
+unsigned long heap_used(void)
+{
+	return heap_used_size;
+}
+
+/*
+ * Returns the number of bytes allocated since the last collection.
+ */
+unsigned long heap_young(void)
+{
+	return heap_young_size;
+}
+
+unsigned long heap_capacity(void)
+{
+	return heap_size;
+}
+
+/*
+ * Sets the heap capacity to @size bytes, clamped to [-Xms, -Xmx].
+ */
+void heap_resize(unsigned long size)
+{
+	heap_lock();
+	heap_size = min(max(size, heap_min_size), heap_max_size);
+	heap_unlock();
+}
+
+/*
+ * Grows the heap capacity so that an allocation of @size bytes fits.
+ * Returns false if the heap is already at its maximum size.
+ */
+bool heap_expand(size_t size)
+{
+	bool ret = false;
+
+	heap_lock();
+
+	if (heap_size < heap_max_size) {
+		size = heap_used_size + size + sizeof(struct heap_header);
+
+		heap_size = min(max(heap_size * 2, size), heap_max_size);
+		ret = true;
+	}
+
+	heap_unlock();
+
+	return ret;
+}
+
+static unsigned long heap_index(void *p)
+{
+	return (p - heap_start) / HEAP_ALIGN;
+}
+
+#define heap_for_each_chunk(this)					\
+	for (this = heap_start; (void *) this < heap_top;		\
+	     this = (void *) this + heap_chunk_size(this))
+
+/*
+ * Builds the object start bitmap which is used to tell whether a word found
+ * during root scanning points to an object.
+ */
+void heap_prepare_collection(void)
+{
+	struct heap_header *hdr;
+
+	memset(heap_starts, 0, DIV_ROUND_UP(heap_index(heap_top), 8));
+
+	heap_for_each_chunk(hdr) {
+		if (!(hdr->word & HEAP_CHUNK_FREE))
+			set_bit(heap_starts, heap_index(hdr));
+	}
+
+	heap_live_mask = HEAP_CHUNK_MARK;
+}
+
+#define heap_for_each_region_chunk(this, region)			\
+	for (this = (region)->start; (void *) this < (region)->end;	\
+	     this = (void *) this + heap_chunk_size(this))
+
+/*
+ * Prepares a minor collection. The object start bitmap already covers the
+ * old objects so only the young chunks are added to it. Old objects are
+ * considered marked.
+ */
+void heap_prepare_minor_collection(void)
+{
+	struct heap_header *hdr;
+
+	heap_merge_young_regions();
+
+	for (unsigned long i = 0; i < nr_heap_young_regions; i++) {
+		heap_for_each_region_chunk(hdr, &heap_young_regions[i]) {
+			if (!(hdr->word & HEAP_CHUNK_FREE))
+				set_bit(heap_starts, heap_index(hdr));
+		}
+	}
+
+	heap_live_mask = HEAP_CHUNK_MARK | HEAP_CHUNK_OLD;
+}
+
+/*
+ * Prepares a major collection which marks while the mutators run. Objects
+ * allocated from now on until the sweep are considered live.
+ */
+void heap_prepare_concurrent_collection(void)
+{
+	heap_prepare_collection();
+	heap_alloc_bits = HEAP_CHUNK_MARK;
+}
+
+/*
+ * Ends a concurrent collection without sweeping. The mark bits are cleared
+ * so that the next collection starts from a clean heap.
+ */
+void heap_abort_collection(void)
+{
+	struct heap_header *hdr;
+
+	heap_for_each_chunk(hdr)
+		hdr->word &= ~HEAP_CHUNK_MARK;
+
+	heap_alloc_bits = 0;
+}
+
+/*
+ * Returns the last allocated chunk which starts at or below @p, if any.
+ */
+static struct heap_header *heap_find_start(void *p)
+{
+	unsigned long idx, word, bits;
+
+	idx	= heap_index(p);
+	word	= idx / BITS_PER_LONG;
+	bits	= heap_starts[word] & (~0UL >> (BITS_PER_LONG - 1 - idx % BITS_PER_LONG));
+
+	while (!bits) {
+		if (word == 0)
+			return NULL;
+
+		bits = heap_starts[--word];
+	}
+
+	idx = word * BITS_PER_LONG + BITS_PER_LONG - 1 - __builtin_clzl(bits);
+
+	return heap_start + idx * HEAP_ALIGN;
+}
+
+/*
+ * Returns @p if it points to the beginning of an allocated object.
+ */
+struct vm_object *heap_lookup_object(void *p)
+{
+	if (p < heap_start + sizeof(struct heap_header) || p >= heap_top)
+		return NULL;
+
+	if ((unsigned long) p & (HEAP_ALIGN - 1))
+		return NULL;
+
+	if (!test_bit(heap_starts, heap_index(p - sizeof(struct heap_header))))
+		return NULL;
+
+	return p;
+}
+
+/*
+ * Returns the allocated object which contains address @p, if any.
+ */
+struct vm_object *heap_lookup_interior(void *p)
+{
+	struct heap_header *hdr;
+
+	if (p < heap_start || p >= heap_top)
+		return NULL;
+
+	hdr = heap_find_start(p);
+	if (!hdr)
+		return NULL;
+
+	if (p >= (void *) hdr + heap_chunk_size(hdr))
+		return NULL;
+
+	return (struct vm_object *) (hdr + 1);
+}
+
+/*
+ * Atomically sets the mark bit of @obj. Returns true if the object was not
+ * marked before. Old objects count as marked during a minor collection.
+ */
+bool heap_mark_object(struct vm_object *obj)
+{
+	struct heap_header *hdr = heap_object_header(obj);
+	unsigned long word;
+
+	do {
+		word = hdr->word;
+
+		if (word & heap_live_mask)
+			return false;
+	} while (atomic_cmpxchg_ptr(&hdr->word, (void *) word,
+				    (void *) (word | HEAP_CHUNK_MARK)) != (void *) word);
+
+	return true;
+}
+
+/*
+ * Returns true if @obj survives the collection in progress. Only valid once
+ * marking has finished.
+ */
+bool heap_object_is_live(struct vm_object *obj)
+{
+	return heap_object_header(obj)->word & heap_live_mask;
+}
+
+/*
+ * Calls @fn for every old object which overlaps a dirty card and cleans the
+ * cards. Objects which span several dirty cards are visited only once.
+ */
+void heap_scan_dirty_cards(void (*fn)(struct vm_object *))
+{
+	unsigned char *card, *end;
+	void *next = heap_start;
+
+	end = heap_cards + DIV_ROUND_UP((unsigned long) (heap_top - heap_start), HEAP_CARD_SIZE);
+
+	for (card = heap_cards; card < end; card++) {
+		struct heap_header *hdr;
+		void *card_start, *card_end;
+
+		if (!*card)
+			continue;
+
+		*card = 0;
+
+		card_start = heap_start + (card - heap_cards) * HEAP_CARD_SIZE;
+		card_end = card_start + HEAP_CARD_SIZE;
+
+		hdr = heap_find_start(card_start);
+		if (!hdr || (void *) hdr < next)
+			hdr = next;
+
+		for (; (void *) hdr < card_end && (void *) hdr < heap_top;
+		     hdr = (void *) hdr + heap_chunk_size(hdr)) {
+			if ((void *) hdr + heap_chunk_size(hdr) <= card_start)
+				continue;
+
+			if ((hdr->word & (HEAP_CHUNK_FREE | HEAP_CHUNK_OLD)) == HEAP_CHUNK_OLD)
+				fn((struct vm_object *) (hdr + 1));
+		}
+
+		next = hdr;
+	}
+}
+
+static void heap_clear_cards(void *old_top)
+{
+	memset(heap_cards, 0, DIV_ROUND_UP((unsigned long) (old_top - heap_start), HEAP_CARD_SIZE));
+}
+
+static void heap_forget_young(void)
+{
+	nr_heap_young_regions = 0;
+	heap_young_size = 0;
+	heap_live_mask = HEAP_CHUNK_MARK;
+}
+
+static void heap_release_tail(void *old_top)
+{
+	unsigned long page_size = getpagesize();
+	unsigned long start, end;
+
+	start	= ALIGN((unsigned long) heap_top, page_size);
+	end	= ALIGN((unsigned long) old_top, page_size);
+
+	if (start < end)
+		madvise((void *) start, end - start, MADV_DONTNEED);
+}
+
+/*
+ * Frees all unmarked chunks, coalescing adjacent free space, and promotes
+ * live objects to the old generation. A free run at the end of the heap is
+ * returned to the wilderness. Returns the number of bytes reclaimed.
+ */
+unsigned long heap_sweep(void)
+{
+	struct heap_header *hdr, *run = NULL;
+	unsigned long freed = 0;
+	void *old_top;
+
+	memset(heap_bins, 0, sizeof(heap_bins));
+	heap_used_size = 0;
+
+	heap_for_each_chunk(hdr) {
+		if (hdr->word & HEAP_CHUNK_MARK) {
+			hdr->word = (hdr->word & ~HEAP_CHUNK_MARK) | HEAP_CHUNK_OLD;
+			heap_used_size += heap_chunk_size(hdr);
+
+			if (run) {
+				heap_free_chunk(run, (void *) hdr - (void *) run);
+				run = NULL;
+			}
+			continue;
+		}
+
+		if (!(hdr->word & HEAP_CHUNK_FREE)) {
+			clear_bit(heap_starts, heap_index(hdr));
+			freed += heap_chunk_size(hdr);
+		}
+
+		if (!run)
+			run = hdr;
+	}
+
+	old_top = heap_top;
+
+	if (run) {
+		heap_top = run;
+		heap_release_tail(old_top);
+	}
+
+	heap_clear_cards(old_top);
+	heap_forget_young();
+	heap_alloc_bits = 0;
+
+	return freed;
+}
+
+/*
+ * Frees the unmarked young chunks and promotes the marked ones. Free space
+ * is only coalesced with dead young chunks because free chunks which are
+ * already on the free lists stay there. Returns the number of bytes
+ * reclaimed.
+ */
+unsigned long heap_sweep_young(void)
+{
+	unsigned long freed = 0;
+
+	for (unsigned long i = 0; i < nr_heap_young_regions; i++) {
+		struct heap_region *region = &heap_young_regions[i];
+		struct heap_header *hdr, *run = NULL;
+		void *old_top;
+
+		heap_for_each_region_chunk(hdr, region) {
+			if (hdr->word & (HEAP_CHUNK_MARK | HEAP_CHUNK_OLD)) {
+				hdr->word = (hdr->word & ~HEAP_CHUNK_MARK) | HEAP_CHUNK_OLD;
+			} else if (!(hdr->word & HEAP_CHUNK_FREE)) {
+				clear_bit(heap_starts, heap_index(hdr));
+				freed += heap_chunk_size(hdr);
+
+				if (!run)
+					run = hdr;
+				continue;
+			}
+
+			if (run) {
+				heap_free_chunk(run, (void *) hdr - (void *) run);
+				run = NULL;
+			}
+		}
+
+		if (!run)
+			continue;
+
+		if (region->end == heap_top) {
+			old_top = heap_top;
+			heap_top = run;
+			heap_release_tail(old_top);
+			continue;
+		}
+
+		heap_free_chunk(run, region->end - (void *) run);
+	}
+
+	heap_used_size -= freed;
+	heap_forget_young();
+
+	return freed;
+}
+
+unsigned long heap_max_objects(void)
+{
+	return heap_max_size / HEAP_MIN_CHUNK;
+}
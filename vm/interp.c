@@ -0,0 +1,1655 @@
+/*
+ * Bytecode interpreter
+ *
+ * This file is released under the GPL version 2. Please refer to the file
+ * LICENSE for details.
+ *
+ * Class initializers run exactly once so compiling them is mostly wasted
+ * time. They are executed by this interpreter instead, together with the
+ * static, private and constructor methods they call for as long as those
+ * are cold. A method is handed off to the JIT once it has been called
+ * INTERP_MAX_INVOCATIONS times or is compiled already. Virtual and
+ * interface calls always go through vm_call_method_a() and friends. The
+ * trampoline also interprets methods while a compiler thread compiles them,
+ * see jit_magic_trampoline().
+ *
+ * Only methods without exception handlers, monitors and subroutines are
+ * interpreted so an exception always leaves the interpreted method. The
+ * interpreter stack lives on the native stack which the GC scans
+ * conservatively. Interpreted frames are kept on a per-thread list which
+ * get_intermediate_stack_trace() merges into Java stack traces. Other stack
+ * walkers do not know about them so methods which call into
+ * caller-sensitive classes are compiled instead.
+ * Calls which pass or return float or double values are left to compiled
+ * code because native_call() can not return them.
+ */
+
+#include "jit/compilation-unit.h"
+#include "jit/compiler.h"
+#include "jit/emulate.h"
+#include "jit/exception.h"
+
+#include "vm/bytecode.h"
+#include "vm/bytecodes.h"
+#include "vm/call.h"
+#include "vm/class.h"
+#include "vm/classloader.h"
+#include "vm/die.h"
+#include "vm/interp.h"
+#include "vm/method.h"
+#include "vm/object.h"
+#include "vm/opcodes.h"
+#include "vm/preload.h"
+#include "vm/string.h"
+#include "vm/system.h"
+
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Cold callees are interpreted until they have been called this often. */
+#define INTERP_MAX_INVOCATIONS	16
+
+/* A loop iteration counts this much less than a call. */
+#define INTERP_BACKEDGE_RATIO	16
+
+/* Deeper calls go to compiled code to bound the native stack usage. */
+#define INTERP_MAX_DEPTH	32
+
+bool opt_interpreter = true;
+
+static __thread unsigned int interp_depth;
+
+static __thread struct interp_frame *interp_frames;
+
+struct interp_frame *interp_current_frame(void)
+{
+	return interp_frames;
+}
+
+/*
+ * Longs and doubles take two slots like in the JVM specification so that
+ * the arguments of a call can be passed to native_call() as is. Unlike
+ * jfloat and jdouble, which hold the bit patterns, slots hold native
+ * floating point values.
+ */
+union slot {
+	jint			i;
+	float			f;
+	struct vm_object	*l;
+	unsigned long		raw;
+};
+
+static inline jlong slot_get_long(const union slot *s)
+{
+	jlong value;
+
+	memcpy(&value, s, sizeof(value));
+
+	return value;
+}
+
+static inline void slot_set_long(union slot *s, jlong value)
+{
+	memcpy(s, &value, sizeof(value));
+}
+
+static inline double slot_get_double(const union slot *s)
+{
+	double value;
+
+	memcpy(&value, s, sizeof(value));
+
+	return value;
+}
+
+static inline void slot_set_double(union slot *s, double value)
+{
+	memcpy(s, &value, sizeof(value));
+}
+
+static unsigned int vm_type_slots(enum vm_type type)
+{
+	switch (type) {
+	case J_VOID:
+		return 0;
+	case J_LONG:
+	case J_DOUBLE:
+		return 2;
+	default:
+		return 1;
+	}
+}
+
+static void slot_to_jvalue(const union slot *s, enum vm_type type, union jvalue *value)
+{
+	switch (type) {
+	case J_BYTE:
+		value->b = s->i;
+		break;
+	case J_BOOLEAN:
+		value->z = s->i;
+		break;
+	case J_CHAR:
+		value->c = s->i;
+		break;
+	case J_SHORT:
+		value->s = s->i;
+		break;
+	case J_INT:
+		value->i = s->i;
+		break;
+	case J_FLOAT:
+		value->f = s->i;
+		break;
+	case J_LONG:
+		value->j = slot_get_long(s);
+		break;
+	case J_DOUBLE:
+		value->d = slot_get_long(s);
+		break;
+	case J_REFERENCE:
+		value->l = s->l;
+		break;
+	default:
+		break;
+	}
+}
+
+static void jvalue_to_slot(union slot *s, enum vm_type type, const union jvalue *value)
+{
+	switch (type) {
+	case J_BYTE:
+		s->i = value->b;
+		break;
+	case J_BOOLEAN:
+		s->i = value->z;
+		break;
+	case J_CHAR:
+		s->i = value->c;
+		break;
+	case J_SHORT:
+		s->i = value->s;
+		break;
+	case J_INT:
+		s->i = value->i;
+		break;
+	case J_FLOAT:
+		s->i = value->f;
+		break;
+	case J_LONG:
+		slot_set_long(s, value->j);
+		break;
+	case J_DOUBLE:
+		slot_set_long(s, value->d);
+		break;
+	case J_REFERENCE:
+		s->l = value->l;
+		break;
+	default:
+		break;
+	}
+}
+
+static void get_static(struct vm_field *vmf, union jvalue *value)
+{
+	switch (vm_field_type(vmf)) {
+	case J_BYTE:
+		value->b = static_field_get_byte(vmf);
+		break;
+	case J_BOOLEAN:
+		value->z = static_field_get_boolean(vmf);
+		break;
+	case J_CHAR:
+		value->c = static_field_get_char(vmf);
+		break;
+	case J_SHORT:
+		value->s = static_field_get_short(vmf);
+		break;
+	case J_INT:
+		value->i = static_field_get_int(vmf);
+		break;
+	case J_FLOAT:
+		value->f = static_field_get_float(vmf);
+		break;
+	case J_LONG:
+		value->j = static_field_get_long(vmf);
+		break;
+	case J_DOUBLE:
+		value->d = static_field_get_double(vmf);
+		break;
+	case J_REFERENCE:
+		value->l = static_field_get_object(vmf);
+		break;
+	default:
+		break;
+	}
+}
+
+static void put_static(struct vm_field *vmf, const union jvalue *value)
+{
+	switch (vm_field_type(vmf)) {
+	case J_BYTE:
+		static_field_set_byte(vmf, value->b);
+		break;
+	case J_BOOLEAN:
+		static_field_set_boolean(vmf, value->z);
+		break;
+	case J_CHAR:
+		static_field_set_char(vmf, value->c);
+		break;
+	case J_SHORT:
+		static_field_set_short(vmf, value->s);
+		break;
+	case J_INT:
+		static_field_set_int(vmf, value->i);
+		break;
+	case J_FLOAT:
+		static_field_set_float(vmf, value->f);
+		break;
+	case J_LONG:
+		static_field_set_long(vmf, value->j);
+		break;
+	case J_DOUBLE:
+		static_field_set_double(vmf, value->d);
+		break;
+	case J_REFERENCE:
+		static_field_set_object(vmf, value->l);
+		break;
+	default:
+		break;
+	}
+}
+
+static void get_field(struct vm_object *obj, struct vm_field *vmf, union jvalue *value)
+{
+	switch (vm_field_type(vmf)) {
+	case J_BYTE:
+		value->b = field_get_byte(obj, vmf);
+		break;
+	case J_BOOLEAN:
+		value->z = field_get_boolean(obj, vmf);
+		break;
+	case J_CHAR:
+		value->c = field_get_char(obj, vmf);
+		break;
+	case J_SHORT:
+		value->s = field_get_short(obj, vmf);
+		break;
+	case J_INT:
+		value->i = field_get_int(obj, vmf);
+		break;
+	case J_FLOAT:
+		value->f = field_get_float(obj, vmf);
+		break;
+	case J_LONG:
+		value->j = field_get_long(obj, vmf);
+		break;
+	case J_DOUBLE:
+		value->d = field_get_double(obj, vmf);
+		break;
+	case J_REFERENCE:
+		value->l = field_get_object(obj, vmf);
+		break;
+	default:
+		break;
+	}
+}
+
+static void put_field(struct vm_object *obj, struct vm_field *vmf, const union jvalue *value)
+{
+	switch (vm_field_type(vmf)) {
+	case J_BYTE:
+		field_set_byte(obj, vmf, value->b);
+		break;
+	case J_BOOLEAN:
+		field_set_boolean(obj, vmf, value->z);
+		break;
+	case J_CHAR:
+		field_set_char(obj, vmf, value->c);
+		break;
+	case J_SHORT:
+		field_set_short(obj, vmf, value->s);
+		break;
+	case J_INT:
+		field_set_int(obj, vmf, value->i);
+		break;
+	case J_FLOAT:
+		field_set_float(obj, vmf, value->f);
+		break;
+	case J_LONG:
+		field_set_long(obj, vmf, value->j);
+		break;
+	case J_DOUBLE:
+		field_set_double(obj, vmf, value->d);
+		break;
+	case J_REFERENCE:
+		field_set_object(obj, vmf, value->l);
+		break;
+	default:
+		break;
+	}
+}
+
+static jint interp_d2i(double value)
+{
+	if (isnan(value))
+		return 0;
+
+	if (value >= (double) INT_MAX)
+		return INT_MAX;
+
+	if (value <= (double) INT_MIN)
+		return INT_MIN;
+
+	return (jint) value;
+}
+
+static jlong interp_d2l(double value)
+{
+	if (isnan(value))
+		return 0;
+
+	if (value >= (double) LLONG_MAX)
+		return LLONG_MAX;
+
+	if (value <= (double) LLONG_MIN)
+		return LLONG_MIN;
+
+	return (jlong) value;
+}
+
+static bool check_null(struct vm_object *obj)
+{
+	if (obj)
+		return true;
+
+	signal_new_exception(vm_java_lang_NullPointerException, NULL);
+
+	return false;
+}
+
+static bool check_array_access(struct vm_object *array, jint index)
+{
+	char index_str[32];
+
+	if (!check_null(array))
+		return false;
+
+	if ((uint32_t) index < (uint32_t) array->array_length)
+		return true;
+
+	snprintf(index_str, sizeof(index_str), "%d", index);
+	signal_new_exception(vm_java_lang_ArrayIndexOutOfBoundsException, index_str);
+
+	return false;
+}
+
+static struct vm_class *array_class_of(struct vm_class *class)
+{
+	struct vm_class *array_class;
+	char *name;
+	int err;
+
+	if (class->name[0] == '[')
+		err = asprintf(&name, "[%s", class->name);
+	else
+		err = asprintf(&name, "[L%s;", class->name);
+
+	if (err < 0) {
+		signal_new_exception(vm_java_lang_OutOfMemoryError, NULL);
+		return NULL;
+	}
+
+	array_class = classloader_load(class->classloader, name);
+	if (!array_class && !exception_occurred())
+		signal_new_exception(vm_java_lang_NoClassDefFoundError, name);
+
+	free(name);
+
+	return array_class;
+}
+
+static bool check_divisor(jlong divisor)
+{
+	if (divisor)
+		return true;
+
+	signal_new_exception(vm_java_lang_ArithmeticException, "division by zero");
+
+	return false;
+}
+
+/*
+ * Classes whose methods look at their caller. They would see the caller of
+ * the interpreted method instead.
+ */
+static const char *caller_sensitive_classes[] = {
+	"gnu/classpath/VMStackWalker",
+	"java/lang/Class",
+	"java/lang/ClassLoader",
+	"java/lang/Runtime",
+	"java/lang/System",
+	"java/lang/Thread",
+	"java/lang/reflect/",
+	"java/security/AccessController",
+	"java/util/ResourceBundle",
+	"java/util/logging/Logger",
+};
+
+static bool is_caller_sensitive(struct vm_class *vmc)
+{
+	for (unsigned int i = 0; i < ARRAY_SIZE(caller_sensitive_classes); i++) {
+		const char *name = caller_sensitive_classes[i];
+		size_t len = strlen(name);
+
+		if (name[len - 1] == '/') {
+			if (!strncmp(vmc->name, name, len))
+				return true;
+		} else if (!strcmp(vmc->name, name))
+			return true;
+	}
+
+	return false;
+}
+
+static bool type_has_floating_point(const char *type)
+{
+	for (; *type; type++) {
+		if (*type == 'L') {
+			type = strchr(type, ';');
+			if (!type)
+				return true;
+
+			continue;
+		}
+
+		if (*type == 'F' || *type == 'D')
+			return true;
+	}
+
+	return false;
+}
+
+static struct vm_method *
+resolve_invoke_target(struct vm_class *vmc, unsigned char opc, uint16_t idx)
+{
+	if (opc == OPC_INVOKEINTERFACE)
+		return vm_class_resolve_interface_method_recursive(vmc, idx);
+
+	return vm_class_resolve_method_recursive(vmc, idx);
+}
+
+static bool ldc_is_supported(struct vm_class *vmc, uint16_t idx)
+{
+	if (cafebabe_class_constant_index_invalid(vmc->class, idx))
+		return false;
+
+	switch (vmc->class->constant_pool[idx].tag) {
+	case CAFEBABE_CONSTANT_TAG_INTEGER:
+	case CAFEBABE_CONSTANT_TAG_FLOAT:
+	case CAFEBABE_CONSTANT_TAG_STRING:
+	case CAFEBABE_CONSTANT_TAG_LONG:
+	case CAFEBABE_CONSTANT_TAG_DOUBLE:
+		return true;
+	case CAFEBABE_CONSTANT_TAG_CLASS:
+		return vm_class_resolve_class(vmc, idx) != NULL;
+	default:
+		return false;
+	}
+}
+
+/*
+ * Resolves everything @code refers to at @pc, like the JIT does at compile
+ * time, so that the interpreter itself never fails to resolve.
+ */
+static bool insn_is_supported(struct vm_class *vmc, const unsigned char *code,
+			      unsigned long pc)
+{
+	struct vm_method *target;
+	unsigned char opc = code[pc];
+
+	switch (opc) {
+	case OPC_JSR:
+	case OPC_JSR_W:
+	case OPC_RET:
+	case OPC_MONITORENTER:
+	case OPC_MONITOREXIT:
+	case OPC_XXXUNUSEDXXX:
+		return false;
+	case OPC_WIDE:
+		return code[pc + 1] != OPC_RET;
+	case OPC_LDC:
+		return ldc_is_supported(vmc, code[pc + 1]);
+	case OPC_LDC_W:
+	case OPC_LDC2_W:
+		return ldc_is_supported(vmc, read_u16(&code[pc + 1]));
+	case OPC_GETSTATIC:
+	case OPC_PUTSTATIC:
+	case OPC_GETFIELD:
+	case OPC_PUTFIELD:
+		return vm_class_resolve_field_recursive(vmc, read_u16(&code[pc + 1])) != NULL;
+	case OPC_NEW:
+	case OPC_ANEWARRAY:
+	case OPC_CHECKCAST:
+	case OPC_INSTANCEOF:
+	case OPC_MULTIANEWARRAY:
+		return vm_class_resolve_class(vmc, read_u16(&code[pc + 1])) != NULL;
+	case OPC_INVOKEVIRTUAL:
+	case OPC_INVOKESPECIAL:
+	case OPC_INVOKESTATIC:
+	case OPC_INVOKEINTERFACE:
+		target = resolve_invoke_target(vmc, opc, read_u16(&code[pc + 1]));
+		if (!target)
+			return false;
+
+		if (type_has_floating_point(target->type))
+			return false;
+
+		return !is_caller_sensitive(target->class);
+	default:
+		return opc < OPC_BREAKPOINT;
+	}
+}
+
+/* The part of interp_can_execute() which only depends on the bytecode. */
+static bool method_is_interpretable(struct vm_method *vmm)
+{
+	const unsigned char *code = vmm->code_attribute.code;
+	unsigned long pc;
+
+	if (vm_method_is_native(vmm) || vm_method_is_abstract(vmm))
+		return false;
+
+	if (method_is_synchronized(vmm))
+		return false;
+
+	if (!vmm->code_attribute.code_length)
+		return false;
+
+	if (vmm->code_attribute.exception_table_length)
+		return false;
+
+	bytecode_for_each_insn(code, vmm->code_attribute.code_length, pc) {
+		if (insn_is_supported(vmm->class, code, pc))
+			continue;
+
+		/* The JIT reports resolution errors when it compiles the method. */
+		clear_exception();
+
+		return false;
+	}
+
+	return true;
+}
+
+bool interp_can_execute(struct vm_method *vmm)
+{
+	enum vm_method_interp interp;
+
+	/* Every invocation is traced by compiled code. */
+	if (!opt_interpreter || opt_trace_invoke)
+		return false;
+
+	if (interp_depth >= INTERP_MAX_DEPTH)
+		return false;
+
+	/*
+	 * The bytecode is scanned once. Threads which race here compute the
+	 * same verdict.
+	 */
+	interp = *(volatile enum vm_method_interp *) &vmm->interp;
+	if (interp == VM_METHOD_INTERP_UNKNOWN) {
+		if (method_is_interpretable(vmm))
+			interp = VM_METHOD_INTERP_YES;
+		else
+			interp = VM_METHOD_INTERP_NO;
+
+		*(volatile enum vm_method_interp *) &vmm->interp = interp;
+	}
+
+	return interp == VM_METHOD_INTERP_YES;
+}
+
+static unsigned long interp_hotness(struct compilation_unit *cu)
+{
+	return cu->nr_invocations + cu->nr_backedges / INTERP_BACKEDGE_RATIO;
+}
+
+/*
+ * Returns true if @vmm should be interpreted when called from interpreted
+ * code. Methods which are compiled or being compiled, or which have been
+ * called often enough, are handed off to the JIT.
+ */
+static bool interp_should_execute(struct vm_method *vmm)
+{
+	struct compilation_unit *cu = vmm->compilation_unit;
+	bool is_compiled;
+
+	if (vm_method_is_native(vmm) || vm_method_is_abstract(vmm))
+		return false;
+
+	if (pthread_mutex_trylock(&cu->mutex) != 0)
+		return false;
+
+	is_compiled = cu->is_compiled;
+	pthread_mutex_unlock(&cu->mutex);
+
+	if (is_compiled || interp_hotness(cu) >= INTERP_MAX_INVOCATIONS)
+		return false;
+
+	return interp_can_execute(vmm);
+}
+
+static bool interp_invoke(struct vm_class *vmc, unsigned char opc, uint16_t idx,
+			  union slot **sp)
+{
+	struct vm_object *this = NULL;
+	struct vm_method *target;
+	union jvalue result;
+	union slot *args;
+
+	target = resolve_invoke_target(vmc, opc, idx);
+	if (!target) {
+		signal_new_exception(vm_java_lang_NoSuchMethodError, NULL);
+		return false;
+	}
+
+	args = *sp - target->args_count;
+	*sp = args;
+
+	if (opc != OPC_INVOKESTATIC) {
+		this = args[0].l;
+
+		if (!check_null(this))
+			return false;
+	}
+
+	switch (opc) {
+	case OPC_INVOKESTATIC:
+		if (vm_class_ensure_init(target->class))
+			return false;
+		/* fall through */
+	case OPC_INVOKESPECIAL:
+		if (interp_should_execute(target))
+			interp_call_method(target, &args->raw, &result);
+		else
+			vm_call_method_a(target, &args->raw, &result);
+		break;
+	case OPC_INVOKEVIRTUAL:
+		if (method_is_virtual(target))
+			vm_call_method_this_a(target, this, &args->raw, &result);
+		else
+			vm_call_method_a(target, &args->raw, &result);
+		break;
+	case OPC_INVOKEINTERFACE: {
+		struct vm_method *impl;
+
+		impl = vm_class_get_method_recursive(this->class, target->name, target->type);
+		if (!impl || vm_method_is_abstract(impl)) {
+			signal_new_exception(vm_java_lang_NoSuchMethodError, target->name);
+			return false;
+		}
+
+		vm_call_method_this_a(impl, this, &args->raw, &result);
+		break;
+	}
+	}
+
+	if (exception_occurred())
+		return false;
+
+	jvalue_to_slot(*sp, target->return_type.vm_type, &result);
+	*sp += vm_type_slots(target->return_type.vm_type);
+
+	return true;
+}
+
+static bool interp_ldc(struct vm_class *vmc, uint16_t idx, union slot **sp)
+{
+	struct cafebabe_constant_pool *cp = &vmc->class->constant_pool[idx];
+	union slot *s = *sp;
+
+	switch (cp->tag) {
+	case CAFEBABE_CONSTANT_TAG_INTEGER:
+		s->i = cp->integer_.bytes;
+		*sp += 1;
+		break;
+	case CAFEBABE_CONSTANT_TAG_FLOAT:
+		s->f = uint32_to_float(cp->float_.bytes);
+		*sp += 1;
+		break;
+	case CAFEBABE_CONSTANT_TAG_STRING: {
+		const struct cafebabe_constant_info_utf8 *utf8;
+		struct vm_object *string;
+
+		if (cafebabe_class_constant_get_utf8(vmc->class, cp->string.string_index, &utf8)) {
+			signal_new_exception(vm_java_lang_InternalError, NULL);
+			return false;
+		}
+
+		string = vm_object_alloc_string_from_utf8(utf8->bytes, utf8->length);
+		if (!string)
+			return false;
+
+		string = vm_string_intern(string);
+		if (!string)
+			return false;
+
+		s->l = string;
+		*sp += 1;
+		break;
+	}
+	case CAFEBABE_CONSTANT_TAG_LONG:
+		slot_set_long(s, ((uint64_t) cp->long_.high_bytes << 32)
+			      + (uint64_t) cp->long_.low_bytes);
+		*sp += 2;
+		break;
+	case CAFEBABE_CONSTANT_TAG_DOUBLE:
+		slot_set_double(s, uint64_to_double(cp->double_.low_bytes,
+						    cp->double_.high_bytes));
+		*sp += 2;
+		break;
+	case CAFEBABE_CONSTANT_TAG_CLASS: {
+		struct vm_class *class = vm_class_resolve_class(vmc, idx);
+
+		if (vm_class_ensure_object(class))
+			return false;
+
+		s->l = class->object;
+		*sp += 1;
+		break;
+	}
+	default:
+		break;
+	}
+
+	return true;
+}
+
+/* The value is evaluated first because it may pop from the stack. */
+#define PUSH(type, member, v)						\
+	do {								\
+		type push_value = (v);					\
+									\
+		(sp++)->member = push_value;				\
+	} while (0)
+
+#define PUSH_I(v)	PUSH(jint, i, v)
+#define PUSH_F(v)	PUSH(float, f, v)
+#define PUSH_A(v)	PUSH(struct vm_object *, l, v)
+
+#define PUSH_L(v)							\
+	do {								\
+		jlong push_value = (v);					\
+									\
+		slot_set_long(sp, push_value);				\
+		sp += 2;						\
+	} while (0)
+
+#define PUSH_D(v)							\
+	do {								\
+		double push_value = (v);				\
+									\
+		slot_set_double(sp, push_value);			\
+		sp += 2;						\
+	} while (0)
+
+#define POP_I()		((--sp)->i)
+#define POP_F()		((--sp)->f)
+#define POP_A()		((--sp)->l)
+#define POP_L()		(sp -= 2, slot_get_long(sp))
+#define POP_D()		(sp -= 2, slot_get_double(sp))
+
+#define BINOP(type, t, expr)						\
+	do {								\
+		type b = POP_ ## t(), a = POP_ ## t();			\
+									\
+		PUSH_ ## t(expr);					\
+	} while (0)
+
+#define ARRAY_LOAD(type, push)						\
+	do {								\
+		jint index = POP_I();					\
+		struct vm_object *array = POP_A();			\
+									\
+		if (!check_array_access(array, index))			\
+			goto out;					\
+									\
+		push(array_get_field_ ## type(array, index));		\
+	} while (0)
+
+#define ARRAY_STORE(type, pop)						\
+	do {								\
+		j ## type value = pop();				\
+		jint index = POP_I();					\
+		struct vm_object *array = POP_A();			\
+									\
+		if (!check_array_access(array, index))			\
+			goto out;					\
+									\
+		array_set_field_ ## type(array, index, value);		\
+	} while (0)
+
+static void interpret(struct vm_method *vmm, struct interp_frame *iframe,
+		      union slot *locals, union slot *sp, union jvalue *result)
+{
+	struct compilation_unit *cu = vmm->compilation_unit;
+	const unsigned char *code = vmm->code_attribute.code;
+	struct vm_class *vmc = vmm->class;
+	unsigned long pc = 0;
+
+	for (;;) {
+		unsigned char opc = code[pc];
+		unsigned long next = pc + bc_insn_size(code, pc);
+		long offset;
+
+		/* For stack traces of exceptions thrown from here on. */
+		iframe->pc = pc;
+
+		switch (opc) {
+		case OPC_NOP:
+			break;
+		case OPC_ACONST_NULL:
+			PUSH_A(NULL);
+			break;
+		case OPC_ICONST_M1:
+		case OPC_ICONST_0:
+		case OPC_ICONST_1:
+		case OPC_ICONST_2:
+		case OPC_ICONST_3:
+		case OPC_ICONST_4:
+		case OPC_ICONST_5:
+			PUSH_I(opc - OPC_ICONST_0);
+			break;
+		case OPC_LCONST_0:
+		case OPC_LCONST_1:
+			PUSH_L(opc - OPC_LCONST_0);
+			break;
+		case OPC_FCONST_0:
+		case OPC_FCONST_1:
+		case OPC_FCONST_2:
+			PUSH_F(opc - OPC_FCONST_0);
+			break;
+		case OPC_DCONST_0:
+		case OPC_DCONST_1:
+			PUSH_D(opc - OPC_DCONST_0);
+			break;
+		case OPC_BIPUSH:
+			PUSH_I((int8_t) code[pc + 1]);
+			break;
+		case OPC_SIPUSH:
+			PUSH_I(read_s16(&code[pc + 1]));
+			break;
+		case OPC_LDC:
+			if (!interp_ldc(vmc, code[pc + 1], &sp))
+				goto out;
+			break;
+		case OPC_LDC_W:
+		case OPC_LDC2_W:
+			if (!interp_ldc(vmc, read_u16(&code[pc + 1]), &sp))
+				goto out;
+			break;
+		case OPC_ILOAD:
+			PUSH_I(locals[code[pc + 1]].i);
+			break;
+		case OPC_LLOAD:
+			PUSH_L(slot_get_long(&locals[code[pc + 1]]));
+			break;
+		case OPC_FLOAD:
+			PUSH_F(locals[code[pc + 1]].f);
+			break;
+		case OPC_DLOAD:
+			PUSH_D(slot_get_double(&locals[code[pc + 1]]));
+			break;
+		case OPC_ALOAD:
+			PUSH_A(locals[code[pc + 1]].l);
+			break;
+		case OPC_ILOAD_0 ... OPC_ILOAD_3:
+			PUSH_I(locals[opc - OPC_ILOAD_0].i);
+			break;
+		case OPC_LLOAD_0 ... OPC_LLOAD_3:
+			PUSH_L(slot_get_long(&locals[opc - OPC_LLOAD_0]));
+			break;
+		case OPC_FLOAD_0 ... OPC_FLOAD_3:
+			PUSH_F(locals[opc - OPC_FLOAD_0].f);
+			break;
+		case OPC_DLOAD_0 ... OPC_DLOAD_3:
+			PUSH_D(slot_get_double(&locals[opc - OPC_DLOAD_0]));
+			break;
+		case OPC_ALOAD_0 ... OPC_ALOAD_3:
+			PUSH_A(locals[opc - OPC_ALOAD_0].l);
+			break;
+		case OPC_IALOAD:
+			ARRAY_LOAD(int, PUSH_I);
+			break;
+		case OPC_LALOAD:
+			ARRAY_LOAD(long, PUSH_L);
+			break;
+		case OPC_FALOAD:
+			/* Floating point elements are copied as bit patterns. */
+			ARRAY_LOAD(int, PUSH_I);
+			break;
+		case OPC_DALOAD:
+			ARRAY_LOAD(long, PUSH_L);
+			break;
+		case OPC_AALOAD:
+			ARRAY_LOAD(object, PUSH_A);
+			break;
+		case OPC_BALOAD:
+			/* Boolean and byte arrays have the same layout. */
+			ARRAY_LOAD(byte, PUSH_I);
+			break;
+		case OPC_CALOAD:
+			ARRAY_LOAD(char, PUSH_I);
+			break;
+		case OPC_SALOAD:
+			ARRAY_LOAD(short, PUSH_I);
+			break;
+		case OPC_ISTORE:
+			locals[code[pc + 1]].i = POP_I();
+			break;
+		case OPC_LSTORE:
+			slot_set_long(&locals[code[pc + 1]], POP_L());
+			break;
+		case OPC_FSTORE:
+			locals[code[pc + 1]].f = POP_F();
+			break;
+		case OPC_DSTORE:
+			slot_set_double(&locals[code[pc + 1]], POP_D());
+			break;
+		case OPC_ASTORE:
+			locals[code[pc + 1]].l = POP_A();
+			break;
+		case OPC_ISTORE_0 ... OPC_ISTORE_3:
+			locals[opc - OPC_ISTORE_0].i = POP_I();
+			break;
+		case OPC_LSTORE_0 ... OPC_LSTORE_3:
+			slot_set_long(&locals[opc - OPC_LSTORE_0], POP_L());
+			break;
+		case OPC_FSTORE_0 ... OPC_FSTORE_3:
+			locals[opc - OPC_FSTORE_0].f = POP_F();
+			break;
+		case OPC_DSTORE_0 ... OPC_DSTORE_3:
+			slot_set_double(&locals[opc - OPC_DSTORE_0], POP_D());
+			break;
+		case OPC_ASTORE_0 ... OPC_ASTORE_3:
+			locals[opc - OPC_ASTORE_0].l = POP_A();
+			break;
+		case OPC_IASTORE:
+			ARRAY_STORE(int, POP_I);
+			break;
+		case OPC_LASTORE:
+			ARRAY_STORE(long, POP_L);
+			break;
+		case OPC_FASTORE:
+			ARRAY_STORE(int, POP_I);
+			break;
+		case OPC_DASTORE:
+			ARRAY_STORE(long, POP_L);
+			break;
+		case OPC_AASTORE: {
+			struct vm_object *value = POP_A();
+			jint index = POP_I();
+			struct vm_object *array = POP_A();
+
+			if (!check_array_access(array, index))
+				goto out;
+
+			array_store_check(array, value);
+			if (exception_occurred())
+				goto out;
+
+			array_set_field_object(array, index, value);
+			break;
+		}
+		case OPC_BASTORE:
+			ARRAY_STORE(byte, POP_I);
+			break;
+		case OPC_CASTORE:
+			ARRAY_STORE(char, POP_I);
+			break;
+		case OPC_SASTORE:
+			ARRAY_STORE(short, POP_I);
+			break;
+		case OPC_POP:
+			sp -= 1;
+			break;
+		case OPC_POP2:
+			sp -= 2;
+			break;
+		case OPC_DUP:
+			sp[0] = sp[-1];
+			sp += 1;
+			break;
+		case OPC_DUP_X1: {
+			union slot v1 = sp[-1], v2 = sp[-2];
+
+			sp[-2] = v1;
+			sp[-1] = v2;
+			sp[0] = v1;
+			sp += 1;
+			break;
+		}
+		case OPC_DUP_X2: {
+			union slot v1 = sp[-1], v2 = sp[-2], v3 = sp[-3];
+
+			sp[-3] = v1;
+			sp[-2] = v3;
+			sp[-1] = v2;
+			sp[0] = v1;
+			sp += 1;
+			break;
+		}
+		case OPC_DUP2:
+			sp[0] = sp[-2];
+			sp[1] = sp[-1];
+			sp += 2;
+			break;
+		case OPC_DUP2_X1: {
+			union slot v1 = sp[-1], v2 = sp[-2], v3 = sp[-3];
+
+			sp[-3] = v2;
+			sp[-2] = v1;
+			sp[-1] = v3;
+			sp[0] = v2;
+			sp[1] = v1;
+			sp += 2;
+			break;
+		}
+		case OPC_DUP2_X2: {
+			union slot v1 = sp[-1], v2 = sp[-2], v3 = sp[-3], v4 = sp[-4];
+
+			sp[-4] = v2;
+			sp[-3] = v1;
+			sp[-2] = v4;
+			sp[-1] = v3;
+			sp[0] = v2;
+			sp[1] = v1;
+			sp += 2;
+			break;
+		}
+		case OPC_SWAP: {
+			union slot v1 = sp[-1];
+
+			sp[-1] = sp[-2];
+			sp[-2] = v1;
+			break;
+		}
+		case OPC_IADD:
+			BINOP(jint, I, (uint32_t) a + (uint32_t) b);
+			break;
+		case OPC_LADD:
+			BINOP(jlong, L, (uint64_t) a + (uint64_t) b);
+			break;
+		case OPC_FADD:
+			BINOP(float, F, a + b);
+			break;
+		case OPC_DADD:
+			BINOP(double, D, a + b);
+			break;
+		case OPC_ISUB:
+			BINOP(jint, I, (uint32_t) a - (uint32_t) b);
+			break;
+		case OPC_LSUB:
+			BINOP(jlong, L, (uint64_t) a - (uint64_t) b);
+			break;
+		case OPC_FSUB:
+			BINOP(float, F, a - b);
+			break;
+		case OPC_DSUB:
+			BINOP(double, D, a - b);
+			break;
+		case OPC_IMUL:
+			BINOP(jint, I, (uint32_t) a * (uint32_t) b);
+			break;
+		case OPC_LMUL:
+			BINOP(jlong, L, (uint64_t) a * (uint64_t) b);
+			break;
+		case OPC_FMUL:
+			BINOP(float, F, a * b);
+			break;
+		case OPC_DMUL:
+			BINOP(double, D, a * b);
+			break;
+		case OPC_IDIV:
+			if (!check_divisor(sp[-1].i))
+				goto out;
+
+			BINOP(jint, I, (a == INT_MIN && b == -1) ? a : a / b);
+			break;
+		case OPC_LDIV:
+			if (!check_divisor(slot_get_long(sp - 2)))
+				goto out;
+
+			BINOP(jlong, L, (a == LLONG_MIN && b == -1) ? a : emulate_ldiv(a, b));
+			break;
+		case OPC_FDIV:
+			BINOP(float, F, a / b);
+			break;
+		case OPC_DDIV:
+			BINOP(double, D, a / b);
+			break;
+		case OPC_IREM:
+			if (!check_divisor(sp[-1].i))
+				goto out;
+
+			BINOP(jint, I, b == -1 ? 0 : a % b);
+			break;
+		case OPC_LREM:
+			if (!check_divisor(slot_get_long(sp - 2)))
+				goto out;
+
+			BINOP(jlong, L, b == -1 ? 0 : emulate_lrem(a, b));
+			break;
+		case OPC_FREM:
+			BINOP(float, F, fmodf(a, b));
+			break;
+		case OPC_DREM:
+			BINOP(double, D, fmod(a, b));
+			break;
+		case OPC_INEG:
+			sp[-1].i = 0U - (uint32_t) sp[-1].i;
+			break;
+		case OPC_LNEG:
+			PUSH_L(0ULL - (uint64_t) POP_L());
+			break;
+		case OPC_FNEG:
+			sp[-1].f = -sp[-1].f;
+			break;
+		case OPC_DNEG:
+			PUSH_D(-POP_D());
+			break;
+		case OPC_ISHL:
+			BINOP(jint, I, (uint32_t) a << (b & 0x1f));
+			break;
+		case OPC_LSHL: {
+			jint b = POP_I();
+
+			PUSH_L(emulate_lshl(POP_L(), b));
+			break;
+		}
+		case OPC_ISHR:
+			BINOP(jint, I, a >> (b & 0x1f));
+			break;
+		case OPC_LSHR: {
+			jint b = POP_I();
+
+			PUSH_L(emulate_lshr(POP_L(), b));
+			break;
+		}
+		case OPC_IUSHR:
+			BINOP(jint, I, (uint32_t) a >> (b & 0x1f));
+			break;
+		case OPC_LUSHR: {
+			jint b = POP_I();
+
+			PUSH_L(emulate_lushr(POP_L(), b));
+			break;
+		}
+		case OPC_IAND:
+			BINOP(jint, I, a & b);
+			break;
+		case OPC_LAND:
+			BINOP(jlong, L, a & b);
+			break;
+		case OPC_IOR:
+			BINOP(jint, I, a | b);
+			break;
+		case OPC_LOR:
+			BINOP(jlong, L, a | b);
+			break;
+		case OPC_IXOR:
+			BINOP(jint, I, a ^ b);
+			break;
+		case OPC_LXOR:
+			BINOP(jlong, L, a ^ b);
+			break;
+		case OPC_IINC:
+			locals[code[pc + 1]].i = (uint32_t) locals[code[pc + 1]].i
+				+ (int8_t) code[pc + 2];
+			break;
+		case OPC_I2L:
+			PUSH_L(POP_I());
+			break;
+		case OPC_I2F:
+			PUSH_F(POP_I());
+			break;
+		case OPC_I2D:
+			PUSH_D(POP_I());
+			break;
+		case OPC_L2I:
+			PUSH_I(POP_L());
+			break;
+		case OPC_L2F:
+			PUSH_F(POP_L());
+			break;
+		case OPC_L2D:
+			PUSH_D(POP_L());
+			break;
+		case OPC_F2I:
+			PUSH_I(interp_d2i(POP_F()));
+			break;
+		case OPC_F2L:
+			PUSH_L(interp_d2l(POP_F()));
+			break;
+		case OPC_F2D:
+			PUSH_D(POP_F());
+			break;
+		case OPC_D2I:
+			PUSH_I(interp_d2i(POP_D()));
+			break;
+		case OPC_D2L:
+			PUSH_L(interp_d2l(POP_D()));
+			break;
+		case OPC_D2F:
+			PUSH_F(POP_D());
+			break;
+		case OPC_I2B:
+			sp[-1].i = (jbyte) sp[-1].i;
+			break;
+		case OPC_I2C:
+			sp[-1].i = (jchar) sp[-1].i;
+			break;
+		case OPC_I2S:
+			sp[-1].i = (jshort) sp[-1].i;
+			break;
+		case OPC_LCMP: {
+			jlong b = POP_L(), a = POP_L();
+
+			PUSH_I(a < b ? -1 : a > b);
+			break;
+		}
+		case OPC_FCMPL: {
+			float b = POP_F(), a = POP_F();
+
+			PUSH_I(emulate_fcmpl(a, b));
+			break;
+		}
+		case OPC_FCMPG: {
+			float b = POP_F(), a = POP_F();
+
+			PUSH_I(emulate_fcmpg(a, b));
+			break;
+		}
+		case OPC_DCMPL: {
+			double b = POP_D(), a = POP_D();
+
+			PUSH_I(emulate_dcmpl(a, b));
+			break;
+		}
+		case OPC_DCMPG: {
+			double b = POP_D(), a = POP_D();
+
+			PUSH_I(emulate_dcmpg(a, b));
+			break;
+		}
+		case OPC_IFEQ ... OPC_IFLE: {
+			jint a = POP_I();
+			bool taken;
+
+			switch (opc) {
+			case OPC_IFEQ:	taken = a == 0; break;
+			case OPC_IFNE:	taken = a != 0; break;
+			case OPC_IFLT:	taken = a < 0; break;
+			case OPC_IFGE:	taken = a >= 0; break;
+			case OPC_IFGT:	taken = a > 0; break;
+			default:	taken = a <= 0; break;
+			}
+
+			if (taken)
+				goto branch16;
+			break;
+		}
+		case OPC_IF_ICMPEQ ... OPC_IF_ICMPLE: {
+			jint b = POP_I(), a = POP_I();
+			bool taken;
+
+			switch (opc) {
+			case OPC_IF_ICMPEQ:	taken = a == b; break;
+			case OPC_IF_ICMPNE:	taken = a != b; break;
+			case OPC_IF_ICMPLT:	taken = a < b; break;
+			case OPC_IF_ICMPGE:	taken = a >= b; break;
+			case OPC_IF_ICMPGT:	taken = a > b; break;
+			default:		taken = a <= b; break;
+			}
+
+			if (taken)
+				goto branch16;
+			break;
+		}
+		case OPC_IF_ACMPEQ:
+		case OPC_IF_ACMPNE: {
+			struct vm_object *b = POP_A(), *a = POP_A();
+
+			if ((a == b) == (opc == OPC_IF_ACMPEQ))
+				goto branch16;
+			break;
+		}
+		case OPC_IFNULL:
+		case OPC_IFNONNULL:
+			if ((POP_A() == NULL) == (opc == OPC_IFNULL))
+				goto branch16;
+			break;
+		case OPC_GOTO:
+			goto branch16;
+		case OPC_GOTO_W:
+			offset = read_s32(&code[pc + 1]);
+			goto branch;
+		case OPC_TABLESWITCH: {
+			struct tableswitch_info info;
+			jint index = POP_I();
+
+			get_tableswitch_info(code, pc, &info);
+
+			if (index < (int32_t) info.low || index > (int32_t) info.high)
+				offset = info.default_target;
+			else
+				offset = read_s32(info.targets + (index - (int32_t) info.low) * 4);
+			goto branch;
+		}
+		case OPC_LOOKUPSWITCH: {
+			struct lookupswitch_info info;
+			jint key = POP_I();
+
+			get_lookupswitch_info(code, pc, &info);
+
+			offset = info.default_target;
+
+			for (unsigned int i = 0; i < info.count; i++) {
+				if (read_lookupswitch_match(&info, i) == key) {
+					offset = read_lookupswitch_target(&info, i);
+					break;
+				}
+			}
+			goto branch;
+		}
+		case OPC_IRETURN:
+			result->i = POP_I();
+			goto out;
+		case OPC_LRETURN:
+			result->j = POP_L();
+			goto out;
+		case OPC_FRETURN:
+			result->f = POP_I();
+			goto out;
+		case OPC_DRETURN:
+			result->d = POP_L();
+			goto out;
+		case OPC_ARETURN:
+			result->l = POP_A();
+			goto out;
+		case OPC_RETURN:
+			goto out;
+		case OPC_GETSTATIC:
+		case OPC_PUTSTATIC: {
+			struct vm_field *vmf;
+			enum vm_type type;
+			union jvalue value;
+
+			vmf = vm_class_resolve_field_recursive(vmc, read_u16(&code[pc + 1]));
+			type = vm_field_type(vmf);
+
+			if (vm_class_ensure_init(vmf->class))
+				goto out;
+
+			if (opc == OPC_GETSTATIC) {
+				get_static(vmf, &value);
+				jvalue_to_slot(sp, type, &value);
+				sp += vm_type_slots(type);
+			} else {
+				sp -= vm_type_slots(type);
+				slot_to_jvalue(sp, type, &value);
+				put_static(vmf, &value);
+			}
+			break;
+		}
+		case OPC_GETFIELD: {
+			struct vm_field *vmf;
+			struct vm_object *obj;
+			enum vm_type type;
+			union jvalue value;
+
+			vmf = vm_class_resolve_field_recursive(vmc, read_u16(&code[pc + 1]));
+			type = vm_field_type(vmf);
+
+			obj = POP_A();
+			if (!check_null(obj))
+				goto out;
+
+			get_field(obj, vmf, &value);
+			jvalue_to_slot(sp, type, &value);
+			sp += vm_type_slots(type);
+			break;
+		}
+		case OPC_PUTFIELD: {
+			struct vm_field *vmf;
+			struct vm_object *obj;
+			enum vm_type type;
+			union jvalue value;
+
+			vmf = vm_class_resolve_field_recursive(vmc, read_u16(&code[pc + 1]));
+			type = vm_field_type(vmf);
+
+			sp -= vm_type_slots(type);
+			slot_to_jvalue(sp, type, &value);
+
+			obj = POP_A();
+			if (!check_null(obj))
+				goto out;
+
+			put_field(obj, vmf, &value);
+			break;
+		}
+		case OPC_INVOKEVIRTUAL:
+		case OPC_INVOKESPECIAL:
+		case OPC_INVOKESTATIC:
+		case OPC_INVOKEINTERFACE:
+			if (!interp_invoke(vmc, opc, read_u16(&code[pc + 1]), &sp))
+				goto out;
+			break;
+		case OPC_NEW: {
+			struct vm_class *class;
+			struct vm_object *obj;
+
+			class = vm_class_resolve_class(vmc, read_u16(&code[pc + 1]));
+
+			obj = vm_object_alloc(class);
+			if (!obj)
+				goto out;
+
+			PUSH_A(obj);
+			break;
+		}
+		case OPC_NEWARRAY: {
+			struct vm_object *array;
+			jint count = POP_I();
+
+			array_size_check(count);
+			if (exception_occurred())
+				goto out;
+
+			array = vm_object_alloc_primitive_array(code[pc + 1], count);
+			if (!array)
+				goto out;
+
+			PUSH_A(array);
+			break;
+		}
+		case OPC_ANEWARRAY: {
+			struct vm_class *class, *array_class;
+			struct vm_object *array;
+			jint count = POP_I();
+
+			array_size_check(count);
+			if (exception_occurred())
+				goto out;
+
+			class = vm_class_resolve_class(vmc, read_u16(&code[pc + 1]));
+
+			array_class = array_class_of(class);
+			if (!array_class)
+				goto out;
+
+			array = vm_object_alloc_array(array_class, count);
+			if (!array)
+				goto out;
+
+			PUSH_A(array);
+			break;
+		}
+		case OPC_MULTIANEWARRAY: {
+			unsigned int nr_dimensions = code[pc + 3];
+			struct vm_class *class;
+			struct vm_object *array;
+			int counts[nr_dimensions];
+
+			sp -= nr_dimensions;
+
+			for (unsigned int i = 0; i < nr_dimensions; i++) {
+				counts[i] = sp[i].i;
+
+				array_size_check(counts[i]);
+				if (exception_occurred())
+					goto out;
+			}
+
+			class = vm_class_resolve_class(vmc, read_u16(&code[pc + 1]));
+
+			array = vm_object_alloc_multi_array(class, nr_dimensions, counts);
+			if (!array)
+				goto out;
+
+			PUSH_A(array);
+			break;
+		}
+		case OPC_ARRAYLENGTH: {
+			struct vm_object *array = POP_A();
+
+			if (!check_null(array))
+				goto out;
+
+			PUSH_I(array->array_length);
+			break;
+		}
+		case OPC_ATHROW: {
+			struct vm_object *exception = POP_A();
+
+			if (check_null(exception))
+				signal_exception(exception);
+			goto out;
+		}
+		case OPC_CHECKCAST: {
+			struct vm_class *class;
+
+			class = vm_class_resolve_class(vmc, read_u16(&code[pc + 1]));
+
+			vm_object_check_cast(sp[-1].l, class);
+			if (exception_occurred())
+				goto out;
+			break;
+		}
+		case OPC_INSTANCEOF: {
+			struct vm_class *class;
+
+			class = vm_class_resolve_class(vmc, read_u16(&code[pc + 1]));
+
+			PUSH_I(vm_object_is_instance_of(POP_A(), class));
+			break;
+		}
+		case OPC_WIDE: {
+			uint16_t idx = read_u16(&code[pc + 2]);
+
+			switch (code[pc + 1]) {
+			case OPC_ILOAD:
+				PUSH_I(locals[idx].i);
+				break;
+			case OPC_LLOAD:
+				PUSH_L(slot_get_long(&locals[idx]));
+				break;
+			case OPC_FLOAD:
+				PUSH_F(locals[idx].f);
+				break;
+			case OPC_DLOAD:
+				PUSH_D(slot_get_double(&locals[idx]));
+				break;
+			case OPC_ALOAD:
+				PUSH_A(locals[idx].l);
+				break;
+			case OPC_ISTORE:
+				locals[idx].i = POP_I();
+				break;
+			case OPC_LSTORE:
+				slot_set_long(&locals[idx], POP_L());
+				break;
+			case OPC_FSTORE:
+				locals[idx].f = POP_F();
+				break;
+			case OPC_DSTORE:
+				slot_set_double(&locals[idx], POP_D());
+				break;
+			case OPC_ASTORE:
+				locals[idx].l = POP_A();
+				break;
+			case OPC_IINC:
+				locals[idx].i = (uint32_t) locals[idx].i
+					+ read_s16(&code[pc + 4]);
+				break;
+			}
+			break;
+		}
+		default:
+			die("unexpected opcode 0x%02x in %s.%s%s", opc,
+			    vmc->name, vmm->name, vmm->type);
+		}
+
+		pc = next;
+		continue;
+
+branch16:
+		offset = read_s16(&code[pc + 1]);
+branch:
+		if (offset <= 0)
+			cu->nr_backedges++;
+
+		pc += offset;
+	}
+out:
+	return;
+}
+
+/*
+ * Executes @vmm which must have passed interp_can_execute(). The arguments
+ * are laid out like for native_call(). On return, an exception may be
+ * pending.
+ */
+void interp_call_method(struct vm_method *vmm, unsigned long *args,
+			union jvalue *result)
+{
+	unsigned long max_locals = vmm->code_attribute.max_locals;
+	unsigned long max_stack = vmm->code_attribute.max_stack;
+	union slot frame[max_locals + max_stack + 1];
+	struct interp_frame iframe;
+
+	if (vmm->args_count)
+		memcpy(frame, args, vmm->args_count * sizeof(unsigned long));
+
+	/* Not exact, see struct compilation_unit. */
+	vmm->compilation_unit->nr_invocations++;
+
+	iframe.method = vmm;
+	iframe.pc = 0;
+	iframe.native_frame = __builtin_frame_address(0);
+	iframe.prev = interp_frames;
+
+	interp_frames = &iframe;
+	interp_depth++;
+
+	interpret(vmm, &iframe, frame, frame + max_locals, result);
+
+	interp_depth--;
+	interp_frames = iframe.prev;
+}
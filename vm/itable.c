@@ -25,16 +25,16 @@
  */
 
 #include <errno.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 
-#include "lib/array.h"
+#include "jit/emit-code.h"
+#include "jit/vtable.h"
 
-#include "vm/classloader.h"
-#include "vm/backtrace.h"
 #include "vm/class.h"
-#include "vm/object.h"
+#include "vm/die.h"
 #include "vm/itable.h"
 #include "vm/method.h"
 #include "vm/trace.h"
@@ -43,167 +43,212 @@
 
 bool opt_trace_itable;
 
-static uint32_t itable_hash_string(const char *str)
-{
-	/* Stolen shamelessly from
-	 * http://en.wikipedia.org/wiki/Jenkins_hash_function */
-
-	uint32_t hash = 0;
-	for (unsigned int i = 0, n = strlen(str); i < n; ++i) {
-		hash += str[i];
-		hash += (hash << 10);
-		hash ^= (hash >> 6);
-	}
+static pthread_mutex_t interface_id_mutex = PTHREAD_MUTEX_INITIALIZER;
+static unsigned int nr_interface_ids;
 
-	hash += (hash << 3);
-	hash ^= (hash >> 11);
-	hash += (hash << 15);
-	return hash;
-}
+static pthread_mutex_t itable_stub_mutex = PTHREAD_MUTEX_INITIALIZER;
 
-static uint32_t itable_hash_combine(uint32_t a, uint32_t b)
+/*
+ * Assigns the interface ID of @vmc and the itable indices of its methods.
+ * Only abstract methods are dispatched through the itable, that is
+ * everything but <clinit>.
+ */
+void vm_itable_setup_interface(struct vm_class *vmc)
 {
-	/* The itable can't be longer than 256 entries anyway, so we can
-	 * compress those 32 bits from each argument into a combined 8 bit
-	 * result. */
-	return ((a >> 24) ^ (a >> 16) ^ (a >> 8) ^ a)
-		^ ((b >> 24) ^ (b >> 16) ^ (b >> 8) ^ b);
+	if (pthread_mutex_lock(&interface_id_mutex))
+		die("pthread_mutex_lock");
+
+	vmc->interface_id = nr_interface_ids++;
+
+	if (pthread_mutex_unlock(&interface_id_mutex))
+		die("pthread_mutex_unlock");
+
+	vmc->nr_itable_methods = 0;
+
+	for (unsigned int i = 0; i < vmc->nr_methods; ++i) {
+		struct vm_method *vmm = &vmc->methods[i];
+
+		if (!vm_method_is_abstract(vmm))
+			continue;
+
+		vmm->itable_index = vmc->nr_itable_methods++;
+	}
 }
 
-unsigned int itable_hash(struct vm_method *vmm)
+static bool itable_has_interface(struct vm_itable *itable, struct vm_class *vmi)
 {
-#if 0
-	/* Very simple hash based on the middle bits of the method pointer.
-	 * This is probably not sufficient because the result depends
-	 * implicitly on the way the memory allocator works. */
-	return ((unsigned long) vmm / 8) % VM_ITABLE_SIZE;
-#endif
-
-	return itable_hash_combine(itable_hash_string(vmm->name),
-		itable_hash_string(vmm->type)) % VM_ITABLE_SIZE;
+	for (unsigned int i = 0; i < itable->nr_interfaces; ++i) {
+		if (itable->table[i].interface == vmi)
+			return true;
+	}
+
+	return false;
 }
 
-static int itable_add_entries(struct vm_class *vmc, struct list_head *itable)
+/*
+ * Appends @vmi to the table, which is sorted and terminated once all
+ * interfaces have been added. @nr_entries is the number of entries
+ * allocated.
+ */
+static int itable_add_interface(struct vm_itable *itable,
+	unsigned int *nr_entries, struct vm_class *vmi,
+	unsigned int *vtable_index)
 {
-	const struct cafebabe_class *class = vmc->class;
-
-	/* Note about error handling: We don't actually clean up on error,
-	 * but assume that the caller will free the entries that have been
-	 * added to the itable so far. That really simplifies this whole
-	 * function. */
-	if (vm_class_is_interface(vmc)) {
-		for (unsigned int i = 0; i < vmc->nr_methods; ++i) {
-			struct vm_method *vmm = &vmc->methods[i];
-			if (!vm_method_is_abstract(vmm))
-				continue;
-
-			unsigned int bucket = itable_hash(vmm);
+	struct vm_itable_entry *entry;
 
-			struct itable_entry *entry = malloc(sizeof *entry);
-			if (!entry)
-				return -1;
+	if (itable->nr_interfaces == *nr_entries) {
+		unsigned int nr = *nr_entries ? 2 * *nr_entries : 4;
 
-			entry->i_method = vmm;
-			list_add(&entry->node, &itable[bucket]);
-		}
-	}
+		entry = realloc(itable->table, nr * sizeof(*entry));
+		if (!entry)
+			return -ENOMEM;
 
-	for (unsigned int i = 0; i < class->interfaces_count; ++i) {
-		int ret = itable_add_entries(vmc->interfaces[i], itable);
-		if (ret)
-			return ret;
+		itable->table = entry;
+		*nr_entries = nr;
 	}
 
-	/* Yay for tail recursion. */
-	if (vmc->super)
-		return itable_add_entries(vmc->super, itable);
+	entry = &itable->table[itable->nr_interfaces++];
+	entry->interface_id = vmi->interface_id;
+	entry->entries = NULL;
+	entry->vtable_index = vtable_index;
+	entry->interface = vmi;
 
 	return 0;
 }
 
-static int itable_entry_compare(const void *a, const void *b)
+static int itable_entry_cmp(const void *p1, const void *p2)
 {
-	const struct itable_entry *ae = *(const struct itable_entry **) a;
-	const struct itable_entry *be = *(const struct itable_entry **) b;
+	const struct vm_itable_entry *a = p1;
+	const struct vm_itable_entry *b = p2;
+
+	if (a->interface_id != b->interface_id)
+		return a->interface_id < b->interface_id ? -1 : 1;
 
-	if (ae->i_method < be->i_method)
-		return -1;
-	if (ae->i_method > be->i_method)
-		return 1;
 	return 0;
 }
 
-static void *itable_create_conflict_resolver(struct vm_class *vmc,
-	struct list_head *methods)
+/*
+ * Returns the entry of @vmi in the sorted table of @itable or NULL if the
+ * interface is not implemented. This is the scan the dispatch stubs do.
+ */
+static struct vm_itable_entry *itable_find(struct vm_itable *itable,
+	struct vm_class *vmi)
 {
-	/* No methods at this index -- return something that will choke the
-	 * caller. */
-	if (list_is_empty(methods))
-		return &itable_resolver_stub_error;
+	struct vm_itable_entry *entry = itable->table;
 
-	/* If it's not empty, and the first element is the same as the last,
-	 * there can only be one element in the list. If so, we can put the
-	 * trampoline of that method directly into the itable. */
-	if (list_first(methods) == list_last(methods)) {
-		struct itable_entry *entry = list_first_entry(methods,
-			struct itable_entry, node);
+	if (!entry)
+		return NULL;
 
-		return vm_method_call_ptr(entry->c_method);
+	while (entry->interface_id < vmi->interface_id)
+		entry++;
+
+	if (entry->interface_id != vmi->interface_id)
+		return NULL;
+
+	return entry;
+}
+
+static bool itable_is_complete(struct vm_class *vmi, unsigned int *vtable_index)
+{
+	for (unsigned int i = 0; i < vmi->nr_itable_methods; ++i) {
+		if (vtable_index[i] == ITABLE_NO_METHOD)
+			return false;
 	}
 
-	struct array sorted_table;
-	array_init(&sorted_table);
-	array_resize(&sorted_table, 64);
+	return true;
+}
 
-	struct itable_entry *entry;
-	list_for_each_entry(entry, methods, node)
-		array_append(&sorted_table, entry);
+static void *itable_block_alloc(struct vm_class *vmi, size_t size)
+{
+	unsigned int nr = vmi->nr_itable_methods;
 
-	array_qsort(&sorted_table, &itable_entry_compare);
-	array_unique(&sorted_table, &itable_entry_compare);
+	/* Marker interfaces have no methods but still get a block. */
+	return malloc(size * (nr ? nr : 1));
+}
+
+static unsigned int *itable_resolve_interface(struct vm_class *vmc,
+	struct vm_class *vmi)
+{
+	unsigned int *vtable_index;
 
-	void *ret = emit_itable_resolver_stub(vmc,
-		(struct itable_entry **) sorted_table.ptr, sorted_table.size);
-	array_destroy(&sorted_table);
+	vtable_index = itable_block_alloc(vmi, sizeof(*vtable_index));
+	if (!vtable_index)
+		return NULL;
+
+	for (unsigned int i = 0; i < vmi->nr_methods; ++i) {
+		struct vm_method *i_vmm = &vmi->methods[i];
+		struct vm_method *c_vmm;
+
+		if (!vm_method_is_abstract(i_vmm))
+			continue;
 
-	return ret;
+		c_vmm = vm_class_get_method_recursive(vmc, i_vmm->name, i_vmm->type);
+		if (!c_vmm || vm_class_is_interface(c_vmm->class))
+			vtable_index[i_vmm->itable_index] = ITABLE_NO_METHOD;
+		else
+			vtable_index[i_vmm->itable_index] = c_vmm->virtual_index;
+	}
+
+	return vtable_index;
 }
 
-static void trace_itable(struct vm_class *vmc, struct list_head *itable)
+static int itable_add_interfaces(struct vm_itable *itable,
+	unsigned int *nr_entries, struct vm_class *vmc, struct vm_class *from)
 {
-	bool empty = true;
-	for (unsigned int i = 0; i < VM_ITABLE_SIZE; ++i) {
-		if (list_is_empty(&itable[i]))
+	for (unsigned int i = 0; i < from->nr_interfaces; ++i) {
+		struct vm_class *vmi = from->interfaces[i];
+		unsigned int *vtable_index;
+
+		if (itable_has_interface(itable, vmi))
 			continue;
 
-		empty = false;
-		break;
+		vtable_index = itable_resolve_interface(vmc, vmi);
+		if (!vtable_index)
+			return -ENOMEM;
+
+		if (itable_add_interface(itable, nr_entries, vmi, vtable_index)) {
+			free(vtable_index);
+			return -ENOMEM;
+		}
+
+		if (itable_add_interfaces(itable, nr_entries, vmc, vmi))
+			return -ENOMEM;
 	}
 
-	if (empty)
+	return 0;
+}
+
+static void trace_itable(struct vm_class *vmc)
+{
+	struct vm_itable *itable = &vmc->itable;
+
+	if (!itable->nr_interfaces)
 		return;
 
-	trace_printf("trace itable (duplicates included): %s\n", vmc->name);
+	trace_printf("trace itable: %s\n", vmc->name);
 
-	for (unsigned int i = 0; i < VM_ITABLE_SIZE; ++i) {
-		if (list_is_empty(&itable[i]))
-			continue;
+	for (unsigned int i = 0; i < itable->nr_interfaces; ++i) {
+		struct vm_class *vmi = itable->table[i].interface;
+		unsigned int *vtable_index = itable->table[i].vtable_index;
 
-		trace_printf(" %d:\n", i);
+		trace_printf(" %u: %s\n", vmi->interface_id, vmi->name);
 
-		struct itable_entry *entry;
-		list_for_each_entry(entry, &itable[i], node) {
-			struct vm_method *i_vmm = entry->i_method;
-			struct vm_method *c_vmm = entry->c_method;
+		for (unsigned int j = 0; j < vmi->nr_methods; ++j) {
+			struct vm_method *i_vmm = &vmi->methods[j];
+			unsigned int idx;
 
-			assert(vm_class_is_interface(i_vmm->class));
-			assert(!vm_class_is_interface(c_vmm->class));
-			assert(!strcmp(c_vmm->name, i_vmm->name));
-			assert(!strcmp(c_vmm->type, i_vmm->type));
+			if (!vm_method_is_abstract(i_vmm))
+				continue;
+
+			idx = vtable_index[i_vmm->itable_index];
+			if (idx == ITABLE_NO_METHOD) {
+				trace_printf("  * %s%s -> (none)\n",
+					i_vmm->name, i_vmm->type);
+				continue;
+			}
 
-			trace_printf("  * %s.%s%s -> %s\n",
-				i_vmm->class->name, i_vmm->name, i_vmm->type,
-				c_vmm->class->name);
+			trace_printf("  * %s%s -> vtable[%u]\n",
+				i_vmm->name, i_vmm->type, idx);
 		}
 	}
 
@@ -211,53 +256,165 @@ static void trace_itable(struct vm_class *vmc, struct list_head *itable)
 	trace_flush();
 }
 
+static void *itable_entry(struct vm_class *vmc, unsigned int vtable_index)
+{
+	if (vtable_index == ITABLE_NO_METHOD)
+		return &itable_resolver_stub_error;
+
+	return vmc->vtable.native_ptr[vtable_index];
+}
+
 int vm_itable_setup(struct vm_class *vmc)
 {
-	/* We need a temporary array of lists for storing multiple results.
-	 * The final itable (the one that gets stored in the class struct
-	 * itself) will only have one method per slot. */
-	struct list_head *itable = malloc(sizeof(*itable) * VM_ITABLE_SIZE);
-	if (!itable)
-		return -ENOMEM;
+	struct vm_class *super = vmc->super;
+	struct vm_itable_entry *table;
+	unsigned int nr_entries = 0;
+	struct vm_itable itable;
+
+	itable.table = NULL;
+	itable.nr_interfaces = 0;
+
+	/*
+	 * Interfaces of the superclass are implemented by the same methods
+	 * or by ones overriding them, both of which have the same vtable
+	 * index. Only interfaces the superclass leaves partly unimplemented
+	 * need to be resolved again.
+	 */
+	if (super) {
+		for (unsigned int i = 0; i < super->itable.nr_interfaces; ++i) {
+			struct vm_itable_entry *entry = &super->itable.table[i];
+			unsigned int *vtable_index = entry->vtable_index;
+
+			if (!itable_is_complete(entry->interface, vtable_index)) {
+				vtable_index = itable_resolve_interface(vmc, entry->interface);
+				if (!vtable_index)
+					goto error;
+			}
+
+			if (itable_add_interface(&itable, &nr_entries, entry->interface, vtable_index))
+				goto error;
+		}
+	}
 
-	for (unsigned int i = 0; i < VM_ITABLE_SIZE; ++i)
-		INIT_LIST_HEAD(&itable[i]);
+	if (itable_add_interfaces(&itable, &nr_entries, vmc, vmc))
+		goto error;
 
-	itable_add_entries(vmc, itable);
+	if (!itable.nr_interfaces)
+		return 0;
 
-	for (unsigned int i = 0; i < VM_ITABLE_SIZE; ++i) {
-		struct itable_entry *entry;
+	qsort(itable.table, itable.nr_interfaces, sizeof(*itable.table), itable_entry_cmp);
 
-		list_for_each_entry(entry, &itable[i], node) {
-			/* Specification */
-			struct vm_method *i_vmm = entry->i_method;
+	for (unsigned int i = 0; i < itable.nr_interfaces; ++i) {
+		struct vm_itable_entry *entry = &itable.table[i];
 
-			/* Implementation */
-			struct vm_method *c_vmm
-				= vm_class_get_method_recursive(vmc,
-					i_vmm->name, i_vmm->type);
-			assert(c_vmm);
+		entry->entries = itable_block_alloc(entry->interface, sizeof(void *));
+		if (!entry->entries)
+			goto error;
+	}
 
-			entry->c_method = c_vmm;
-		}
+	/* Trim the table to size and terminate it. */
+	table = realloc(itable.table, (itable.nr_interfaces + 1) * sizeof(*table));
+	if (!table)
+		goto error;
+
+	itable.table = table;
+	itable.table[itable.nr_interfaces] = (struct vm_itable_entry) {
+		.interface_id	= ITABLE_END,
+	};
+
+	/*
+	 * The entries mirror the vtable and are fixed up along with it, see
+	 * vm_itable_fixup(), so fill them in and publish the itable under
+	 * the same lock.
+	 */
+	vtable_lock();
+
+	for (unsigned int i = 0; i < itable.nr_interfaces; ++i) {
+		struct vm_itable_entry *entry = &itable.table[i];
+
+		for (unsigned int j = 0; j < entry->interface->nr_itable_methods; ++j)
+			entry->entries[j] = itable_entry(vmc, entry->vtable_index[j]);
 	}
 
+	vmc->itable = itable;
+
+	vtable_unlock();
+
 	if (opt_trace_itable)
-		trace_itable(vmc, itable);
+		trace_itable(vmc);
 
-	for (unsigned int i = 0; i < VM_ITABLE_SIZE; ++i) {
-		vmc->itable[i]
-			= itable_create_conflict_resolver(vmc, &itable[i]);
-	}
+	return 0;
 
-	/* Free the temporary itable */
-	for (unsigned int i = 0; i < VM_ITABLE_SIZE; ++i) {
-		struct itable_entry *entry, *tmp;
+error:
+	/* Vtable indices may be shared with the superclass so they leak. */
+	for (unsigned int i = 0; i < itable.nr_interfaces; ++i)
+		free(itable.table[i].entries);
+
+	free(itable.table);
+
+	return -ENOMEM;
+}
 
-		list_for_each_entry_safe(entry, tmp, &itable[i], node)
-			free(entry);
+/*
+ * Returns the entry point of the implementation of @i_method in @vmc or
+ * NULL if @vmc does not implement the interface. The entry point is taken
+ * from the vtable so it is up to date even before fixups have reached the
+ * itable.
+ */
+void *vm_itable_lookup(struct vm_class *vmc, struct vm_method *i_method)
+{
+	struct vm_itable_entry *entry;
+	unsigned int idx;
+
+	entry = itable_find(&vmc->itable, i_method->class);
+	if (!entry)
+		return NULL;
+
+	idx = entry->vtable_index[i_method->itable_index];
+	if (idx == ITABLE_NO_METHOD)
+		return NULL;
+
+	return vmc->vtable.native_ptr[idx];
+}
+
+/*
+ * Returns the stub which dispatches invokeinterface of @i_method at call
+ * sites without an inline cache, emitting it on first use. The stub checks
+ * the receiver like vm_itable_lookup() does.
+ */
+void *vm_itable_stub(struct vm_method *i_method)
+{
+	void *stub;
+
+	if (pthread_mutex_lock(&itable_stub_mutex))
+		die("pthread_mutex_lock");
+
+	stub = i_method->itable_stub;
+	if (!stub) {
+		stub = emit_itable_stub(i_method);
+		i_method->itable_stub = stub;
 	}
 
-	free(itable);
-	return 0;
+	if (pthread_mutex_unlock(&itable_stub_mutex))
+		die("pthread_mutex_unlock");
+
+	return stub;
+}
+
+/*
+ * Called with vtable_lock() held when the vtable slot @vtable_index of @vmc
+ * is fixed up to point to @target.
+ */
+void vm_itable_fixup(struct vm_class *vmc, unsigned long vtable_index, void *target)
+{
+	struct vm_itable *itable = &vmc->itable;
+
+	for (unsigned int i = 0; i < itable->nr_interfaces; ++i) {
+		struct vm_itable_entry *entry = &itable->table[i];
+
+		for (unsigned int j = 0; j < entry->interface->nr_itable_methods; ++j) {
+			if (entry->vtable_index[j] == vtable_index)
+				entry->entries[j] = target;
+		}
+	}
 }
@@ -55,6 +55,7 @@
 #include "runtime/class.h"
 #include "runtime/classloader.h"
 
+#include "jit/compile-queue.h"
 #include "jit/compiler.h"
 #include "jit/cu-mapping.h"
 #include "jit/gdb.h"
@@ -71,6 +72,7 @@
 #include "vm/natives.h"
 #include "vm/preload.h"
 #include "vm/version.h"
+#include "vm/interp.h"
 #include "vm/itable.h"
 #include "vm/method.h"
 #include "vm/object.h"
@@ -81,6 +83,7 @@
 #include "vm/thread.h"
 #include "vm/class.h"
 #include "vm/call.h"
+#include "vm/heap.h"
 #include "vm/jar.h"
 #include "vm/jni.h"
 #include "vm/gc.h"
@@ -348,11 +351,19 @@ native_vmsystem_arraycopy(struct vm_object *src, int src_start,
 		return;
 	}
 
+	if (elem_type == J_REFERENCE && gc_marking) {
+		for (jint i = 0; i < len; i++)
+			gc_satb_barrier(array_get_field_object(dest, dest_start + i));
+	}
+
 	elem_size = get_vmtype_size(elem_type);
 	memmove(dest->fields + dest_start * elem_size,
 		src->fields + src_start * elem_size,
 		len * elem_size);
 
+	if (elem_type == J_REFERENCE)
+		gc_write_barrier(dest);
+
 	return;
 }
 
@@ -468,7 +479,7 @@ static void native_vmthread_interrupt(struct vm_object *vmthread)
 
 static void native_vmobject_notify(struct vm_object *obj)
 {
-	vm_monitor_notify(&obj->monitor);
+	vm_object_notify(obj);
 
 	if (exception_occurred())
 		return;
@@ -476,7 +487,7 @@ static void native_vmobject_notify(struct vm_object *obj)
 
 static void native_vmobject_notify_all(struct vm_object *obj)
 {
-	vm_monitor_notify_all(&obj->monitor);
+	vm_object_notify_all(obj);
 
 	if (exception_occurred())
 		return;
@@ -497,9 +508,9 @@ static jlong native_vmsystem_nano_time(void)
 static void native_vmobject_wait(struct vm_object *object, jlong ms, jint ns)
 {
 	if (ms == 0 && ns == 0)
-		vm_monitor_wait(&object->monitor);
+		vm_object_wait(object);
 	else
-		vm_monitor_timed_wait(&object->monitor, ms, ns);
+		vm_object_timed_wait(object, ms, ns);
 }
 
 static struct vm_object *native_vmstring_intern(struct vm_object *str)
@@ -548,9 +559,13 @@ static struct vm_native natives[] = {
 	DEFINE_NATIVE("java/lang/VMObject", "notifyAll", native_vmobject_notify_all),
 	DEFINE_NATIVE("java/lang/VMObject", "wait", native_vmobject_wait),
 	DEFINE_NATIVE("java/lang/VMRuntime", "exit", native_vmruntime_exit),
+	DEFINE_NATIVE("java/lang/VMRuntime", "freeMemory", native_vmruntime_free_memory),
+	DEFINE_NATIVE("java/lang/VMRuntime", "gc", native_vmruntime_gc),
 	DEFINE_NATIVE("java/lang/VMRuntime", "mapLibraryName", native_vmruntime_maplibraryname),
+	DEFINE_NATIVE("java/lang/VMRuntime", "maxMemory", native_vmruntime_max_memory),
 	DEFINE_NATIVE("java/lang/VMRuntime", "nativeLoad", native_vmruntime_native_load),
 	DEFINE_NATIVE("java/lang/VMRuntime", "runFinalizationForExit", native_vmruntime_run_finalization_for_exit),
+	DEFINE_NATIVE("java/lang/VMRuntime", "totalMemory", native_vmruntime_total_memory),
 	DEFINE_NATIVE("java/lang/VMString", "intern", native_vmstring_intern),
 	DEFINE_NATIVE("java/lang/VMSystem", "arraycopy", native_vmsystem_arraycopy),
 	DEFINE_NATIVE("java/lang/VMSystem", "identityHashCode", native_vmsystem_identityhashcode),
@@ -656,6 +671,118 @@ static void handle_gc(void)
 	gc_enabled = true;
 }
 
+static void handle_nogc(void)
+{
+	gc_enabled = false;
+}
+
+static unsigned long parse_heap_size(const char *arg)
+{
+	unsigned long size;
+	char *end;
+
+	size = strtoul(arg, &end, 10);
+
+	switch (*end) {
+	case 'g':
+	case 'G':
+		size *= 1024;
+		/* fall through */
+	case 'm':
+	case 'M':
+		size *= 1024;
+		/* fall through */
+	case 'k':
+	case 'K':
+		size *= 1024;
+		end++;
+		break;
+	}
+
+	if (end == arg || *end != '\0' || size == 0)
+		usage(stderr, EXIT_FAILURE);
+
+	return size;
+}
+
+static void handle_heap_min_size(const char *arg)
+{
+	heap_min_size = parse_heap_size(arg);
+}
+
+static void handle_heap_max_size(const char *arg)
+{
+	heap_max_size = parse_heap_size(arg);
+}
+
+static void handle_gc_nursery_size(const char *arg)
+{
+	gc_nursery_size = parse_heap_size(arg);
+}
+
+static void handle_gc_trigger_percent(const char *arg)
+{
+	char *end;
+
+	gc_trigger_percent = strtoul(arg, &end, 10);
+
+	if (end == arg || *end != '\0')
+		usage(stderr, EXIT_FAILURE);
+
+	if (gc_trigger_percent < 1 || gc_trigger_percent > 100)
+		usage(stderr, EXIT_FAILURE);
+}
+
+static void handle_gc_nr_workers(const char *arg)
+{
+	char *end;
+
+	gc_nr_workers = strtoul(arg, &end, 10);
+
+	if (end == arg || *end != '\0' || gc_nr_workers < 1)
+		usage(stderr, EXIT_FAILURE);
+}
+
+static void handle_nr_compiler_threads(const char *arg)
+{
+	char *end;
+
+	opt_nr_compiler_threads = strtol(arg, &end, 10);
+
+	if (end == arg || *end != '\0' || opt_nr_compiler_threads < 0)
+		usage(stderr, EXIT_FAILURE);
+}
+
+static void handle_tiered_compilation(void)
+{
+	opt_tiered_compilation = true;
+}
+
+static void handle_no_tiered_compilation(void)
+{
+	opt_tiered_compilation = false;
+}
+
+static void handle_no_interpreter(void)
+{
+	opt_interpreter = false;
+}
+
+static void handle_compile_threshold(const char *arg)
+{
+	char *end;
+
+	opt_compile_threshold = strtoul(arg, &end, 10);
+
+	if (end == arg || *end != '\0')
+		usage(stderr, EXIT_FAILURE);
+}
+
+static void handle_gc_concurrent_mark(void)
+{
+	gc_concurrent_mark = true;
+}
+
 static void handle_maps(void)
 {
 	dump_maps = true;
@@ -739,6 +866,16 @@ static void handle_trace_jit(void)
 	opt_trace_compile = true;
 }
 
+static void handle_trace_biased_locking(void)
+{
+	opt_trace_biased_locking = true;
+}
+
+static void handle_trace_monitors(void)
+{
+	opt_trace_monitors = true;
+}
+
 static void handle_trace_bytecode(void)
 {
 	opt_trace_bytecode = true;
@@ -818,12 +955,25 @@ const struct option options[] = {
 	DEFINE_OPTION("verbose:gc",	handle_verbose_gc),
 
 	DEFINE_OPTION("Xgc",			handle_gc),
+	DEFINE_OPTION("Xnogc",			handle_nogc),
+	DEFINE_OPTION_ADJACENT_ARG("Xms",	handle_heap_min_size),
+	DEFINE_OPTION_ADJACENT_ARG("Xmx",	handle_heap_max_size),
+	DEFINE_OPTION_ADJACENT_ARG("Xmn",	handle_gc_nursery_size),
+	DEFINE_OPTION_ADJACENT_ARG("XX:GCTriggerPercent=",	handle_gc_trigger_percent),
+	DEFINE_OPTION_ADJACENT_ARG("XX:ParallelGCThreads=",	handle_gc_nr_workers),
+	DEFINE_OPTION("XX:+ConcurrentMark",	handle_gc_concurrent_mark),
+	DEFINE_OPTION_ADJACENT_ARG("XX:CICompilerCount=",	handle_nr_compiler_threads),
+	DEFINE_OPTION("XX:+TieredCompilation",	handle_tiered_compilation),
+	DEFINE_OPTION("XX:-TieredCompilation",	handle_no_tiered_compilation),
+	DEFINE_OPTION_ADJACENT_ARG("XX:CompileThreshold=",	handle_compile_threshold),
+	DEFINE_OPTION("XX:-UseInterpreter",	handle_no_interpreter),
 	DEFINE_OPTION("Xmaps",			handle_maps),
 	DEFINE_OPTION("Xperf",			handle_perf),
 
 	DEFINE_OPTION_ARG("Xtrace:method",	handle_trace_method),
 
 	DEFINE_OPTION("Xtrace:asm",		handle_trace_asm),
+	DEFINE_OPTION("Xtrace:biased-locking",	handle_trace_biased_locking),
 	DEFINE_OPTION("Xtrace:bytecode",	handle_trace_bytecode),
 	DEFINE_OPTION("Xtrace:bytecode-offset",	handle_trace_bytecode_offset),
 	DEFINE_OPTION("Xtrace:classloader",	handle_trace_classloader),
@@ -833,6 +983,7 @@ const struct option options[] = {
 	DEFINE_OPTION("Xtrace:invoke-verbose",	handle_trace_invoke_verbose),
 	DEFINE_OPTION("Xtrace:itable",		handle_trace_itable),
 	DEFINE_OPTION("Xtrace:jit",		handle_trace_jit),
+	DEFINE_OPTION("Xtrace:monitors",	handle_trace_monitors),
 	DEFINE_OPTION("Xtrace:trampoline",	handle_trace_trampoline),
 };
 
@@ -1037,7 +1188,6 @@ main(int argc, char *argv[])
 	classloader_init();
 
 	init_vm_objects();
-	init_vm_monitors();
 
 	jit_text_init();
 
@@ -1076,6 +1226,9 @@ main(int argc, char *argv[])
 		goto out_check_exception;
 	}
 
+	compile_queue_init();
+	trampoline_init();
+
 	switch (operation) {
 	case OPERATION_MAIN_CLASS:
 		do_main_class();
@@ -162,6 +162,22 @@ int vm_jni_load_object(const char *name, struct vm_object *classloader)
 	return 0;
 }
 
+/*
+ * Calls @fn for the classloader of every loaded JNI library. The world must
+ * be stopped.
+ */
+void vm_jni_for_each_classloader(void (*fn)(struct vm_object *))
+{
+	struct hash_map_entry *this;
+
+	hash_map_for_each_entry(this, jni_objects) {
+		struct jni_object *object = this->value;
+
+		if (object->classloader)
+			fn(object->classloader);
+	}
+}
+
 static void *vm_jni_lookup_symbol(const char *symbol_name)
 {
 	struct hash_map_entry *this;
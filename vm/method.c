@@ -75,6 +75,8 @@ int vm_method_init(struct vm_method *vmm,
 		++vmm->args_count;
 
 	vmm->is_vm_native = false;
+	vmm->itable_stub = NULL;
+	vmm->interp = VM_METHOD_INTERP_UNKNOWN;
 
 	if (vm_method_is_native(vmm)) {
 		vmm->is_vm_native =
@@ -144,6 +146,8 @@ int vm_method_init_from_interface(struct vm_method *vmm, struct vm_class *vmc,
 
 	vmm->args_count = interface_method->args_count;
 	vmm->is_vm_native = false;
+	vmm->itable_stub = NULL;
+	vmm->interp = VM_METHOD_INTERP_UNKNOWN;
 
 	if (parse_method_type(vmm)) {
 		warn("method type parsing failed for: %s", vmm->type);
@@ -165,6 +169,9 @@ int vm_method_prepare_jit(struct vm_method *vmm)
 
 	vmm->compilation_unit = cu;
 
+	vmm->is_overridden = false;
+	INIT_LIST_HEAD(&vmm->cha_site_list);
+
 	/*
 	 * VM native methods are linked on initialization.
 	 */
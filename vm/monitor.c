@@ -25,64 +25,253 @@
  */
 
 #include <errno.h>
+#include <limits.h>
 #include <pthread.h>
+#include <stdlib.h>
+#include <time.h>
 
+#include "arch/atomic.h"
+#include "arch/memory.h"
+
+#include "lib/futex.h"
+
+#include "jit/compilation-unit.h"
 #include "jit/exception.h"
 
+#include "vm/class.h"
+#include "vm/die.h"
+#include "vm/gc.h"
+#include "vm/heap.h"
 #include "vm/object.h"
 #include "vm/preload.h"
+#include "vm/stack-trace.h"
+#include "vm/stdlib.h"
+#include "vm/system.h"
+#include "vm/trace.h"
+
+/*
+ * The monitor mutex is not recursive; recursive locking is tracked with
+ * @owner and @lock_count instead.
+ */
+int vm_monitor_init(struct vm_monitor *mon)
+{
+	if (pthread_mutex_init(&mon->mutex, NULL))
+		return -1;
+
+	INIT_LIST_HEAD(&mon->wait_queue);
+	INIT_LIST_HEAD(&mon->entry_queue);
+	mon->owner = NULL;
+	mon->lock_count = 0;
+	mon->object = NULL;
+	INIT_LIST_HEAD(&mon->inflated_node);
+	mon->spin_limit = 0;
+	mon->owner_method = NULL;
+	mon->profile = NULL;
 
-static pthread_mutexattr_t monitor_mutexattr;
+	return 0;
+}
 
-int init_vm_monitors(void)
+/*
+ * @owner is only written by the thread holding @mutex: it is set right after
+ * the mutex is acquired and cleared right before it is released, so the mutex
+ * operations order it. Other threads only compare it against themselves and
+ * a thread can never observe itself unless it stored itself, hence a plain
+ * pointer-sized access is enough and no barrier is needed here.
+ */
+struct vm_thread *vm_monitor_get_owner(struct vm_monitor *mon)
 {
-	int err;
+	return *(struct vm_thread * volatile *) &mon->owner;
+}
 
-	err = pthread_mutexattr_init(&monitor_mutexattr);
-	if (err)
-		return -err;
+void vm_monitor_set_owner(struct vm_monitor *mon, struct vm_thread *owner)
+{
+	*(struct vm_thread * volatile *) &mon->owner = owner;
+}
 
-	err = pthread_mutexattr_settype(&monitor_mutexattr,
-		PTHREAD_MUTEX_RECURSIVE);
-	if (err)
-		return -err;
+/*
+ * Contention profile of a monitor for -Xtrace:monitors. Profiles outlive
+ * their monitors so that the report at exit covers every monitor.
+ */
+struct monitor_profile {
+	struct list_head	node;
+	void			*monitor;
+	const char		*class_name;
+	struct vm_method	*owner_method;
+	unsigned long		nr_contended;
+	unsigned long long	blocked_ns;
+};
+
+bool opt_trace_monitors;
+
+static pthread_mutex_t monitor_profiles_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct list_head monitor_profiles = LIST_HEAD_INIT(monitor_profiles);
+static unsigned long nr_monitor_profiles;
+
+static struct vm_method *current_java_method(void)
+{
+	struct stack_trace_elem elem;
+	struct compilation_unit *cu;
 
-	return 0;
+	init_stack_trace_elem_current(&elem);
+
+	if (stack_trace_elem_next_java(&elem))
+		return NULL;
+
+	cu = stack_trace_elem_get_cu(&elem);
+	if (!cu)
+		return NULL;
+
+	return cu->method;
 }
 
-int vm_monitor_init(struct vm_monitor *mon)
+/*
+ * Records that the current thread was blocked on @mon since @start while
+ * @owner_method held it. Called with @mon held.
+ */
+static void profile_contention(struct vm_monitor *mon,
+			       struct vm_method *owner_method,
+			       struct timespec *start)
 {
-	if (pthread_mutex_init(&mon->owner_mutex, NULL))
-		return -1;
+	struct monitor_profile *profile;
+	struct timespec now;
 
-	if (pthread_mutex_init(&mon->mutex, &monitor_mutexattr))
-		return -1;
+	clock_gettime(CLOCK_MONOTONIC, &now);
 
-	if (pthread_cond_init(&mon->cond, NULL))
-		return -1;
+	if (pthread_mutex_lock(&monitor_profiles_mutex))
+		die("pthread_mutex_lock");
 
-	mon->owner = NULL;
-	mon->lock_count = 0;
+	profile = mon->profile;
+	if (!profile) {
+		profile = zalloc(sizeof *profile);
+		if (!profile)
+			goto out;
+
+		profile->monitor = mon;
+		if (mon->object)
+			profile->class_name = mon->object->class->name;
+		else
+			profile->class_name = "(class initialization)";
+
+		list_add_tail(&profile->node, &monitor_profiles);
+		nr_monitor_profiles++;
+		mon->profile = profile;
+	}
+
+	profile->nr_contended++;
+	profile->blocked_ns += (now.tv_sec - start->tv_sec) * 1000000000ULL
+		+ now.tv_nsec - start->tv_nsec;
+	profile->owner_method = owner_method;
+out:
+	if (pthread_mutex_unlock(&monitor_profiles_mutex))
+		die("pthread_mutex_unlock");
+}
+
+static int profile_cmp(const void *p1, const void *p2)
+{
+	const struct monitor_profile *a = *(const struct monitor_profile **) p1;
+	const struct monitor_profile *b = *(const struct monitor_profile **) p2;
+
+	if (a->blocked_ns != b->blocked_ns)
+		return a->blocked_ns < b->blocked_ns ? 1 : -1;
 
 	return 0;
 }
 
-struct vm_thread *vm_monitor_get_owner(struct vm_monitor *mon)
+/*
+ * Prints the contended monitors, the ones threads were blocked on longest
+ * first.
+ */
+void vm_monitor_print_profile(void)
 {
-	struct vm_thread *owner;
+	struct monitor_profile **profiles, *profile;
+	unsigned long i = 0;
+
+	if (pthread_mutex_lock(&monitor_profiles_mutex))
+		die("pthread_mutex_lock");
+
+	profiles = malloc(nr_monitor_profiles * sizeof *profiles);
+	if (!profiles)
+		goto out;
 
-	pthread_mutex_lock(&mon->owner_mutex);
-	owner = mon->owner;
-	pthread_mutex_unlock(&mon->owner_mutex);
+	list_for_each_entry(profile, &monitor_profiles, node)
+		profiles[i++] = profile;
 
-	return owner;
+	qsort(profiles, nr_monitor_profiles, sizeof *profiles, profile_cmp);
+
+	trace_printf("Monitor contention (%lu contended monitors):\n", nr_monitor_profiles);
+
+	for (i = 0; i < nr_monitor_profiles; i++) {
+		struct vm_method *vmm;
+
+		profile = profiles[i];
+		vmm = profile->owner_method;
+
+		trace_printf("  %p %-32s %8lu contended %10llu us blocked, owner %s%s%s\n",
+			     profile->monitor, profile->class_name,
+			     profile->nr_contended, profile->blocked_ns / 1000,
+			     vmm ? vmm->class->name : "unknown",
+			     vmm ? "." : "", vmm ? vmm->name : "");
+	}
+
+	trace_flush();
+	free(profiles);
+out:
+	if (pthread_mutex_unlock(&monitor_profiles_mutex))
+		die("pthread_mutex_unlock");
 }
 
-void vm_monitor_set_owner(struct vm_monitor *mon, struct vm_thread *owner)
+#define MONITOR_SPIN_MIN	16
+#define MONITOR_SPIN_MAX	4096
+
+/*
+ * Spins for a monitor which is held by another thread. The spin limit
+ * follows how many attempts recent acquisitions took, which approximates
+ * how long the monitor is held, and shrinks when spinning does not pay
+ * off so that monitors with long critical sections park right away.
+ * Returns true if the monitor was acquired.
+ */
+static bool vm_monitor_spin(struct vm_monitor *mon)
+{
+	unsigned int limit = mon->spin_limit + MONITOR_SPIN_MIN;
+
+	for (unsigned int i = 1; i <= limit; i++) {
+		cpu_relax();
+
+		if (!pthread_mutex_trylock(&mon->mutex)) {
+			mon->spin_limit = min((mon->spin_limit + 2 * i) / 2, (unsigned int) MONITOR_SPIN_MAX);
+			return true;
+		}
+	}
+
+	mon->spin_limit /= 2;
+
+	return false;
+}
+
+static int vm_monitor_park(struct vm_monitor *mon, struct vm_thread *self)
 {
-	pthread_mutex_lock(&mon->owner_mutex);
-	mon->owner = owner;
-	pthread_mutex_unlock(&mon->owner_mutex);
+	struct vm_method *owner_method = NULL;
+	struct timespec start;
+	int err;
+
+	if (opt_trace_monitors) {
+		owner_method = mon->owner_method;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+	}
+
+	/*
+	 * XXX: according to Thread.getState() documentation thread
+	 * state does not have to be precise, it's used rather
+	 * for monitoring.
+	 */
+	vm_thread_set_state(self, VM_THREAD_STATE_BLOCKED);
+	err = pthread_mutex_lock(&mon->mutex);
+	vm_thread_set_state(self, VM_THREAD_STATE_RUNNABLE);
+
+	if (opt_trace_monitors && !err)
+		profile_contention(mon, owner_method, &start);
+
+	return err;
 }
 
 int vm_monitor_lock(struct vm_monitor *mon)
@@ -93,56 +282,112 @@ int vm_monitor_lock(struct vm_monitor *mon)
 	self = vm_thread_self();
 	err = 0;
 
-	if (pthread_mutex_trylock(&mon->mutex)) {
-		/*
-		 * XXX: according to Thread.getState() documentation thread
-		 * state does not have to be precise, it's used rather
-		 * for monitoring.
-		 */
-		vm_thread_set_state(self, VM_THREAD_STATE_BLOCKED);
-		err = pthread_mutex_lock(&mon->mutex);
-		vm_thread_set_state(self, VM_THREAD_STATE_RUNNABLE);
+	/*
+	 * Only the owner can see itself in @owner so no race here. Threads
+	 * which are not attached yet have no vm_thread; that only happens
+	 * while the VM is bootstrapped on a single thread.
+	 */
+	if (mon->lock_count && vm_monitor_get_owner(mon) == self) {
+		mon->lock_count++;
+		return 0;
 	}
 
+	if (pthread_mutex_trylock(&mon->mutex) && !vm_monitor_spin(mon))
+		err = vm_monitor_park(mon, self);
+
 	/* If err is non zero the lock has not been acquired. */
 	if (!err) {
 		vm_monitor_set_owner(mon, self);
-		mon->lock_count++;
+		mon->lock_count = 1;
+
+		if (opt_trace_monitors)
+			mon->owner_method = current_java_method();
 	}
 
 	return err;
 }
 
+/*
+ * Waiting threads sleep on their own futex word. A notification moves the
+ * waiter from @wait_queue to @entry_queue, and each time the monitor is
+ * released the first thread on @entry_queue is woken. Notified threads thus
+ * only run once the notifier has left the monitor, one at a time, instead of
+ * all of them stampeding the mutex. Both queues are protected by @mutex.
+ */
+static struct vm_thread *vm_monitor_dequeue_entry(struct vm_monitor *mon)
+{
+	struct vm_thread *thread;
+
+	if (list_is_empty(&mon->entry_queue))
+		return NULL;
+
+	thread = list_first_entry(&mon->entry_queue, struct vm_thread, wait_node);
+	list_del(&thread->wait_node);
+	INIT_LIST_HEAD(&thread->wait_node);
+
+	return thread;
+}
+
+void vm_monitor_wake_waiter(struct vm_thread *thread)
+{
+	*(volatile uint32_t *) &thread->wait_futex = 1;
+	futex_wake(&thread->wait_futex, 1);
+}
+
+static void vm_monitor_sleep(struct vm_thread *self,
+			     const struct timespec *deadline)
+{
+	while (!*(volatile uint32_t *) &self->wait_futex) {
+		if (futex_wait(&self->wait_futex, 0, deadline) && errno == ETIMEDOUT)
+			break;
+	}
+}
+
 int vm_monitor_unlock(struct vm_monitor *mon)
 {
+	struct vm_thread *next;
+
 	if (vm_monitor_get_owner(mon) != vm_thread_self()) {
 		signal_new_exception(vm_java_lang_IllegalMonitorStateException,
 				     NULL);
 		return -1;
 	}
 
-	if (--mon->lock_count == 0)
-		vm_monitor_set_owner(mon, NULL);
+	if (--mon->lock_count > 0)
+		return 0;
+
+	vm_monitor_set_owner(mon, NULL);
+
+	next = vm_monitor_dequeue_entry(mon);
 
 	int err = pthread_mutex_unlock(&mon->mutex);
 
 	/* If err is non zero the lock has not been released. */
 	if (err) {
+		if (next)
+			list_add(&next->wait_node, &mon->entry_queue);
+
 		++mon->lock_count;
 		vm_monitor_set_owner(mon, vm_thread_self());
+		return err;
 	}
 
-	return err;
+	if (next)
+		vm_monitor_wake_waiter(next);
+
+	return 0;
 }
 
-static int vm_monitor_do_wait(struct vm_monitor *mon, struct timespec *timespec)
+static int vm_monitor_do_wait(struct vm_monitor *mon, struct timespec *deadline)
 {
-	struct vm_thread *self;
+	struct vm_thread *self, *next;
 	int old_lock_count;
 	bool interrupted;
-	int err;
+	bool notified;
 
-	if (vm_monitor_get_owner(mon) != vm_thread_self()) {
+	self = vm_thread_self();
+
+	if (vm_monitor_get_owner(mon) != self) {
 		signal_new_exception(vm_java_lang_IllegalMonitorStateException,
 				     NULL);
 		return -1;
@@ -152,10 +397,17 @@ static int vm_monitor_do_wait(struct vm_monitor *mon, struct timespec *timespec)
 	mon->lock_count = 0;
 	vm_monitor_set_owner(mon, NULL);
 
-	self = vm_thread_self();
+	self->wait_futex = 0;
+	self->wait_notified = false;
+	list_add_tail(&self->wait_node, &mon->wait_queue);
 
+	/*
+	 * vm_thread_interrupt() wakes the thread through @wait_futex when
+	 * @wait_mon is set, so it must be published after the futex word
+	 * has been reset.
+	 */
 	pthread_mutex_lock(&self->mutex);
-	if (timespec != NULL)
+	if (deadline != NULL)
 		self->state = VM_THREAD_STATE_TIMED_WAITING;
 	else
 		self->state = VM_THREAD_STATE_WAITING;
@@ -164,50 +416,70 @@ static int vm_monitor_do_wait(struct vm_monitor *mon, struct timespec *timespec)
 	interrupted = self->interrupted;
 	pthread_mutex_unlock(&self->mutex);
 
-	if (interrupted)
-		err = 0;
-	else if (timespec) {
-		err = pthread_cond_timedwait(&mon->cond, &mon->mutex, timespec);
-		if (err == ETIMEDOUT)
-			err = 0;
-	} else
-		err = pthread_cond_wait(&mon->cond, &mon->mutex);
+	next = vm_monitor_dequeue_entry(mon);
+
+	if (pthread_mutex_unlock(&mon->mutex))
+		die("pthread_mutex_unlock");
+
+	if (next)
+		vm_monitor_wake_waiter(next);
+
+	if (!interrupted)
+		vm_monitor_sleep(self, deadline);
 
 	pthread_mutex_lock(&self->mutex);
-	self->state = VM_THREAD_STATE_RUNNABLE;
+	self->state = VM_THREAD_STATE_BLOCKED;
 	self->wait_mon = NULL;
 	pthread_mutex_unlock(&self->mutex);
 
+	if (pthread_mutex_lock(&mon->mutex))
+		die("pthread_mutex_lock");
+
+	vm_thread_set_state(self, VM_THREAD_STATE_RUNNABLE);
+
+	/* Timed out, interrupted or woken before being dequeued. */
+	if (!list_is_empty(&self->wait_node)) {
+		list_del(&self->wait_node);
+		INIT_LIST_HEAD(&self->wait_node);
+	}
+
+	notified = self->wait_notified;
+
 	vm_monitor_set_owner(mon, self);
 	mon->lock_count = old_lock_count;
 
-	if (vm_thread_interrupted(self)) {
+	/*
+	 * A thread which has been both notified and interrupted returns
+	 * normally and leaves the interrupt pending so that the notification
+	 * is not lost.
+	 */
+	if (!notified && vm_thread_interrupted(self)) {
 		signal_new_exception(vm_java_lang_InterruptedException, NULL);
 		return -1;
 	}
 
-	return err;
+	return 0;
 }
 
 int vm_monitor_timed_wait(struct vm_monitor *mon, long long ms, int ns)
 {
-	struct timespec timespec;
+	struct timespec deadline;
 
 	/*
-	 * XXX: we must use CLOCK_REALTIME here because
-	 * pthread_cond_timedwait() uses this clock.
+	 * The futex deadline is measured on CLOCK_MONOTONIC so that the
+	 * timeout is not affected by changes to the wall clock.
 	 */
-	clock_gettime(CLOCK_REALTIME, &timespec);
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
 
-	timespec.tv_sec += ms / 1000;
-	timespec.tv_nsec += (long)ns + (long)(ms % 1000) * 1000000l;
+	deadline.tv_sec += ms / 1000;
+	deadline.tv_nsec += (long)ns + (long)(ms % 1000) * 1000000l;
 
-	if (timespec.tv_nsec >= 1000000000l) {
-		timespec.tv_sec++;
-		timespec.tv_nsec -= 1000000000l;
+	if (deadline.tv_nsec >= 1000000000l) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000l;
 	}
 
-	return vm_monitor_do_wait(mon, &timespec);
+	return vm_monitor_do_wait(mon, &deadline);
 }
 
 int vm_monitor_wait(struct vm_monitor *mon)
@@ -215,6 +487,17 @@ int vm_monitor_wait(struct vm_monitor *mon)
 	return vm_monitor_do_wait(mon, NULL);
 }
 
+static void vm_monitor_requeue_waiter(struct vm_monitor *mon)
+{
+	struct vm_thread *thread;
+
+	thread = list_first_entry(&mon->wait_queue, struct vm_thread, wait_node);
+	thread->wait_notified = true;
+
+	list_del(&thread->wait_node);
+	list_add_tail(&thread->wait_node, &mon->entry_queue);
+}
+
 int vm_monitor_notify(struct vm_monitor *mon)
 {
 	if (vm_monitor_get_owner(mon) != vm_thread_self()) {
@@ -223,16 +506,510 @@ int vm_monitor_notify(struct vm_monitor *mon)
 		return -1;
 	}
 
-	return pthread_cond_signal(&mon->cond);
+	if (!list_is_empty(&mon->wait_queue))
+		vm_monitor_requeue_waiter(mon);
+
+	return 0;
 }
 
 int vm_monitor_notify_all(struct vm_monitor *mon)
 {
-	if (vm_monitor_get_owner(mon) != vm_get_exec_env()->thread) {
+	if (vm_monitor_get_owner(mon) != vm_thread_self()) {
+		signal_new_exception(vm_java_lang_IllegalMonitorStateException,
+				     NULL);
+		return -1;
+	}
+
+	while (!list_is_empty(&mon->wait_queue))
+		vm_monitor_requeue_waiter(mon);
+
+	return 0;
+}
+
+/*
+ * Object locks
+ *
+ * Objects do not carry a monitor. The lock word in the object header is in
+ * one of these states:
+ *
+ *   0                               never locked
+ *   owner | depth                   biased towards @owner and locked @depth
+ *                                   times by it
+ *   VM_LOCK_UNBIASED                unlocked
+ *   owner | VM_LOCK_UNBIASED | n    thin locked by @owner with @n re-entries
+ *   ... | VM_LOCK_CONTENDED         thin locked, other threads are waiting
+ *   monitor | VM_LOCK_INFLATED      inflated to a vm_monitor
+ *
+ * The first thread which locks an object gets the bias. Only the bias owner
+ * changes a biased word so JIT compiled code locks and unlocks it with plain
+ * stores. When another thread wants the lock the bias is revoked with every
+ * thread stopped at a safepoint and the word becomes a thin lock. C code can
+ * be stopped anywhere, so it updates biased words with compare and swap.
+ *
+ * Thin locks are taken with a single compare and swap. A thread which finds
+ * the object thin locked by another thread sets VM_LOCK_CONTENDED with
+ * compare and swap and sleeps on the lock word futex. Thin locks are
+ * therefore also updated and released with compare and swap, and an owner
+ * which finds the bit set when it releases the lock inflates the lock word
+ * to an unlocked vm_monitor and wakes the sleepers, which then queue on the
+ * monitor mutex.
+ *
+ * The lock word is also inflated when the owner calls wait() on the object,
+ * when the count overflows, and when a thread without a vm_thread finds the
+ * object unlocked. Inflated monitors are never deflated; they are freed by
+ * the garbage collector together with the object.
+ */
+
+bool opt_trace_biased_locking;
+
+static uint32_t nr_bias_grants;
+static uint32_t nr_bias_revocations;
+
+static struct list_head inflated_monitors = LIST_HEAD_INIT(inflated_monitors);
+
+static void count_lock_event(uint32_t *counter)
+{
+	uint32_t old;
+
+	if (!opt_trace_biased_locking)
+		return;
+
+	do {
+		old = *(volatile uint32_t *) counter;
+	} while (atomic_cmpxchg_32(counter, old, old + 1) != old);
+}
+
+static inline struct vm_monitor *lock_word_monitor(unsigned long word)
+{
+	return (struct vm_monitor *) (word & ~VM_LOCK_INFLATED);
+}
+
+static inline struct vm_thread *lock_word_owner(unsigned long word)
+{
+	return (struct vm_thread *) (word & ~VM_LOCK_BITS);
+}
+
+static inline unsigned long lock_word_count(unsigned long word)
+{
+	return (word & VM_LOCK_COUNT_MASK) / VM_LOCK_COUNT_ONE;
+}
+
+static inline bool lock_word_is_biased(unsigned long word)
+{
+	return word && !(word & (VM_LOCK_INFLATED | VM_LOCK_UNBIASED));
+}
+
+/*
+ * Returns true if the lock word @word, which is not inflated, is held by
+ * @self.
+ */
+static bool lock_word_is_held(unsigned long word, struct vm_thread *self)
+{
+	if (!self || lock_word_owner(word) != self)
+		return false;
+
+	if (lock_word_is_biased(word))
+		return lock_word_count(word) > 0;
+
+	return true;
+}
+
+static bool lock_word_cmpxchg(struct vm_object *obj, unsigned long old,
+			      unsigned long new)
+{
+	return atomic_cmpxchg_ptr(&obj->lock_word, (void *) old,
+				  (void *) new) == (void *) old;
+}
+
+/*
+ * Threads contending for a thin lock sleep on the low half of the lock word,
+ * which holds the lock bits on x86.
+ */
+static inline volatile uint32_t *lock_word_futex(struct vm_object *obj)
+{
+	return (volatile uint32_t *) &obj->lock_word;
+}
+
+static void wake_contenders(struct vm_object *obj)
+{
+	futex_wake(lock_word_futex(obj), INT_MAX);
+}
+
+/*
+ * Turns a biased lock word into the equivalent thin lock. Runs with every
+ * thread stopped at a safepoint so the bias owner can not race with us.
+ */
+static void revoke_bias(void *arg)
+{
+	struct vm_object *obj = arg;
+	unsigned long word = obj->lock_word;
+	unsigned long depth;
+
+	if (!lock_word_is_biased(word))
+		return;
+
+	depth = lock_word_count(word);
+	if (depth)
+		obj->lock_word = (unsigned long) lock_word_owner(word)
+			| VM_LOCK_UNBIASED | (depth - 1) * VM_LOCK_COUNT_ONE;
+	else
+		obj->lock_word = VM_LOCK_UNBIASED;
+
+	count_lock_event(&nr_bias_revocations);
+}
+
+static struct vm_monitor *vm_monitor_alloc(struct vm_object *obj)
+{
+	struct vm_monitor *mon;
+
+	mon = malloc(sizeof *mon);
+	if (!mon)
+		return NULL;
+
+	if (vm_monitor_init(mon)) {
+		free(mon);
+		return NULL;
+	}
+
+	mon->object = obj;
+
+	return mon;
+}
+
+static void vm_monitor_free(struct vm_monitor *mon)
+{
+	pthread_mutex_destroy(&mon->mutex);
+	free(mon);
+}
+
+/*
+ * The list of inflated monitors is protected by the heap lock so that the
+ * collector never stops a thread in the middle of an update.
+ */
+static void register_inflated_monitor(struct vm_monitor *mon)
+{
+	heap_lock();
+	list_add(&mon->inflated_node, &inflated_monitors);
+	heap_unlock();
+}
+
+/*
+ * Transfers the biased or thin lock of @obj, which is held by the current
+ * thread, to a new monitor. Returns NULL if the monitor can not be
+ * allocated.
+ */
+static struct vm_monitor *inflate_owned(struct vm_object *obj)
+{
+	struct vm_monitor *mon;
+	unsigned long word;
+
+	mon = vm_monitor_alloc(obj);
+	if (!mon)
+		return NULL;
+
+	pthread_mutex_lock(&mon->mutex);
+
+	/* The bias can be revoked under us but the lock stays ours. */
+	do {
+		word = obj->lock_word;
+
+		mon->owner = lock_word_owner(word);
+		mon->lock_count = lock_word_count(word);
+		if (!lock_word_is_biased(word))
+			mon->lock_count++;
+	} while (!lock_word_cmpxchg(obj, word, (unsigned long) mon | VM_LOCK_INFLATED));
+
+	register_inflated_monitor(mon);
+
+	if (word & VM_LOCK_CONTENDED)
+		wake_contenders(obj);
+
+	return mon;
+}
+
+/*
+ * Releases the thin lock of @obj, which is held once by the current thread
+ * and has VM_LOCK_CONTENDED set. Nobody else changes such a word. The lock
+ * is handed to the sleeping threads as an unlocked monitor, or as an
+ * unlocked word which they race for if the monitor can not be allocated.
+ */
+static int unlock_contended(struct vm_object *obj, unsigned long word)
+{
+	struct vm_monitor *mon;
+
+	mon = vm_monitor_alloc(obj);
+	if (!mon) {
+		lock_word_cmpxchg(obj, word, VM_LOCK_UNBIASED);
+		wake_contenders(obj);
+		return 0;
+	}
+
+	lock_word_cmpxchg(obj, word, (unsigned long) mon | VM_LOCK_INFLATED);
+	register_inflated_monitor(mon);
+	wake_contenders(obj);
+
+	return 0;
+}
+
+/*
+ * Inflates the lock word of @obj, which is not held by the current thread,
+ * and acquires the monitor.
+ */
+static int inflate_contended(struct vm_object *obj)
+{
+	struct vm_thread *self = vm_thread_self();
+	struct vm_monitor *mon;
+	bool blocked = false;
+	unsigned long word;
+
+	mon = vm_monitor_alloc(obj);
+	if (!mon) {
+		signal_new_exception(vm_java_lang_OutOfMemoryError, NULL);
+		return -1;
+	}
+
+	pthread_mutex_lock(&mon->mutex);
+	mon->owner = self;
+	mon->lock_count = 1;
+
+	for (;;) {
+		word = obj->lock_word;
+
+		if (word & VM_LOCK_INFLATED)
+			break;
+
+		if (word == 0 || word == VM_LOCK_UNBIASED) {
+			if (lock_word_cmpxchg(obj, word, (unsigned long) mon | VM_LOCK_INFLATED))
+				break;
+
+			continue;
+		}
+
+		if (lock_word_is_biased(word)) {
+			gc_safepoint_operation(revoke_bias, obj);
+			continue;
+		}
+
+		/*
+		 * Thin locked by another thread. Ask the owner to inflate the
+		 * lock when it releases it and sleep until the word changes.
+		 */
+		if (!(word & VM_LOCK_CONTENDED) &&
+		    !lock_word_cmpxchg(obj, word, word | VM_LOCK_CONTENDED))
+			continue;
+
+		if (!blocked && self) {
+			vm_thread_set_state(self, VM_THREAD_STATE_BLOCKED);
+			blocked = true;
+		}
+
+		futex_wait(lock_word_futex(obj), (uint32_t) (word | VM_LOCK_CONTENDED), NULL);
+	}
+
+	if (blocked)
+		vm_thread_set_state(self, VM_THREAD_STATE_RUNNABLE);
+
+	if (word & VM_LOCK_INFLATED) {
+		/* Somebody else inflated the lock first. */
+		pthread_mutex_unlock(&mon->mutex);
+		vm_monitor_free(mon);
+
+		return vm_monitor_lock(lock_word_monitor(word));
+	}
+
+	register_inflated_monitor(mon);
+
+	return 0;
+}
+
+int vm_object_lock(struct vm_object *obj)
+{
+	struct vm_thread *self = vm_thread_self();
+	struct vm_monitor *mon;
+	unsigned long word;
+
+	/*
+	 * Threads which are not attached yet have no vm_thread to record in
+	 * the lock word so they always inflate.
+	 */
+	if (!self)
+		return inflate_contended(obj);
+
+	for (;;) {
+		word = obj->lock_word;
+
+		if (word & VM_LOCK_INFLATED)
+			return vm_monitor_lock(lock_word_monitor(word));
+
+		if (word == 0) {
+			if (lock_word_cmpxchg(obj, 0, (unsigned long) self | VM_LOCK_COUNT_ONE)) {
+				count_lock_event(&nr_bias_grants);
+				return 0;
+			}
+
+			continue;
+		}
+
+		if (word == VM_LOCK_UNBIASED) {
+			if (lock_word_cmpxchg(obj, word, (unsigned long) self | VM_LOCK_UNBIASED))
+				return 0;
+
+			continue;
+		}
+
+		if (lock_word_owner(word) != self) {
+			if (!lock_word_is_biased(word))
+				return inflate_contended(obj);
+
+			gc_safepoint_operation(revoke_bias, obj);
+			continue;
+		}
+
+		if ((word & VM_LOCK_COUNT_MASK) == VM_LOCK_COUNT_MASK)
+			break;
+
+		if (lock_word_cmpxchg(obj, word, word + VM_LOCK_COUNT_ONE))
+			return 0;
+	}
+
+	/* The count does not fit in the lock word. */
+	mon = inflate_owned(obj);
+	if (!mon) {
+		signal_new_exception(vm_java_lang_OutOfMemoryError, NULL);
+		return -1;
+	}
+
+	return vm_monitor_lock(mon);
+}
+
+int vm_object_unlock(struct vm_object *obj)
+{
+	struct vm_thread *self = vm_thread_self();
+	unsigned long word, new;
+
+	for (;;) {
+		word = obj->lock_word;
+
+		if (word & VM_LOCK_INFLATED)
+			return vm_monitor_unlock(lock_word_monitor(word));
+
+		if (!lock_word_is_held(word, self)) {
+			signal_new_exception(vm_java_lang_IllegalMonitorStateException,
+					     NULL);
+			return -1;
+		}
+
+		if (lock_word_is_biased(word) || (word & VM_LOCK_COUNT_MASK))
+			new = word - VM_LOCK_COUNT_ONE;
+		else if (word & VM_LOCK_CONTENDED)
+			return unlock_contended(obj, word);
+		else
+			new = VM_LOCK_UNBIASED;
+
+		if (lock_word_cmpxchg(obj, word, new))
+			return 0;
+	}
+}
+
+/*
+ * Returns the monitor of @obj for wait(). The caller must own the object
+ * lock.
+ */
+static struct vm_monitor *owned_monitor(struct vm_object *obj)
+{
+	unsigned long word = obj->lock_word;
+	struct vm_monitor *mon;
+
+	if (word & VM_LOCK_INFLATED)
+		return lock_word_monitor(word);
+
+	if (!lock_word_is_held(word, vm_thread_self())) {
+		signal_new_exception(vm_java_lang_IllegalMonitorStateException,
+				     NULL);
+		return NULL;
+	}
+
+	mon = inflate_owned(obj);
+	if (!mon)
+		signal_new_exception(vm_java_lang_OutOfMemoryError, NULL);
+
+	return mon;
+}
+
+int vm_object_wait(struct vm_object *obj)
+{
+	struct vm_monitor *mon = owned_monitor(obj);
+
+	if (!mon)
+		return -1;
+
+	return vm_monitor_wait(mon);
+}
+
+int vm_object_timed_wait(struct vm_object *obj, long long ms, int ns)
+{
+	struct vm_monitor *mon = owned_monitor(obj);
+
+	if (!mon)
+		return -1;
+
+	return vm_monitor_timed_wait(mon, ms, ns);
+}
+
+int vm_object_notify(struct vm_object *obj)
+{
+	unsigned long word = obj->lock_word;
+
+	if (word & VM_LOCK_INFLATED)
+		return vm_monitor_notify(lock_word_monitor(word));
+
+	if (!lock_word_is_held(word, vm_thread_self())) {
+		signal_new_exception(vm_java_lang_IllegalMonitorStateException,
+				     NULL);
+		return -1;
+	}
+
+	/* Nobody can wait on a monitor which has not been inflated. */
+	return 0;
+}
+
+int vm_object_notify_all(struct vm_object *obj)
+{
+	unsigned long word = obj->lock_word;
+
+	if (word & VM_LOCK_INFLATED)
+		return vm_monitor_notify_all(lock_word_monitor(word));
+
+	if (!lock_word_is_held(word, vm_thread_self())) {
 		signal_new_exception(vm_java_lang_IllegalMonitorStateException,
 				     NULL);
 		return -1;
 	}
 
-	return pthread_cond_broadcast(&mon->cond);
+	return 0;
+}
+
+/*
+ * Frees the inflated monitors of objects which are about to be reclaimed.
+ * Called by the garbage collector with the world stopped and the heap lock
+ * held after marking.
+ */
+void vm_monitor_reclaim(bool (*is_live)(struct vm_object *))
+{
+	struct vm_monitor *mon, *next;
+
+	list_for_each_entry_safe(mon, next, &inflated_monitors, inflated_node) {
+		if (is_live(mon->object))
+			continue;
+
+		list_del(&mon->inflated_node);
+		vm_monitor_free(mon);
+	}
+}
+
+void vm_monitor_print_stats(void)
+{
+	trace_printf("Biased locking: %u biases granted, %u revoked\n",
+		     nr_bias_grants, nr_bias_revocations);
+	trace_flush();
 }
@@ -43,23 +43,54 @@ int init_vm_objects(void)
 
 struct vm_object *vm_object_alloc(struct vm_class *class)
 {
-	struct vm_object *res;
-
 	if (vm_class_ensure_init(class))
 		return rethrow_exception();
 
+	return vm_object_alloc_initialized(class);
+}
+
+/*
+ * Allocates an instance of @class which must already be initialized. Used by
+ * code compiled after the initialization of @class.
+ */
+struct vm_object *vm_object_alloc_initialized(struct vm_class *class)
+{
+	struct vm_object *res;
+
 	res = gc_alloc(sizeof(*res) + class->object_size);
 	if (!res)
 		return throw_oom_error();
 
 	res->class = class;
 
-	if (vm_monitor_init(&res->monitor))
-		return throw_internal_error();
-
 	return res;
 }
 
+static const char *primitive_array_class_names[] = {
+	[T_BOOLEAN]	= "[Z",
+	[T_CHAR]	= "[C",
+	[T_FLOAT]	= "[F",
+	[T_DOUBLE]	= "[D",
+	[T_BYTE]	= "[B",
+	[T_SHORT]	= "[S",
+	[T_INT]		= "[I",
+	[T_LONG]	= "[J",
+};
+
+/*
+ * Returns the array class for the newarray type code @type.
+ */
+struct vm_class *vm_primitive_array_class(int type)
+{
+	if (type < 0 || type >= (int) ARRAY_SIZE(primitive_array_class_names))
+		return NULL;
+
+	if (!primitive_array_class_names[type])
+		return NULL;
+
+	return classloader_load(NULL, primitive_array_class_names[type]);
+}
+
 struct vm_object *vm_object_alloc_primitive_array(int type, int count)
 {
 	struct vm_object *res;
@@ -72,35 +103,7 @@ struct vm_object *vm_object_alloc_primitive_array(int type, int count)
 	if (!res)
 		return throw_oom_error();
 
-	switch (type) {
-	case T_BOOLEAN:
-		res->class = classloader_load(NULL, "[Z");
-		break;
-	case T_CHAR:
-		res->class = classloader_load(NULL, "[C");
-		break;
-	case T_FLOAT:
-		res->class = classloader_load(NULL, "[F");
-		break;
-	case T_DOUBLE:
-		res->class = classloader_load(NULL, "[D");
-		break;
-	case T_BYTE:
-		res->class = classloader_load(NULL, "[B");
-		break;
-	case T_SHORT:
-		res->class = classloader_load(NULL, "[S");
-		break;
-	case T_INT:
-		res->class = classloader_load(NULL, "[I");
-		break;
-	case T_LONG:
-		res->class = classloader_load(NULL, "[J");
-		break;
-	default:
-		return throw_internal_error();
-	}
-
+	res->class = vm_primitive_array_class(type);
 	if (!res->class)
 		return throw_internal_error();
 
@@ -109,9 +112,6 @@ struct vm_object *vm_object_alloc_primitive_array(int type, int count)
 
 	res->array_length = count;
 
-	if (vm_monitor_init(&res->monitor))
-		return throw_internal_error();
-
 	return res;
 }
 
@@ -134,9 +134,6 @@ vm_object_alloc_multi_array(struct vm_class *class, int nr_dimensions, int *coun
 	if (!res)
 		return throw_oom_error();
 
-	if (vm_monitor_init(&res->monitor))
-		return throw_internal_error();
-
 	res->array_length = counts[0];
 	res->class = class;
 
@@ -162,9 +159,6 @@ struct vm_object *vm_object_alloc_array(struct vm_class *class, int count)
 	if (!res)
 		return throw_oom_error();
 
-	if (vm_monitor_init(&res->monitor))
-		return throw_internal_error();
-
 	res->array_length = count;
 
 	struct vm_object **elems = (struct vm_object **) (res + 1);
@@ -248,16 +242,6 @@ struct vm_object *vm_object_clone(struct vm_object *obj)
 	return NULL;
 }
 
-void vm_object_lock(struct vm_object *obj)
-{
-	vm_monitor_lock(&obj->monitor);
-}
-
-void vm_object_unlock(struct vm_object *obj)
-{
-	vm_monitor_unlock(&obj->monitor);
-}
-
 struct vm_object *
 vm_object_alloc_string_from_utf8(const uint8_t bytes[], unsigned int length)
 {
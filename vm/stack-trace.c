@@ -30,6 +30,7 @@
 #include "vm/call.h"
 #include "vm/class.h"
 #include "vm/classloader.h"
+#include "vm/interp.h"
 #include "vm/jni.h"
 #include "vm/object.h"
 #include "vm/method.h"
@@ -369,6 +370,173 @@ int get_java_stack_trace_depth(struct stack_trace_elem *elem)
 	return depth;
 }
 
+/* Returns the bytecode offset of the call or fault site of @elem. */
+static unsigned long stack_trace_elem_bc_offset(struct stack_trace_elem *elem,
+						struct compilation_unit *cu)
+{
+	if (vm_method_is_native(cu->method))
+		return BC_OFFSET_UNKNOWN;
+
+	return jit_lookup_inline_bc_offset(cu, (unsigned char *) elem->addr);
+}
+
+/*
+ * Interpreted methods run in native frames which the stack walker skips.
+ * Their frames are kept on a per-thread list instead, see vm/interp.c, and
+ * are merged with the Java stack trace elements by the address of their
+ * native frame.
+ */
+struct java_stack_cursor {
+	struct stack_trace_elem	elem;
+	bool			has_elem;
+	struct interp_frame	*iframe;
+};
+
+static bool java_stack_cursor_is_interp(struct java_stack_cursor *c)
+{
+	if (!c->iframe)
+		return false;
+
+	if (!c->has_elem)
+		return true;
+
+	/* The stack grows down. JNI elements have no frame. */
+	return c->elem.frame && c->iframe->native_frame < c->elem.frame;
+}
+
+static bool java_stack_cursor_is_done(struct java_stack_cursor *c)
+{
+	return !c->has_elem && !c->iframe;
+}
+
+static struct vm_method *java_stack_cursor_method(struct java_stack_cursor *c)
+{
+	struct compilation_unit *cu;
+
+	if (java_stack_cursor_is_interp(c))
+		return c->iframe->method;
+
+	cu = stack_trace_elem_get_cu(&c->elem);
+	if (!cu) {
+		fprintf(stderr, "%s: no compilation unit mapping for %p\n",
+			__func__, (void *) c->elem.addr);
+		return NULL;
+	}
+
+	return cu->method;
+}
+
+static void java_stack_cursor_next(struct java_stack_cursor *c)
+{
+	struct vm_method *interp_method;
+	struct compilation_unit *cu;
+
+	if (!java_stack_cursor_is_interp(c)) {
+		c->has_elem = stack_trace_elem_next_java(&c->elem) == 0;
+		return;
+	}
+
+	interp_method = c->iframe->method;
+	c->iframe = c->iframe->prev;
+
+	if (!c->has_elem || java_stack_cursor_is_interp(c))
+		return;
+
+	/* The trampoline which handed the call to the interpreter. */
+	if (c->elem.type != STACK_TRACE_ELEM_TYPE_TRAMPOLINE)
+		return;
+
+	cu = stack_trace_elem_get_cu(&c->elem);
+	if (cu && cu->method == interp_method)
+		c->has_elem = stack_trace_elem_next_java(&c->elem) == 0;
+}
+
+static void init_java_stack_cursor(struct java_stack_cursor *c)
+{
+	init_stack_trace_elem_current(&c->elem);
+
+	c->has_elem = stack_trace_elem_next_java(&c->elem) == 0;
+	c->iframe = interp_current_frame();
+}
+
+/*
+ * Makes @c point to the nearest method which does not belong to @class or
+ * its subclasses. Returns -1 on error.
+ */
+static int java_stack_cursor_skip_class(struct java_stack_cursor *c,
+					struct vm_class *class)
+{
+	while (!java_stack_cursor_is_done(c)) {
+		struct vm_method *vmm = java_stack_cursor_method(c);
+
+		if (!vmm)
+			return -1;
+
+		if (!vm_class_is_assignable_from(class, vmm->class))
+			break;
+
+		java_stack_cursor_next(c);
+	}
+
+	return 0;
+}
+
+/*
+ * Stores the stack trace from @c on into @array, or just counts the
+ * elements when @array is NULL. Methods inlined into compiled code have no
+ * frames of their own but show in stack traces. Returns the number of
+ * elements or -1 on error.
+ */
+static int fill_intermediate_stack_trace(struct java_stack_cursor c,
+					 struct vm_object *array)
+{
+	struct compilation_unit *cu;
+	int i = 0;
+
+	for (; !java_stack_cursor_is_done(&c); java_stack_cursor_next(&c)) {
+		unsigned long bc_offset;
+
+		if (java_stack_cursor_is_interp(&c)) {
+			if (array) {
+				array_set_field_ptr(array, 2 * i, c.iframe->method);
+				array_set_field_ptr(array, 2 * i + 1, (void *) c.iframe->pc);
+			}
+			i++;
+			continue;
+		}
+
+		cu = stack_trace_elem_get_cu(&c.elem);
+		if (!cu) {
+			fprintf(stderr,
+				"%s: no compilation unit mapping for %p\n",
+				__func__, (void*)c.elem.addr);
+			return -1;
+		}
+
+		bc_offset = stack_trace_elem_bc_offset(&c.elem, cu);
+
+		while (bc_offset_is_inlined(bc_offset)) {
+			if (array) {
+				array_set_field_ptr(array, 2 * i,
+						    bc_offset_method(cu, bc_offset));
+				array_set_field_ptr(array, 2 * i + 1,
+						    (void *) bc_offset_pc(bc_offset));
+			}
+			i++;
+
+			bc_offset = bc_offset_caller(cu, bc_offset);
+		}
+
+		if (array) {
+			array_set_field_ptr(array, 2 * i, cu->method);
+			array_set_field_ptr(array, 2 * i + 1, (void*)bc_offset);
+		}
+		i++;
+	}
+
+	return i;
+}
+
 /**
  * get_intermediate_stack_trace - returns an array with intermediate
  *   java stack trace. Each stack trace element is described by two
@@ -377,52 +545,28 @@ int get_java_stack_trace_depth(struct stack_trace_elem *elem)
  */
 static struct vm_object *get_intermediate_stack_trace(void)
 {
-	struct stack_trace_elem st_elem;
-	struct compilation_unit *cu;
+	struct java_stack_cursor cursor;
 	struct vm_object *array;
 	int depth;
-	int i;
-
-	init_stack_trace_elem_current(&st_elem);
 
-	if (stack_trace_elem_next_java(&st_elem))
-		return NULL;
+	init_java_stack_cursor(&cursor);
 
-	if (skip_frames_from_class(&st_elem, vm_java_lang_VMThrowable))
+	if (java_stack_cursor_skip_class(&cursor, vm_java_lang_VMThrowable))
 		return NULL;
 
-	if (skip_frames_from_class(&st_elem, vm_java_lang_Throwable))
+	if (java_stack_cursor_skip_class(&cursor, vm_java_lang_Throwable))
 		return NULL;
 
-	depth = get_java_stack_trace_depth(&st_elem);
-	if (depth == 0)
+	depth = fill_intermediate_stack_trace(cursor, NULL);
+	if (depth <= 0)
 		return NULL;
 
 	array = vm_object_alloc_primitive_array(J_NATIVE_PTR, depth * 2);
 	if (!array)
 		return NULL;
 
-	i = 0;
-	do {
-		unsigned long bc_offset;
-
-		cu = stack_trace_elem_get_cu(&st_elem);
-		if (!cu) {
-			fprintf(stderr,
-				"%s: no compilation unit mapping for %p\n",
-				__func__, (void*)st_elem.addr);
-			return NULL;
-		}
-
-		if (vm_method_is_native(cu->method))
-			bc_offset = BC_OFFSET_UNKNOWN;
-		else
-			bc_offset = jit_lookup_bc_offset(cu,
-						(unsigned char*)st_elem.addr);
-
-		array_set_field_ptr(array, i++, cu->method);
-		array_set_field_ptr(array, i++, (void*)bc_offset);
-	} while (stack_trace_elem_next_java(&st_elem) == 0);
+	if (fill_intermediate_stack_trace(cursor, array) != depth)
+		return NULL;
 
 	return array;
 }
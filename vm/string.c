@@ -107,9 +107,8 @@ struct vm_object *vm_string_intern(struct vm_object *string)
 	pthread_rwlock_wrlock(&literals_rwlock);
 
 	/*
-	 * XXX: we should notify GC that we store a reference to
-	 * string here (both as a key and a value). It should be
-	 * marked as a weak reference.
+	 * XXX: interned strings are GC roots (see
+	 * vm_string_for_each_literal()). They should be weak references.
 	 */
 	intern = string;
 	if (hash_map_put(literals, string, intern))
@@ -119,3 +118,14 @@ struct vm_object *vm_string_intern(struct vm_object *string)
 
 	return intern;
 }
+
+/*
+ * Calls @fn for every interned string. The world must be stopped.
+ */
+void vm_string_for_each_literal(void (*fn)(struct vm_object *))
+{
+	struct hash_map_entry *this;
+
+	hash_map_for_each_entry(this, literals)
+		fn(this->value);
+}
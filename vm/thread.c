@@ -65,8 +65,10 @@ static void vm_thread_free(struct vm_thread *thread)
 
 static struct vm_thread *vm_thread_alloc(void)
 {
-	struct vm_thread *thread = malloc(sizeof(struct vm_thread));
-	if (!thread)
+	struct vm_thread *thread;
+
+	/* The low bits of the address are used in object lock words. */
+	if (posix_memalign((void **) &thread, VM_LOCK_OWNER_ALIGN, sizeof(struct vm_thread)))
 		return NULL;
 
 	if (pthread_mutex_init(&thread->mutex, NULL)) {
@@ -80,11 +82,34 @@ static struct vm_thread *vm_thread_alloc(void)
 	thread->posix_id = -1;
 	thread->interrupted = false;
 	thread->wait_mon = NULL;
-	thread->thread_state = THREAD_STATE_CONSISTENT;
+	INIT_LIST_HEAD(&thread->wait_node);
+	thread->wait_futex = 0;
+	thread->wait_notified = false;
+	thread->stack_top = NULL;
+	thread->gc_stack_ptr = NULL;
+	thread->gc_exception = NULL;
+	thread->tlab = NULL;
 
 	return thread;
 }
 
+static void vm_thread_init_stack(struct vm_thread *thread)
+{
+	pthread_attr_t attr;
+	size_t stack_size;
+	void *stack_addr;
+
+	if (pthread_getattr_np(pthread_self(), &attr) != 0)
+		die("pthread_getattr_np");
+
+	if (pthread_attr_getstack(&attr, &stack_addr, &stack_size) != 0)
+		die("pthread_attr_getstack");
+
+	pthread_attr_destroy(&attr);
+
+	thread->stack_top = stack_addr + stack_size;
+}
+
 /**
  * Returns instance of java.lang.Thread associated with given thread.
  */
@@ -152,6 +177,8 @@ int init_threading(void)
 	if (!main_thread_group)
 		return -ENOMEM;
 
+	gc_register_root(&main_thread_group);
+
 	vm_call_method(vm_java_lang_ThreadGroup_init, main_thread_group);
 	if (exception_occurred())
 		return -1;
@@ -179,7 +206,10 @@ int init_threading(void)
 	main_thread->vmthread = vmthread;
 	main_thread->posix_id = pthread_self();
 
+	vm_thread_init_stack(main_thread);
+
 	vm_get_exec_env()->thread = main_thread;
+	gc_attach_thread();
 
 	field_set_int(thread, vm_java_lang_Thread_priority, 5);
 	field_set_int(thread, vm_java_lang_Thread_daemon, 0);
@@ -212,7 +242,10 @@ static void *vm_thread_entry(void *arg)
 {
 	struct vm_thread *thread = arg;
 
+	vm_thread_init_stack(thread);
+
 	vm_get_exec_env()->thread = thread;
+	gc_attach_thread();
 
 	setup_signal_handlers();
 	thread_init_exceptions();
@@ -222,6 +255,8 @@ static void *vm_thread_entry(void *arg)
 	if (exception_occurred())
 		vm_print_exception(exception_occurred());
 
+	gc_detach_thread();
+
 	pthread_mutex_lock(&threads_mutex);
 	while (thread_count_locked)
 		pthread_cond_wait(&thread_count_lock_cond, &threads_mutex);
@@ -232,6 +267,102 @@ static void *vm_thread_entry(void *arg)
 	return NULL;
 }
 
+struct system_thread {
+	struct vm_thread	*thread;
+	void			*(*start_routine)(void *);
+	void			*arg;
+};
+
+static void *vm_system_thread_entry(void *arg)
+{
+	struct system_thread st = *(struct system_thread *) arg;
+
+	free(arg);
+
+	vm_thread_init_stack(st.thread);
+
+	vm_get_exec_env()->thread = st.thread;
+	gc_attach_thread();
+
+	setup_signal_handlers();
+	thread_init_exceptions();
+
+	return st.start_routine(st.arg);
+}
+
+/**
+ * Starts a daemon thread that runs the C function @start_routine for the
+ * VM itself. The thread has a java.lang.Thread so that it can run Java code
+ * and it stops at safepoints like any other thread, but it is not added to
+ * a thread group.
+ */
+int vm_thread_start_system(const char *name, void *(*start_routine)(void *), void *arg)
+{
+	struct vm_object *jthread, *vmthread, *thread_name;
+	struct system_thread *st;
+	struct vm_thread *thread;
+
+	jthread = vm_object_alloc(vm_java_lang_Thread);
+	if (!jthread)
+		return -ENOMEM;
+
+	thread_name = vm_object_alloc_string_from_c(name);
+	if (!thread_name)
+		return -ENOMEM;
+
+	vmthread = vm_object_alloc(vm_java_lang_VMThread);
+	if (!vmthread)
+		return -ENOMEM;
+
+	st = malloc(sizeof(*st));
+	if (!st)
+		return -ENOMEM;
+
+	thread = vm_thread_alloc();
+	if (!thread) {
+		free(st);
+		return -ENOMEM;
+	}
+
+	field_set_int(jthread, vm_java_lang_Thread_priority, 5);
+	field_set_int(jthread, vm_java_lang_Thread_daemon, 1);
+	field_set_object(jthread, vm_java_lang_Thread_name, thread_name);
+	field_set_object(jthread, vm_java_lang_Thread_group, main_thread_group);
+	field_set_object(jthread, vm_java_lang_Thread_vmThread, vmthread);
+
+	field_set_object(jthread,
+		vm_java_lang_Thread_contextClassLoader, NULL);
+	field_set_int(jthread,
+		vm_java_lang_Thread_contextClassLoaderIsSystemClassLoader, 1);
+
+	field_set_object(vmthread, vm_java_lang_VMThread_thread, jthread);
+	field_set_object(vmthread, vm_java_lang_VMThread_vmdata,
+			 (struct vm_object *) thread);
+
+	thread->vmthread = vmthread;
+	thread->state = VM_THREAD_STATE_RUNNABLE;
+
+	st->thread		= thread;
+	st->start_routine	= start_routine;
+	st->arg			= arg;
+
+	pthread_mutex_lock(&threads_mutex);
+	while (thread_count_locked)
+		pthread_cond_wait(&thread_count_lock_cond, &threads_mutex);
+
+	vm_thread_attach_thread(thread);
+
+	if (pthread_create(&thread->posix_id, NULL, &vm_system_thread_entry, st)) {
+		vm_thread_detach_thread(thread);
+		pthread_mutex_unlock(&threads_mutex);
+		free(st);
+		return -1;
+	}
+
+	pthread_mutex_unlock(&threads_mutex);
+	return 0;
+}
+
 /**
  * Creates new native thread representing a java thread.
  */
@@ -328,15 +459,11 @@ void vm_thread_interrupt(struct vm_thread *thread)
 		return;
 
 	/*
-	 * We should wait until thread actually enters a conditional
-	 * wait so that the signal will not be lost. This can
-	 * spuriously wake threads after @thread has left the wait()
-	 * operation but it is fine with the JVM spec.
+	 * The waiter resets its futex word before publishing @wait_mon so
+	 * the wakeup can not be lost. This can spuriously wake @thread after
+	 * it has left the wait() operation but it is fine with the JVM spec.
 	 */
-	while (pthread_mutex_trylock(&mon->mutex))
-		sched_yield();
-	pthread_cond_broadcast(&mon->cond);
-	pthread_mutex_unlock(&mon->mutex);
+	vm_monitor_wake_waiter(thread);
 }
 
 void vm_lock_thread_count(void)